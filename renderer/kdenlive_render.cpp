@@ -18,17 +18,72 @@
  ***************************************************************************/
 
 #include "../src/lib/localeHandling.h"
+#include "../src/lib/renderprogress.h"
 #include "mlt++/Mlt.h"
+#include "queuerenderjob.h"
+#include "queueworker.h"
 #include "renderjob.h"
+#include "segmentrenderjob.h"
+#include "twopassrenderjob.h"
 #include <QApplication>
 #include <QDir>
 #include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMap>
+#include <QTimer>
+#include <atomic>
+
+namespace {
+/** @brief Frame counters of a timeline preview chunk, updated from the consumer threads */
+struct ChunkStats
+{
+    RenderProgress::Log *log;
+    int frame;
+    std::atomic<int> rendered{0};
+    std::atomic<int> encoded{0};
+    QElapsedTimer timer;
+    qint64 lastReport{0};
+};
+
+void chunk_frame_render(mlt_consumer, ChunkStats *stats, mlt_frame)
+{
+    stats->rendered++;
+}
+
+void chunk_frame_show(mlt_consumer, ChunkStats *stats, mlt_frame)
+{
+    int encoded = ++stats->encoded;
+    qint64 elapsed = stats->timer.elapsed();
+    if (elapsed - stats->lastReport < 500) {
+        return;
+    }
+    stats->lastReport = elapsed;
+    RenderProgress::Record record;
+    record.frame = stats->frame + encoded - 1;
+    record.frames = encoded;
+    record.fps = 1000. * encoded / qMax(qint64(1), elapsed);
+    record.queue = qMax(0, stats->rendered - encoded);
+    stats->log->write(record);
+}
+} // namespace
 
 int main(int argc, char **argv)
 {
     QApplication app(argc, argv);
     QStringList args = app.arguments();
     QStringList preargs;
+    if (args.count() == 3 && args.at(1).startsWith(QLatin1String("-worker:"))) {
+        // Render the chunks of a shared render queue
+        auto *worker = new QueueWorker(args.at(2), args.at(1).mid(8), qApp);
+        if (!worker->prepare()) {
+            fprintf(stderr, "No render queue in %s\n", qPrintable(args.at(1).mid(8)));
+            return 1;
+        }
+        QObject::connect(worker, &QueueWorker::renderingFinished, &app, &QCoreApplication::quit);
+        QTimer::singleShot(0, worker, &QueueWorker::start);
+        return app.exec();
+    }
     if (args.count() >= 4) {
         // Remove program name
         args.removeFirst();
@@ -47,6 +102,51 @@ int main(int argc, char **argv)
             pid = args.at(0).section(QLatin1Char(':'), 1).toInt();
             args.removeFirst();
         }
+        // Second pass playlist of a two pass encoding, encoded from a lossless intermediate
+        QString secondPass;
+        if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-pass2:"))) {
+            secondPass = args.takeFirst().mid(7);
+        }
+        // Render in parallel segments, joined with ffmpeg
+        int segments = 0;
+        QString ffmpeg;
+        if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-segments:"))) {
+            segments = args.at(0).section(QLatin1Char(':'), 1).toInt();
+            args.removeFirst();
+            if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-ffmpeg:"))) {
+                ffmpeg = args.at(0).mid(8);
+                args.removeFirst();
+            }
+        }
+        // Render through a shared work queue, its chunks are pulled by local workers and by workers started on the queue folder
+        QString queueFolder;
+        int queueWorkers = 0;
+        if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-queue:"))) {
+            queueFolder = args.takeFirst().mid(7);
+            if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-workers:"))) {
+                queueWorkers = args.takeFirst().section(QLatin1Char(':'), 1).toInt();
+            }
+            if (args.count() > 0 && args.at(0).startsWith(QLatin1String("-ffmpeg:"))) {
+                ffmpeg = args.takeFirst().mid(8);
+            }
+        }
+        // Timeline preview chunks that can be copied instead of rendered
+        QMap<int, QString> reusedChunks;
+        int reusedChunkSize = 0;
+        if (args.count() > 3 && args.at(0) == QLatin1String("-reuse")) {
+            args.removeFirst();
+            QDir chunkFolder(args.takeFirst());
+            reusedChunkSize = args.takeFirst().toInt();
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+            const QStringList frames = args.takeFirst().split(QLatin1Char(','), QString::SkipEmptyParts);
+#else
+            const QStringList frames = args.takeFirst().split(QLatin1Char(','), Qt::SkipEmptyParts);
+#endif
+            const QString extension = QFileInfo(target).suffix();
+            for (const QString &frame : frames) {
+                reusedChunks.insert(frame.toInt(), chunkFolder.absoluteFilePath(QStringLiteral("%1.%2").arg(frame, extension)));
+            }
+        }
         // Do we want a split render
         if (args.count() > 0 && args.at(0) == QLatin1String("-split")) {
             args.removeFirst();
@@ -89,14 +189,22 @@ int main(int argc, char **argv)
             }
             const char *localename = prod.get_lcnumeric();
             QLocale::setDefault(QLocale(localename));
+            // Progress is written on stdout, stderr only gets the MLT messages
+            RenderProgress::Log progressLog(QString(), true);
             for (const QString &frame : qAsConst(chunks)) {
-                fprintf(stderr, "START:%d \n", frame.toInt());
+                RenderProgress::Record record;
+                record.event = RenderProgress::Event::ChunkStarted;
+                record.frame = frame.toInt();
+                progressLog.write(record);
+                record.event = RenderProgress::Event::ChunkDone;
                 QString fileName = QStringLiteral("%1.%2").arg(frame,extension);
                 if (baseFolder.exists(fileName)) {
                     // Don't overwrite an existing file
-                    fprintf(stderr, "DONE:%d \n", frame.toInt());
+                    progressLog.write(record);
                     continue;
                 }
+                QElapsedTimer stageTimer;
+                stageTimer.start();
                 QScopedPointer<Mlt::Producer> playlst(prod.cut(frame.toInt(), frame.toInt() + chunkSize));
                 QScopedPointer<Mlt::Consumer> cons(
                     new Mlt::Consumer(profile, QString("avformat:%1").arg(baseFolder.absoluteFilePath(fileName)).toUtf8().constData()));
@@ -107,43 +215,117 @@ int main(int argc, char **argv)
                 }
                 if (!cons->is_valid()) {
                     fprintf(stderr, " = =  = INVALID CONSUMER\n\n");
+                    record.event = RenderProgress::Event::Failed;
+                    record.message = QStringLiteral("Invalid consumer");
+                    progressLog.write(record);
                     return 1;
                 }
                 cons->set("terminate_on_pause", 1);
                 cons->connect(*playlst);
                 playlst.reset();
+                ChunkStats stats;
+                stats.log = &progressLog;
+                stats.frame = frame.toInt();
+                QScopedPointer<Mlt::Event> renderEvent(cons->listen("consumer-frame-render", &stats, (mlt_listener)chunk_frame_render));
+                QScopedPointer<Mlt::Event> showEvent(cons->listen("consumer-frame-show", &stats, (mlt_listener)chunk_frame_show));
+                record.stages.insert(QStringLiteral("load"), stageTimer.restart());
+                stats.timer.start();
                 cons->run();
+                record.stages.insert(QStringLiteral("encode"), stageTimer.restart());
                 cons->stop();
                 cons->purge();
-                fprintf(stderr, "DONE:%d \n", frame.toInt());
+                renderEvent.reset();
+                showEvent.reset();
+                record.stages.insert(QStringLiteral("close"), stageTimer.elapsed());
+                record.frames = stats.encoded;
+                record.fps = 1000. * record.frames / qMax(qint64(1), record.stages.value(QStringLiteral("encode")));
+                progressLog.write(record);
             }
             // Mlt::Factory::close();
-            fprintf(stderr, "+ + + RENDERING FINSHED + + + \n");
+            RenderProgress::Record done;
+            done.event = RenderProgress::Event::Finished;
+            progressLog.write(done);
             return 0;
         }
+        if (!queueFolder.isEmpty()) {
+            auto *qJob = new QueueRenderJob(render, playlist, target, ffmpeg, queueFolder, queueWorkers, pid, qApp);
+            if (qJob->prepare()) {
+                QObject::connect(qJob, &QueueRenderJob::renderingFinished, [&, qJob]() {
+                    qJob->deleteLater();
+                    app.quit();
+                });
+                QTimer::singleShot(0, qJob, &QueueRenderJob::start);
+                return app.exec();
+            }
+            // Playlist cannot be split, render it in one process
+            delete qJob;
+        }
+        if (segments > 1 || !reusedChunks.isEmpty()) {
+            auto *sJob = new SegmentRenderJob(render, playlist, target, ffmpeg, segments, pid, qApp);
+            sJob->setReusableChunks(reusedChunks, reusedChunkSize);
+            if (sJob->prepare()) {
+                QObject::connect(sJob, &SegmentRenderJob::renderingFinished, [&, sJob]() {
+                    sJob->deleteLater();
+                    app.quit();
+                });
+                QTimer::singleShot(0, sJob, &SegmentRenderJob::start);
+                return app.exec();
+            }
+            // Playlist cannot be split, render it in one process
+            delete sJob;
+        }
+        if (!secondPass.isEmpty()) {
+            auto *tJob = new TwoPassRenderJob(render, playlist, secondPass, target, pid, qApp);
+            if (tJob->prepare()) {
+                QObject::connect(tJob, &TwoPassRenderJob::renderingFinished, [&, tJob]() {
+                    tJob->deleteLater();
+                    app.quit();
+                });
+                QTimer::singleShot(0, tJob, &TwoPassRenderJob::start);
+                return app.exec();
+            }
+            // The passes cannot be encoded from an intermediate, render them one after the other
+            delete tJob;
+        }
         int in = -1;
         int out = -1;
 
         // older MLT version, does not support embedded consumer in/out in xml, and current 
         // MLT (6.16) does not pass it onto the multi / movit consumer, so read it manually and enforce
-        QFile f(playlist);
-        QDomDocument doc;
-        doc.setContent(&f, false);
-        f.close();
-        QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
-        if (!consumer.isNull()) {
-            if (consumer.hasAttribute(QLatin1String("s")) || consumer.hasAttribute(QLatin1String("r"))) {
-                // Workaround MLT embedded consumer resize (MLT issue #453)
-                playlist.prepend(QStringLiteral("xml:"));
-                playlist.append(QStringLiteral("?multi=1"));
+        auto createJob = [&](QString scenelist) {
+            QFile f(scenelist);
+            QDomDocument doc;
+            doc.setContent(&f, false);
+            f.close();
+            QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+            if (!consumer.isNull()) {
+                if (consumer.hasAttribute(QLatin1String("s")) || consumer.hasAttribute(QLatin1String("r"))) {
+                    // Workaround MLT embedded consumer resize (MLT issue #453)
+                    scenelist.prepend(QStringLiteral("xml:"));
+                    scenelist.append(QStringLiteral("?multi=1"));
+                }
             }
-        }
+            return new RenderJob(render, scenelist, target, pid, in, out, qApp);
+        };
 
-        auto *rJob = new RenderJob(render, playlist, target, pid, in, out, qApp);
+        auto *rJob = createJob(playlist);
+        if (!secondPass.isEmpty()) {
+            rJob->setDualPass(true);
+        }
         rJob->start();
         QObject::connect(rJob, &RenderJob::renderingFinished, [&, rJob]() {
             rJob->deleteLater();
-            app.quit();
+            if (secondPass.isEmpty()) {
+                app.quit();
+                return;
+            }
+            auto *pass2Job = createJob(secondPass);
+            secondPass.clear();
+            QObject::connect(pass2Job, &RenderJob::renderingFinished, [&, pass2Job]() {
+                pass2Job->deleteLater();
+                app.quit();
+            });
+            pass2Job->start();
         }); 
         return app.exec();
     } else {
@@ -153,6 +335,11 @@ int main(int argc, char **argv)
                 "[arg2] ...]\n"
                 "  -erase: if that parameter is present, src file will be erased at the end\n"
                 "  -kuiserver: if that parameter is present, use KDE job tracker\n"
+                "  -pass2:PLAYLIST : encode src and PLAYLIST, the two passes of an encoding, from a lossless render of the timeline\n"
+                "  -segments:N -ffmpeg:PATH : render in N parallel segments, joined with the ffmpeg binary at PATH\n"
+                "  -queue:FOLDER -workers:N -ffmpeg:PATH : render in chunks through a work queue in FOLDER, pulled by N local workers\n"
+                "  -worker:FOLDER RENDER : (only argument) render chunks of the queue in FOLDER with the melt binary RENDER, to help a -queue render\n"
+                "  -reuse FOLDER SIZE FRAMES : with -segments, copy the SIZE frames long chunks starting at the comma separated FRAMES from FOLDER\n"
                 "  -locale:LOCALE : set a locale for rendering. For example, -locale:fr_FR.UTF-8 will use a french locale (comma as numeric separator)\n"
                 "  in=pos: start rendering at frame pos\n"
                 "  out=pos: end rendering at frame pos\n"
@@ -162,7 +349,8 @@ int main(int argc, char **argv)
                 "  player: path to video player to play when rendering is over, use '-' to disable playing\n"
                 "  src: source file (usually MLT XML)\n"
                 "  dest: destination file\n"
-                "  args: space separated libavformat arguments\n");
+                "  args: space separated libavformat arguments\n"
+                "Progress is written on standard output, one JSON object per line. A timing log of each render is kept in the renderlogs cache folder.\n");
         return 1;
     }
 }
@@ -0,0 +1,388 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "queuerenderjob.h"
+#include "queueworker.h"
+#include "renderjob.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDomDocument>
+#include <QFileInfo>
+#include <QtDBus>
+#include <algorithm>
+
+namespace {
+// Chunks per local worker, faster workers render more chunks and a failed chunk is quicker to render again
+const int chunksPerWorker = 4;
+// Milliseconds between two checks of the queue
+const int pollInterval = 1000;
+// Seconds without any chunk rendering before the render fails, when no worker joins the queue
+const int idleTimeout = 300;
+} // namespace
+
+QueueRenderJob::QueueRenderJob(const QString &render, const QString &scenelist, const QString &target, const QString &ffmpeg, const QString &folder,
+                               int workers, int pid, QObject *parent)
+    : QObject(parent)
+    , m_prog(render)
+    , m_scenelist(scenelist)
+    , m_dest(target)
+    , m_ffmpeg(ffmpeg)
+    , m_queue(folder)
+    , m_workerCount(qMax(0, workers))
+    , m_pid(pid)
+    , m_erase(scenelist.startsWith(QDir::tempPath()))
+    , m_logfile(target + QStringLiteral(".log"))
+    , m_progressLog(target, true)
+{
+    if (!m_logfile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Unable to log to " << m_logfile.fileName();
+    } else {
+        m_logstream.setDevice(&m_logfile);
+    }
+    m_pollTimer.setInterval(pollInterval);
+    connect(&m_pollTimer, &QTimer::timeout, this, &QueueRenderJob::poll);
+}
+
+QueueRenderJob::~QueueRenderJob()
+{
+    stopWorkers();
+    qDeleteAll(m_workers);
+    delete m_audioProcess;
+    delete m_concatProcess;
+    m_logfile.close();
+}
+
+bool QueueRenderJob::prepare()
+{
+    if (m_ffmpeg.isEmpty()) {
+        return false;
+    }
+    QFile f(m_scenelist);
+    QDomDocument doc;
+    if (!f.open(QIODevice::ReadOnly) || !doc.setContent(&f, false)) {
+        return false;
+    }
+    f.close();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    const QString extension = QFileInfo(m_dest).suffix();
+    if (!RenderSegments::canSplit(consumer) || extension.isEmpty()) {
+        return false;
+    }
+    m_in = consumer.attribute(QStringLiteral("in")).toInt();
+    int out = consumer.attribute(QStringLiteral("out")).toInt();
+    m_length = out - m_in + 1;
+    QDir folder(m_queue.folder());
+    if (folder.exists(QStringLiteral("queue.json"))) {
+        // Left by a previous render of the same file
+        folder.removeRecursively();
+    }
+    auto segments = RenderSegments::split(m_in, out, qMax(2, m_workerCount * chunksPerWorker), RenderSegments::gopSize(consumer));
+    if (segments.size() < 2) {
+        return false;
+    }
+    QDomDocument video = doc.cloneNode(true).toDocument();
+    video.documentElement().firstChildElement(QStringLiteral("consumer")).setAttribute(QStringLiteral("an"), 1);
+    if (!m_queue.create(video, segments, extension)) {
+        return false;
+    }
+    if (consumer.attribute(QStringLiteral("an")).toInt() != 1) {
+        // Audio is encoded in one piece, encoder delay and frame padding would otherwise produce gaps at each boundary
+        consumer.setAttribute(QStringLiteral("vn"), 1);
+        m_audioFile = folder.absoluteFilePath(QStringLiteral("audio.") + extension);
+        consumer.setAttribute(QStringLiteral("target"), m_audioFile);
+        m_audioPlaylist = folder.absoluteFilePath(QStringLiteral("audio.mlt"));
+        QFile file(m_audioPlaylist);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return false;
+        }
+        file.write(doc.toString().toUtf8());
+        file.close();
+        if (consumer.hasAttribute(QLatin1String("s")) || consumer.hasAttribute(QLatin1String("r"))) {
+            // Workaround MLT embedded consumer resize (MLT issue #453), see kdenlive_render
+            m_audioPlaylist = QStringLiteral("xml:%1?multi=1").arg(m_audioPlaylist);
+        }
+        m_audioDone = false;
+    }
+    return true;
+}
+
+void QueueRenderJob::start()
+{
+    m_kdenliveinterface = RenderJob::kdenliveInterface(m_pid, this);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, 0, m_in});
+        connect(m_kdenliveinterface, SIGNAL(abortRenderJob(QString)), this, SLOT(slotAbort(QString)));
+        connect(m_kdenliveinterface, SIGNAL(pauseRenderJob(QString,bool)), this, SLOT(slotPause(QString,bool)));
+    }
+    m_logstream << "Timing log: " << m_progressLog.fileName() << "\n";
+    m_logstream << "Render queue: " << m_queue.folder() << ", " << m_queue.count() << " chunks\n";
+    m_logstream << "Other workers can join with: kdenlive_render -worker:" << m_queue.folder() << ' ' << m_prog << "\n";
+    if (m_workerCount == 0) {
+        m_logstream << "No local worker, the render fails if no other worker joins within " << idleTimeout << " seconds\n";
+    }
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = m_dest;
+    m_progressLog.write(record);
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    if (!m_audioDone) {
+        m_audioProcess = new QProcess;
+        connect(m_audioProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+                [this](int exitCode, QProcess::ExitStatus status) {
+                    if (status == QProcess::CrashExit || exitCode != 0 || !QFile::exists(m_audioFile)) {
+                        setFailed(QString::fromLocal8Bit(m_audioProcess->readAllStandardError()));
+                        return;
+                    }
+                    m_stages.insert(QStringLiteral("audio"), m_progressLog.elapsed());
+                    m_audioDone = true;
+                });
+        m_audioProcess->start(m_prog, {QStringLiteral("-progress"), m_audioPlaylist});
+    }
+    for (int i = 0; i < m_workerCount; ++i) {
+        auto *worker = new QProcess;
+        worker->setStandardOutputFile(QProcess::nullDevice());
+        worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->start(QCoreApplication::applicationFilePath(), {QStringLiteral("-worker:%1").arg(m_queue.folder()), m_prog});
+        m_workers << worker;
+    }
+    m_logstream.flush();
+    m_idleTimer.start();
+    m_pollTimer.start();
+}
+
+void QueueRenderJob::poll()
+{
+    if (m_finished || m_concatProcess) {
+        return;
+    }
+    // Workers also do this, but there may be none left
+    m_queue.requeueStale(QueueWorker::staleTimeout);
+    const QVector<RenderQueue::Chunk> failed = m_queue.chunks(RenderQueue::Failed);
+    if (!failed.isEmpty()) {
+        const RenderQueue::Chunk &chunk = failed.constFirst();
+        setFailed(tr("Frames %1 to %2 could not be rendered after %3 attempts:\n%4").arg(chunk.in).arg(chunk.out).arg(chunk.attempts).arg(chunk.error));
+        return;
+    }
+    int done = 0;
+    for (const RenderQueue::Chunk &chunk : m_queue.chunks(RenderQueue::Done)) {
+        done += chunk.length();
+    }
+    const QVector<RenderQueue::Chunk> running = m_queue.chunks(RenderQueue::Running);
+    for (const RenderQueue::Chunk &chunk : running) {
+        done += chunk.done;
+    }
+    if (!running.isEmpty() || m_queue.isFinished()) {
+        m_idleTimer.restart();
+    } else if (m_idleTimer.elapsed() > idleTimeout * 1000LL) {
+        // Local workers all crashed, or none was started and no other worker joined
+        setFailed(tr("No worker rendered the queue for %1 seconds. Start a worker with:\nkdenlive_render -worker:%2 %3")
+                      .arg(idleTimeout)
+                      .arg(m_queue.folder(), m_prog));
+        return;
+    }
+    // The last percent is reached when the chunks are joined
+    int progress = qMin(99, int(100LL * done / qMax(1, m_length)));
+    if (progress > m_progress) {
+        m_progress = progress;
+        RenderProgress::Record record;
+        record.frame = m_in + done;
+        record.frames = done;
+        record.percent = m_progress;
+        record.fps = 1000. * done / qMax(qint64(1), m_progressLog.elapsed());
+        m_progressLog.write(record);
+        if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
+            m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, m_progress, m_in + done});
+        }
+    }
+    if (m_audioDone && m_queue.isFinished()) {
+        m_pollTimer.stop();
+        reportChunks();
+        concatenate();
+    }
+}
+
+void QueueRenderJob::reportChunks()
+{
+    const QVector<RenderQueue::Chunk> chunks = m_queue.chunks(RenderQueue::Done);
+    if (chunks.isEmpty()) {
+        return;
+    }
+    QVector<double> speeds;
+    for (const RenderQueue::Chunk &chunk : chunks) {
+        speeds << chunk.fps;
+    }
+    std::sort(speeds.begin(), speeds.end());
+    const double median = speeds.at(speeds.size() / 2);
+    for (const RenderQueue::Chunk &chunk : chunks) {
+        const QString name = QStringLiteral("chunk-%1").arg(chunk.index, 4, 10, QLatin1Char('0'));
+        m_stages.insert(name, chunk.elapsed);
+        RenderProgress::Record record;
+        record.event = RenderProgress::Event::ChunkDone;
+        record.frame = chunk.in;
+        record.frames = chunk.length();
+        record.fps = chunk.fps;
+        record.stages.insert(QStringLiteral("encode"), chunk.elapsed);
+        record.message = chunk.worker;
+        m_progressLog.write(record);
+        m_logstream << "Frames " << chunk.in << " to " << chunk.out << " rendered by " << chunk.worker << " in " << chunk.elapsed << " ms ("
+                    << QString::number(chunk.fps, 'f', 1) << " fps)";
+        if (chunk.attempts > 0) {
+            m_logstream << ", " << chunk.attempts << " failed attempts";
+        }
+        if (chunk.fps < median / 2) {
+            m_logstream << ", slow";
+        }
+        m_logstream << "\n";
+    }
+    m_logstream.flush();
+}
+
+void QueueRenderJob::concatenate()
+{
+    QStringList files;
+    for (int i = 0; i < m_queue.count(); ++i) {
+        files << m_queue.chunkFile(i);
+    }
+    const QString listFile = QDir(m_queue.folder()).absoluteFilePath(QStringLiteral("chunks.txt"));
+    if (!RenderSegments::writeConcatList(listFile, files)) {
+        setFailed(tr("Cannot write to %1, check permissions.").arg(listFile));
+        return;
+    }
+    const QStringList args = RenderSegments::concatArguments(listFile, m_audioFile, m_dest);
+    m_logstream << "Joining chunks: " << m_ffmpeg << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    m_logstream.flush();
+    m_concatStart = m_progressLog.elapsed();
+    m_concatProcess = new QProcess;
+    connect(m_concatProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus status) {
+                if (status == QProcess::CrashExit || exitCode != 0) {
+                    setFailed(QString::fromLocal8Bit(m_concatProcess->readAllStandardError()));
+                } else {
+                    m_stages.insert(QStringLiteral("concat"), m_progressLog.elapsed() - m_concatStart);
+                    setFinished(-1);
+                }
+            });
+    connect(m_concatProcess, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            setFailed(tr("Cannot start %1").arg(m_ffmpeg));
+        }
+    });
+    m_concatProcess->start(m_ffmpeg, args);
+}
+
+void QueueRenderJob::stopWorkers()
+{
+    m_finished = true;
+    m_pollTimer.stop();
+    // Workers on other computers stop when they see the cancelled queue
+    m_queue.cancel();
+    QVector<QProcess *> processes = m_workers;
+    processes << m_audioProcess << m_concatProcess;
+    for (QProcess *process : qAsConst(processes)) {
+        if (process && process->state() != QProcess::NotRunning) {
+            process->disconnect(this);
+            process->kill();
+            process->waitForFinished(1000);
+        }
+    }
+}
+
+void QueueRenderJob::slotAbort(const QString &url)
+{
+    if (m_dest == url) {
+        slotAbort();
+    }
+}
+
+void QueueRenderJob::slotAbort()
+{
+    qWarning() << "Job aborted by user...";
+    stopWorkers();
+    QFile(m_dest).remove();
+    m_logstream << "Job aborted by user" << "\n";
+    setFinished(-3);
+}
+
+void QueueRenderJob::slotPause(const QString &url, bool pause)
+{
+    if (m_dest != url) {
+        return;
+    }
+    // Only local processes are paused, their chunks go to other workers if the pause is longer than the heartbeat timeout
+    for (QProcess *worker : qAsConst(m_workers)) {
+        RenderJob::pauseProcess(worker, pause);
+    }
+    RenderJob::pauseProcess(m_audioProcess, pause);
+    RenderJob::pauseProcess(m_concatProcess, pause);
+    // Paused local workers send no heartbeat, do not release their chunks while paused or right after resuming
+    if (pause) {
+        m_pollTimer.stop();
+    } else if (!m_finished && !m_concatProcess) {
+        m_queue.resetStaleCheck();
+        m_idleTimer.restart();
+        m_pollTimer.start();
+    }
+    m_logstream << (pause ? "Job paused" : "Job resumed") << "\n";
+}
+
+void QueueRenderJob::setFailed(const QString &error)
+{
+    stopWorkers();
+    QString message = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+    m_logstream << message << "\n" << error << "\n";
+    m_logstream << "The render queue is kept in " << m_queue.folder() << "\n";
+    QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), message});
+    setFinished(-2, error);
+}
+
+void QueueRenderJob::setFinished(int status, const QString &error)
+{
+    if (!m_finished) {
+        stopWorkers();
+    }
+    RenderProgress::Record record;
+    record.event = status == -1 ? RenderProgress::Event::Finished : (status == -3 ? RenderProgress::Event::Aborted : RenderProgress::Event::Failed);
+    record.frames = status == -1 ? m_length : 0;
+    record.frame = m_in + record.frames;
+    record.percent = status == -1 ? 100 : m_progress;
+    record.fps = 1000. * record.frames / qMax(qint64(1), m_progressLog.elapsed());
+    record.stages = m_stages;
+    record.message = error;
+    m_progressLog.write(record);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), {m_dest, status, error});
+    }
+    if (m_erase) {
+        QFile(m_scenelist).remove();
+    }
+    if (status == -1) {
+        m_logfile.remove();
+    } else {
+        m_logstream.flush();
+    }
+    if (status != -2) {
+        // A failed queue is kept to find out which chunk failed
+        QDir(m_queue.folder()).removeRecursively();
+    }
+    emit renderingFinished();
+}
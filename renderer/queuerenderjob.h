@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef QUEUERENDERJOB_H
+#define QUEUERENDERJOB_H
+
+#include "../src/lib/renderprogress.h"
+#include "renderqueue.h"
+
+#include <QDBusInterface>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QObject>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+/**
+ * @class QueueRenderJob
+ * @brief Renders a playlist through a shared RenderQueue, so that workers in other processes, containers
+ * or computers sharing the queue folder can help with the render.
+ *
+ * The in/out range is split in more chunks than workers, so that faster workers take more chunks.
+ * The job starts local workers (kdenlive_render -worker:FOLDER MELT), any other worker started on the
+ * same folder pulls chunks from the queue too. Like for a SegmentRenderJob, the audio is rendered
+ * in one piece and the chunks are joined with ffmpeg without re-encoding. The render time, speed and
+ * worker of each chunk are written to the timing log, and chunks much slower than the others are
+ * listed in the render log.
+ */
+class QueueRenderJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    QueueRenderJob(const QString &render, const QString &scenelist, const QString &target, const QString &ffmpeg, const QString &folder, int workers,
+                   int pid = -1, QObject *parent = nullptr);
+    ~QueueRenderJob() override;
+    /** @brief Create the queue. Returns false if the playlist cannot be split, it must then be rendered by a RenderJob */
+    bool prepare();
+
+public slots:
+    void start();
+
+private slots:
+    void slotAbort();
+    void slotAbort(const QString &url);
+    void slotPause(const QString &url, bool pause);
+
+private:
+    QString m_prog;
+    QString m_scenelist;
+    QString m_dest;
+    QString m_ffmpeg;
+    RenderQueue m_queue;
+    int m_workerCount;
+    int m_pid;
+    int m_in{0};
+    int m_length{0};
+    int m_progress{0};
+    bool m_finished{false};
+    bool m_erase;
+    QString m_audioPlaylist;
+    QString m_audioFile;
+    QProcess *m_audioProcess{nullptr};
+    bool m_audioDone{true};
+    QVector<QProcess *> m_workers;
+    QProcess *m_concatProcess{nullptr};
+    QTimer m_pollTimer;
+    /** @brief Time since a chunk was last seen rendering */
+    QElapsedTimer m_idleTimer;
+    QDBusInterface *m_kdenliveinterface{nullptr};
+    /** @brief Used to create a temporary file for logging. */
+    QFile m_logfile;
+    QTextStream m_logstream;
+    /** @brief The progress records, kept in the timing log */
+    RenderProgress::Log m_progressLog;
+    QMap<QString, qint64> m_stages;
+    qint64 m_concatStart{0};
+
+    /** @brief Check the queue: release chunks of stopped workers, report progress and join the chunks once all are rendered */
+    void poll();
+    /** @brief Write the render time of each chunk to the logs */
+    void reportChunks();
+    void concatenate();
+    void stopWorkers();
+    void setFailed(const QString &error);
+    void setFinished(int status, const QString &error = QString());
+
+signals:
+    void renderingFinished();
+};
+
+#endif
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "queueworker.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSysInfo>
+
+namespace {
+// Milliseconds between two heartbeats while rendering
+const int heartbeatInterval = 5000;
+// Milliseconds between two checks of the queue while the last chunks are rendered by other workers
+const int pollInterval = 2000;
+} // namespace
+
+const int QueueWorker::staleTimeout = 60;
+
+QueueWorker::QueueWorker(const QString &render, const QString &folder, QObject *parent)
+    : QObject(parent)
+    , m_prog(render)
+    , m_name(QStringLiteral("%1-%2").arg(QSysInfo::machineHostName()).arg(QCoreApplication::applicationPid()))
+    , m_queue(folder)
+    , m_progressLog(QString(), true)
+{
+    m_heartbeat.setInterval(heartbeatInterval);
+    connect(&m_heartbeat, &QTimer::timeout, this, &QueueWorker::sendHeartbeat);
+}
+
+QueueWorker::~QueueWorker()
+{
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+    delete m_process;
+}
+
+bool QueueWorker::prepare()
+{
+    return m_queue.load();
+}
+
+const QString &QueueWorker::name() const
+{
+    return m_name;
+}
+
+void QueueWorker::start()
+{
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = m_name;
+    m_progressLog.write(record);
+    nextChunk();
+}
+
+void QueueWorker::nextChunk()
+{
+    if (m_queue.isCancelled()) {
+        emit renderingFinished();
+        return;
+    }
+    m_queue.requeueStale(staleTimeout);
+    if (!m_queue.claim(m_name, m_chunk)) {
+        if (m_queue.isFinished()) {
+            RenderProgress::Record record;
+            record.event = RenderProgress::Event::Finished;
+            m_progressLog.write(record);
+            emit renderingFinished();
+            return;
+        }
+        // Other workers are rendering the last chunks, they come back to the queue if a worker stops responding
+        QTimer::singleShot(pollInterval, this, &QueueWorker::nextChunk);
+        return;
+    }
+    QFile source(m_queue.playlist());
+    QDomDocument doc;
+    if (!source.open(QIODevice::ReadOnly) || !doc.setContent(&source, false)) {
+        m_queue.release(m_chunk, tr("Cannot read %1").arg(m_queue.playlist()));
+        QTimer::singleShot(pollInterval, this, &QueueWorker::nextChunk);
+        return;
+    }
+    source.close();
+    const QString extension = QFileInfo(m_queue.chunkFile(m_chunk.index)).suffix();
+    m_file = m_queue.workFile(m_chunk, extension);
+    m_playlist = m_queue.workFile(m_chunk, QStringLiteral("mlt"));
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    consumer.setAttribute(QStringLiteral("in"), m_chunk.in);
+    consumer.setAttribute(QStringLiteral("out"), m_chunk.out);
+    consumer.setAttribute(QStringLiteral("target"), m_file);
+    QFile file(m_playlist);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_queue.release(m_chunk, tr("Cannot write to %1, check permissions.").arg(m_playlist));
+        QTimer::singleShot(pollInterval, this, &QueueWorker::nextChunk);
+        return;
+    }
+    file.write(doc.toString().toUtf8());
+    file.close();
+    QString scenelist = m_playlist;
+    if (consumer.hasAttribute(QLatin1String("s")) || consumer.hasAttribute(QLatin1String("r"))) {
+        // Workaround MLT embedded consumer resize (MLT issue #453), see kdenlive_render
+        scenelist = QStringLiteral("xml:%1?multi=1").arg(scenelist);
+    }
+
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::ChunkStarted;
+    record.frame = m_chunk.in;
+    record.frames = m_chunk.length();
+    m_progressLog.write(record);
+    m_errorMessage.clear();
+    delete m_process;
+    m_process = new QProcess;
+    m_process->setReadChannel(QProcess::StandardError);
+    connect(m_process, &QProcess::readyReadStandardError, this, &QueueWorker::receivedStderr);
+    connect(m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &QueueWorker::chunkFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            m_errorMessage = tr("Cannot start %1").arg(m_prog);
+            chunkFinished(-1, QProcess::CrashExit);
+        }
+    });
+    m_heartbeat.start();
+    m_process->start(m_prog, {QStringLiteral("-progress"), scenelist});
+}
+
+void QueueWorker::receivedStderr()
+{
+    QString result = QString::fromLocal8Bit(m_process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QLatin1Char('\n'));
+        return;
+    }
+    int progress = result.section(QLatin1Char(' '), -1).toInt();
+    if (progress > 0 && progress <= 100) {
+        m_chunk.done = qMax(m_chunk.done, m_chunk.length() * progress / 100);
+    }
+}
+
+void QueueWorker::sendHeartbeat()
+{
+    if (!m_queue.heartbeat(m_chunk)) {
+        // The chunk was given to another worker, or the render was cancelled
+        qWarning() << "Chunk" << m_chunk.index << "is not assigned to" << m_name << "anymore, stopping";
+        m_heartbeat.stop();
+        if (m_process) {
+            m_process->disconnect(this);
+            m_process->kill();
+            m_process->waitForFinished(1000);
+        }
+        cleanChunk();
+        nextChunk();
+        return;
+    }
+    RenderProgress::Record record;
+    record.frame = m_chunk.in + m_chunk.done;
+    record.frames = m_chunk.done;
+    record.fps = 1000. * m_chunk.done / qMax(qint64(1), QDateTime::currentMSecsSinceEpoch() - m_chunk.started);
+    m_progressLog.write(record);
+}
+
+void QueueWorker::chunkFinished(int exitCode, QProcess::ExitStatus status)
+{
+    m_heartbeat.stop();
+    RenderProgress::Record record;
+    record.frame = m_chunk.in;
+    if (status == QProcess::CrashExit || exitCode != 0 || !QFile::exists(m_file)) {
+        const QString error = m_errorMessage.isEmpty() ? m_process->errorString() : m_errorMessage;
+        m_queue.release(m_chunk, error);
+        record.event = RenderProgress::Event::Failed;
+        record.message = error;
+    } else if (m_queue.complete(m_chunk, m_file)) {
+        record.event = RenderProgress::Event::ChunkDone;
+        record.frames = m_chunk.length();
+        record.stages.insert(QStringLiteral("encode"), QDateTime::currentMSecsSinceEpoch() - m_chunk.started);
+        record.fps = 1000. * record.frames / qMax(qint64(1), record.stages.value(QStringLiteral("encode")));
+    } else {
+        record.event = RenderProgress::Event::Failed;
+        record.message = QStringLiteral("Chunk was given to another worker");
+    }
+    m_progressLog.write(record);
+    cleanChunk();
+    // Let the event loop delete the process, we are called from one of its signals
+    m_process->deleteLater();
+    m_process = nullptr;
+    QTimer::singleShot(0, this, &QueueWorker::nextChunk);
+}
+
+void QueueWorker::cleanChunk()
+{
+    QFile::remove(m_playlist);
+    QFile::remove(m_file);
+}
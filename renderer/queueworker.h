@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef QUEUEWORKER_H
+#define QUEUEWORKER_H
+
+#include "../src/lib/renderprogress.h"
+#include "renderqueue.h"
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+
+/**
+ * @class QueueWorker
+ * @brief Renders the chunks of a shared RenderQueue with melt, one at a time, until the queue is empty.
+ *
+ * Several workers, in this process or others, can render the same queue. The worker sends a heartbeat
+ * while rendering a chunk, and puts back the chunks of workers that stopped responding. Progress of
+ * each chunk is written on standard output as render progress records.
+ */
+class QueueWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    QueueWorker(const QString &render, const QString &folder, QObject *parent = nullptr);
+    ~QueueWorker() override;
+    /** @brief Load the queue, returns false if the folder does not contain a render queue */
+    bool prepare();
+    /** @brief The worker name, unique across computers */
+    const QString &name() const;
+
+    /** @brief Seconds without heartbeat after which a chunk is rendered by another worker */
+    static const int staleTimeout;
+
+public slots:
+    void start();
+
+private:
+    QString m_prog;
+    QString m_name;
+    RenderQueue m_queue;
+    RenderQueue::Chunk m_chunk;
+    QString m_playlist;
+    QString m_file;
+    QString m_errorMessage;
+    QProcess *m_process{nullptr};
+    QTimer m_heartbeat;
+    RenderProgress::Log m_progressLog;
+
+    /** @brief Claim and render the next pending chunk, or wait for the running ones */
+    void nextChunk();
+    void receivedStderr();
+    void sendHeartbeat();
+    void chunkFinished(int exitCode, QProcess::ExitStatus status);
+    /** @brief Remove the files of the current chunk */
+    void cleanChunk();
+
+signals:
+    void renderingFinished();
+};
+
+#endif
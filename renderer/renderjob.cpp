@@ -25,6 +25,10 @@
 #include <QtDBus>
 #include <QElapsedTimer>
 #include <utility>
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <sys/types.h>
+#endif
 // Can't believe I need to do this to sleep.
 class SleepThread : QThread
 {
@@ -51,6 +55,7 @@ RenderJob::RenderJob(const QString &render, const QString &scenelist, const QStr
     , m_frameout(out)
     , m_pid(pid)
     , m_dualpass(false)
+    , m_progressLog(target, true)
 {
     m_renderProcess = new QProcess;
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -82,6 +87,11 @@ RenderJob::~RenderJob()
     m_logfile.close();
 }
 
+void RenderJob::setDualPass(bool dualPass)
+{
+    m_dualpass = dualPass;
+}
+
 void RenderJob::slotAbort(const QString &url)
 {
     if (m_dest == url) {
@@ -106,10 +116,36 @@ void RenderJob::slotAbort()
     QFile(m_dest).remove();
     m_logstream << "Job aborted by user" << "\n";
     m_logstream.flush();
+    writeFinalRecord(RenderProgress::Event::Aborted);
     m_logfile.close();
     qApp->quit();
 }
 
+void RenderJob::slotPause(const QString &url, bool pause)
+{
+    if (m_dest == url) {
+        pauseProcess(m_renderProcess, pause);
+        m_logstream << (pause ? "Job paused" : "Job resumed") << "\n";
+        RenderProgress::Record record;
+        record.frame = m_lastFrame;
+        record.message = pause ? QStringLiteral("paused") : QStringLiteral("resumed");
+        m_progressLog.write(record);
+    }
+}
+
+// static
+void RenderJob::pauseProcess(QProcess *process, bool pause)
+{
+#ifdef Q_OS_UNIX
+    if (process && process->state() == QProcess::Running) {
+        ::kill(pid_t(process->processId()), pause ? SIGSTOP : SIGCONT);
+    }
+#else
+    Q_UNUSED(process)
+    Q_UNUSED(pause)
+#endif
+}
+
 void RenderJob::receivedStderr()
 {
     QString result = QString::fromLocal8Bit(m_renderProcess->readAllStandardError()).simplified();
@@ -117,8 +153,14 @@ void RenderJob::receivedStderr()
         m_errorMessage.append(result + QStringLiteral("<br>"));
         m_logstream << result;
     } else {
+        // melt only reports its progress as text, it is converted to progress records here
         int progress = result.section(QLatin1Char(' '), -1).toInt();
         int frame = result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt();
+        if (m_encodeStart < 0) {
+            m_encodeStart = m_progressLog.elapsed();
+            m_firstFrame = frame;
+        }
+        m_lastFrame = frame;
         if (progress <= m_progress || progress <= 0 || progress > 100) {
             return;
         }
@@ -128,6 +170,12 @@ void RenderJob::receivedStderr()
         } else if (m_args.contains(QStringLiteral("pass=2"))) {
             m_progress = 50 + m_progress / 2.0;
         }
+        RenderProgress::Record record;
+        record.frame = frame;
+        record.frames = frame - m_firstFrame;
+        record.percent = m_progress;
+        record.fps = 1000. * record.frames / qMax(qint64(1), m_progressLog.elapsed() - m_encodeStart);
+        m_progressLog.write(record);
         if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
             m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, m_progress, frame});
         }
@@ -212,15 +260,25 @@ void RenderJob::start()
     connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
     m_renderProcess->start(m_prog, m_args);
     m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+    m_logstream << "Timing log: " << m_progressLog.fileName() << "\n";
     m_logstream.flush();
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = m_dest;
+    m_progressLog.write(record);
 }
 
-void RenderJob::initKdenliveDbusInterface()
+// static
+QDBusInterface *RenderJob::kdenliveInterface(int pid, QObject *parent)
 {
     QString kdenliveId;
     QDBusConnection connection = QDBusConnection::sessionBus();
     QDBusConnectionInterface *ibus = connection.interface();
-    kdenliveId = QStringLiteral("org.kde.kdenlive-%1").arg(m_pid);
+    if (ibus == nullptr) {
+        // No session bus, the render is not followed by Kdenlive
+        return nullptr;
+    }
+    kdenliveId = QStringLiteral("org.kde.kdenlive-%1").arg(pid);
     if (!ibus->isServiceRegistered(kdenliveId)) {
         kdenliveId.clear();
         const QStringList services = ibus->registeredServiceNames();
@@ -233,16 +291,20 @@ void RenderJob::initKdenliveDbusInterface()
         }
     }
     if (kdenliveId.isEmpty()) {
-        return;
+        return nullptr;
     }
-    m_kdenliveinterface =
-        new QDBusInterface(kdenliveId, QStringLiteral("/kdenlive/MainWindow_1"), QStringLiteral("org.kde.kdenlive.rendering"), connection, this);
+    return new QDBusInterface(kdenliveId, QStringLiteral("/kdenlive/MainWindow_1"), QStringLiteral("org.kde.kdenlive.rendering"), connection, parent);
+}
 
+void RenderJob::initKdenliveDbusInterface()
+{
+    m_kdenliveinterface = kdenliveInterface(m_pid, this);
     if (m_kdenliveinterface) {
         if (!m_args.contains(QStringLiteral("pass=2"))) {
             m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, 0, 0});
         }
         connect(m_kdenliveinterface, SIGNAL(abortRenderJob(QString)), this, SLOT(slotAbort(QString)));
+        connect(m_kdenliveinterface, SIGNAL(pauseRenderJob(QString,bool)), this, SLOT(slotPause(QString,bool)));
     }
 }
 
@@ -266,6 +328,7 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
         }
         QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), error});
         m_logstream << error << "\n";
+        writeFinalRecord(RenderProgress::Event::Failed, error);
         emit renderingFinished();
         //qApp->quit();
     }
@@ -284,6 +347,7 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
         }
         args << QStringLiteral("--error") << error;
         m_logstream << error << "\n";
+        writeFinalRecord(RenderProgress::Event::Failed, m_errorMessage);
         QProcess::startDetached(QStringLiteral("kdialog"), args);
         emit renderingFinished();
     } else {
@@ -291,6 +355,7 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
             m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), {m_dest, -1, QString()});
         }
         m_logstream << "Rendering of " << m_dest << " finished" << "\n";
+        writeFinalRecord(RenderProgress::Event::Finished);
         if (!m_dualpass && m_player.length() > 3 && m_player.contains(QLatin1Char(' '))) {
             QStringList args = m_player.split(QLatin1Char(' '));
             QString exec = args.takeFirst();
@@ -308,3 +373,27 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
     }
     emit renderingFinished();
 }
+
+void RenderJob::writeFinalRecord(RenderProgress::Event event, const QString &message)
+{
+    if (m_finalRecord) {
+        return;
+    }
+    m_finalRecord = true;
+    RenderProgress::Record record;
+    record.event = event;
+    record.frame = m_lastFrame;
+    record.percent = m_progress;
+    record.message = message;
+    const qint64 elapsed = m_progressLog.elapsed();
+    if (m_encodeStart < 0) {
+        record.stages.insert(QStringLiteral("load"), elapsed);
+    } else {
+        // Loading the playlist until the first frame, then encoding until the file is closed
+        record.frames = m_lastFrame - m_firstFrame;
+        record.fps = 1000. * record.frames / qMax(qint64(1), elapsed - m_encodeStart);
+        record.stages.insert(QStringLiteral("load"), m_encodeStart);
+        record.stages.insert(QStringLiteral("encode"), elapsed - m_encodeStart);
+    }
+    m_progressLog.write(record);
+}
@@ -20,6 +20,8 @@
 #ifndef RENDERJOB_H
 #define RENDERJOB_H
 
+#include "../src/lib/renderprogress.h"
+
 #include <QDBusInterface>
 #include <QObject>
 #include <QProcess>
@@ -35,6 +37,12 @@ class RenderJob : public QObject
 public:
     RenderJob(const QString &render, const QString &scenelist, const QString &target, int pid = -1, int in = -1, int out = -1, QObject *parent = nullptr);
     ~RenderJob();
+    /** @brief The job is the first pass of a two pass encoding, the second pass reports the end of the render */
+    void setDualPass(bool dualPass);
+    /** @brief Suspend or resume a process, only supported on Unix */
+    static void pauseProcess(QProcess *process, bool pause);
+    /** @brief Returns the rendering interface of the Kdenlive instance with process id pid, or of any running instance */
+    static QDBusInterface *kdenliveInterface(int pid, QObject *parent);
 
 public slots:
     void start();
@@ -44,6 +52,7 @@ private slots:
     void receivedStderr();
     void slotAbort();
     void slotAbort(const QString &url);
+    void slotPause(const QString &url, bool pause);
     void slotCheckProcess(QProcess::ProcessState state);
 
 private:
@@ -72,7 +81,16 @@ private:
     QStringList m_args;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
+    /** @brief The progress records, kept in the timing log */
+    RenderProgress::Log m_progressLog;
+    /** @brief Time and frame of the first progress report, encoding speed is measured from there */
+    qint64 m_encodeStart{-1};
+    int m_firstFrame{0};
+    int m_lastFrame{0};
+    bool m_finalRecord{false};
     void initKdenliveDbusInterface();
+    /** @brief Write the final progress record */
+    void writeFinalRecord(RenderProgress::Event event, const QString &message = QString());
 
 signals:
     void renderingFinished();
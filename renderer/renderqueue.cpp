@@ -0,0 +1,333 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "renderqueue.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+const QStringList stateFolders{QStringLiteral("pending"), QStringLiteral("running"), QStringLiteral("done"), QStringLiteral("failed")};
+const QString queueFile = QStringLiteral("queue.json");
+const QString playlistFile = QStringLiteral("render.mlt");
+const QString cancelFile = QStringLiteral("cancel");
+const QString chunkFolder = QStringLiteral("chunks");
+
+QString chunkName(int index)
+{
+    return QStringLiteral("%1").arg(index, 4, 10, QLatin1Char('0'));
+}
+} // namespace
+
+RenderQueue::RenderQueue(const QString &folder)
+    : m_dir(folder)
+{
+    m_clock.start();
+}
+
+bool RenderQueue::create(const QDomDocument &playlist, const QVector<RenderSegments::Segment> &segments, const QString &extension, int maxAttempts)
+{
+    for (const QString &folder : stateFolders) {
+        if (!m_dir.mkpath(folder)) {
+            return false;
+        }
+    }
+    if (!m_dir.mkpath(chunkFolder)) {
+        return false;
+    }
+    QFile file(m_dir.absoluteFilePath(playlistFile));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    file.write(playlist.toString().toUtf8());
+    file.close();
+    m_extension = extension;
+    m_chunkCount = segments.size();
+    m_maxAttempts = qMax(1, maxAttempts);
+    for (int i = 0; i < segments.size(); ++i) {
+        Chunk chunk;
+        chunk.index = i;
+        chunk.in = segments.at(i).in;
+        chunk.out = segments.at(i).out;
+        if (!writeChunk(stateFile(Pending, i), chunk, false)) {
+            return false;
+        }
+    }
+    // Written last, workers only join a complete queue
+    QJsonObject settings;
+    settings.insert(QLatin1String("extension"), m_extension);
+    settings.insert(QLatin1String("chunks"), m_chunkCount);
+    settings.insert(QLatin1String("maxAttempts"), m_maxAttempts);
+    QFile queue(m_dir.absoluteFilePath(queueFile));
+    if (!queue.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    queue.write(QJsonDocument(settings).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+bool RenderQueue::load()
+{
+    QFile queue(m_dir.absoluteFilePath(queueFile));
+    if (!queue.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonObject settings = QJsonDocument::fromJson(queue.readAll()).object();
+    m_extension = settings.value(QLatin1String("extension")).toString();
+    m_chunkCount = settings.value(QLatin1String("chunks")).toInt();
+    m_maxAttempts = qMax(1, settings.value(QLatin1String("maxAttempts")).toInt());
+    return !m_extension.isEmpty() && m_chunkCount > 0;
+}
+
+QString RenderQueue::folder() const
+{
+    return m_dir.absolutePath();
+}
+
+QString RenderQueue::playlist() const
+{
+    return m_dir.absoluteFilePath(playlistFile);
+}
+
+int RenderQueue::count() const
+{
+    return m_chunkCount;
+}
+
+QString RenderQueue::chunkFile(int index) const
+{
+    return m_dir.absoluteFilePath(QStringLiteral("%1/%2.%3").arg(chunkFolder, chunkName(index), m_extension));
+}
+
+QString RenderQueue::workFile(const Chunk &chunk, const QString &suffix) const
+{
+    // Worker names are unique, a chunk given to another worker does not overwrite this file
+    QString worker = chunk.worker;
+    worker.replace(QLatin1Char('/'), QLatin1Char('_'));
+    return m_dir.absoluteFilePath(QStringLiteral("%1/%2-%3.%4").arg(chunkFolder, chunkName(chunk.index), worker, suffix));
+}
+
+QString RenderQueue::stateFile(State state, int index) const
+{
+    return m_dir.absoluteFilePath(QStringLiteral("%1/%2.json").arg(stateFolders.at(state), chunkName(index)));
+}
+
+bool RenderQueue::claim(const QString &worker, Chunk &chunk)
+{
+    QDir pending(m_dir.absoluteFilePath(stateFolders.at(Pending)));
+    const QStringList files = pending.entryList({QStringLiteral("*.json")}, QDir::Files, QDir::Name);
+    for (const QString &name : files) {
+        const QString claimed = m_dir.absoluteFilePath(QStringLiteral("%1/%2").arg(stateFolders.at(Running), name));
+        // Only one worker can move the file, the others try the next chunk
+        if (!QFile::rename(pending.absoluteFilePath(name), claimed)) {
+            continue;
+        }
+        if (!readChunk(claimed, chunk)) {
+            continue;
+        }
+        chunk.worker = worker;
+        chunk.done = 0;
+        chunk.started = QDateTime::currentMSecsSinceEpoch();
+        chunk.error.clear();
+        if (writeChunk(claimed, chunk, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RenderQueue::heartbeat(const Chunk &chunk)
+{
+    const QString path = stateFile(Running, chunk.index);
+    Chunk current;
+    if (!readChunk(path, current) || current.worker != chunk.worker) {
+        return false;
+    }
+    Chunk alive(chunk);
+    alive.beat = current.beat + 1;
+    return writeChunk(path, alive, true);
+}
+
+bool RenderQueue::complete(Chunk chunk, const QString &file)
+{
+    const QString path = stateFile(Running, chunk.index);
+    Chunk current;
+    if (!readChunk(path, current) || current.worker != chunk.worker) {
+        QFile::remove(file);
+        return false;
+    }
+    const QString target = chunkFile(chunk.index);
+    QFile::remove(target);
+    if (!QFile::rename(file, target)) {
+        return false;
+    }
+    chunk.done = chunk.length();
+    chunk.elapsed = QDateTime::currentMSecsSinceEpoch() - chunk.started;
+    chunk.fps = 1000. * chunk.done / qMax(qint64(1), chunk.elapsed);
+    return writeChunk(path, chunk, true) && QFile::rename(path, stateFile(Done, chunk.index));
+}
+
+bool RenderQueue::release(Chunk chunk, const QString &error)
+{
+    const QString path = stateFile(Running, chunk.index);
+    Chunk current;
+    if (!readChunk(path, current) || current.worker != chunk.worker) {
+        return false;
+    }
+    chunk.attempts++;
+    chunk.error = error;
+    chunk.done = 0;
+    if (!writeChunk(path, chunk, true)) {
+        return false;
+    }
+    return QFile::rename(path, stateFile(chunk.attempts >= m_maxAttempts ? Failed : Pending, chunk.index));
+}
+
+int RenderQueue::requeueStale(int timeout)
+{
+    int released = 0;
+    const qint64 now = m_clock.elapsed();
+    QHash<int, Beat> beats;
+    const QVector<Chunk> running = chunks(Running);
+    for (const Chunk &chunk : running) {
+        auto previous = m_beats.constFind(chunk.index);
+        if (previous == m_beats.constEnd() || previous->worker != chunk.worker || previous->beat != chunk.beat) {
+            // First seen or alive
+            beats.insert(chunk.index, {chunk.worker, chunk.beat, now});
+            continue;
+        }
+        if (now - previous->seen < timeout * 1000LL) {
+            beats.insert(chunk.index, previous.value());
+            continue;
+        }
+        if (release(chunk, QStringLiteral("Worker %1 stopped responding").arg(chunk.worker))) {
+            released++;
+        }
+    }
+    m_beats = beats;
+    return released;
+}
+
+void RenderQueue::resetStaleCheck()
+{
+    m_beats.clear();
+}
+
+QVector<RenderQueue::Chunk> RenderQueue::chunks(State state) const
+{
+    QVector<Chunk> result;
+    QDir folder(m_dir.absoluteFilePath(stateFolders.at(state)));
+    const QStringList files = folder.entryList({QStringLiteral("*.json")}, QDir::Files, QDir::Name);
+    for (const QString &name : files) {
+        Chunk chunk;
+        if (readChunk(folder.absoluteFilePath(name), chunk)) {
+            result << chunk;
+        }
+    }
+    return result;
+}
+
+bool RenderQueue::isFinished() const
+{
+    const QStringList filter{QStringLiteral("*.json")};
+    return QDir(m_dir.absoluteFilePath(stateFolders.at(Pending))).entryList(filter, QDir::Files).isEmpty() &&
+           QDir(m_dir.absoluteFilePath(stateFolders.at(Running))).entryList(filter, QDir::Files).isEmpty();
+}
+
+void RenderQueue::cancel()
+{
+    QFile file(m_dir.absoluteFilePath(cancelFile));
+    if (file.open(QIODevice::WriteOnly)) {
+        file.close();
+    }
+}
+
+bool RenderQueue::isCancelled() const
+{
+    return m_dir.exists(cancelFile) || !m_dir.exists(queueFile);
+}
+
+bool RenderQueue::readChunk(const QString &path, Chunk &chunk) const
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) && parse(file.readAll(), chunk);
+}
+
+bool RenderQueue::writeChunk(const QString &path, const Chunk &chunk, bool existing) const
+{
+    QFile file(path);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Truncate;
+    if (existing) {
+        mode |= QIODevice::ExistingOnly;
+    }
+    if (!file.open(mode)) {
+        return false;
+    }
+    const QByteArray data = serialize(chunk);
+    return file.write(data) == data.size();
+}
+
+// static
+QByteArray RenderQueue::serialize(const Chunk &chunk)
+{
+    QJsonObject obj;
+    obj.insert(QLatin1String("index"), chunk.index);
+    obj.insert(QLatin1String("in"), chunk.in);
+    obj.insert(QLatin1String("out"), chunk.out);
+    obj.insert(QLatin1String("attempts"), chunk.attempts);
+    if (!chunk.worker.isEmpty()) {
+        obj.insert(QLatin1String("worker"), chunk.worker);
+        obj.insert(QLatin1String("done"), chunk.done);
+        obj.insert(QLatin1String("started"), chunk.started);
+        obj.insert(QLatin1String("beat"), chunk.beat);
+    }
+    if (chunk.elapsed > 0) {
+        obj.insert(QLatin1String("elapsed"), chunk.elapsed);
+        obj.insert(QLatin1String("fps"), chunk.fps);
+    }
+    if (!chunk.error.isEmpty()) {
+        obj.insert(QLatin1String("error"), chunk.error);
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+// static
+bool RenderQueue::parse(const QByteArray &data, Chunk &chunk)
+{
+    const QJsonObject obj = QJsonDocument::fromJson(data).object();
+    if (!obj.contains(QLatin1String("index"))) {
+        return false;
+    }
+    chunk.index = obj.value(QLatin1String("index")).toInt();
+    chunk.in = obj.value(QLatin1String("in")).toInt();
+    chunk.out = obj.value(QLatin1String("out")).toInt();
+    chunk.attempts = obj.value(QLatin1String("attempts")).toInt();
+    chunk.worker = obj.value(QLatin1String("worker")).toString();
+    chunk.done = obj.value(QLatin1String("done")).toInt();
+    chunk.started = qint64(obj.value(QLatin1String("started")).toDouble());
+    chunk.beat = obj.value(QLatin1String("beat")).toInt();
+    chunk.elapsed = qint64(obj.value(QLatin1String("elapsed")).toDouble());
+    chunk.fps = obj.value(QLatin1String("fps")).toDouble();
+    chunk.error = obj.value(QLatin1String("error")).toString();
+    return true;
+}
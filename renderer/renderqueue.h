@@ -0,0 +1,140 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "rendersegments.h"
+
+#include <QDir>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class RenderQueue
+ * @brief A work queue of render chunks kept in a folder, shared by several kdenlive_render workers.
+ *
+ * The queue needs no service: each chunk is a small JSON file, and its state is the sub folder it
+ * is in (pending, running, done or failed). A worker claims a chunk by moving its file from pending
+ * to running, which only one worker can do. While rendering, the worker rewrites the file with its
+ * progress, this is its heartbeat. A chunk whose heartbeat stops is put back in the queue by any
+ * worker, so that a crashed or stopped worker does not block the render, and a chunk that failed
+ * too many times is moved to failed. Workers can run on this computer or on any computer with
+ * the same media paths that can access the folder.
+ * Finished chunks keep the worker, duration and speed of their render, to spot slow segments.
+ */
+class RenderQueue
+{
+public:
+    enum State { Pending, Running, Done, Failed };
+
+    struct Chunk
+    {
+        int index{-1};
+        int in{0};
+        int out{-1};
+        int attempts{0};
+        /** @brief The worker rendering the chunk, or the last one that rendered it */
+        QString worker;
+        /** @brief The number of frames rendered */
+        int done{0};
+        /** @brief Milliseconds since epoch when the chunk was claimed */
+        qint64 started{0};
+        /** @brief Incremented on each heartbeat, workers may not share the same clock */
+        int beat{0};
+        /** @brief Milliseconds spent rendering, once done */
+        qint64 elapsed{0};
+        double fps{0.};
+        QString error;
+        int length() const { return out - in + 1; }
+    };
+
+    explicit RenderQueue(const QString &folder);
+
+    /** @brief Create the queue: the playlist rendered by the workers, and one pending chunk per segment.
+     *  @param extension is the file extension of the rendered chunks
+     *  @param maxAttempts is the number of times a chunk is rendered before it is considered failed
+     */
+    bool create(const QDomDocument &playlist, const QVector<RenderSegments::Segment> &segments, const QString &extension, int maxAttempts = 3);
+    /** @brief Read the settings of an existing queue. Returns false if the folder has no queue */
+    bool load();
+
+    QString folder() const;
+    /** @brief The render playlist of the queue, chunks are rendered by changing its consumer's range and target */
+    QString playlist() const;
+    /** @brief The number of chunks in the queue */
+    int count() const;
+    /** @brief The rendered file of a chunk */
+    QString chunkFile(int index) const;
+    /** @brief A file in the chunks folder, used by a worker while rendering a chunk */
+    QString workFile(const Chunk &chunk, const QString &suffix) const;
+
+    /** @brief Claim the first pending chunk for a worker. Returns false if no chunk is pending */
+    bool claim(const QString &worker, Chunk &chunk);
+    /** @brief Store the progress of a claimed chunk, it shows that the worker is alive. Returns false if the chunk was given to another worker */
+    bool heartbeat(const Chunk &chunk);
+    /** @brief Move the rendered file of a claimed chunk in place and mark it done. Returns false if the chunk was given to another worker */
+    bool complete(Chunk chunk, const QString &file);
+    /** @brief Put a chunk that could not be rendered back in the queue, or mark it failed after too many attempts */
+    bool release(Chunk chunk, const QString &error);
+    /** @brief Release the running chunks without heartbeat for more than timeout seconds. Returns the number of released chunks
+     *  Heartbeats are counted on this process' clock, the clocks of the workers and of the file server are never compared.
+     *  A chunk is only released after this queue saw it running without heartbeat for the timeout.
+     */
+    int requeueStale(int timeout);
+    /** @brief Forget the heartbeats seen by requeueStale, for example when this process was paused */
+    void resetStaleCheck();
+
+    /** @brief The chunks in a state, sorted by index */
+    QVector<Chunk> chunks(State state) const;
+    /** @brief Returns true if no chunk is pending or running */
+    bool isFinished() const;
+    /** @brief Ask all workers to stop */
+    void cancel();
+    bool isCancelled() const;
+
+    static QByteArray serialize(const Chunk &chunk);
+    static bool parse(const QByteArray &data, Chunk &chunk);
+
+private:
+    QDir m_dir;
+    QString m_extension;
+    int m_chunkCount{0};
+    int m_maxAttempts{3};
+    struct Beat
+    {
+        QString worker;
+        int beat;
+        qint64 seen;
+    };
+    /** @brief The last heartbeat seen for each running chunk, and when it was seen on m_clock */
+    QHash<int, Beat> m_beats;
+    QElapsedTimer m_clock;
+    QString stateFile(State state, int index) const;
+    bool readChunk(const QString &path, Chunk &chunk) const;
+    /** @brief Write a chunk file. An existing file is only rewritten if it still exists, so that a released chunk is not claimed again */
+    bool writeChunk(const QString &path, const Chunk &chunk, bool existing) const;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "rendersegments.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QtMath>
+
+namespace RenderSegments {
+
+bool canSplit(const QDomElement &consumer)
+{
+    if (consumer.isNull() || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat")) {
+        return false;
+    }
+    if (!consumer.hasAttribute(QStringLiteral("in")) || !consumer.hasAttribute(QStringLiteral("out"))) {
+        return false;
+    }
+    if (consumer.attribute(QStringLiteral("out")).toInt() <= consumer.attribute(QStringLiteral("in")).toInt()) {
+        return false;
+    }
+    if (consumer.hasAttribute(QStringLiteral("pass")) || consumer.attribute(QStringLiteral("x265-params")).contains(QLatin1String("pass="))) {
+        return false;
+    }
+    if (consumer.attribute(QStringLiteral("vn")).toInt() == 1 || consumer.attribute(QStringLiteral("f")) == QLatin1String("image2") ||
+        consumer.attribute(QStringLiteral("target")).contains(QLatin1Char('%'))) {
+        return false;
+    }
+    return true;
+}
+
+int gopSize(const QDomElement &consumer)
+{
+    return qMax(1, consumer.attribute(QStringLiteral("g")).toInt());
+}
+
+QVector<Segment> split(int in, int out, int count, int gop)
+{
+    QVector<Segment> segments;
+    const int total = out - in + 1;
+    if (total <= 0) {
+        return segments;
+    }
+    gop = qMax(1, gop);
+    count = qBound(1, count, total);
+    int length = qCeil(double(total) / count);
+    length = qCeil(double(length) / gop) * gop;
+    for (int start = in; start <= out; start += length) {
+        segments.append({start, qMin(out, start + length - 1), QString()});
+    }
+    return segments;
+}
+
+QVector<Segment> plan(int in, int out, const QMap<int, QString> &chunks, int chunkSize, int count, int gop)
+{
+    QVector<Segment> segments;
+    // Each worker loads the whole project, don't split short ranges
+    const int minLength = qMax(1, 4 * chunkSize);
+    auto addRange = [&](int start, int end) {
+        segments << split(start, end, qBound(1, (end - start + 1) / minLength, count), gop);
+    };
+    int pos = in;
+    for (auto i = chunks.constBegin(); i != chunks.constEnd(); ++i) {
+        if (i.key() < pos || i.key() + chunkSize - 1 > out) {
+            continue;
+        }
+        if (i.key() > pos) {
+            addRange(pos, i.key() - 1);
+        }
+        segments.append({i.key(), i.key() + chunkSize - 1, i.value()});
+        pos = i.key() + chunkSize;
+    }
+    if (pos <= out) {
+        addRange(pos, out);
+    }
+    return segments;
+}
+
+bool writeConcatList(const QString &path, const QStringList &files)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    for (QString f : files) {
+        // Single quotes are escaped as '\''
+        stream << QStringLiteral("file '%1'\n").arg(f.replace(QLatin1Char('\''), QLatin1String("'\\''")));
+    }
+    stream.flush();
+    return file.error() == QFile::NoError;
+}
+
+QStringList concatArguments(const QString &listFile, const QString &audioFile, const QString &target)
+{
+    QStringList args = {QStringLiteral("-y"), QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-f"), QStringLiteral("concat"),
+                        QStringLiteral("-safe"), QStringLiteral("0"), QStringLiteral("-i"), listFile};
+    if (!audioFile.isEmpty()) {
+        args << QStringLiteral("-i") << audioFile << QStringLiteral("-map") << QStringLiteral("0:v") << QStringLiteral("-map") << QStringLiteral("1:a");
+    }
+    args << QStringLiteral("-c") << QStringLiteral("copy") << target;
+    return args;
+}
+
+} // namespace RenderSegments
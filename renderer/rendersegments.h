@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef RENDERSEGMENTS_H
+#define RENDERSEGMENTS_H
+
+#include <QDomElement>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+/** @brief Helpers used to render a playlist as several segments in parallel, and to join the
+ *  rendered segments with ffmpeg's concat demuxer without re-encoding them.
+ */
+namespace RenderSegments {
+
+struct Segment
+{
+    int in;
+    int out;
+    /** @brief An already rendered file that is copied for this segment, empty if the segment must be rendered */
+    QString file;
+    int length() const { return out - in + 1; }
+};
+
+/** @brief Returns true if the render playlist's consumer can be rendered in segments. Image sequences,
+ *  two pass encoding, audio only renders and playlists without in/out points are rendered in one process.
+ */
+bool canSplit(const QDomElement &consumer);
+
+/** @brief Returns the keyframe interval requested by the consumer (its "g" property), or 1 if none is set */
+int gopSize(const QDomElement &consumer);
+
+/** @brief Split the in/out range in at most count segments. All segments but the last one are a multiple of gop frames
+ *  long, so that keyframes are placed where a single process render would place them.
+ */
+QVector<Segment> split(int in, int out, int count, int gop);
+
+/** @brief Returns the segments covering the in/out range, reusing rendered chunks.
+ *  @param chunks maps the start frame of each reusable chunk to its file, chunks are chunkSize frames long
+ *  The ranges between reused chunks are split in at most count segments each.
+ */
+QVector<Segment> plan(int in, int out, const QMap<int, QString> &chunks, int chunkSize, int count, int gop);
+
+/** @brief Write the file list read by ffmpeg's concat demuxer */
+bool writeConcatList(const QString &path, const QStringList &files);
+
+/** @brief Returns the ffmpeg arguments joining the segments listed in listFile into target without re-encoding.
+ *  @param audioFile if not empty, the audio rendered in one piece which replaces the segments' audio
+ */
+QStringList concatArguments(const QString &listFile, const QString &audioFile, const QString &target);
+
+} // namespace RenderSegments
+
+#endif
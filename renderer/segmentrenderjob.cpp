@@ -0,0 +1,393 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "segmentrenderjob.h"
+#include "renderjob.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDomDocument>
+#include <QFileInfo>
+#include <QtDBus>
+
+SegmentRenderJob::SegmentRenderJob(const QString &render, const QString &scenelist, const QString &target, const QString &ffmpeg, int workers, int pid,
+                                   QObject *parent)
+    : QObject(parent)
+    , m_prog(render)
+    , m_scenelist(scenelist)
+    , m_dest(target)
+    , m_ffmpeg(ffmpeg)
+    , m_workerCount(qMax(1, workers))
+    , m_pid(pid)
+    , m_erase(scenelist.startsWith(QDir::tempPath()))
+    , m_logfile(target + QStringLiteral(".log"))
+    , m_progressLog(target, true)
+{
+    if (!m_logfile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Unable to log to " << m_logfile.fileName();
+    } else {
+        m_logstream.setDevice(&m_logfile);
+    }
+}
+
+SegmentRenderJob::~SegmentRenderJob()
+{
+    stopWorkers();
+    for (const Worker &worker : qAsConst(m_workers)) {
+        delete worker.process;
+    }
+    delete m_concatProcess;
+    m_logfile.close();
+}
+
+void SegmentRenderJob::setReusableChunks(const QMap<int, QString> &chunks, int chunkSize)
+{
+    m_chunks = chunks;
+    m_chunkSize = chunkSize;
+}
+
+bool SegmentRenderJob::prepare()
+{
+    if (m_ffmpeg.isEmpty()) {
+        return false;
+    }
+    QFile f(m_scenelist);
+    QDomDocument doc;
+    if (!f.open(QIODevice::ReadOnly) || !doc.setContent(&f, false)) {
+        return false;
+    }
+    f.close();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    const QString extension = QFileInfo(m_dest).suffix();
+    if (!RenderSegments::canSplit(consumer) || extension.isEmpty()) {
+        return false;
+    }
+    m_in = consumer.attribute(QStringLiteral("in")).toInt();
+    int out = consumer.attribute(QStringLiteral("out")).toInt();
+    // Segments are written next to the destination, the temporary folder may not have room for the whole render
+    m_tmpDir.reset(new QTemporaryDir(QFileInfo(m_dest).absoluteDir().absoluteFilePath(QStringLiteral(".kdenlive-render-XXXXXX"))));
+    if (!m_tmpDir->isValid()) {
+        return false;
+    }
+    // Chunks are copied so that a preview refresh cannot change them while rendering. Chunks modified
+    // after the playlist was written don't match it anymore and are rendered again
+    const QDateTime playlistDate = QFileInfo(m_scenelist).lastModified();
+    const qint64 copyStart = m_progressLog.elapsed();
+    QMap<int, QString> chunks;
+    for (auto i = m_chunks.constBegin(); i != m_chunks.constEnd(); ++i) {
+        QFileInfo info(i.value());
+        const QString copy = m_tmpDir->filePath(QStringLiteral("chunk-%1.%2").arg(i.key()).arg(extension));
+        if (info.exists() && info.lastModified() <= playlistDate && QFile::copy(i.value(), copy)) {
+            chunks.insert(i.key(), copy);
+        }
+    }
+    if (!chunks.isEmpty()) {
+        m_stages.insert(QStringLiteral("copy"), m_progressLog.elapsed() - copyStart);
+    }
+    const int gop = RenderSegments::gopSize(consumer);
+    if (chunks.isEmpty()) {
+        m_parts = RenderSegments::split(m_in, out, m_workerCount, gop);
+    } else {
+        m_parts = RenderSegments::plan(m_in, out, chunks, m_chunkSize, m_workerCount, gop);
+    }
+    if (m_parts.size() < 2) {
+        return false;
+    }
+    // Workaround MLT embedded consumer resize (MLT issue #453), see kdenlive_render
+    bool multi = consumer.hasAttribute(QLatin1String("s")) || consumer.hasAttribute(QLatin1String("r"));
+    auto addWorker = [&](const QDomDocument &playlist, const QString &name, int length, bool audio) {
+        Worker worker{m_tmpDir->filePath(name + QStringLiteral(".mlt")), m_tmpDir->filePath(name + QLatin1Char('.') + extension), length, 0, audio, nullptr,
+                      QString(), 0};
+        QDomElement cons = playlist.documentElement().firstChildElement(QStringLiteral("consumer"));
+        cons.setAttribute(QStringLiteral("target"), worker.file);
+        QFile file(worker.playlist);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return false;
+        }
+        file.write(playlist.toString().toUtf8());
+        file.close();
+        if (multi) {
+            worker.playlist = QStringLiteral("xml:%1?multi=1").arg(worker.playlist);
+        }
+        m_workers << worker;
+        return true;
+    };
+    if (consumer.attribute(QStringLiteral("an")).toInt() != 1) {
+        // Audio is encoded in one piece, encoder delay and frame padding would otherwise produce gaps at each boundary.
+        // It is the longest job, start it first
+        QDomDocument audio = doc.cloneNode(true).toDocument();
+        QDomElement cons = audio.documentElement().firstChildElement(QStringLiteral("consumer"));
+        cons.setAttribute(QStringLiteral("vn"), 1);
+        if (!addWorker(audio, QStringLiteral("audio"), 0, true)) {
+            return false;
+        }
+        m_audioFile = m_workers.constLast().file;
+    }
+    for (int i = 0; i < m_parts.size(); ++i) {
+        RenderSegments::Segment &part = m_parts[i];
+        m_length += part.length();
+        if (!part.file.isEmpty()) {
+            m_reused += part.length();
+            continue;
+        }
+        QDomDocument segment = doc.cloneNode(true).toDocument();
+        QDomElement cons = segment.documentElement().firstChildElement(QStringLiteral("consumer"));
+        cons.setAttribute(QStringLiteral("in"), part.in);
+        cons.setAttribute(QStringLiteral("out"), part.out);
+        cons.setAttribute(QStringLiteral("an"), 1);
+        if (!addWorker(segment, QStringLiteral("segment-%1").arg(i, 4, 10, QLatin1Char('0')), part.length(), false)) {
+            return false;
+        }
+        part.file = m_workers.constLast().file;
+    }
+    if (m_reused > 0) {
+        m_logstream << "Reusing " << m_reused << " of " << m_length << " frames from timeline preview" << "\n";
+    }
+    return true;
+}
+
+void SegmentRenderJob::start()
+{
+    m_kdenliveinterface = RenderJob::kdenliveInterface(m_pid, this);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, 0, m_in});
+        connect(m_kdenliveinterface, SIGNAL(abortRenderJob(QString)), this, SLOT(slotAbort(QString)));
+        connect(m_kdenliveinterface, SIGNAL(pauseRenderJob(QString,bool)), this, SLOT(slotPause(QString,bool)));
+    }
+    m_logstream << "Timing log: " << m_progressLog.fileName() << "\n";
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = m_dest;
+    m_progressLog.write(record);
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    if (m_workers.isEmpty()) {
+        // Everything is copied from existing chunks
+        concatenate();
+        return;
+    }
+    startWorkers();
+}
+
+void SegmentRenderJob::startWorkers()
+{
+    while (!m_paused && m_running < m_workerCount && m_nextWorker < m_workers.size()) {
+        const int i = m_nextWorker++;
+        auto *process = new QProcess;
+        process->setReadChannel(QProcess::StandardError);
+        connect(process, &QProcess::readyReadStandardError, this, [this, i]() { receivedStderr(i); });
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+                [this, i](int exitCode, QProcess::ExitStatus status) { workerFinished(i, exitCode, status); });
+        connect(process, &QProcess::errorOccurred, this, [this, i](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                workerFinished(i, -1, QProcess::CrashExit);
+            }
+        });
+        m_workers[i].process = process;
+        m_workers[i].started = m_progressLog.elapsed();
+        const QStringList args = {QStringLiteral("-progress"), m_workers.at(i).playlist};
+        m_logstream << "Started render process: " << m_prog << ' ' << args.join(QLatin1Char(' ')) << "\n";
+        m_running++;
+        process->start(m_prog, args);
+    }
+    m_logstream.flush();
+}
+
+void SegmentRenderJob::receivedStderr(int index)
+{
+    Worker &worker = m_workers[index];
+    QString result = QString::fromLocal8Bit(worker.process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        worker.errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+        return;
+    }
+    if (worker.audio) {
+        return;
+    }
+    int progress = result.section(QLatin1Char(' '), -1).toInt();
+    if (progress <= 0 || progress > 100) {
+        return;
+    }
+    worker.done = qMax(worker.done, worker.length * progress / 100);
+    int done = m_reused;
+    for (const Worker &w : qAsConst(m_workers)) {
+        done += w.done;
+    }
+    // The last percent is reached when the segments are joined
+    progress = qMin(99, int(100LL * done / m_length));
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    RenderProgress::Record record;
+    record.frame = m_in + done;
+    record.frames = done;
+    record.percent = m_progress;
+    // Copied chunks don't count in the encoding speed
+    record.fps = 1000. * (done - m_reused) / qMax(qint64(1), m_progressLog.elapsed());
+    m_progressLog.write(record);
+    if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, m_progress, m_in + done});
+    }
+}
+
+void SegmentRenderJob::workerFinished(int index, int exitCode, QProcess::ExitStatus status)
+{
+    if (m_finished) {
+        return;
+    }
+    Worker &worker = m_workers[index];
+    if (status == QProcess::CrashExit || exitCode != 0 || !QFile::exists(worker.file)) {
+        setFailed(worker.errorMessage.isEmpty() ? worker.process->errorString() : worker.errorMessage);
+        return;
+    }
+    worker.done = worker.length;
+    m_stages.insert(QFileInfo(worker.file).completeBaseName(), m_progressLog.elapsed() - worker.started);
+    m_logstream << "Rendered " << worker.file << "\n";
+    m_running--;
+    if (++m_doneWorkers == m_workers.size()) {
+        concatenate();
+    } else {
+        startWorkers();
+    }
+}
+
+void SegmentRenderJob::concatenate()
+{
+    QStringList files;
+    for (const RenderSegments::Segment &part : qAsConst(m_parts)) {
+        files << part.file;
+    }
+    const QString listFile = m_tmpDir->filePath(QStringLiteral("segments.txt"));
+    if (!RenderSegments::writeConcatList(listFile, files)) {
+        setFailed(tr("Cannot write to %1, check permissions.").arg(listFile));
+        return;
+    }
+    const QStringList args = RenderSegments::concatArguments(listFile, m_audioFile, m_dest);
+    m_logstream << "Joining segments: " << m_ffmpeg << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    m_logstream.flush();
+    m_concatStart = m_progressLog.elapsed();
+    m_concatProcess = new QProcess;
+    connect(m_concatProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus status) {
+                if (status == QProcess::CrashExit || exitCode != 0) {
+                    setFailed(QString::fromLocal8Bit(m_concatProcess->readAllStandardError()));
+                } else {
+                    m_stages.insert(QStringLiteral("concat"), m_progressLog.elapsed() - m_concatStart);
+                    setFinished(-1);
+                }
+            });
+    connect(m_concatProcess, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            setFailed(tr("Cannot start %1").arg(m_ffmpeg));
+        }
+    });
+    m_concatProcess->start(m_ffmpeg, args);
+}
+
+void SegmentRenderJob::stopWorkers()
+{
+    m_finished = true;
+    for (const Worker &worker : qAsConst(m_workers)) {
+        if (worker.process && worker.process->state() != QProcess::NotRunning) {
+            worker.process->kill();
+            worker.process->waitForFinished(1000);
+        }
+    }
+    if (m_concatProcess && m_concatProcess->state() != QProcess::NotRunning) {
+        m_concatProcess->kill();
+        m_concatProcess->waitForFinished(1000);
+    }
+}
+
+void SegmentRenderJob::slotAbort(const QString &url)
+{
+    if (m_dest == url) {
+        slotAbort();
+    }
+}
+
+void SegmentRenderJob::slotAbort()
+{
+    qWarning() << "Job aborted by user...";
+    stopWorkers();
+    QFile(m_dest).remove();
+    m_logstream << "Job aborted by user" << "\n";
+    setFinished(-3);
+}
+
+void SegmentRenderJob::slotPause(const QString &url, bool pause)
+{
+    if (m_dest != url) {
+        return;
+    }
+    m_paused = pause;
+    for (const Worker &worker : qAsConst(m_workers)) {
+        RenderJob::pauseProcess(worker.process, pause);
+    }
+    RenderJob::pauseProcess(m_concatProcess, pause);
+    m_logstream << (pause ? "Job paused" : "Job resumed") << "\n";
+    if (!pause) {
+        startWorkers();
+    }
+}
+
+void SegmentRenderJob::setFailed(const QString &error)
+{
+    stopWorkers();
+    QString message = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+    m_logstream << message << "\n" << error << "\n";
+    QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), message});
+    setFinished(-2, error);
+}
+
+void SegmentRenderJob::setFinished(int status, const QString &error)
+{
+    m_finished = true;
+    RenderProgress::Record record;
+    record.event = status == -1 ? RenderProgress::Event::Finished : (status == -3 ? RenderProgress::Event::Aborted : RenderProgress::Event::Failed);
+    record.frames = m_reused;
+    for (const Worker &worker : qAsConst(m_workers)) {
+        record.frames += worker.done;
+    }
+    record.frame = m_in + record.frames;
+    record.percent = status == -1 ? 100 : m_progress;
+    record.fps = 1000. * (record.frames - m_reused) / qMax(qint64(1), m_progressLog.elapsed());
+    record.stages = m_stages;
+    record.message = error;
+    m_progressLog.write(record);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), {m_dest, status, error});
+    }
+    if (m_erase) {
+        QFile(m_scenelist).remove();
+    }
+    if (status == -1) {
+        m_logfile.remove();
+    } else {
+        m_logstream.flush();
+    }
+    // Rendered segments are deleted with the temporary folder
+    m_tmpDir.reset();
+    emit renderingFinished();
+}
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef SEGMENTRENDERJOB_H
+#define SEGMENTRENDERJOB_H
+
+#include "../src/lib/renderprogress.h"
+#include "rendersegments.h"
+
+#include <QDBusInterface>
+#include <QFile>
+#include <QMap>
+#include <QObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+#include <memory>
+
+/**
+ * @class SegmentRenderJob
+ * @brief Renders a playlist as several segments in parallel melt processes.
+ *
+ * The in/out range of the playlist's consumer is split in one segment per worker, aligned on the
+ * keyframe interval. Each segment is rendered without audio in its own process, while the audio is
+ * rendered in one piece by an additional process so that it has no gap or priming delay at the
+ * segment boundaries. The segments and the audio are then joined with ffmpeg's concat demuxer,
+ * without re-encoding. Progress of all workers is reported to Kdenlive as a single render job.
+ * Chunks already rendered by the timeline preview with the same encoding can be copied instead of
+ * being rendered again, only the ranges between them are rendered.
+ */
+class SegmentRenderJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    SegmentRenderJob(const QString &render, const QString &scenelist, const QString &target, const QString &ffmpeg, int workers, int pid = -1,
+                     QObject *parent = nullptr);
+    ~SegmentRenderJob() override;
+    /** @brief Copy these chunks (start frame and file, chunkSize frames each) instead of rendering them */
+    void setReusableChunks(const QMap<int, QString> &chunks, int chunkSize);
+    /** @brief Write the playlists of the segments. Returns false if the playlist cannot be split, it must then be rendered by a RenderJob */
+    bool prepare();
+
+public slots:
+    void start();
+
+private slots:
+    void slotAbort();
+    void slotAbort(const QString &url);
+    void slotPause(const QString &url, bool pause);
+
+private:
+    struct Worker
+    {
+        QString playlist;
+        QString file;
+        int length;
+        int done;
+        bool audio;
+        QProcess *process;
+        QString errorMessage;
+        /** @brief Start time in the timing log */
+        qint64 started;
+    };
+    QString m_prog;
+    QString m_scenelist;
+    QString m_dest;
+    QString m_ffmpeg;
+    int m_workerCount;
+    int m_pid;
+    int m_in{0};
+    int m_length{0};
+    /** @brief The number of frames copied from existing chunks */
+    int m_reused{0};
+    int m_progress{0};
+    int m_running{0};
+    int m_nextWorker{0};
+    int m_doneWorkers{0};
+    bool m_finished{false};
+    bool m_paused{false};
+    bool m_erase;
+    QMap<int, QString> m_chunks;
+    int m_chunkSize{0};
+    QVector<RenderSegments::Segment> m_parts;
+    QVector<Worker> m_workers;
+    std::unique_ptr<QTemporaryDir> m_tmpDir;
+    QString m_audioFile;
+    QProcess *m_concatProcess{nullptr};
+    QDBusInterface *m_kdenliveinterface{nullptr};
+    /** @brief Used to create a temporary file for logging. */
+    QFile m_logfile;
+    QTextStream m_logstream;
+    /** @brief The progress records, kept in the timing log */
+    RenderProgress::Log m_progressLog;
+    /** @brief Milliseconds spent copying chunks, rendering each worker and joining the segments */
+    QMap<QString, qint64> m_stages;
+    qint64 m_concatStart{0};
+
+    /** @brief Start waiting workers, so that at most m_workerCount processes are running */
+    void startWorkers();
+    void receivedStderr(int index);
+    void workerFinished(int index, int exitCode, QProcess::ExitStatus status);
+    /** @brief Join the rendered segments into the destination file */
+    void concatenate();
+    void stopWorkers();
+    void setFailed(const QString &error);
+    void setFinished(int status, const QString &error = QString());
+
+signals:
+    void renderingFinished();
+};
+
+#endif
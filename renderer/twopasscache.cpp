@@ -0,0 +1,262 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "twopasscache.h"
+
+#include <QSize>
+
+namespace {
+// Consumer properties that change the rendered frames or audio, they must be applied when writing the intermediate
+const QStringList frameProperties{QStringLiteral("in"),
+                                  QStringLiteral("out"),
+                                  QStringLiteral("s"),
+                                  QStringLiteral("width"),
+                                  QStringLiteral("height"),
+                                  QStringLiteral("aspect"),
+                                  QStringLiteral("progressive"),
+                                  QStringLiteral("top_field_first"),
+                                  QStringLiteral("deinterlace_method"),
+                                  QStringLiteral("rescale"),
+                                  QStringLiteral("pix_fmt"),
+                                  QStringLiteral("color_trc"),
+                                  QStringLiteral("colorspace"),
+                                  QStringLiteral("channels"),
+                                  QStringLiteral("channel_layout"),
+                                  QStringLiteral("ar"),
+                                  QStringLiteral("frequency"),
+                                  QStringLiteral("an"),
+                                  QStringLiteral("threads"),
+                                  QStringLiteral("real_time")};
+
+// Pixel formats that ffvhuff can encode, the intermediate keeps the pixel format requested by the consumer
+const QStringList ffvhuffFormats{QStringLiteral("yuv420p"),
+                                 QStringLiteral("yuv422p"),
+                                 QStringLiteral("yuv444p"),
+                                 QStringLiteral("yuv411p"),
+                                 QStringLiteral("yuv410p"),
+                                 QStringLiteral("yuv440p"),
+                                 QStringLiteral("yuva420p"),
+                                 QStringLiteral("yuva422p"),
+                                 QStringLiteral("yuva444p"),
+                                 QStringLiteral("yuv420p10le"),
+                                 QStringLiteral("yuv422p10le"),
+                                 QStringLiteral("yuv444p10le"),
+                                 QStringLiteral("yuv420p12le"),
+                                 QStringLiteral("yuv422p12le"),
+                                 QStringLiteral("yuv444p12le"),
+                                 QStringLiteral("yuv420p16le"),
+                                 QStringLiteral("yuv422p16le"),
+                                 QStringLiteral("yuv444p16le"),
+                                 QStringLiteral("gbrp"),
+                                 QStringLiteral("gbrap"),
+                                 QStringLiteral("gbrp10le"),
+                                 QStringLiteral("gbrp12le"),
+                                 QStringLiteral("gbrp16le"),
+                                 QStringLiteral("gray"),
+                                 QStringLiteral("gray16le"),
+                                 QStringLiteral("rgb24"),
+                                 QStringLiteral("bgra")};
+
+/* Bytes per pixel of a planar or packed pixel format, before compression. 4:2:2 8 bit if unknown */
+double pixelSize(const QString &pixFmt)
+{
+    if (pixFmt.isEmpty()) {
+        return 2.;
+    }
+    if (pixFmt == QLatin1String("rgb24")) {
+        return 3.;
+    }
+    if (pixFmt == QLatin1String("bgra")) {
+        return 4.;
+    }
+    double samples = 2.;
+    if (pixFmt.startsWith(QLatin1String("gray"))) {
+        samples = 1.;
+    } else if (pixFmt.startsWith(QLatin1String("gbr")) || pixFmt.contains(QLatin1String("444"))) {
+        samples = 3.;
+    } else if (pixFmt.contains(QLatin1String("420")) || pixFmt.contains(QLatin1String("411"))) {
+        samples = 1.5;
+    } else if (pixFmt.contains(QLatin1String("410"))) {
+        samples = 1.125;
+    }
+    if (pixFmt.startsWith(QLatin1String("yuva")) || pixFmt.startsWith(QLatin1String("gbrap"))) {
+        samples += 1.;
+    }
+    // Formats above 8 bit end with their depth and endianness, like yuv422p10le
+    return pixFmt.endsWith(QLatin1String("le")) ? samples * 2 : samples;
+}
+
+/* The PCM codec of the intermediate, as deep as the audio the output encodes so that nothing is lost before encoding */
+QString pcmCodec(const QDomElement &consumer)
+{
+    const QString acodec = consumer.attribute(QStringLiteral("acodec"));
+    if (acodec.startsWith(QLatin1String("pcm_"))) {
+        return acodec;
+    }
+    const QString format = consumer.attribute(QStringLiteral("sample_fmt"), consumer.attribute(QStringLiteral("mlt_audio_format")));
+    if (format.startsWith(QLatin1String("flt")) || format.startsWith(QLatin1String("f32"))) {
+        return QStringLiteral("pcm_f32le");
+    }
+    if (format.startsWith(QLatin1String("dbl")) || format.startsWith(QLatin1String("f64"))) {
+        return QStringLiteral("pcm_f64le");
+    }
+    if (format.startsWith(QLatin1String("s32"))) {
+        return QStringLiteral("pcm_s32le");
+    }
+    if (format.startsWith(QLatin1String("s24"))) {
+        return QStringLiteral("pcm_s24le");
+    }
+    if (format.isEmpty() && !acodec.isEmpty() && acodec != QLatin1String("flac") && acodec != QLatin1String("alac")) {
+        // Lossy encoders work on float samples
+        return QStringLiteral("pcm_f32le");
+    }
+    return QStringLiteral("pcm_s16le");
+}
+
+/* Bytes per sample of a PCM codec like pcm_s24le */
+int pcmSampleSize(const QString &codec)
+{
+    const int bits = codec.mid(5, codec.size() - 7).toInt();
+    return bits > 0 ? bits / 8 : 2;
+}
+
+QSize frameSize(const QDomElement &consumer)
+{
+    const QString size = consumer.attribute(QStringLiteral("s"));
+    return {size.section(QLatin1Char('x'), 0, 0, QString::SectionCaseInsensitiveSeps).toInt(),
+            size.section(QLatin1Char('x'), 1, 1, QString::SectionCaseInsensitiveSeps).toInt()};
+}
+} // namespace
+
+namespace TwoPassCache {
+
+bool canCache(const QDomElement &consumer)
+{
+    if (consumer.isNull() || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat")) {
+        return false;
+    }
+    if (!consumer.hasAttribute(QStringLiteral("in")) || !consumer.hasAttribute(QStringLiteral("out")) ||
+        consumer.attribute(QStringLiteral("out")).toInt() <= consumer.attribute(QStringLiteral("in")).toInt()) {
+        return false;
+    }
+    if (consumer.hasAttribute(QStringLiteral("r")) || consumer.attribute(QStringLiteral("vn")).toInt() == 1 ||
+        consumer.attribute(QStringLiteral("f")) == QLatin1String("image2") || consumer.attribute(QStringLiteral("target")).contains(QLatin1Char('%'))) {
+        return false;
+    }
+    if (consumer.hasAttribute(QStringLiteral("pix_fmt")) && !ffvhuffFormats.contains(consumer.attribute(QStringLiteral("pix_fmt")))) {
+        return false;
+    }
+    return !consumer.hasAttribute(QStringLiteral("s")) || !frameSize(consumer).isEmpty();
+}
+
+QDomDocument cachePlaylist(const QDomDocument &playlist, const QString &cacheFile)
+{
+    QDomDocument doc = playlist.cloneNode(true).toDocument();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    QDomElement cache = doc.createElement(QStringLiteral("consumer"));
+    for (const QString &name : frameProperties) {
+        if (consumer.hasAttribute(name)) {
+            cache.setAttribute(name, consumer.attribute(name));
+        }
+    }
+    // A fast lossless codec, the intermediate is read twice and deleted after the second pass
+    cache.setAttribute(QStringLiteral("mlt_service"), QStringLiteral("avformat"));
+    cache.setAttribute(QStringLiteral("target"), cacheFile);
+    cache.setAttribute(QStringLiteral("f"), QStringLiteral("matroska"));
+    cache.setAttribute(QStringLiteral("vcodec"), QStringLiteral("ffvhuff"));
+    cache.setAttribute(QStringLiteral("acodec"), pcmCodec(consumer));
+    doc.documentElement().replaceChild(cache, consumer);
+    return doc;
+}
+
+qint64 cacheSize(const QDomDocument &playlist)
+{
+    QDomElement root = playlist.documentElement();
+    QDomElement consumer = root.firstChildElement(QStringLiteral("consumer"));
+    QDomElement profile = root.firstChildElement(QStringLiteral("profile"));
+    const qint64 frames = consumer.attribute(QStringLiteral("out")).toInt() - consumer.attribute(QStringLiteral("in")).toInt() + 1;
+    QSize size = frameSize(consumer);
+    if (size.isEmpty()) {
+        size = QSize(profile.attribute(QStringLiteral("width")).toInt(), profile.attribute(QStringLiteral("height")).toInt());
+    }
+    qint64 bytes = qint64(frames * size.width() * size.height() * pixelSize(consumer.attribute(QStringLiteral("pix_fmt"))));
+    if (consumer.attribute(QStringLiteral("an")).toInt() != 1) {
+        double fps = 25.;
+        int num = profile.attribute(QStringLiteral("frame_rate_num")).toInt();
+        int den = profile.attribute(QStringLiteral("frame_rate_den")).toInt();
+        if (num > 0 && den > 0) {
+            fps = double(num) / den;
+        }
+        int frequency = consumer.attribute(QStringLiteral("ar"), consumer.attribute(QStringLiteral("frequency"))).toInt();
+        int channels = consumer.attribute(QStringLiteral("channels")).toInt();
+        bytes += qint64(frames / fps * (frequency > 0 ? frequency : 48000)) * (channels > 0 ? channels : 2) * pcmSampleSize(pcmCodec(consumer));
+    }
+    return bytes;
+}
+
+QDomDocument passPlaylist(const QDomDocument &playlist, const QString &cacheFile)
+{
+    QDomDocument doc = playlist.cloneNode(true).toDocument();
+    QDomElement root = doc.documentElement();
+    QDomElement consumer = root.firstChildElement(QStringLiteral("consumer"));
+    QDomElement profile = root.firstChildElement(QStringLiteral("profile"));
+    const int length = consumer.attribute(QStringLiteral("out")).toInt() - consumer.attribute(QStringLiteral("in")).toInt() + 1;
+    // Only keep the profile and consumer, the timeline is replaced by the intermediate
+    QDomElement child = root.firstChildElement();
+    while (!child.isNull()) {
+        QDomElement next = child.nextSiblingElement();
+        if (child != consumer && child != profile) {
+            root.removeChild(child);
+        }
+        child = next;
+    }
+    const QSize size = frameSize(consumer);
+    if (!profile.isNull() && !size.isEmpty()) {
+        // The intermediate already has the output size, keep the display aspect ratio of the profile
+        int dar_num = profile.attribute(QStringLiteral("display_aspect_num")).toInt();
+        int dar_den = profile.attribute(QStringLiteral("display_aspect_den")).toInt();
+        profile.setAttribute(QStringLiteral("width"), size.width());
+        profile.setAttribute(QStringLiteral("height"), size.height());
+        if (dar_num > 0 && dar_den > 0) {
+            profile.setAttribute(QStringLiteral("sample_aspect_num"), dar_num * size.height());
+            profile.setAttribute(QStringLiteral("sample_aspect_den"), dar_den * size.width());
+        }
+        consumer.removeAttribute(QStringLiteral("s"));
+    }
+    QDomElement producer = doc.createElement(QStringLiteral("producer"));
+    producer.setAttribute(QStringLiteral("id"), QStringLiteral("twopass_cache"));
+    producer.setAttribute(QStringLiteral("in"), 0);
+    producer.setAttribute(QStringLiteral("out"), length - 1);
+    auto addProperty = [&doc, &producer](const QString &name, const QString &value) {
+        QDomElement property = doc.createElement(QStringLiteral("property"));
+        property.setAttribute(QStringLiteral("name"), name);
+        property.appendChild(doc.createTextNode(value));
+        producer.appendChild(property);
+    };
+    addProperty(QStringLiteral("resource"), cacheFile);
+    addProperty(QStringLiteral("mlt_service"), QStringLiteral("avformat"));
+    root.insertBefore(producer, consumer);
+    consumer.setAttribute(QStringLiteral("in"), 0);
+    consumer.setAttribute(QStringLiteral("out"), length - 1);
+    return doc;
+}
+
+} // namespace TwoPassCache
@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef TWOPASSCACHE_H
+#define TWOPASSCACHE_H
+
+#include <QDomDocument>
+#include <QStringList>
+
+/** @brief Helpers used to encode a two pass render from a lossless intermediate file. The timeline, with
+ *  all its decoding and effects, is rendered once to the intermediate, then both passes read it instead
+ *  of evaluating the timeline again.
+ */
+namespace TwoPassCache {
+
+/** @brief Returns true if the consumer of a render playlist can be encoded from an intermediate. Frame rate
+ *  conversions, image sequences, audio only renders and pixel formats that the lossless codec cannot store are
+ *  rendered from the timeline.
+ */
+bool canCache(const QDomElement &consumer);
+
+/** @brief Returns a copy of the render playlist writing the timeline to a lossless intermediate at cacheFile.
+ *  The intermediate keeps the frame size, field order, pixel format, audio layout and sample depth requested by the consumer.
+ */
+QDomDocument cachePlaylist(const QDomDocument &playlist, const QString &cacheFile);
+
+/** @brief Returns an upper estimate of the intermediate's size in bytes, assuming no compression of the frames.
+ *  The frame size is read from the consumer, or the profile if the consumer does not scale.
+ */
+qint64 cacheSize(const QDomDocument &playlist);
+
+/** @brief Returns a copy of the render playlist (one of the passes) reading its frames from the intermediate.
+ *  The profile is set to the intermediate's frame size so that frames are not scaled again.
+ */
+QDomDocument passPlaylist(const QDomDocument &playlist, const QString &cacheFile);
+
+} // namespace TwoPassCache
+
+#endif
@@ -0,0 +1,285 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "twopassrenderjob.h"
+#include "renderjob.h"
+#include "twopasscache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDomDocument>
+#include <QFileInfo>
+#include <QStorageInfo>
+#include <QtDBus>
+
+TwoPassRenderJob::TwoPassRenderJob(const QString &render, const QString &firstPass, const QString &secondPass, const QString &target, int pid,
+                                   QObject *parent)
+    : QObject(parent)
+    , m_prog(render)
+    , m_scenelists({firstPass, secondPass})
+    , m_dest(target)
+    , m_pid(pid)
+    , m_erase(firstPass.startsWith(QDir::tempPath()))
+    , m_logfile(target + QStringLiteral(".log"))
+    , m_progressLog(target, true)
+{
+    if (!m_logfile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Unable to log to " << m_logfile.fileName();
+    } else {
+        m_logstream.setDevice(&m_logfile);
+    }
+}
+
+TwoPassRenderJob::~TwoPassRenderJob()
+{
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+    delete m_process;
+    m_logfile.close();
+}
+
+bool TwoPassRenderJob::prepare()
+{
+    QVector<QDomDocument> passes;
+    for (const QString &scenelist : qAsConst(m_scenelists)) {
+        QFile f(scenelist);
+        QDomDocument doc;
+        if (!f.open(QIODevice::ReadOnly) || !doc.setContent(&f, false)) {
+            return false;
+        }
+        if (!TwoPassCache::canCache(doc.documentElement().firstChildElement(QStringLiteral("consumer")))) {
+            return false;
+        }
+        passes << doc;
+    }
+    QDomElement consumer = passes.constLast().documentElement().firstChildElement(QStringLiteral("consumer"));
+    m_in = consumer.attribute(QStringLiteral("in")).toInt();
+    // The intermediate is written next to the destination, or in the temporary folder (TMPDIR) if the destination disk is
+    // too small. Without room for it, the passes are rendered from the timeline
+    const qint64 needed = TwoPassCache::cacheSize(passes.constLast());
+    for (const QString &folder : {QFileInfo(m_dest).absolutePath(), QDir::tempPath()}) {
+        QStorageInfo storage(folder);
+        // Keep some room for the output and the pass statistics
+        if (storage.isValid() && storage.bytesAvailable() - needed > needed / 10) {
+            m_tmpDir.reset(new QTemporaryDir(QDir(folder).absoluteFilePath(QStringLiteral(".kdenlive-render-XXXXXX"))));
+            if (m_tmpDir->isValid()) {
+                break;
+            }
+        }
+        m_tmpDir.reset();
+    }
+    if (!m_tmpDir) {
+        m_logstream << "Not enough disk space for a " << needed / 1048576 << "MB intermediate, rendering both passes from the timeline\n";
+        m_logstream.flush();
+        return false;
+    }
+    const QString cacheFile = m_tmpDir->filePath(QStringLiteral("cache.mkv"));
+    auto addStage = [this](const QDomDocument &playlist, const QString &name, int weight) {
+        Stage stage{name, m_tmpDir->filePath(name + QStringLiteral(".mlt")), weight};
+        QFile file(stage.playlist);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return false;
+        }
+        file.write(playlist.toString().toUtf8());
+        file.close();
+        QDomElement cons = playlist.documentElement().firstChildElement(QStringLiteral("consumer"));
+        if (cons.hasAttribute(QLatin1String("s"))) {
+            // Workaround MLT embedded consumer resize (MLT issue #453), see kdenlive_render
+            stage.playlist = QStringLiteral("xml:%1?multi=1").arg(stage.playlist);
+        }
+        m_stages << stage;
+        return true;
+    };
+    // Decoding and effects happen in the first stage, it usually takes most of the time
+    return addStage(TwoPassCache::cachePlaylist(passes.constLast(), cacheFile), QStringLiteral("cache"), 60) &&
+           addStage(TwoPassCache::passPlaylist(passes.constFirst(), cacheFile), QStringLiteral("pass1"), 15) &&
+           addStage(TwoPassCache::passPlaylist(passes.constLast(), cacheFile), QStringLiteral("pass2"), 25);
+}
+
+void TwoPassRenderJob::start()
+{
+    m_kdenliveinterface = RenderJob::kdenliveInterface(m_pid, this);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, 0, m_in});
+        connect(m_kdenliveinterface, SIGNAL(abortRenderJob(QString)), this, SLOT(slotAbort(QString)));
+        connect(m_kdenliveinterface, SIGNAL(pauseRenderJob(QString,bool)), this, SLOT(slotPause(QString,bool)));
+    }
+    m_logstream << "Timing log: " << m_progressLog.fileName() << "\n";
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = m_dest;
+    m_progressLog.write(record);
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    startStage(0);
+}
+
+void TwoPassRenderJob::startStage(int index)
+{
+    m_current = index;
+    m_errorMessage.clear();
+    if (m_process) {
+        // The previous stage's process may still be delivering its finished signal
+        m_process->deleteLater();
+    }
+    m_process = new QProcess;
+    m_process->setReadChannel(QProcess::StandardError);
+    connect(m_process, &QProcess::readyReadStandardError, this, &TwoPassRenderJob::receivedStderr);
+    connect(m_process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &TwoPassRenderJob::stageFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            setFailed(tr("Cannot start %1").arg(m_prog));
+        }
+    });
+    const QStringList args = {QStringLiteral("-progress"), m_stages.at(index).playlist};
+    m_logstream << "Started render process: " << m_prog << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    m_logstream.flush();
+    m_stageStart = m_progressLog.elapsed();
+    m_process->start(m_prog, args);
+}
+
+void TwoPassRenderJob::receivedStderr()
+{
+    QString result = QString::fromLocal8Bit(m_process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+        return;
+    }
+    int progress = result.section(QLatin1Char(' '), -1).toInt();
+    int frame = result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt();
+    if (progress <= 0 || progress > 100) {
+        return;
+    }
+    int done = 0;
+    for (int i = 0; i < m_current; ++i) {
+        done += m_stages.at(i).weight;
+    }
+    // The last percent is reached when the second pass is finished
+    progress = qMin(99, done + m_stages.at(m_current).weight * progress / 100);
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    // Passes read the intermediate from its start
+    if (m_current > 0) {
+        frame += m_in;
+    }
+    RenderProgress::Record record;
+    record.frame = frame;
+    record.frames = frame - m_in;
+    record.percent = m_progress;
+    record.fps = 1000. * record.frames / qMax(qint64(1), m_progressLog.elapsed() - m_stageStart);
+    record.message = m_stages.at(m_current).name;
+    m_progressLog.write(record);
+    if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), {m_dest, m_progress, frame});
+    }
+}
+
+void TwoPassRenderJob::stageFinished(int exitCode, QProcess::ExitStatus status)
+{
+    if (m_finished) {
+        return;
+    }
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        setFailed(m_errorMessage.isEmpty() ? m_process->errorString() : m_errorMessage);
+        return;
+    }
+    const QString name = m_stages.at(m_current).name;
+    m_stageTimes.insert(name, m_progressLog.elapsed() - m_stageStart);
+    m_logstream << "Finished stage " << name << "\n";
+    if (m_current + 1 < m_stages.size()) {
+        startStage(m_current + 1);
+    } else {
+        setFinished(-1);
+    }
+}
+
+void TwoPassRenderJob::slotAbort(const QString &url)
+{
+    if (m_dest == url) {
+        slotAbort();
+    }
+}
+
+void TwoPassRenderJob::slotAbort()
+{
+    qWarning() << "Job aborted by user...";
+    m_finished = true;
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+    QFile(m_dest).remove();
+    m_logstream << "Job aborted by user" << "\n";
+    setFinished(-3);
+}
+
+void TwoPassRenderJob::slotPause(const QString &url, bool pause)
+{
+    if (m_dest == url) {
+        RenderJob::pauseProcess(m_process, pause);
+        m_logstream << (pause ? "Job paused" : "Job resumed") << "\n";
+    }
+}
+
+void TwoPassRenderJob::setFailed(const QString &error)
+{
+    m_finished = true;
+    if (m_process && m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+    QString message = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+    m_logstream << message << "\n" << error << "\n";
+    QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), message});
+    setFinished(-2, error);
+}
+
+void TwoPassRenderJob::setFinished(int status, const QString &error)
+{
+    m_finished = true;
+    RenderProgress::Record record;
+    record.event = status == -1 ? RenderProgress::Event::Finished : (status == -3 ? RenderProgress::Event::Aborted : RenderProgress::Event::Failed);
+    record.percent = status == -1 ? 100 : m_progress;
+    record.stages = m_stageTimes;
+    record.message = error;
+    m_progressLog.write(record);
+    if (m_kdenliveinterface) {
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingFinished"), {m_dest, status, error});
+    }
+    if (m_erase) {
+        for (const QString &scenelist : qAsConst(m_scenelists)) {
+            QFile(scenelist).remove();
+        }
+    }
+    if (status == -1) {
+        m_logfile.remove();
+    } else {
+        m_logstream.flush();
+    }
+    // The intermediate is deleted with the temporary folder
+    m_tmpDir.reset();
+    emit renderingFinished();
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef TWOPASSRENDERJOB_H
+#define TWOPASSRENDERJOB_H
+
+#include "../src/lib/renderprogress.h"
+
+#include <QDBusInterface>
+#include <QFile>
+#include <QMap>
+#include <QObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+#include <memory>
+
+/**
+ * @class TwoPassRenderJob
+ * @brief Renders a two pass encoding while evaluating the timeline only once.
+ *
+ * The timeline is first rendered to a lossless intermediate file, with the frame size and audio
+ * layout of the output. Both encoding passes then read the intermediate instead of decoding the
+ * clips and applying the effects again. The intermediate is written next to the destination, or in
+ * the temporary folder if the destination disk is too small, and deleted when the job ends. If no
+ * folder has room for it, prepare() fails and the passes are rendered from the timeline as before.
+ * The time spent in each stage is recorded in the timing log.
+ */
+class TwoPassRenderJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    TwoPassRenderJob(const QString &render, const QString &firstPass, const QString &secondPass, const QString &target, int pid = -1,
+                     QObject *parent = nullptr);
+    ~TwoPassRenderJob() override;
+    /** @brief Write the playlists of the stages. Returns false if the passes cannot be encoded from an intermediate */
+    bool prepare();
+
+public slots:
+    void start();
+
+private slots:
+    void slotAbort();
+    void slotAbort(const QString &url);
+    void slotPause(const QString &url, bool pause);
+
+private:
+    struct Stage
+    {
+        QString name;
+        QString playlist;
+        /** @brief Share of the job progress */
+        int weight;
+    };
+    QString m_prog;
+    QStringList m_scenelists;
+    QString m_dest;
+    int m_pid;
+    int m_in{0};
+    int m_progress{0};
+    int m_current{-1};
+    qint64 m_stageStart{0};
+    bool m_finished{false};
+    bool m_erase;
+    QVector<Stage> m_stages;
+    std::unique_ptr<QTemporaryDir> m_tmpDir;
+    QProcess *m_process{nullptr};
+    QString m_errorMessage;
+    QDBusInterface *m_kdenliveinterface{nullptr};
+    /** @brief Used to create a temporary file for logging. */
+    QFile m_logfile;
+    QTextStream m_logstream;
+    /** @brief The progress records, kept in the timing log */
+    RenderProgress::Log m_progressLog;
+    QMap<QString, qint64> m_stageTimes;
+
+    void startStage(int index);
+    void receivedStderr();
+    void stageFinished(int exitCode, QProcess::ExitStatus status);
+    void setFailed(const QString &error);
+    void setFinished(int status, const QString &error = QString());
+
+signals:
+    void renderingFinished();
+};
+
+#endif
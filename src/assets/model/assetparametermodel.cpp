@@ -279,10 +279,10 @@ void AssetParameterModel::setParameter(const QString &name, int value, bool upda
         // Update fades in timeline
         pCore->updateItemModel(m_ownerId, m_assetId);
         if (!m_isAudio) {
-            // Trigger monitor refresh
-            pCore->refreshProjectItem(m_ownerId);
-            // Invalidate timeline preview
-            pCore->invalidateItem(m_ownerId);
+            // Trigger monitor refresh, merged with other pending requests
+            pCore->scheduleItemRefresh(m_ownerId);
+            // Invalidate timeline preview once the parameter stops changing
+            pCore->scheduleItemInvalidation(m_ownerId);
         }
     }
 }
@@ -382,10 +382,10 @@ void AssetParameterModel::setParameter(const QString &name, const QString &param
         // Update fades in timeline
         pCore->updateItemModel(m_ownerId, m_assetId);
         if (!m_isAudio) {
-            // Trigger monitor refresh
-            pCore->refreshProjectItem(m_ownerId);
-            // Invalidate timeline preview
-            pCore->invalidateItem(m_ownerId);
+            // Trigger monitor refresh, merged with other pending requests
+            pCore->scheduleItemRefresh(m_ownerId);
+            // Invalidate timeline preview once the parameter stops changing
+            pCore->scheduleItemInvalidation(m_ownerId);
         }
     }
 }
@@ -39,6 +39,7 @@
 #include "kdenlivesettings.h"
 #include "keyframeimport.h"
 #include "profiles/profilemodel.hpp"
+#include "utils/analysistrack.hpp"
 #include "widgets/positionwidget.h"
 #include <macros.hpp>
 
@@ -258,6 +259,26 @@ KeyframeImport::KeyframeImport(const QString &animData, std::shared_ptr<AssetPar
     connect(m_limitKeyframes, &QCheckBox::toggled, m_limitNumber, &QSpinBox::setEnabled);
     connect(m_limitKeyframes, &QAbstractButton::toggled, this, &KeyframeImport::updateDisplay);
     connect(m_limitNumber, SIGNAL(valueChanged(int)), this, SLOT(updateDisplay()));
+    l1 = new QHBoxLayout;
+    m_simplify = new QCheckBox(i18n("Simplify curve"), this);
+    m_simplify->setToolTip(i18n("Only import the keyframes needed to follow the data within the tolerance"));
+    m_simplify->setChecked(KdenliveSettings::simplifyimportedkeyframes());
+    m_tolerance = new QDoubleSpinBox(this);
+    m_tolerance->setToolTip(i18n("Maximum deviation from the imported data, in percent of the parameter range"));
+    m_tolerance->setRange(0., 10.);
+    m_tolerance->setDecimals(2);
+    m_tolerance->setSingleStep(0.1);
+    m_tolerance->setSuffix(i18n("%"));
+    m_tolerance->setValue(KdenliveSettings::keyframeimporttolerance());
+    m_tolerance->setEnabled(m_simplify->isChecked());
+    l1->addWidget(m_simplify);
+    l1->addWidget(new QLabel(i18n("Tolerance"), this));
+    l1->addWidget(m_tolerance);
+    l1->addStretch(10);
+    lay->addLayout(l1);
+    connect(m_simplify, &QCheckBox::toggled, m_tolerance, &QDoubleSpinBox::setEnabled);
+    connect(m_simplify, &QCheckBox::toggled, &KdenliveSettings::setSimplifyimportedkeyframes);
+    connect(m_tolerance, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), &KdenliveSettings::setKeyframeimporttolerance);
     connect(m_dataCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(updateDataDisplay()));
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
     connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
@@ -281,6 +302,8 @@ void KeyframeImport::updateDataDisplay()
     QString comboData = m_dataCombo->currentData().toString();
     auto type = m_dataCombo->currentData(Qt::UserRole + 1).value<ParamType>();
     m_maximas = KeyframeModel::getRanges(comboData, m_model);
+    // Parse the data once for the curves preview
+    m_track = std::make_shared<const AnalysisTrack>(AnalysisTrack::fromAnimation(comboData));
     m_sourceCombo->clear();
     if (type == ParamType::KeyframeParam) {
         // 1 dimensional param.
@@ -501,6 +524,22 @@ void KeyframeImport::drawKeyFrameChannels(QPixmap &pix, int in, int out, int lim
 {
     qDebug()<<"============= DRAWING KFR CHANNS: "<<m_dataCombo->currentData().toString();
     std::shared_ptr<Mlt::Properties> animData = KeyframeModel::getAnimation(m_model, m_dataCombo->currentData().toString());
+    // Sample the parsed track when possible instead of going through the MLT animation for each pixel
+    bool useTrack = m_track && m_track->isValid() && m_track->components() >= 4;
+    double values[5] = {0};
+    auto rectAt = [&](int frame) {
+        if (!useTrack) {
+            return animData->anim_get_rect("key", frame);
+        }
+        m_track->valuesAt(frame, values);
+        mlt_rect rect;
+        rect.x = values[0];
+        rect.y = values[1];
+        rect.w = values[2];
+        rect.h = values[3];
+        rect.o = m_track->components() > 4 ? values[4] : 1.;
+        return rect;
+    };
     QRect br(0, 0, pix.width(), pix.height());
     double frameFactor = (double)(out - in) / br.width();
     int offset = 1;
@@ -571,7 +610,7 @@ void KeyframeImport::drawKeyFrameChannels(QPixmap &pix, int in, int out, int lim
 
     // Draw curves
     for (int i = 0; i < br.width(); i++) {
-        mlt_rect rect = animData->anim_get_rect("key", (int)(i * frameFactor) + in);
+        mlt_rect rect = rectAt((int)(i * frameFactor) + in);
         if (xDist > 0) {
             painter.setPen(cX);
             int val = (rect.x - xOffset) * maxHeight / xDist;
@@ -601,10 +640,10 @@ void KeyframeImport::drawKeyFrameChannels(QPixmap &pix, int in, int out, int lim
         cY.setAlpha(255);
         cW.setAlpha(255);
         cH.setAlpha(255);
-        mlt_rect rect1 = animData->anim_get_rect("key", in);
+        mlt_rect rect1 = rectAt(in);
         int prevPos = 0;
         for (int i = offset; i < br.width(); i += offset) {
-            mlt_rect rect2 = animData->anim_get_rect("key", (int)(i * frameFactor) + in);
+            mlt_rect rect2 = rectAt((int)(i * frameFactor) + in);
             if (xDist > 0) {
                 painter.setPen(cX);
                 int val1 = (rect1.x - xOffset) * maxHeight / xDist;
@@ -645,6 +684,116 @@ void KeyframeImport::importSelectedData()
     Fun redo = []() { return true; };
     // Geometry target
     int finalAlign = m_alignCombo->currentIndex();
+    KeyframeImport::ImportRoles convertMode = static_cast<KeyframeImport::ImportRoles> (m_sourceCombo->currentData().toInt());
+    auto alignedRect = [&](int frame) {
+        mlt_rect rect = animData->anim_get_rect("key", frame);
+        if (convertMode == ImportRoles::Position) {
+            switch (finalAlign) {
+            case 1:
+                // Align center
+                rect.x += rect.w / 2;
+                rect.y += rect.h / 2;
+                break;
+            case 2:
+                //Align bottom right
+                rect.x += rect.w;
+                rect.y += rect.h;
+                break;
+            default:
+                break;
+            }
+        }
+        return rect;
+    };
+    // Collect the imported values, so that keyframes which can be interpolated from their neighbours are dropped
+    AnalysisTrack samples(convertMode == ImportRoles::FullGeometry ? 4 : convertMode == ImportRoles::Position ? 2 : 1);
+    QVector<double> values;
+    int frame = 0;
+    mlt_keyframe_type type;
+    for (int i = 0; i < anim->key_count(); i++) {
+        int error = anim->key_get(i, frame, type);
+        if (error) {
+            continue;
+        }
+        values.clear();
+        if (convertMode == ImportRoles::SimpleValue) {
+            values << animData->anim_get_double("key", frame);
+        } else {
+            mlt_rect rect = alignedRect(frame);
+            switch (convertMode) {
+                case ImportRoles::FullGeometry:
+                    values << rect.x << rect.y << rect.w << rect.h;
+                    break;
+                case ImportRoles::Position:
+                    values << rect.x << rect.y;
+                    break;
+                case ImportRoles::YOnly:
+                    values << rect.y;
+                    break;
+                case ImportRoles::WidthOnly:
+                    values << rect.w;
+                    break;
+                case ImportRoles::HeightOnly:
+                    values << rect.h;
+                    break;
+                default:
+                    values << rect.x;
+                    break;
+            }
+        }
+        char kfType = type == mlt_keyframe_discrete ? '|' : (type == mlt_keyframe_smooth ? '~' : 0);
+        samples.append(frame, kfType, values);
+    }
+    // The tolerance is a percentage of each component's range: the parameter range, or the frame size for geometries
+    QVector<double> tolerances;
+    const double profileWidth = pCore->getCurrentProfile()->width();
+    const double profileHeight = pCore->getCurrentProfile()->height();
+    switch (convertMode) {
+    case ImportRoles::SimpleValue: {
+        const QModelIndex target = m_targetCombo->currentData().toModelIndex();
+        double range = m_model->data(target, AssetParameterModel::MaxRole).toDouble() - m_model->data(target, AssetParameterModel::MinRole).toDouble();
+        if (range <= 0.) {
+            // Unbounded parameter, use the range of the data
+            double min = 0.;
+            double max = 0.;
+            for (int i = 0; i < samples.count(); ++i) {
+                min = i == 0 ? samples.value(i, 0) : qMin(min, samples.value(i, 0));
+                max = i == 0 ? samples.value(i, 0) : qMax(max, samples.value(i, 0));
+            }
+            range = max - min;
+        }
+        tolerances << range;
+        break;
+    }
+    case ImportRoles::FullGeometry:
+        tolerances << profileWidth << profileHeight << profileWidth << profileHeight;
+        break;
+    case ImportRoles::Position:
+        tolerances << profileWidth << profileHeight;
+        break;
+    case ImportRoles::YOnly:
+    case ImportRoles::HeightOnly:
+        tolerances << profileHeight;
+        break;
+    default:
+        tolerances << profileWidth;
+        break;
+    }
+    for (double &tolerance : tolerances) {
+        tolerance *= m_tolerance->value() / 100.;
+    }
+    double deviation = 0.;
+    const AnalysisTrack keyframes = m_simplify->isChecked() ? samples.simplified(tolerances, &deviation) : samples;
+    auto keyframeType = [&keyframes](int ix) {
+        switch (keyframes.keyframeType(ix)) {
+        case '|':
+            return KeyframeType::Discrete;
+        case '~':
+            return KeyframeType::Curve;
+        default:
+            return KeyframeType::Linear;
+        }
+    };
     QLocale locale; // Import from clipboard – OK to use locale here?
     locale.setNumberOptions(QLocale::OmitGroupSeparator);
     for (const auto &ix : qAsConst(m_indexes)) {
@@ -653,18 +802,12 @@ void KeyframeImport::importSelectedData()
         qDebug()<<"== "<<ix<<" = "<<m_targetCombo->currentData().toModelIndex();
         if (ix == m_targetCombo->currentData().toModelIndex()) {
             // Import our keyframes
-            int frame = 0;
-            KeyframeImport::ImportRoles convertMode = static_cast<KeyframeImport::ImportRoles> (m_sourceCombo->currentData().toInt());
-            mlt_keyframe_type type;
-            for (int i = 0; i < anim->key_count(); i++) {
-                int error = anim->key_get(i, frame, type);
-                if (error) {
-                    continue;
-                }
+            for (int i = 0; i < keyframes.count(); i++) {
+                frame = keyframes.frame(i);
                 QVariant current = km->getInterpolatedValue(frame);
                 if (convertMode == ImportRoles::SimpleValue) {
                     double dval = animData->anim_get_double("key", frame);
-                    km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), (KeyframeType)type, dval, true, undo, redo);
+                    km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), keyframeType(i), dval, true, undo, redo);
                     continue;
                 }
                 QStringList kfrData = current.toString().split(QLatin1Char(' '));
@@ -690,23 +833,7 @@ void KeyframeImport::importSelectedData()
                         }
                         break;
                 }
-                mlt_rect rect = animData->anim_get_rect("key", frame);
-                if (convertMode == ImportRoles::Position) {
-                    switch (finalAlign) {
-                    case 1:
-                        // Align center
-                        rect.x += rect.w / 2;
-                        rect.y += rect.h / 2;
-                        break;
-                    case 2:
-                        //Align bottom right
-                        rect.x += rect.w;
-                        rect.y += rect.h;
-                        break;
-                    default:
-                        break;
-                    }
-                }
+                mlt_rect rect = alignedRect(frame);
                 switch (convertMode) {
                     case ImportRoles::FullGeometry:
                         kfrData[0] = locale.toString((int)rect.x);
@@ -735,23 +862,23 @@ void KeyframeImport::importSelectedData()
                         break;
                 }
                 current = kfrData.join(QLatin1Char(' '));
-                km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), (KeyframeType)type, current, true, undo, redo);
+                km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), keyframeType(i), current, true, undo, redo);
             }
         } else {
-            int frame = 0;
-            mlt_keyframe_type type;
-            for (int i = 0; i < anim->key_count(); i++) {
-                int error = anim->key_get(i, frame, type);
-                if (error) {
-                    continue;
-                }
+            for (int i = 0; i < keyframes.count(); i++) {
+                frame = keyframes.frame(i);
                 //frame += (m_inPoint->getPosition() - m_offsetPoint->getPosition());
                 QVariant current = km->getInterpolatedValue(frame);
-                km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), (KeyframeType)type, current, true, undo, redo);
+                km->addKeyframe(GenTime(frame - m_inPoint->getPosition() + m_offsetPoint->getPosition(), pCore->getCurrentFps()), keyframeType(i), current, true, undo, redo);
             }
         }
     }
     pCore->pushUndo(undo, redo, i18n("Import keyframes from clipboard"));
+    if (samples.count() > 0 && keyframes.count() < samples.count()) {
+        pCore->displayMessage(i18n("Imported %1 of %2 keyframes (%3%), maximum deviation %4%", keyframes.count(), samples.count(),
+                                   100 * keyframes.count() / samples.count(), QString::number(deviation * m_tolerance->value(), 'g', 3)),
+                              InformationMessage);
+    }
 }
 
 int KeyframeImport::getImportType() const
@@ -30,6 +30,7 @@
 #include "definitions.h"
 #include "timecode.h"
 
+class AnalysisTrack;
 class PositionWidget;
 class QComboBox;
 class QCheckBox;
@@ -61,11 +62,15 @@ private:
     QCheckBox *m_limitRange;
     QCheckBox *m_limitKeyframes;
     QSpinBox *m_limitNumber;
+    QCheckBox *m_simplify;
+    QDoubleSpinBox *m_tolerance;
     QComboBox *m_sourceCombo;
     QComboBox *m_targetCombo;
     QComboBox *m_alignCombo;
     QLabel *m_sourceRangeLabel;
     QList<QPoint> m_maximas;
+    /** @brief The selected data, parsed for fast preview */
+    std::shared_ptr<const AnalysisTrack> m_track;
     QDoubleSpinBox m_destMin;
     QDoubleSpinBox m_destMax;
     /** @brief Contains the 4 dimensional (x,y,w,h) target parameter names / tag **/
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bin.h"
 #include "bincommands.h"
 #include "clipcreator.hpp"
+#include "clipimporter.hpp"
 #include "core.h"
 #include "dialogs/clipcreationdialog.h"
 #include "doc/documentchecker.h"
@@ -3256,14 +3257,14 @@ void Bin::slotItemDropped(const QList<QUrl> &urls, const QModelIndex &parent)
         }
         parentFolder = parentItem->clipId();
     }
-    const QString id = ClipCreator::createClipsFromList(urls, true, parentFolder, m_itemModel);
-    if (!id.isEmpty()) {
+    ClipImporter *importer = ClipCreator::importClips(urls, true, parentFolder, m_itemModel);
+    connect(importer, &ClipImporter::firstItemCreated, this, [this](const QString &id) {
         std::shared_ptr<AbstractProjectItem> item = m_itemModel->getItemByBinId(id);
         if (item) {
             QModelIndex ix = m_itemModel->getIndexFromItem(item);
             m_itemView->scrollTo(m_proxyModel->mapFromSource(ix), QAbstractItemView::PositionAtCenter);
         }
-    }
+    });
 }
 
 void Bin::slotExpandUrl(const ItemInfo &info, const QString &url, QUndoCommand *command)
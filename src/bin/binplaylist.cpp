@@ -25,6 +25,7 @@
 #include "core.h"
 #include "profiles/profilemodel.hpp"
 #include "projectclip.h"
+#include "utils/proxysubstitution.hpp"
 #include <mlt++/Mlt.h>
 
 QString BinPlaylist::binPlaylistId = QString("main_bin");
@@ -182,6 +183,38 @@ QMap<QString, QString> BinPlaylist::getProxies(const QString &root)
     return proxies;
 }
 
+void BinPlaylist::getProxyClips(const QString &root, ProxySubstitution &substitution)
+{
+    int size = m_binPlaylist->count();
+    for (int i = 0; i < size; i++) {
+        QScopedPointer<Mlt::Producer> prod(m_binPlaylist->get_clip(i));
+        if (!prod->is_valid() || prod->is_blank()) {
+            continue;
+        }
+        Mlt::Producer &parent = prod->parent();
+        QString proxy = parent.get("kdenlive:proxy");
+        if (proxy.length() <= 2) {
+            continue;
+        }
+        if (QFileInfo(proxy).isRelative()) {
+            proxy.prepend(root);
+        }
+        ProxySubstitution::Clip clip;
+        clip.original = parent.get("kdenlive:originalurl");
+        if (QFileInfo(clip.original).isRelative()) {
+            clip.original.prepend(root);
+        }
+        clip.name = parent.get("kdenlive:clipname");
+        if (clip.name.isEmpty()) {
+            clip.name = QFileInfo(clip.original).fileName();
+        }
+        // The producer is the proxy, the original properties were backed up when the proxy was requested
+        clip.proxySize = QSize(parent.get_int("meta.media.width"), parent.get_int("meta.media.height"));
+        clip.originalSize = QSize(parent.get_int("kdenlive:original.meta.media.width"), parent.get_int("kdenlive:original.meta.media.height"));
+        substitution.addClip(proxy, clip);
+    }
+}
+
 int BinPlaylist::count() const
 {
     return m_binPlaylist->count();
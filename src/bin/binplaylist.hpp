@@ -40,6 +40,7 @@ class Tractor;
 } // namespace Mlt
 
 class MarkerListModel;
+class ProxySubstitution;
 
 class BinPlaylist : public QObject
 {
@@ -75,6 +76,8 @@ public:
 
     /** @brief Retrieve a list of proxy/original urls */
     QMap<QString, QString> getProxies(const QString &root);
+    /** @brief Register the proxied clips, with their proxy and original frame sizes */
+    void getProxyClips(const QString &root, ProxySubstitution &substitution);
 
     /** @brief The number of clips in the Bin Playlist */
     int count() const;
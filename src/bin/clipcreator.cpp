@@ -21,6 +21,7 @@
 
 #include "clipcreator.hpp"
 #include "bin/bin.h"
+#include "clipimporter.hpp"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "kdenlivesettings.h"
@@ -85,7 +86,7 @@ QString ClipCreator::createColorClip(const QString &color, int duration, const Q
     return res ? id : QStringLiteral("-1");
 }
 
-QDomDocument ClipCreator::getXmlFromUrl(const QString &path)
+QDomDocument ClipCreator::getXmlFromUrl(const QString &path, const QString &mimeType)
 {
     QDomDocument xml;
     QUrl fileUrl = QUrl::fromLocalFile(path);
@@ -95,7 +96,7 @@ QDomDocument ClipCreator::getXmlFromUrl(const QString &path)
         return xml;
     }
     QMimeDatabase db;
-    QMimeType type = db.mimeTypeForUrl(fileUrl);
+    QMimeType type = mimeType.isEmpty() ? db.mimeTypeForUrl(fileUrl) : db.mimeTypeForName(mimeType);
 
     QDomElement prod;
     qDebug()<<"=== GOT DROPPED MIME: "<<type.name();
@@ -333,3 +334,17 @@ const QString ClipCreator::createClipsFromList(const QList<QUrl> &list, bool che
     }
     return id;
 }
+
+ClipImporter *ClipCreator::importClips(const QList<QUrl> &list, bool checkRemovable, const QString &parentFolder, const std::shared_ptr<ProjectItemModel> &model)
+{
+    QList<QUrl> urls;
+    for (const QUrl &file : list) {
+        if (QFile::exists(file.toLocalFile())) {
+            urls << file;
+        }
+    }
+    // Removable devices are checked once the folders are scanned, for all the files found
+    auto *importer = new ClipImporter(urls, checkRemovable, parentFolder, model, pCore->window());
+    importer->start();
+    return importer;
+}
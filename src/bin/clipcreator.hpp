@@ -31,6 +31,7 @@
 /** @brief This namespace provides convenience functions to create clips based on various parameters
  */
 
+class ClipImporter;
 class ProjectItemModel;
 namespace ClipCreator {
 /* @brief Create and inserts a color clip
@@ -96,9 +97,20 @@ const QString createClipsFromList(const QList<QUrl> &list, bool checkRemovable,
                          Fun &redo, bool topLevel = true);
 const QString createClipsFromList(const QList<QUrl> &list, bool checkRemovable, const QString &parentFolder, std::shared_ptr<ProjectItemModel> model);
 
+/* @brief Import the given url list in the background. Folders are scanned recursively in a separate thread, recreating their
+   structure, and the clips are added in batches, each batch being a separate undo entry
+   @param list: the list of items (can be folders)
+   @param checkRemovable: if true, it will check if files are on removable devices, and warn the user if so
+   @param parentFolder: the binId of the containing folder
+   @param model: a shared pointer to the bin item model
+   @return the importer, which deletes itself when done
+ */
+ClipImporter *importClips(const QList<QUrl> &list, bool checkRemovable, const QString &parentFolder, const std::shared_ptr<ProjectItemModel> &model);
+
 /* @brief Create minimal xml description from an url
+   @param mimeType: the mime type of the file if it is already known
  */
-QDomDocument getXmlFromUrl(const QString &path);
+QDomDocument getXmlFromUrl(const QString &path, const QString &mimeType = QString());
 } // namespace ClipCreator
 
 #endif
@@ -0,0 +1,287 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "clipimporter.hpp"
+#include "clipcreator.hpp"
+#include "core.h"
+#include "dialogs/clipcreationdialog.h"
+#include "doc/kdenlivedoc.h"
+#include "kdenlive_debug.h"
+#include "project/projectmanager.h"
+#include "projectitemmodel.h"
+#include "utils/devices.hpp"
+
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <QApplication>
+#include <QDirIterator>
+#include <QDomDocument>
+#include <QHash>
+#include <QMimeDatabase>
+#include <QProgressDialog>
+#include <QSet>
+#include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Number of clips inserted in the bin per event loop iteration
+const int batchSize = 50;
+} // namespace
+
+ClipImporter::ClipImporter(const QList<QUrl> &urls, bool checkRemovable, const QString &parentFolder, std::shared_ptr<ProjectItemModel> model,
+                           QObject *parent)
+    : QObject(parent)
+    , m_urls(urls)
+    , m_checkRemovable(checkRemovable)
+    , m_parentFolder(parentFolder)
+    , m_model(std::move(model))
+{
+    connect(&m_scanWatcher, &QFutureWatcher<QVector<Entry>>::finished, this, &ClipImporter::slotScanDone);
+    // Don't insert clips in another project
+    connect(pCore->projectManager(), &ProjectManager::docOpened, this, &ClipImporter::slotProjectChanged);
+}
+
+ClipImporter::~ClipImporter()
+{
+    m_abort = true;
+    m_scanWatcher.waitForFinished();
+    delete m_progressDialog;
+}
+
+void ClipImporter::start()
+{
+    m_progressDialog = new QProgressDialog(qobject_cast<QWidget *>(parent()));
+    m_progressDialog->setWindowTitle(i18n("Loading clips"));
+    m_progressDialog->setLabelText(i18n("Scanning folders..."));
+    m_progressDialog->setMaximum(0);
+    m_progressDialog->setAutoClose(false);
+    m_progressDialog->setAutoReset(false);
+    m_progressDialog->setMinimumDuration(1000);
+    connect(m_progressDialog.data(), &QProgressDialog::canceled, this, &ClipImporter::abort);
+    // Extensions are read from the settings, get them in the main thread
+    const QStringList filters = ClipCreationDialog::getExtensions();
+    m_scanWatcher.setFuture(QtConcurrent::run(&ClipImporter::scan, m_urls, filters, &m_abort));
+}
+
+void ClipImporter::abort()
+{
+    m_abort = true;
+}
+
+void ClipImporter::slotProjectChanged()
+{
+    m_created = 0;
+    abort();
+}
+
+// static
+QVector<ClipImporter::Entry> ClipImporter::scan(const QList<QUrl> &urls, const QStringList &filters, const std::atomic<bool> *abort)
+{
+    QVector<Entry> entries;
+    QSet<QString> found;
+    for (int root = 0; root < urls.size(); ++root) {
+        QFileInfo info(urls.at(root).toLocalFile());
+        if (!info.isDir()) {
+            if (!found.contains(info.absoluteFilePath())) {
+                found.insert(info.absoluteFilePath());
+                entries.append({info.absoluteFilePath(), QString(), QString(), -1});
+            }
+            continue;
+        }
+        // The dropped folder itself is recreated in the bin
+        QDir dir(info.absoluteFilePath());
+        QDir base(dir);
+        base.cdUp();
+        int first = entries.size();
+        QDirIterator it(dir.absolutePath(), filters, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            if (*abort) {
+                return {};
+            }
+            const QString path = it.next();
+            if (found.contains(path)) {
+                continue;
+            }
+            found.insert(path);
+            entries.append({path, base.relativeFilePath(it.fileInfo().absolutePath()), QString(), root});
+        }
+        // Group clips by folder so that batches create few folders
+        std::sort(entries.begin() + first, entries.end(), [](const Entry &a, const Entry &b) {
+            return a.folder == b.folder ? a.path < b.path : a.folder < b.folder;
+        });
+    }
+    // Content based mime type detection reads the files, do it in parallel
+    QtConcurrent::blockingMap(entries, [abort](Entry &entry) {
+        if (*abort) {
+            return;
+        }
+        QMimeDatabase db;
+        entry.mimeType = db.mimeTypeForFile(entry.path).name();
+    });
+    return entries;
+}
+
+void ClipImporter::slotScanDone()
+{
+    if (m_abort) {
+        finish();
+        return;
+    }
+    m_entries = m_scanWatcher.result();
+    if (m_checkRemovable) {
+        checkRemovable();
+    }
+    qCDebug(KDENLIVE_LOG) << "// Importing " << m_entries.size() << " clips";
+    if (m_progressDialog) {
+        m_progressDialog->setLabelText(i18n("Importing bin clips..."));
+        m_progressDialog->setMaximum(m_entries.size());
+        m_progressDialog->setValue(0);
+    }
+    insertBatch();
+}
+
+// static
+QVector<int> ClipImporter::removableEntries(const QVector<Entry> &entries, const std::function<bool(const QString &)> &isRemovable)
+{
+    QVector<int> removable;
+    QHash<QString, bool> folders;
+    for (int i = 0; i < entries.size(); ++i) {
+        const QString folder = QFileInfo(entries.at(i).path).absolutePath();
+        auto found = folders.constFind(folder);
+        if (found == folders.constEnd()) {
+            found = folders.insert(folder, isRemovable(folder));
+        }
+        if (found.value()) {
+            removable << i;
+        }
+    }
+    return removable;
+}
+
+void ClipImporter::checkRemovable()
+{
+    if (isOnRemovableDevice(pCore->currentDoc()->projectDataFolder())) {
+        return;
+    }
+    const QVector<int> removable = removableEntries(m_entries, [](const QString &folder) { return isOnRemovableDevice(folder); });
+    if (removable.isEmpty()) {
+        return;
+    }
+    QStringList files;
+    for (int i : removable) {
+        files << m_entries.at(i).path;
+    }
+    int answer = KMessageBox::warningContinueCancelList(
+        QApplication::activeWindow(),
+        i18np("This clip is on a removable device, it will not be available when the device is unplugged or mounted at a different position.\nYou "
+              "may want to copy it first to your hard-drive. Would you like to add it anyways?",
+              "These %1 clips are on a removable device, they will not be available when the device is unplugged or mounted at a different position.\nYou "
+              "may want to copy them first to your hard-drive. Would you like to add them anyways?",
+              files.size()),
+        files, i18n("Removable device"), KStandardGuiItem::cont(), KStandardGuiItem::cancel(), QStringLiteral("confirm_removable_device"));
+    if (answer == KMessageBox::Cancel) {
+        for (int j = removable.size() - 1; j >= 0; --j) {
+            m_entries.remove(removable.at(j));
+        }
+    }
+}
+
+void ClipImporter::insertBatch()
+{
+    if (m_abort || m_index >= m_entries.size()) {
+        finish();
+        return;
+    }
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    QVector<QPair<QDomElement, QString>> clips;
+    const int last = qMin(m_index + batchSize, m_entries.size());
+    for (; m_index < last; ++m_index) {
+        const Entry &entry = m_entries.at(m_index);
+        QDomDocument xml = ClipCreator::getXmlFromUrl(entry.path, entry.mimeType);
+        if (xml.isNull()) {
+            continue;
+        }
+        QDomElement prod = xml.documentElement();
+        if (m_created > 0 || !clips.isEmpty()) {
+            // Only the first clip may trigger the profile check
+            prod.removeAttribute(QStringLiteral("_checkProfile"));
+        }
+        clips << qMakePair(prod, folderFor(entry.root, entry.folder, undo, redo));
+    }
+    QStringList ids;
+    if (m_model->requestAddBinClips(clips, ids, undo, redo) && !ids.isEmpty()) {
+        itemCreated(ids.first());
+        m_created += ids.size();
+        // Each batch is undoable as soon as it is inserted, the user may edit the project during the import
+        pCore->pushUndo(undo, redo, i18np("Add clip", "Add clips", ids.size()));
+    } else {
+        // Remove the folders created for this batch
+        undo();
+    }
+    if (m_progressDialog) {
+        m_progressDialog->setValue(m_index);
+    }
+    // Let the event loop run between batches
+    QTimer::singleShot(0, this, &ClipImporter::insertBatch);
+}
+
+QString ClipImporter::folderFor(int root, const QString &path, Fun &undo, Fun &redo)
+{
+    if (path.isEmpty()) {
+        return m_parentFolder;
+    }
+    auto existing = m_folders.constFind({root, path});
+    if (existing != m_folders.constEnd() && m_model->getFolderByBinId(existing.value())) {
+        return existing.value();
+    }
+    int pos = path.lastIndexOf(QLatin1Char('/'));
+    const QString parentId = folderFor(root, pos < 0 ? QString() : path.left(pos), undo, redo);
+    QString id;
+    if (!m_model->requestAddFolder(id, path.mid(pos + 1), parentId, undo, redo)) {
+        return parentId;
+    }
+    m_folders.insert({root, path}, id);
+    itemCreated(id);
+    return id;
+}
+
+void ClipImporter::itemCreated(const QString &binId)
+{
+    if (!m_notified) {
+        m_notified = true;
+        emit firstItemCreated(binId);
+    }
+}
+
+void ClipImporter::finish()
+{
+    if (m_progressDialog) {
+        m_progressDialog->close();
+    }
+    if (m_abort && m_created > 0) {
+        pCore->displayMessage(i18np("Import canceled, %1 clip added", "Import canceled, %1 clips added", m_created), InformationMessage);
+    }
+    emit finished(m_created);
+    deleteLater();
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef CLIPIMPORTER_H
+#define CLIPIMPORTER_H
+
+#include "undohelper.hpp"
+#include <QFutureWatcher>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class ProjectItemModel;
+class QProgressDialog;
+
+/** @brief This class imports a list of files and folders into the bin without blocking the UI.
+    Folders are scanned recursively and the mime type of the files is detected in parallel in background threads.
+    Clips are then inserted in batches from the event loop, each batch being a separate undo entry pushed as it is inserted,
+    and the loading and thumbnail jobs of a batch are scheduled together. A progress dialog allows canceling the import, the
+    clips already inserted are kept.
+ */
+
+class ClipImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClipImporter(const QList<QUrl> &urls, bool checkRemovable, const QString &parentFolder, std::shared_ptr<ProjectItemModel> model,
+                 QObject *parent = nullptr);
+    ~ClipImporter() override;
+    /** @brief Start scanning the urls in the background */
+    void start();
+    /** @brief Stop the import, clips already inserted are kept */
+    void abort();
+
+private:
+    struct Entry
+    {
+        QString path;
+        // Folder path relative to the parent folder, empty for files imported directly
+        QString folder;
+        QString mimeType;
+        // Index of the dropped folder containing the file, so that dropped folders with the same name stay apart
+        int root{-1};
+    };
+    QList<QUrl> m_urls;
+    bool m_checkRemovable;
+    QString m_parentFolder;
+    std::shared_ptr<ProjectItemModel> m_model;
+    QFutureWatcher<QVector<Entry>> m_scanWatcher;
+    QVector<Entry> m_entries;
+    // Bin ids of the created folders, by dropped folder and relative path
+    QMap<QPair<int, QString>, QString> m_folders;
+    QPointer<QProgressDialog> m_progressDialog;
+    int m_index{0};
+    int m_created{0};
+    bool m_notified{false};
+    std::atomic<bool> m_abort{false};
+
+    static QVector<Entry> scan(const QList<QUrl> &urls, const QStringList &filters, const std::atomic<bool> *abort);
+    /** @brief Returns the index of the entries on a removable device. The device is checked once per folder */
+    static QVector<int> removableEntries(const QVector<Entry> &entries, const std::function<bool(const QString &)> &isRemovable);
+    /** @brief Ask whether files on removable devices should be imported, removing them from the entries otherwise */
+    void checkRemovable();
+    /** @brief Returns the bin id of the folder matching a relative path in a dropped folder, creating it if needed */
+    QString folderFor(int root, const QString &path, Fun &undo, Fun &redo);
+    void itemCreated(const QString &binId);
+    void finish();
+
+private slots:
+    void slotScanDone();
+    /** @brief Another project was opened, stop inserting clips */
+    void slotProjectChanged();
+    void insertBatch();
+
+signals:
+    /** @brief Emitted once, with the first folder or clip created by the import */
+    void firstItemCreated(const QString &binId);
+    void finished(int count);
+};
+
+#endif
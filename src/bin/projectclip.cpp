@@ -46,6 +46,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timecode.h"
 #include "timeline2/model/snapmodel.hpp"
 
+#include "utils/analysistrack.hpp"
+#include "utils/fingerprintcache.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
 #include <QPainter>
@@ -570,7 +572,7 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool repl
         QTimer::singleShot(1000, this, [this]() {
             int loadjobId;
             if (!pCore->jobManager()->hasPendingJob(m_binId, AbstractClipJob::CACHEJOB, &loadjobId)) {
-                emit pCore->jobManager()->startJob<CacheJob>({m_binId}, -1, QString());
+                emit pCore->jobManager()->startJob<CacheJob>({m_binId}, -1, QString(), 30, 0, 0, false);
             }
         });
     }
@@ -1014,28 +1016,8 @@ const QString ProjectClip::getFileHash()
 
 const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString path)
 {
-    QFile file(path);
-    QByteArray fileHash;
-    qint64 fSize = 0;
-    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-        /*
-        * 1 MB = 1 second per 450 files (or faster)
-        * 10 MB = 9 seconds per 450 files (or faster)
-        */
-        QByteArray fileData;
-        fSize = file.size();
-        if (fSize > 2000000) {
-            fileData = file.read(1000000);
-            if (file.seek(file.size() - 1000000)) {
-                fileData.append(file.readAll());
-            }
-        } else {
-            fileData = file.readAll();
-        }
-        file.close();
-        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-    }
-    return {fileHash, fSize};
+    // Hash is only read from disk if the file changed since it was last computed
+    return FingerprintCache::get()->fingerprint(path);
 }
 
 double ProjectClip::getOriginalFps() const
@@ -1418,9 +1400,17 @@ QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString
         if (KMessageBox::questionYesNo(QApplication::activeWindow(), i18n("Clip already contains analysis data %1", name), QString(), KGuiItem(i18n("Merge")),
                                        KGuiItem(i18n("Add"))) == KMessageBox::Yes) {
             // Merge data
+            AnalysisTrack track = *AnalysisTrack::load(current);
+            AnalysisTrack newTrack = *AnalysisTrack::load(data);
+            newTrack.offsetFrames(offset);
+            if (track.isValid() && newTrack.isValid() && track.merge(newTrack)) {
+                QString reference = track.store();
+                return QStringList() << QString("kdenlive:clipanalysis." + name) << (reference.isEmpty() ? track.toAnimation() : reference);
+            }
+            // Data cannot be stored in binary form, merge as text
             auto &profile = pCore->getCurrentProfile();
-            Mlt::Geometry geometry(current.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
-            Mlt::Geometry newGeometry(data.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
+            Mlt::Geometry geometry(AnalysisTrack::resolve(current).toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
+            Mlt::Geometry newGeometry(AnalysisTrack::resolve(data).toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
             Mlt::GeometryItem item;
             int pos = 0;
             while (newGeometry.next_key(&item, pos) == 0) {
@@ -1439,16 +1429,21 @@ QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString
             ++i;
             previous = getProducerProperty("kdenlive:clipanalysis." + name + QString::number(i));
         }
-        return QStringList() << QString("kdenlive:clipanalysis." + name + QString::number(i)) << geometryWithOffset(data, offset);
+        return QStringList() << QString("kdenlive:clipanalysis." + name + QString::number(i)) << AnalysisTrack::storeValue(geometryWithOffset(data, offset));
         // m_controller->setProperty("kdenlive:clipanalysis." + name + QLatin1Char(' ') + QString::number(i), geometryWithOffset(data, offset));
     }
-    return QStringList() << QString("kdenlive:clipanalysis." + name) << geometryWithOffset(data, offset);
+    return QStringList() << QString("kdenlive:clipanalysis." + name) << AnalysisTrack::storeValue(geometryWithOffset(data, offset));
     // m_controller->setProperty("kdenlive:clipanalysis." + name, geometryWithOffset(data, offset));
 }
 
 QMap<QString, QString> ProjectClip::analysisData(bool withPrefix)
 {
-    return getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    QMap<QString, QString> result = getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."), withPrefix);
+    // Load the data stored in sidecar files
+    for (auto i = result.begin(); i != result.end(); ++i) {
+        i.value() = AnalysisTrack::resolve(i.value());
+    }
+    return result;
 }
 
 const QString ProjectClip::geometryWithOffset(const QString &data, int offset)
@@ -1456,6 +1451,11 @@ const QString ProjectClip::geometryWithOffset(const QString &data, int offset)
     if (offset == 0) {
         return data;
     }
+    AnalysisTrack track = *AnalysisTrack::load(data);
+    if (track.isValid()) {
+        track.offsetFrames(offset);
+        return AnalysisTrack::isReference(data) ? track.store() : track.toAnimation();
+    }
     auto &profile = pCore->getCurrentProfile();
     Mlt::Geometry geometry(data.toUtf8().data(), duration().frames(profile->fps()), profile->width(), profile->height());
     Mlt::Geometry newgeometry(nullptr, duration().frames(profile->fps()), profile->width(), profile->height());
@@ -1624,7 +1624,7 @@ void ProjectClip::getThumbFromPercent(int percent)
         // Generate percent thumbs
         int id;
         if (!pCore->jobManager()->hasPendingJob(m_binId, AbstractClipJob::CACHEJOB, &id)) {
-            emit pCore->jobManager()->startJob<CacheJob>({m_binId}, -1, QString());
+            emit pCore->jobManager()->startJob<CacheJob>({m_binId}, -1, QString(), 30, 0, 0, false);
         }
     }
 }
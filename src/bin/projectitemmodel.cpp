@@ -40,6 +40,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "projectfolder.h"
 #include "projectsubclip.h"
 #include "lib/localeHandling.h"
+#include "utils/probecache.hpp"
 #include "xml/xml.hpp"
 
 #include <KLocalizedString>
@@ -716,6 +717,47 @@ bool ProjectItemModel::requestAddBinClip(QString &id, const QDomElement &descrip
     return res;
 }
 
+bool ProjectItemModel::requestAddBinClips(const QVector<QPair<QDomElement, QString>> &clips, QStringList &ids, Fun &undo, Fun &redo)
+{
+    QWriteLocker locker(&m_lock);
+    Fun local_undo = []() { return true; };
+    Fun local_redo = []() { return true; };
+    std::vector<QString> created;
+    std::vector<QString> audioClips;
+    std::unordered_map<QString, QDomElement> descriptions;
+    for (const auto &clip : clips) {
+        QString id = QString::number(getFreeClipId());
+        std::shared_ptr<ProjectClip> new_clip =
+            ProjectClip::construct(id, clip.first, m_blankThumb, std::static_pointer_cast<ProjectItemModel>(shared_from_this()));
+        if (!addItem(new_clip, clip.second, local_undo, local_redo)) {
+            bool undone = local_undo();
+            Q_ASSERT(undone);
+            return false;
+        }
+        created.push_back(id);
+        descriptions[id] = clip.first;
+        ClipType::ProducerType type = new_clip->clipType();
+        if (type == ClipType::AV || type == ClipType::Audio || type == ClipType::Playlist || type == ClipType::Unknown) {
+            audioClips.push_back(id);
+        }
+    }
+    UPDATE_UNDO_REDO_NOLOCK(local_redo, local_undo, undo, redo);
+    if (created.empty()) {
+        return true;
+    }
+    auto createFn = [desc = std::move(descriptions)](const QString &id) { return AbstractClipJob::make<LoadJob>(id, desc.at(id)); };
+    using local_createFn_t = std::function<std::shared_ptr<LoadJob>(const QString &)>;
+    int loadJob = emit pCore->jobManager()->startJob<LoadJob>(created, -1, QString(), local_createFn_t(std::move(createFn)));
+    emit pCore->jobManager()->startJob<ThumbJob>(created, loadJob, QString(), 0, true);
+    if (KdenliveSettings::audiothumbnails() && !audioClips.empty()) {
+        emit pCore->jobManager()->startJob<AudioThumbJob>(audioClips, loadJob, QString());
+    }
+    for (const QString &id : created) {
+        ids << id;
+    }
+    return true;
+}
+
 bool ProjectItemModel::requestAddBinClip(QString &id, const QDomElement &description, const QString &parentId, const QString &undoText)
 {
     QWriteLocker locker(&m_lock);
@@ -1027,6 +1069,9 @@ void ProjectItemModel::loadBinPlaylist(Mlt::Tractor *documentTractor, Mlt::Tract
                     continue;
                 }
                 std::shared_ptr<Mlt::Producer> producer(new Mlt::Producer(prod->parent()));
+                // Remember the probe result so that next project opening can skip it
+                ProbeCache::get()->storeProbeData(QString::fromUtf8(producer->get("resource")), producer.get(),
+                                                  QString::fromUtf8(producer->get("kdenlive:file_hash")));
                 int id = producer->get_int("kdenlive:id");
                 if (!id) id = getFreeClipId();
                 binProducers.insert(id, producer);
@@ -1068,6 +1113,12 @@ QMap<QString, QString> ProjectItemModel::getProxies(const QString &root)
     return m_binPlaylist->getProxies(root);
 }
 
+void ProjectItemModel::getProxyClips(const QString &root, ProxySubstitution &substitution)
+{
+    READ_LOCK();
+    m_binPlaylist->getProxyClips(root, substitution);
+}
+
 void ProjectItemModel::reloadClip(const QString &binId)
 {
     QWriteLocker locker(&m_lock);
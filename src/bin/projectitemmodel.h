@@ -39,6 +39,7 @@ class FileWatcher;
 class MarkerListModel;
 class ProjectClip;
 class ProjectFolder;
+class ProxySubstitution;
 class QProgressDialog;
 
 namespace Mlt {
@@ -161,6 +162,13 @@ public:
     bool requestAddBinClip(QString &id, const QDomElement &description, const QString &parentId, Fun &undo, Fun &redo,
                            const std::function<void(const QString &)> &readyCallBack = [](const QString &) {});
     bool requestAddBinClip(QString &id, const QDomElement &description, const QString &parentId, const QString &undoText = QString());
+    /* @brief Request creation of several bin clips at once. The clips are loaded by a single job, and their thumbnails by another one,
+       instead of scheduling jobs for each clip
+       @param clips Xml description of each clip, with the bin id of its parent folder
+       @param ids the ids of the created clips are appended to this list
+       @param undo,redo: lambdas that are updated to accumulate operation.
+    */
+    bool requestAddBinClips(const QVector<QPair<QDomElement, QString>> &clips, QStringList &ids, Fun &undo, Fun &redo);
 
     /* @brief This is the addition function when we already have a producer for the clip*/
     bool requestAddBinClip(QString &id, const std::shared_ptr<Mlt::Producer> &producer, const QString &parentId, Fun &undo, Fun &redo);
@@ -197,6 +205,8 @@ public:
 
     /** @brief Retrieve a list of proxy/original urls */
     QMap<QString, QString> getProxies(const QString &root);
+    /** @brief Register the proxied clips, with their proxy and original frame sizes */
+    void getProxyClips(const QString &root, ProxySubstitution &substitution);
 
     /** @brief Request that the producer of a given clip is reloaded */
     void reloadClip(const QString &binId);
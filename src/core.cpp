@@ -23,12 +23,14 @@ the Free Software Foundation, either version 3 of the License, or
 #include "mltconnection.h"
 #include "mltcontroller/clipcontroller.h"
 #include "monitor/monitormanager.h"
+#include "monitor/refreshscheduler.h"
 #include "profiles/profilemodel.hpp"
 #include "profiles/profilerepository.hpp"
 #include "project/projectmanager.h"
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
+#include "utils/startupprofiler.hpp"
 #include <mlt++/MltRepository.h>
 
 #include <KMessageBox>
@@ -47,11 +49,13 @@ Core::Core()
     , m_thumbProfile(nullptr)
     , m_capture(new MediaCapture(this))
 {
+    m_refreshScheduler = new RefreshScheduler(this);
 }
 
 void Core::prepareShutdown()
 {
     m_guiConstructed = false;
+    m_refreshScheduler->clear();
     m_mainWindow->getCurrentTimeline()->controller()->prepareClose();
     projectItemModel()->blockSignals(true);
     QThreadPool::globalInstance()->clear();
@@ -75,6 +79,7 @@ void Core::build(bool isAppImage, const QString &MltPath)
     if (m_self) {
         return;
     }
+    StartupProfiler::Phase buildPhase(QStringLiteral("Core::build"));
     m_self.reset(new Core());
     m_self->initLocale();
 
@@ -89,6 +94,7 @@ void Core::build(bool isAppImage, const QString &MltPath)
     qRegisterMetaType<QDomElement>("QDomElement");
     qRegisterMetaType<requestClipInfo>("requestClipInfo");
 
+    StartupProfiler::Phase phase(QStringLiteral("MLT connection"));
     if (isAppImage) {
         QString appPath = qApp->applicationDirPath();
         KdenliveSettings::setFfmpegpath(QDir::cleanPath(appPath + QStringLiteral("/ffmpeg")));
@@ -102,6 +108,7 @@ void Core::build(bool isAppImage, const QString &MltPath)
     }
 
     // load the profile from disk
+    phase.next(QStringLiteral("Profiles"));
     ProfileRepository::get()->refresh();
     // load default profile
     m_self->m_profile = KdenliveSettings::default_profile();
@@ -115,6 +122,7 @@ void Core::build(bool isAppImage, const QString &MltPath)
     ClipController::mediaUnavailable = std::make_shared<Mlt::Producer>(ProfileRepository::get()->getProfile(m_self->m_profile)->profile(), "color:blue");
     ClipController::mediaUnavailable->set("length", 99999999);
 
+    phase.next(QStringLiteral("Project item model and job manager"));
     m_self->m_projectItemModel = ProjectItemModel::construct();
     // Job manager must be created before bin to correctly connect
     m_self->m_jobManager.reset(new JobManager(m_self.get()));
@@ -122,9 +130,11 @@ void Core::build(bool isAppImage, const QString &MltPath)
 
 void Core::initGUI(const QUrl &Url, const QString &clipsToLoad)
 {
+    StartupProfiler::Phase guiPhase(QStringLiteral("Core::initGUI"));
     m_profile = KdenliveSettings::default_profile();
     m_currentProfile = m_profile;
     profileChanged();
+    StartupProfiler::Phase phase(QStringLiteral("Main window"));
     m_mainWindow = new MainWindow();
     m_guiConstructed = true;
     QStringList styles = QQuickStyle::availableStyles();
@@ -176,14 +186,19 @@ void Core::initGUI(const QUrl &Url, const QString &clipsToLoad)
         profileChanged();
     }
 
+    phase.next(QStringLiteral("Project manager"));
     m_projectManager = new ProjectManager(this);
+    phase.next(QStringLiteral("Bin"));
     m_binWidget = new Bin(m_projectItemModel, m_mainWindow);
+    phase.next(QStringLiteral("Library"));
     m_library = new LibraryWidget(m_projectManager, m_mainWindow);
+    phase.next(QStringLiteral("Audio mixer"));
     m_mixerWidget = new MixerManager(m_mainWindow);
     connect(m_library, SIGNAL(addProjectClips(QList<QUrl>)), m_binWidget, SLOT(droppedUrls(QList<QUrl>)));
     connect(this, &Core::updateLibraryPath, m_library, &LibraryWidget::slotUpdateLibraryPath);
     connect(m_capture.get(), &MediaCapture::recordStateChanged, m_mixerWidget, &MixerManager::recordStateChanged);
     connect(m_mixerWidget, &MixerManager::updateRecVolume, m_capture.get(), &MediaCapture::setAudioVolume);
+    phase.next(QStringLiteral("Monitor manager"));
     m_monitorManager = new MonitorManager(this);
     connect(m_monitorManager, &MonitorManager::cleanMixer, m_mixerWidget, &MixerManager::clearMixers);
     // Producer queue, creating MLT::Producers on request
@@ -200,7 +215,9 @@ void Core::initGUI(const QUrl &Url, const QString &clipsToLoad)
     // TODO
     connect(m_producerQueue, SIGNAL(removeInvalidProxy(QString,bool)), m_binWidget, SLOT(slotRemoveInvalidProxy(QString,bool)));*/
 
+    phase.next(QStringLiteral("MainWindow::init"));
     m_mainWindow->init();
+    phase.next(QStringLiteral("Show main window"));
     if (!Url.isEmpty()) {
         emit loadingMessageUpdated(i18n("Loading project..."));
     }
@@ -551,6 +568,23 @@ void Core::refreshProjectItem(const ObjectId &id)
     }
 }
 
+void Core::scheduleItemRefresh(const ObjectId &id)
+{
+    if (!m_guiConstructed) return;
+    m_refreshScheduler->scheduleRefresh(id);
+}
+
+void Core::scheduleItemInvalidation(const ObjectId &id)
+{
+    if (!m_guiConstructed) return;
+    m_refreshScheduler->scheduleInvalidation(id);
+}
+
+RefreshScheduler *Core::refreshScheduler()
+{
+    return m_refreshScheduler;
+}
+
 bool Core::hasTimelinePreview() const
 {
     if (!m_guiConstructed) {
@@ -559,6 +593,14 @@ bool Core::hasTimelinePreview() const
     return m_mainWindow->getCurrentTimeline()->controller()->renderedChunks().size() > 0;
 }
 
+QList<int> Core::reusablePreviewChunks(int in, int out, const QDomElement &consumer) const
+{
+    if (!m_guiConstructed) {
+        return QList<int>();
+    }
+    return m_mainWindow->getCurrentTimeline()->controller()->reusablePreviewChunks(in, out, consumer);
+}
+
 KdenliveDoc *Core::currentDoc()
 {
     return m_projectManager->current();
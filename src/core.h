@@ -37,6 +37,8 @@ class MonitorManager;
 class ProfileModel;
 class ProjectItemModel;
 class ProjectManager;
+class RefreshScheduler;
+class QDomElement;
 
 namespace Mlt {
     class Repository;
@@ -146,6 +148,12 @@ public:
     void refreshProjectRange(QSize range);
     /** @brief Request project monitor refresh if referenced item is under cursor */
     void refreshProjectItem(const ObjectId &id);
+    /** @brief Request a delayed project monitor refresh, multiple requests for the same item are merged */
+    void scheduleItemRefresh(const ObjectId &id);
+    /** @brief Request a delayed timeline preview invalidation, processed once the item stops changing */
+    void scheduleItemInvalidation(const ObjectId &id);
+    /** @brief Returns the scheduler handling delayed refresh / invalidation requests */
+    RefreshScheduler *refreshScheduler();
     /** @brief Returns a reference to a monitor (clip or project monitor) */
     Monitor *getMonitor(int id);
 
@@ -193,6 +201,8 @@ public:
     int projectDuration() const;
     /** @brief Returns true if current project has some rendered timeline preview  */
     bool hasTimelinePreview() const;
+    /** @brief Returns the timeline preview chunks in the in/out range that can be copied into a render using this consumer  */
+    QList<int> reusablePreviewChunks(int in, int out, const QDomElement &consumer) const;
     /** @brief Returns current timeline cursor position  */
     int getTimelinePosition() const;
     /** @brief Handles audio and video capture **/
@@ -244,6 +254,7 @@ private:
     Bin *m_binWidget{nullptr};
     LibraryWidget *m_library{nullptr};
     MixerManager *m_mixerWidget{nullptr};
+    RefreshScheduler *m_refreshScheduler{nullptr};
     /** @brief Current project's profile path */
     QString m_currentProfile;
 
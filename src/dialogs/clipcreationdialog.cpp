@@ -438,13 +438,8 @@ void ClipCreationDialog::createClipsCommand(KdenliveDoc *doc, const QString &par
     if (handle) {
         KWindowConfig::saveWindowSize(handle, group);
     }
-    Fun undo = []() { return true; };
-    Fun redo = []() { return true; };
-    const QString id = ClipCreator::createClipsFromList(list, true, parentFolder, model, undo, redo);
+    ClipCreator::importClips(list, true, parentFolder, model);
 
     // We reset the state of the "don't ask again" for the question about removable devices
     KMessageBox::enableMessage(QStringLiteral("removable"));
-    if (!id.isEmpty()) {
-        pCore->pushUndo(undo, redo, i18np("Add clip", "Add clips", list.size()));
-    }
 }
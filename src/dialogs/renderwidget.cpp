@@ -23,6 +23,7 @@
 #include "core.h"
 #include "dialogs/profilesdialog.h"
 #include "doc/kdenlivedoc.h"
+#include "effects/effectsrepository.hpp"
 #include "kdenlivesettings.h"
 #include "monitor/monitor.h"
 #include "profiles/profilemodel.hpp"
@@ -30,6 +31,9 @@
 #include "project/projectmanager.h"
 #include "timecode.h"
 #include "ui_saveprofile_ui.h"
+#include "utils/audiomixdown.hpp"
+#include "utils/inprocessrender.hpp"
+#include "utils/proxysubstitution.hpp"
 #include "xml/xml.hpp"
 
 #include "klocalizedstring.h"
@@ -97,11 +101,14 @@ enum {
     ProgressRole,
     ExtraInfoRole = ProgressRole + 2, // vpinon: don't understand why, else spurious message displayed
     LastTimeRole,
-    LastFrameRole
+    LastFrameRole,
+    ThreadsRole,
+    InProcessRole,
+    ResumeRole
 };
 
 // Running job status
-enum JOBSTATUS { WAITINGJOB = 0, STARTINGJOB, RUNNINGJOB, FINISHEDJOB, FAILEDJOB, ABORTEDJOB };
+enum JOBSTATUS { WAITINGJOB = 0, STARTINGJOB, RUNNINGJOB, FINISHEDJOB, FAILEDJOB, ABORTEDJOB, PAUSEDJOB };
 
 static QStringList acodecsList;
 static QStringList vcodecsList;
@@ -141,6 +148,10 @@ void RenderJobItem::setStatus(int status)
         setIcon(0, QIcon::fromTheme(QStringLiteral("dialog-cancel")));
         setData(1, ProgressRole, 100);
         break;
+    case PAUSEDJOB:
+        setData(1, Qt::UserRole, i18n("Paused"));
+        setIcon(0, QIcon::fromTheme(QStringLiteral("media-playback-pause")));
+        break;
     default:
         break;
     }
@@ -222,8 +233,19 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     m_view.error_box->setVisible(false);
     m_view.tc_type->setEnabled(false);
     m_view.checkTwoPass->setEnabled(false);
+    m_view.twopass_cache->setEnabled(false);
+    m_view.twopass_cache->setChecked(KdenliveSettings::twopasscache());
+    connect(m_view.checkTwoPass, &QCheckBox::toggled, [this](bool checked) { m_view.twopass_cache->setEnabled(checked && m_view.checkTwoPass->isEnabled()); });
+    connect(m_view.twopass_cache, &QCheckBox::toggled, [](bool checked) { KdenliveSettings::setTwopasscache(checked); });
     m_view.proxy_render->setHidden(!enableProxy);
+    m_view.proxy_hybrid->setHidden(!enableProxy);
+    m_view.proxy_hybrid->setEnabled(false);
+    m_view.proxy_hybrid->setChecked(KdenliveSettings::proxyhybridrender());
     connect(m_view.proxy_render, &QCheckBox::toggled, this, &RenderWidget::slotProxyWarn);
+    connect(m_view.proxy_hybrid, &QCheckBox::toggled, [this](bool checked) {
+        KdenliveSettings::setProxyhybridrender(checked);
+        slotProxyWarn(m_view.proxy_render->isChecked());
+    });
     KColorScheme scheme(palette().currentColorGroup(), KColorScheme::Window);
     QColor bg = scheme.background(KColorScheme::NegativeBackground).color();
     m_view.errorBox->setStyleSheet(
@@ -360,9 +382,45 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
 #endif
     m_view.parallel_process->setChecked(KdenliveSettings::parallelrender());
     connect(m_view.parallel_process, &QCheckBox::stateChanged, [](int state) { KdenliveSettings::setParallelrender(state == Qt::Checked); });
+    m_view.segmented_render->setChecked(KdenliveSettings::segmentedrender());
+    m_view.render_segments->setValue(KdenliveSettings::rendersegments());
+    m_view.render_segments->setEnabled(m_view.segmented_render->isChecked());
+    m_view.shared_queue->setChecked(KdenliveSettings::sharedrenderqueue());
+    m_view.shared_queue->setEnabled(m_view.segmented_render->isChecked());
+    connect(m_view.segmented_render, &QCheckBox::stateChanged, [this](int state) {
+        KdenliveSettings::setSegmentedrender(state == Qt::Checked);
+        m_view.render_segments->setEnabled(state == Qt::Checked);
+        m_view.shared_queue->setEnabled(state == Qt::Checked);
+    });
+    connect(m_view.shared_queue, &QCheckBox::stateChanged, [](int state) { KdenliveSettings::setSharedrenderqueue(state == Qt::Checked); });
+    connect(m_view.render_segments, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [](int value) { KdenliveSettings::setRendersegments(value); });
     if (KdenliveSettings::gpu_accel()) {
         // Disable parallel rendering for movit
         m_view.parallel_process->setEnabled(false);
+        m_view.segmented_render->setEnabled(false);
+        m_view.shared_queue->setEnabled(false);
+    }
+    m_view.max_jobs->setValue(KdenliveSettings::renderjobs());
+    connect(m_view.max_jobs, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this](int value) {
+        KdenliveSettings::setRenderjobs(value);
+        checkRenderStatus();
+    });
+    m_view.thread_budget->setValue(KdenliveSettings::renderthreads());
+    connect(m_view.thread_budget, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this](int value) {
+        KdenliveSettings::setRenderthreads(value);
+        checkRenderStatus();
+    });
+    m_view.inprocess_length->setValue(KdenliveSettings::inprocessrender());
+    connect(m_view.inprocess_length, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            [](int value) { KdenliveSettings::setInprocessrender(value); });
+    m_view.reuse_preview->setChecked(KdenliveSettings::reusepreview());
+    connect(m_view.reuse_preview, &QCheckBox::stateChanged, [](int state) { KdenliveSettings::setReusepreview(state == Qt::Checked); });
+    if (KdenliveSettings::ffmpegpath().isEmpty()) {
+        // Segments are joined with ffmpeg
+        m_view.segmented_render->setEnabled(false);
+        m_view.shared_queue->setEnabled(false);
+        m_view.reuse_preview->setEnabled(false);
     }
     m_view.field_order->setEnabled(false);
     connect(m_view.scanning_list, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) { m_view.field_order->setEnabled(index == 2); });
@@ -395,6 +453,24 @@ void RenderWidget::slotShareActionFinished(const QJsonObject &output, int error,
 #endif
 }
 
+QSize RenderWidget::renderOutputSize() const
+{
+    std::unique_ptr<ProfileModel> &profile = pCore->getCurrentProfile();
+    QSize size(profile->width(), profile->height());
+    const QString renderArgs = m_view.advanced_params->toPlainText().simplified();
+    QString subsize;
+    if (renderArgs.startsWith(QLatin1String("s="))) {
+        subsize = renderArgs.section(QLatin1Char(' '), 0, 0).section(QLatin1Char('='), 1, 1);
+    } else if (renderArgs.contains(QStringLiteral(" s="))) {
+        subsize = renderArgs.section(QStringLiteral(" s="), 1, 1).section(QLatin1Char(' '), 0, 0);
+    } else if (m_view.rescale->isChecked() && m_view.rescale->isEnabled()) {
+        return size.boundedTo(QSize(m_view.rescale_width->value(), m_view.rescale_height->value()));
+    }
+    QSize rescaled(subsize.section(QLatin1Char('x'), 0, 0, QString::SectionCaseInsensitiveSeps).toInt(),
+                   subsize.section(QLatin1Char('x'), 1, 1, QString::SectionCaseInsensitiveSeps).toInt());
+    return rescaled.isEmpty() ? size : size.boundedTo(rescaled);
+}
+
 QSize RenderWidget::sizeHint() const
 {
     // Make sure the widget has minimum size on opening
@@ -1280,7 +1356,9 @@ void RenderWidget::prepareRendering(bool delayedRendering, const QString &chapte
     }
 
     // Do we want proxy rendering
-    if (project->useProxy() && !proxyRendering()) {
+    m_proxySubstitution.reset();
+    bool hybridProxy = project->useProxy() && proxyRendering() && m_view.proxy_hybrid->isChecked();
+    if (project->useProxy() && (!proxyRendering() || hybridProxy)) {
         QString root = doc.documentElement().attribute(QStringLiteral("root"));
         if (!root.isEmpty() && !root.endsWith(QLatin1Char('/'))) {
             root.append(QLatin1Char('/'));
@@ -1288,6 +1366,11 @@ void RenderWidget::prepareRendering(bool delayedRendering, const QString &chapte
 
         // replace proxy clips with originals
         QMap<QString, QString> proxies = pCore->projectItemModel()->getProxies(pCore->currentDoc()->documentRoot());
+        if (hybridProxy) {
+            // Clips keep their proxy when it has enough resolution for the output
+            m_proxySubstitution.reset(new ProxySubstitution(renderOutputSize()));
+            pCore->projectItemModel()->getProxyClips(pCore->currentDoc()->documentRoot(), *m_proxySubstitution);
+        }
 
         QDomNodeList producers = doc.elementsByTagName(QStringLiteral("producer"));
         QString producerResource;
@@ -1320,6 +1403,10 @@ void RenderWidget::prepareRendering(bool delayedRendering, const QString &chapte
                     producerResource.prepend(root);
                 }
                 if (proxies.contains(producerResource)) {
+                    if (m_proxySubstitution && m_proxySubstitution->contains(producerResource) &&
+                        m_proxySubstitution->resource(producerResource) == producerResource) {
+                        continue;
+                    }
                     QString replacementResource = proxies.value(producerResource);
                     Xml::setXmlProperty(e, QStringLiteral("resource"), prefix + replacementResource + suffix);
                     if (producerService == QLatin1String("timewarp")) {
@@ -1332,6 +1419,10 @@ void RenderWidget::prepareRendering(bool delayedRendering, const QString &chapte
                 }
             }
         }
+        if (m_proxySubstitution) {
+            qCDebug(KDENLIVE_LOG) << "// Render sources:\n" << m_proxySubstitution->report();
+            pCore->displayMessage(m_proxySubstitution->summary(), InformationMessage);
+        }
     }
     generateRenderFiles(doc, playlistPath, in, out, delayedRendering);
 }
@@ -1494,6 +1585,16 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
         consumer.setAttribute(QStringLiteral("an"), 1);
     }
 
+    // Audio only renders don't need the video tracks, MLT would still open and evaluate their producers
+    QString mixdownInfo;
+    if (AudioMixdown::isAudioOnly(consumer)) {
+        int stripped = AudioMixdown::strip(
+            doc, [](const QString &id) { return EffectsRepository::get()->exists(id) && !EffectsRepository::get()->isAudioEffect(id); });
+        if (stripped > 0) {
+            mixdownInfo = i18np("Audio mixdown, %1 video track skipped", "Audio mixdown, %1 video tracks skipped", stripped);
+        }
+    }
+
     int threadCount = QThread::idealThreadCount();
     if (threadCount < 2 || !m_view.parallel_process->isChecked() || !m_view.parallel_process->isEnabled()) {
         threadCount = 1;
@@ -1502,8 +1603,15 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
     }
 
     // Set the thread counts
+    int encodeThreads = KdenliveSettings::encodethreads();
     if (!renderArgs.contains(QStringLiteral("threads="))) {
-        consumer.setAttribute(QStringLiteral("threads"), KdenliveSettings::encodethreads());
+        if (encodeThreads == 0 && KdenliveSettings::renderjobs() > 1) {
+            // Jobs share the machine, don't let the encoder start a thread per core
+            encodeThreads = qMax(1, renderThreadBudget() / KdenliveSettings::renderjobs() - threadCount);
+        }
+        consumer.setAttribute(QStringLiteral("threads"), encodeThreads);
+    } else {
+        encodeThreads = consumer.attribute(QStringLiteral("threads")).toInt();
     }
     consumer.setAttribute(QStringLiteral("real_time"), -threadCount);
 
@@ -1606,12 +1714,87 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
         file.close();
     }
 
+    // Both passes in one job, encoded from a single render of the timeline
+    QStringList passArgs;
+    if (passes == 2 && m_view.twopass_cache->isChecked() && m_view.twopass_cache->isEnabled() && !renderedFile.contains(QLatin1Char('%'))) {
+        passArgs << QStringLiteral("-pass2:%1").arg(playlists.takeLast());
+    }
+
+    // Segmented rendering, not possible for two pass encoding or image sequences
+    QStringList segmentArgs;
+    QString reuseInfo;
+    QString queueInfo;
+    int parallelJobs = 1;
+    if (passes == 1 && !renderedFile.contains(QLatin1Char('%')) && !KdenliveSettings::ffmpegpath().isEmpty()) {
+        bool segmented = m_view.segmented_render->isChecked() && m_view.segmented_render->isEnabled();
+        QList<int> chunks;
+        // Timeline preview is rendered with proxy clips
+        if (m_view.reuse_preview->isChecked() && !(project->useProxy() && !proxyRendering()) &&
+            !(m_proxySubstitution && !m_proxySubstitution->originalClips().isEmpty())) {
+            chunks = pCore->reusablePreviewChunks(consumer.attribute(QStringLiteral("in")).toInt(), consumer.attribute(QStringLiteral("out")).toInt(),
+                                                  consumer);
+        }
+        if (segmented && chunks.isEmpty() && m_view.shared_queue->isChecked()) {
+            // The queue is next to the rendered file, where other computers rendering to the same folder can find it
+            QFileInfo info(renderedFile);
+            const QString queueFolder = info.absoluteDir().absoluteFilePath(info.completeBaseName() + QStringLiteral(".kdenlive-queue"));
+            parallelJobs = m_view.render_segments->value();
+            segmentArgs << QStringLiteral("-queue:%1").arg(queueFolder) << QStringLiteral("-workers:%1").arg(parallelJobs)
+                        << QStringLiteral("-ffmpeg:%1").arg(KdenliveSettings::ffmpegpath());
+            queueInfo = i18n("Other workers can join with: kdenlive_render -worker:%1 %2", queueFolder, KdenliveSettings::rendererpath());
+        } else if (segmented || !chunks.isEmpty()) {
+            parallelJobs = segmented ? m_view.render_segments->value() : 1;
+            segmentArgs << QStringLiteral("-segments:%1").arg(parallelJobs) << QStringLiteral("-ffmpeg:%1").arg(KdenliveSettings::ffmpegpath());
+        }
+        if (!chunks.isEmpty()) {
+            bool ok;
+            QStringList frames;
+            for (int frame : qAsConst(chunks)) {
+                frames << QString::number(frame);
+            }
+            int chunkSize = KdenliveSettings::timelinechunks();
+            segmentArgs << QStringLiteral("-reuse") << project->getCacheDir(CachePreview, &ok).absolutePath() << QString::number(chunkSize)
+                        << frames.join(QLatin1Char(','));
+            int frameCount = consumer.attribute(QStringLiteral("out")).toInt() - consumer.attribute(QStringLiteral("in")).toInt() + 1;
+            reuseInfo = i18n("%1 of %2 frames reused from timeline preview", chunks.size() * chunkSize, frameCount);
+            pCore->displayMessage(reuseInfo, InformationMessage);
+        }
+    }
+
+    QStringList jobInfo;
+    if (m_proxySubstitution) {
+        jobInfo << m_proxySubstitution->summary();
+    }
+    if (!reuseInfo.isEmpty()) {
+        jobInfo << reuseInfo;
+    }
+    if (!mixdownInfo.isEmpty()) {
+        jobInfo << mixdownInfo;
+    }
+    QStringList jobTooltip;
+    if (m_proxySubstitution) {
+        jobTooltip << m_proxySubstitution->report();
+    }
+    if (!queueInfo.isEmpty()) {
+        jobTooltip << queueInfo;
+    }
+
+    // Threads used by the job, for the render queue budget. An encoder without thread count uses all cores
+    int jobThreads = renderArgs.contains(QLatin1String("vn=1")) ? 1 : threadCount + (encodeThreads > 0 ? encodeThreads : renderThreadBudget());
+    jobThreads *= parallelJobs;
+    jobThreads = qBound(1, jobThreads, renderThreadBudget());
+
+    // Short exports are rendered inside Kdenlive, starting kdenlive_render would take longer than the render. Movit needs its own GL context
+    bool inProcess = passes == 1 && passArgs.isEmpty() && segmentArgs.isEmpty() && !KdenliveSettings::gpu_accel() &&
+                     InProcessRender::canRender(consumer, qRound(KdenliveSettings::inprocessrender() * profile->fps()));
+
     // Create job
     RenderJobItem *renderItem = nullptr;
     QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(renderedFile, Qt::MatchExactly, 1);
     if (!existing.isEmpty()) {
         renderItem = static_cast<RenderJobItem *>(existing.at(0));
-        if (renderItem->status() == RUNNINGJOB || renderItem->status() == WAITINGJOB || renderItem->status() == STARTINGJOB) {
+        if (renderItem->status() == RUNNINGJOB || renderItem->status() == WAITINGJOB || renderItem->status() == STARTINGJOB ||
+            renderItem->status() == PAUSEDJOB) {
             KMessageBox::information(
                 this, i18n("There is already a job writing file:<br /><b>%1</b><br />Abort the job if you want to overwrite it...", renderedFile),
                 i18n("Already running"));
@@ -1627,7 +1810,10 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
             renderItem->setData(1, Qt::UserRole, i18n("Waiting..."));
             QStringList argsJob = {KdenliveSettings::rendererpath(), playlistPath, renderedFile,
                                    QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid())};
+            argsJob << passArgs << segmentArgs;
             renderItem->setData(1, ParametersRole, argsJob);
+            renderItem->setData(1, ThreadsRole, jobThreads);
+            renderItem->setData(1, InProcessRole, inProcess);
             QDateTime t = QDateTime::currentDateTime();
             renderItem->setData(1, StartTimeRole, t);
             renderItem->setData(1, LastTimeRole, t);
@@ -1635,8 +1821,9 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
             if (!exportAudio) {
                 renderItem->setData(1, ExtraInfoRole, i18n("Video without audio track"));
             } else {
-                renderItem->setData(1, ExtraInfoRole, QString());
+                renderItem->setData(1, ExtraInfoRole, jobInfo.join(QStringLiteral(", ")));
             }
+            renderItem->setToolTip(1, jobTooltip.join(QLatin1Char('\n')));
             m_view.running_jobs->setCurrentItem(renderItem);
             m_view.tabWidget->setCurrentIndex(1);
             checkRenderStatus();
@@ -1655,13 +1842,17 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
         renderItem->setData(1, LastTimeRole, t);
         renderItem->setData(1, LastFrameRole, in);
         QStringList argsJob = {KdenliveSettings::rendererpath(), pl, renderedFile, QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid())};
+        argsJob << passArgs << segmentArgs;
         renderItem->setData(1, ParametersRole, argsJob);
+        renderItem->setData(1, ThreadsRole, jobThreads);
+        renderItem->setData(1, InProcessRole, inProcess);
         qDebug() << "* CREATED JOB WITH ARGS: " << argsJob;
         if (!exportAudio) {
             renderItem->setData(1, ExtraInfoRole, i18n("Video without audio track"));
         } else {
-            renderItem->setData(1, ExtraInfoRole, QString());
+            renderItem->setData(1, ExtraInfoRole, jobInfo.join(QStringLiteral(", ")));
         }
+        renderItem->setToolTip(1, jobTooltip.join(QLatin1Char('\n')));
         jobList << renderItem;
     }
 
@@ -1713,55 +1904,144 @@ void RenderWidget::checkRenderStatus()
         return;
     }
 
+    // Several jobs can run at the same time, within the configured job count and thread budget
+    const int maxJobs = KdenliveSettings::renderjobs();
+    const int budget = renderThreadBudget();
+    int running = 0;
+    int usedThreads = 0;
     auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
-
-    // Make sure no other rendering is running
     while (item != nullptr) {
-        if (item->status() == RUNNINGJOB) {
-            return;
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB) {
+            running++;
+            usedThreads += jobThreads(item);
         }
         item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
     }
     item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
-    bool waitingJob = false;
+    bool waitingJob = running > 0;
+    bool blocked = false;
 
-    // Find first waiting job
-    while (item != nullptr) {
-        if (item->status() == WAITINGJOB) {
+    // Start waiting jobs in queue order
+    while (item != nullptr && running < maxJobs) {
+        auto *next = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+        if (item->status() == PAUSEDJOB) {
+            waitingJob = true;
+            if (!item->data(1, ResumeRole).toBool()) {
+                item = next;
+                continue;
+            }
+            // A resumed job needs its threads again, like a new one
+            int threads = jobThreads(item);
+            if ((running > 0 && usedThreads + threads > budget) || (blocked && threads > 1)) {
+                blocked = true;
+                item = next;
+                continue;
+            }
+            item->setData(1, ResumeRole, false);
+            item->setStatus(RUNNINGJOB);
+            item->setIcon(0, QIcon::fromTheme(QStringLiteral("media-record")));
+            emit pauseProcess(item->text(1), false);
+            running++;
+            usedThreads += threads;
+        } else if (item->status() == WAITINGJOB) {
+            // Check for 2 pass encoding
+            RenderJobItem *firstPass = firstPassJob(item);
+            if (firstPass && (firstPass->status() == FAILEDJOB || firstPass->status() == ABORTEDJOB)) {
+                // No second pass without a complete first one
+                item->setStatus(firstPass->status());
+                item->setData(1, Qt::UserRole, firstPass->status() == FAILEDJOB ? i18n("First pass crashed") : i18n("First pass aborted"));
+                if (next == firstPass) {
+                    next = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(firstPass));
+                }
+                delete firstPass;
+                item = next;
+                continue;
+            }
+            waitingJob = true;
+            if (firstPass && firstPass->status() != FINISHEDJOB) {
+                // Second pass has to wait for the first one
+                item = next;
+                continue;
+            }
+            int threads = jobThreads(item);
+            if (running > 0 && usedThreads + threads > budget) {
+                // Once a job waits for threads, only single threaded jobs may start before it
+                blocked = true;
+                item = next;
+                continue;
+            }
+            if (blocked && threads > 1) {
+                item = next;
+                continue;
+            }
             QDateTime t = QDateTime::currentDateTime();
             item->setData(1, StartTimeRole, t);
             item->setData(1, LastTimeRole, t);
-            waitingJob = true;
             startRendering(item);
-            // Check for 2 pass encoding
-            QStringList jobData = item->data(1, ParametersRole).toStringList();
-            if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
-                // Find and remove 1st pass job
-                QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
-                QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
-                while (above) {
-                    QStringList aboveData = above->data(1, ParametersRole).toStringList();
-                    qDebug() << "// GOT  JOB: " << aboveData.at(1);
-                    if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
-                        delete above;
-                        break;
-                    }
-                    above = m_view.running_jobs->itemAbove(above);
+            if (firstPass) {
+                // Remove 1st pass job
+                if (next == firstPass) {
+                    next = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(firstPass));
                 }
+                delete firstPass;
+            }
+            if (item->status() != FAILEDJOB) {
+                item->setStatus(STARTINGJOB);
+                running++;
+                usedThreads += threads;
             }
-            item->setStatus(STARTINGJOB);
-            break;
         }
-        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+        item = next;
     }
     if (!waitingJob && m_view.shutdown->isChecked()) {
         emit shutdown();
     }
 }
 
+int RenderWidget::renderThreadBudget() const
+{
+    return KdenliveSettings::renderthreads() > 0 ? KdenliveSettings::renderthreads() : qMax(1, QThread::idealThreadCount());
+}
+
+int RenderWidget::jobThreads(RenderJobItem *item) const
+{
+    // Jobs started from scripts or by another instance have no thread allocation
+    return qMax(1, item->data(1, ThreadsRole).toInt());
+}
+
+RenderJobItem *RenderWidget::firstPassJob(RenderJobItem *item) const
+{
+    QStringList jobData = item->data(1, ParametersRole).toStringList();
+    if (jobData.size() < 3 || !jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
+        return nullptr;
+    }
+    QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
+    for (int i = 0; i < m_view.running_jobs->topLevelItemCount(); ++i) {
+        auto *job = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(i));
+        QStringList data = job->data(1, ParametersRole).toStringList();
+        if (job != item && data.size() > 2 && data.at(1) == firstPassName) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
 void RenderWidget::startRendering(RenderJobItem *item)
 {
     auto rendererArgs = item->data(1, ParametersRole).toStringList();
+    if (item->data(1, InProcessRole).toBool() && rendererArgs.size() > 2 && !m_inProcessRenders.contains(rendererArgs.at(2))) {
+        auto *render = new InProcessRender(rendererArgs.at(1), rendererArgs.at(2), this);
+        connect(render, &InProcessRender::progress, this, &RenderWidget::setRenderJob);
+        connect(render, &InProcessRender::finished, this, [this, render](const QString &dest, int status, const QString &error) {
+            m_inProcessRenders.remove(dest);
+            render->deleteLater();
+            setRenderStatus(dest, status, error);
+        });
+        m_inProcessRenders.insert(render->target(), render);
+        render->start();
+        KNotification::event(QStringLiteral("RenderStarted"), i18n("Rendering <i>%1</i> started", item->text(1)), QPixmap(), this);
+        return;
+    }
     qDebug() << "starting kdenlive_render process using: " << m_renderer;
     if (!QProcess::startDetached(m_renderer, rendererArgs)) {
         item->setStatus(FAILEDJOB);
@@ -2072,6 +2352,7 @@ void RenderWidget::refreshParams()
     bool passes = params.contains(QStringLiteral("passes"));
     m_view.checkTwoPass->setEnabled(passes);
     m_view.checkTwoPass->setChecked(passes && params.contains(QStringLiteral("passes=2")));
+    m_view.twopass_cache->setEnabled(m_view.checkTwoPass->isChecked() && passes);
 
     m_view.encoder_threads->setEnabled(!params.contains(QStringLiteral("threads=")));
 
@@ -2504,7 +2785,9 @@ void RenderWidget::setRenderJob(const QString &dest, int progress, int frame)
         }
     }
     item->setData(1, ProgressRole, progress);
-    item->setStatus(RUNNINGJOB);
+    if (item->status() != PAUSEDJOB) {
+        item->setStatus(RUNNINGJOB);
+    }
     if (progress == 0) {
         item->setIcon(0, QIcon::fromTheme(QStringLiteral("media-record")));
         slotCheckJob();
@@ -2524,7 +2807,8 @@ void RenderWidget::setRenderJob(const QString &dest, int progress, int frame)
             est.append(i18np("%1 day ", "%1 days ", days));
         }
         est.append(when.toString(QStringLiteral("hh:mm:ss")));
-        int speed = (frame - item->data(1, LastFrameRole).toInt()) / dt;
+        // Frames start again with each stage of a two pass render
+        int speed = qMax(0, frame - item->data(1, LastFrameRole).toInt()) / dt;
         est.append(i18n(" (frame %1 @ %2 fps)", frame, speed));
         item->setData(1, Qt::UserRole, est);
         item->setData(1, LastTimeRole, elapsedTime);
@@ -2599,7 +2883,9 @@ void RenderWidget::slotAbortCurrentJob()
 {
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
     if (current) {
-        if (current->status() == RUNNINGJOB) {
+        if (m_inProcessRenders.contains(current->text(1))) {
+            m_inProcessRenders.value(current->text(1))->abort();
+        } else if (current->status() == RUNNINGJOB || current->status() == PAUSEDJOB) {
             emit abortProcess(current->text(1));
         } else {
             delete current;
@@ -2623,7 +2909,7 @@ void RenderWidget::slotCheckJob()
     bool activate = false;
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
     if (current) {
-        if (current->status() == RUNNINGJOB || current->status() == STARTINGJOB) {
+        if (current->status() == RUNNINGJOB || current->status() == STARTINGJOB || current->status() == PAUSEDJOB) {
             m_view.abort_job->setText(i18n("Abort Job"));
             m_view.start_job->setEnabled(false);
         } else {
@@ -2742,7 +3028,8 @@ void RenderWidget::slotStartScript()
         QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(destination, Qt::MatchExactly, 1);
         if (!existing.isEmpty()) {
             renderItem = static_cast<RenderJobItem *>(existing.at(0));
-            if (renderItem->status() == RUNNINGJOB || renderItem->status() == WAITINGJOB || renderItem->status() == STARTINGJOB) {
+            if (renderItem->status() == RUNNINGJOB || renderItem->status() == WAITINGJOB || renderItem->status() == STARTINGJOB ||
+                renderItem->status() == PAUSEDJOB) {
                 KMessageBox::information(
                     this, i18n("There is already a job writing file:<br /><b>%1</b><br />Abort the job if you want to overwrite it...", destination),
                     i18n("Already running"));
@@ -3029,6 +3316,7 @@ bool RenderWidget::selectedAudioExport() const
 void RenderWidget::updateProxyConfig(bool enable)
 {
     m_view.proxy_render->setHidden(!enable);
+    m_view.proxy_hybrid->setHidden(!enable);
 }
 
 bool RenderWidget::proxyRendering()
@@ -3151,6 +3439,11 @@ void RenderWidget::checkCodecs()
 
 void RenderWidget::slotProxyWarn(bool enableProxy)
 {
+    m_view.proxy_hybrid->setEnabled(enableProxy);
+    if (enableProxy && m_view.proxy_hybrid->isChecked()) {
+        errorMessage(ProxyWarning, i18n("Rendering using proxy clips when their resolution is sufficient for the output"));
+        return;
+    }
     errorMessage(ProxyWarning, enableProxy ? i18n("Rendering using low quality proxy") : QString());
 }
 
@@ -3164,15 +3457,67 @@ void RenderWidget::prepareMenu(const QPoint &pos)
     if (!renderItem) {
         return;
     }
-    if (renderItem->status() != FINISHEDJOB) {
+    QMenu menu(this);
+    switch (renderItem->status()) {
+    case FINISHEDJOB: {
+        QAction *newAct = new QAction(i18n("Add to current project"), &menu);
+        connect(newAct, &QAction::triggered, [&, renderItem]() {
+            pCore->bin()->slotAddClipToProject(QUrl::fromLocalFile(renderItem->text(1)));
+        });
+        menu.addAction(newAct);
+        break;
+    }
+    case WAITINGJOB: {
+        int ix = m_view.running_jobs->indexOfTopLevelItem(renderItem);
+        QAction *upAct = menu.addAction(QIcon::fromTheme(QStringLiteral("go-up")), i18n("Move Up"));
+        upAct->setEnabled(ix > 0);
+        connect(upAct, &QAction::triggered, [this, renderItem]() { moveJob(renderItem, -1); });
+        QAction *downAct = menu.addAction(QIcon::fromTheme(QStringLiteral("go-down")), i18n("Move Down"));
+        downAct->setEnabled(ix < m_view.running_jobs->topLevelItemCount() - 1);
+        connect(downAct, &QAction::triggered, [this, renderItem]() { moveJob(renderItem, 1); });
+        break;
+    }
+#ifdef Q_OS_UNIX
+    case RUNNINGJOB: {
+        if (m_inProcessRenders.contains(renderItem->text(1))) {
+            // Only render processes can be paused
+            return;
+        }
+        QAction *pauseAct = menu.addAction(QIcon::fromTheme(QStringLiteral("media-playback-pause")), i18n("Pause"));
+        connect(pauseAct, &QAction::triggered, [this, renderItem]() {
+            renderItem->setStatus(PAUSEDJOB);
+            emit pauseProcess(renderItem->text(1), true);
+            // Paused jobs don't use their threads
+            checkRenderStatus();
+        });
+        break;
+    }
+    case PAUSEDJOB: {
+        QAction *resumeAct = menu.addAction(QIcon::fromTheme(QStringLiteral("media-playback-start")), i18n("Resume"));
+        connect(resumeAct, &QAction::triggered, [this, renderItem]() {
+            // The job resumes when enough threads are available
+            renderItem->setData(1, ResumeRole, true);
+            renderItem->setData(1, Qt::UserRole, i18n("Waiting..."));
+            checkRenderStatus();
+        });
+        break;
+    }
+#endif
+    default:
         return;
     }
-    QMenu menu(this);
-    QAction *newAct = new QAction(i18n("Add to current project"), this);
-    connect(newAct, &QAction::triggered, [&, renderItem]() {
-        pCore->bin()->slotAddClipToProject(QUrl::fromLocalFile(renderItem->text(1)));
-    });
-    menu.addAction(newAct);
-    
     menu.exec(m_view.running_jobs->mapToGlobal(pos));
 }
+
+void RenderWidget::moveJob(RenderJobItem *item, int offset)
+{
+    int ix = m_view.running_jobs->indexOfTopLevelItem(item);
+    int newIx = ix + offset;
+    if (ix < 0 || newIx < 0 || newIx >= m_view.running_jobs->topLevelItemCount()) {
+        return;
+    }
+    m_view.running_jobs->takeTopLevelItem(ix);
+    m_view.running_jobs->insertTopLevelItem(newIx, item);
+    m_view.running_jobs->setCurrentItem(item);
+    checkRenderStatus();
+}
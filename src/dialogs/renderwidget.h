@@ -36,6 +36,8 @@ class Menu;
 #include "bin/model/markerlistmodel.hpp"
 #include "ui_renderwidget_ui.h"
 
+class InProcessRender;
+class ProxySubstitution;
 class QDomElement;
 class QKeyEvent;
 
@@ -215,17 +217,31 @@ private:
     KMessageWidget *m_jobInfoMessage;
     QMap<int, QString> m_errorMessages;
     std::weak_ptr<MarkerListModel> m_guidesModel;
+    /** @brief The proxy / original choices of the last prepared render, when rendering with proxies where their resolution is sufficient */
+    std::unique_ptr<ProxySubstitution> m_proxySubstitution;
+    /** @brief The renders running inside Kdenlive, by destination file */
+    QMap<QString, InProcessRender *> m_inProcessRenders;
 
 #ifdef KF5_USE_PURPOSE
     Purpose::Menu *m_shareMenu;
 #endif
     void parseMltPresets();
+    /** @brief The frame size of the rendered file, clips are never rendered larger than the project profile */
+    QSize renderOutputSize() const;
     void parseProfiles(const QString &selectedProfile = QString());
     void parseFile(const QString &exportFile, bool editable);
     void updateButtons();
     QUrl filenameWithExtension(QUrl url, const QString &extension);
-    /** @brief Check if a job needs to be started. */
+    /** @brief Start waiting jobs, as long as the number of running jobs and their threads fit in the configured limits. */
     void checkRenderStatus();
+    /** @brief Returns the maximum number of threads used by all running jobs. */
+    int renderThreadBudget() const;
+    /** @brief Returns the number of threads allocated to a job. */
+    int jobThreads(RenderJobItem *item) const;
+    /** @brief Returns the first pass job of a second pass job, if it is still in the queue. */
+    RenderJobItem *firstPassJob(RenderJobItem *item) const;
+    /** @brief Move a waiting job up (negative offset) or down in the queue. */
+    void moveJob(RenderJobItem *item, int offset);
     void startRendering(RenderJobItem *item);
     bool saveProfile(QDomElement newprofile);
     /** @brief Create a rendering profile from MLT preset. */
@@ -237,6 +253,7 @@ private:
 
 signals:
     void abortProcess(const QString &url);
+    void pauseProcess(const QString &url, bool pause);
     void openDvdWizard(const QString &url);
     /** Send the info about rendering that will be saved in the document:
     (profile destination, profile name and url of rendered file */
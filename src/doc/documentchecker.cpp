@@ -24,6 +24,7 @@
 #include "kthumb.h"
 #include "titler/titlewidget.h"
 #include "bin/projectclip.h"
+#include "utils/fingerprintcache.hpp"
 
 #include <KMessageBox>
 #include <KRecentDirs>
@@ -143,6 +144,9 @@ bool DocumentChecker::hasErrorInClips()
     max = documentProducers.count();
     QStringList verifiedPaths;
     QStringList missingPaths;
+    // Existing clips whose hash must be checked
+    QList<QDomElement> hashedClips;
+    QStringList hashedPaths;
     QStringList serviceToCheck;
     serviceToCheck << QStringLiteral("kdenlivetitle") << QStringLiteral("qimage") << QStringLiteral("pixbuf") << QStringLiteral("timewarp")
                    << QStringLiteral("framebuffer") << QStringLiteral("xml") << QStringLiteral("qtext");
@@ -315,21 +319,26 @@ bool DocumentChecker::hasErrorInClips()
                 missingPaths.append(resource);
             }
         } else if (service.startsWith(QLatin1String("avformat"))) {
-            // Check if file changed
-            const QByteArray hash = Xml::getXmlProperty(e, "kdenlive:file_hash").toLatin1();
-            if (!hash.isEmpty()) {
-                const QByteArray fileData = ProjectClip::calculateHash(resource).first.toHex();
-                if (hash != fileData) {
-                    // Clip was changed, notify and trigger clip reload
-                    Xml::removeXmlProperty(e, "kdenlive:file_hash");
-                    m_changedClips.append(resource);
-                }
+            // Check if file changed, hashes are computed in parallel below
+            if (!Xml::getXmlProperty(e, QStringLiteral("kdenlive:file_hash")).isEmpty()) {
+                hashedClips.append(e);
+                hashedPaths.append(resource);
             }
         }
         // Make sure we don't query same path twice
         verifiedPaths.append(resource);
     }
 
+    const QMap<QString, QString> fileHashes = FingerprintCache::get()->fingerprints(hashedPaths);
+    for (int i = 0; i < hashedClips.size(); ++i) {
+        QDomElement e = hashedClips.at(i);
+        if (Xml::getXmlProperty(e, QStringLiteral("kdenlive:file_hash")) != fileHashes.value(hashedPaths.at(i))) {
+            // Clip was changed, notify and trigger clip reload
+            Xml::removeXmlProperty(e, "kdenlive:file_hash");
+            m_changedClips.append(hashedPaths.at(i));
+        }
+    }
+
     // Get list of used Luma files
     QStringList missingLumas;
     QStringList filesToCheck;
@@ -800,12 +809,34 @@ void DocumentChecker::slotSearchClips()
     // TODO: make non modal
     QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
     QDir searchDir(newpath);
+    // Walk the folder once for all missing clips with a known size and hash
+    QList<QPair<qint64, QString>> requests;
+    while (child != nullptr) {
+        int status = child->data(0, statusRole).toInt();
+        if (status == SOURCEMISSING) {
+            for (int j = 0; j < child->childCount(); ++j) {
+                requests << qMakePair(child->child(j)->data(0, sizeRole).toLongLong(), child->child(j)->data(0, hashRole).toString());
+            }
+        } else if (status == CLIPMISSING && child->data(0, clipTypeRole).toInt() != ClipType::SlideShow) {
+            requests << qMakePair(child->data(0, sizeRole).toLongLong(), child->data(0, hashRole).toString());
+        }
+        child = m_ui.treeWidget->topLevelItem(++ix);
+    }
+    const QMap<QString, QString> matches = FingerprintCache::get()->findFiles(searchDir, requests);
+    auto searchFile = [this, &matches, &searchDir](QTreeWidgetItem *item) {
+        const QString hash = item->data(0, hashRole).toString();
+        if (item->data(0, sizeRole).toString().isEmpty() || hash.isEmpty()) {
+            return searchPathRecursively(searchDir, QUrl::fromLocalFile(item->text(1)).fileName());
+        }
+        return matches.value(hash);
+    };
+    ix = 0;
+    child = m_ui.treeWidget->topLevelItem(ix);
     while (child != nullptr) {
         if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
             for (int j = 0; j < child->childCount(); ++j) {
                 QTreeWidgetItem *subchild = child->child(j);
-                QString clipPath =
-                    searchFileRecursively(searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
+                QString clipPath = searchFile(subchild);
                 if (!clipPath.isEmpty()) {
                     fixed = true;
                     subchild->setText(1, clipPath);
@@ -819,7 +850,7 @@ void DocumentChecker::slotSearchClips()
             QString clipPath;
             if (type != ClipType::SlideShow) {
                 // Slideshows cannot be found with hash / size
-                clipPath = searchFileRecursively(searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
+                clipPath = searchFile(child);
             } else {
                 clipPath = searchPathRecursively(searchDir, child->text(1), type);
             }
@@ -949,43 +980,7 @@ QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &m
     if (matchSize.isEmpty() && matchHash.isEmpty()) {
         return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
     }
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash, fileName);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    return FingerprintCache::get()->findFile(dir, matchSize.toLongLong(), matchHash);
 }
 
 void DocumentChecker::slotEditItem(QTreeWidgetItem *item, int)
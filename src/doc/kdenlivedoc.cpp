@@ -40,6 +40,10 @@
 #include "project/projectcommands.h"
 #include "titler/titlewidget.h"
 #include "transitions/transitionsrepository.hpp"
+#include "utils/analysistrack.hpp"
+#include "utils/cacheusage.hpp"
+#include "utils/fingerprintcache.hpp"
+#include "utils/probecache.hpp"
 
 #include <config-kdenlive.h>
 
@@ -56,8 +60,11 @@
 #include <QDomImplementation>
 #include <QFile>
 #include <QFileDialog>
+#include <QSaveFile>
 #include <QUndoGroup>
 #include <QUndoStack>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include <KJobWidgets/KJobWidgets>
 #include <QStandardPaths>
@@ -308,6 +315,19 @@ int KdenliveDoc::clipsCount() const
 
 const QByteArray KdenliveDoc::getAndClearProjectXml()
 {
+    // Media files that did not change since last probe will be opened on first use
+    int lazyProducers = ProbeCache::get()->applyToDocument(m_document);
+    qCDebug(KDENLIVE_LOG) << "// Skipping media probe for " << lazyProducers << " producers";
+    // Analysis sidecar files left by unsaved changes are not referenced by the project anymore
+    QStringList analysisValues;
+    QDomNodeList props = m_document.elementsByTagName(QStringLiteral("property"));
+    for (int i = 0; i < props.count(); ++i) {
+        QDomElement prop = props.item(i).toElement();
+        if (prop.attribute(QStringLiteral("name")).startsWith(QLatin1String("kdenlive:clipanalysis."))) {
+            analysisValues << prop.text();
+        }
+    }
+    AnalysisTrack::removeUnused(analysisValues);
     const QByteArray result = m_document.toString().toUtf8();
     // We don't need the xml data anymore, throw away
     m_document.clear();
@@ -486,90 +506,144 @@ QPair<int, int> KdenliveDoc::targetTracks() const
     return {m_documentProperties.value(QStringLiteral("videoTarget")).toInt(), m_documentProperties.value(QStringLiteral("audioTarget")).toInt()};
 }
 
-QDomDocument KdenliveDoc::xmlSceneList(const QString &scene)
+bool KdenliveDoc::writeSceneList(QIODevice *source, QIODevice *target, const QMap<QString, QString> &replacements)
 {
-    QDomDocument sceneList;
-    sceneList.setContent(scene, true);
-    QDomElement mlt = sceneList.firstChildElement(QStringLiteral("mlt"));
-    if (mlt.isNull() || !mlt.hasChildNodes()) {
-        // scenelist is corrupted
-        return QDomDocument();
-    }
-
-    // Set playlist audio volume to 100%
-    QDomNodeList tractors = mlt.elementsByTagName(QStringLiteral("tractor"));
-    for (int i = 0; i < tractors.count(); ++i) {
-        if (tractors.at(i).toElement().hasAttribute(QStringLiteral("global_feed"))) {
-            // This is our main tractor
-            QDomElement tractor = tractors.at(i).toElement();
-            if (Xml::hasXmlProperty(tractor, QLatin1String("meta.volume"))) {
-                Xml::setXmlProperty(tractor, QStringLiteral("meta.volume"), QStringLiteral("1"));
-            }
-            break;
+    // Replacement patterns were designed for the xml string, where ">" precedes element texts
+    auto replace = [&replacements](const QString &text, bool elementText) {
+        if (replacements.isEmpty()) {
+            return text;
         }
-    }
-    QDomNodeList tracks = mlt.elementsByTagName(QStringLiteral("track"));
-    if (tracks.isEmpty()) {
-        // Something is very wrong, inform user.
-        qDebug()<<" = = = =  = =  CORRUPTED DOC\n"<<scene;
-        return QDomDocument();
-    }
-
-    QDomNodeList pls = mlt.elementsByTagName(QStringLiteral("playlist"));
-    QDomElement mainPlaylist;
-    for (int i = 0; i < pls.count(); ++i) {
-        if (pls.at(i).toElement().attribute(QStringLiteral("id")) == BinPlaylist::binPlaylistId) {
-            mainPlaylist = pls.at(i).toElement();
+        QString result = elementText ? QLatin1Char('>') + text : text;
+        QMapIterator<QString, QString> i(replacements);
+        while (i.hasNext()) {
+            i.next();
+            result.replace(i.key(), i.value());
+        }
+        if (elementText && result.startsWith(QLatin1Char('>'))) {
+            result.remove(0, 1);
+        }
+        return result;
+    };
+    QXmlStreamReader reader(source);
+    QXmlStreamWriter writer(target);
+    int depth = 0;
+    int tracksCount = 0;
+    // Depth of our main tractor while we are inside it
+    int mainTractorDepth = -1;
+    bool mainTractorFound = false;
+    // Set when we are in a clip analysis property, its value is converted to or from a sidecar reference
+    bool analysisData = false;
+    // Set when we are in the main tractor's meta.volume property
+    bool resetVolume = false;
+    bool volumeWritten = false;
+    bool elementText = false;
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartDocument:
+            writer.writeStartDocument();
+            break;
+        case QXmlStreamReader::DTD:
+            writer.writeDTD(reader.text().toString());
+            break;
+        case QXmlStreamReader::StartElement: {
+            const QStringRef name = reader.name();
+            const QXmlStreamAttributes attributes = reader.attributes();
+            if (depth == 0 && name != QLatin1String("mlt")) {
+                qCWarning(KDENLIVE_LOG) << "// Scene list has no mlt root element";
+                return false;
+            }
+            if (name == QLatin1String("track")) {
+                tracksCount++;
+            } else if (name == QLatin1String("tractor") && !mainTractorFound && attributes.hasAttribute(QLatin1String("global_feed"))) {
+                // This is our main tractor
+                mainTractorFound = true;
+                mainTractorDepth = depth;
+            } else if (name == QLatin1String("property") && depth == mainTractorDepth + 1 && attributes.value(QLatin1String("name")) == QLatin1String("meta.volume")) {
+                // Set playlist audio volume to 100%
+                resetVolume = true;
+                volumeWritten = false;
+            } else if (name == QLatin1String("property") && attributes.value(QLatin1String("name")).startsWith(QLatin1String("kdenlive:clipanalysis."))) {
+                analysisData = true;
+            }
+            writer.writeStartElement(reader.qualifiedName().toString());
+            for (const QXmlStreamAttribute &a : attributes) {
+                writer.writeAttribute(a.qualifiedName().toString(), replace(a.value().toString(), false));
+            }
+            depth++;
+            elementText = true;
             break;
         }
-    }
-
-    // check if project contains custom effects to embed them in project file
-    QDomNodeList effects = mlt.elementsByTagName(QStringLiteral("filter"));
-    int maxEffects = effects.count();
-    // qCDebug(KDENLIVE_LOG) << "// FOUD " << maxEffects << " EFFECTS+++++++++++++++++++++";
-    QMap<QString, QString> effectIds;
-    for (int i = 0; i < maxEffects; ++i) {
-        QDomNode m = effects.at(i);
-        QDomNodeList params = m.childNodes();
-        QString id;
-        QString tag;
-        for (int j = 0; j < params.count(); ++j) {
-            QDomElement e = params.item(j).toElement();
-            if (e.attribute(QStringLiteral("name")) == QLatin1String("kdenlive_id")) {
-                id = e.firstChild().nodeValue();
+        case QXmlStreamReader::EndElement:
+            depth--;
+            if (resetVolume) {
+                if (!volumeWritten) {
+                    writer.writeCharacters(QStringLiteral("1"));
+                }
+                resetVolume = false;
             }
-            if (e.attribute(QStringLiteral("name")) == QLatin1String("tag")) {
-                tag = e.firstChild().nodeValue();
+            analysisData = false;
+            if (depth == mainTractorDepth) {
+                mainTractorDepth = -1;
             }
-            if (!id.isEmpty() && !tag.isEmpty()) {
-                effectIds.insert(id, tag);
+            writer.writeEndElement();
+            elementText = false;
+            break;
+        case QXmlStreamReader::Characters:
+            if (resetVolume) {
+                if (!volumeWritten) {
+                    writer.writeCharacters(QStringLiteral("1"));
+                    volumeWritten = true;
+                }
+            } else if (analysisData) {
+                writer.writeCharacters(AnalysisTrack::saveValue(reader.text().toString()));
+            } else if (reader.isCDATA()) {
+                writer.writeCDATA(reader.text().toString());
+            } else {
+                writer.writeCharacters(replace(reader.text().toString(), elementText));
             }
+            elementText = false;
+            break;
+        case QXmlStreamReader::Comment:
+            writer.writeComment(reader.text().toString());
+            break;
+        case QXmlStreamReader::ProcessingInstruction:
+            writer.writeProcessingInstruction(reader.processingInstructionTarget().toString(), reader.processingInstructionData().toString());
+            break;
+        case QXmlStreamReader::EntityReference:
+            writer.writeEntityReference(reader.name().toString());
+            break;
+        default:
+            break;
+        }
+        if (writer.hasError()) {
+            qCWarning(KDENLIVE_LOG) << "// Error writing scene list";
+            return false;
         }
     }
-    // TODO: find a way to process this before rendering MLT scenelist to xml
-    /*QDomDocument customeffects = initEffects::getUsedCustomEffects(effectIds);
-    if (!customeffects.documentElement().childNodes().isEmpty()) {
-        Xml::setXmlProperty(mainPlaylist, QStringLiteral("kdenlive:customeffects"), customeffects.toString());
-    }*/
-    // addedXml.appendChild(sceneList.importNode(customeffects.documentElement(), true));
-
-    // TODO: move metadata to previous step in saving process
-    QDomElement docmetadata = sceneList.createElement(QStringLiteral("documentmetadata"));
-    QMapIterator<QString, QString> j(m_documentMetadata);
-    while (j.hasNext()) {
-        j.next();
-        docmetadata.setAttribute(j.key(), j.value());
+    writer.writeEndDocument();
+    if (reader.hasError()) {
+        qCWarning(KDENLIVE_LOG) << "// Error parsing scene list: " << reader.errorString() << " at line " << reader.lineNumber();
+        return false;
     }
-    // addedXml.appendChild(docmetadata);
-
-    return sceneList;
+    if (tracksCount == 0) {
+        // Something is very wrong, inform user.
+        qCWarning(KDENLIVE_LOG) << " = = = =  = =  CORRUPTED DOC, no tracks";
+        return false;
+    }
+    return !writer.hasError();
 }
 
-bool KdenliveDoc::saveSceneList(const QString &path, const QString &scene)
+bool KdenliveDoc::saveSceneList(const QString &path, QIODevice *scene, const QMap<QString, QString> &replacements)
 {
-    QDomDocument sceneList = xmlSceneList(scene);
-    if (sceneList.isNull()) {
+    // QSaveFile writes to a temporary file, renamed over the project file on commit
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(KDENLIVE_LOG) << "//////  ERROR writing to file: " << path;
+        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
+        return false;
+    }
+    if (!writeSceneList(scene, &file, replacements)) {
+        file.cancelWriting();
         // Make sure we don't save if scenelist is corrupted
         KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", path));
         return false;
@@ -607,16 +681,6 @@ bool KdenliveDoc::saveSceneList(const QString &path, const QString &scene)
                      backupFile));
         }
     }
-    QSaveFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qCWarning(KDENLIVE_LOG) << "//////  ERROR writing to file: " << path;
-        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
-        return false;
-    }
-
-    const QByteArray sceneData = sceneList.toString().toUtf8();
-
-    file.write(sceneData);
     if (!file.commit()) {
         KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1", path));
         return false;
@@ -708,6 +772,25 @@ void KdenliveDoc::moveProjectData(const QString & /*src*/, const QString &dest)
             }
         }
     }
+    // Copy analysis sidecars, the old folder is still used by the saved project file
+    QDir analysisDir(AnalysisTrack::analysisFolder(projectDataFolder()));
+    const QString destAnalysis = AnalysisTrack::analysisFolder(dest);
+    if (analysisDir.exists() && QDir(analysisDir.absolutePath()) != QDir(destAnalysis)) {
+        QList<QUrl> analysisUrls;
+        const QStringList sidecars = analysisDir.entryList(QDir::Files);
+        for (const QString &sidecar : sidecars) {
+            if (!QFile::exists(QDir(destAnalysis).absoluteFilePath(sidecar))) {
+                analysisUrls << QUrl::fromLocalFile(analysisDir.absoluteFilePath(sidecar));
+            }
+        }
+        if (!analysisUrls.isEmpty() && QDir(destAnalysis).mkpath(QStringLiteral("."))) {
+            KIO::CopyJob *job = KIO::copy(analysisUrls, QUrl::fromLocalFile(destAnalysis));
+            KJobWidgets::setWindow(job, QApplication::activeWindow());
+            if (!job->exec()) {
+                KMessageBox::sorry(QApplication::activeWindow(), i18n("Copying analysis data failed: %1", job->errorText()));
+            }
+        }
+    }
 }
 
 bool KdenliveDoc::profileChanged(const QString &profile) const
@@ -788,47 +871,9 @@ const QString KdenliveDoc::description() const
 
 QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
 {
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-                qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    return FingerprintCache::get()->findFile(dir, matchSize.toLongLong(), matchHash);
 }
 
-
 QStringList KdenliveDoc::getBinFolderClipIds(const QString &folderId) const
 {
     return pCore->bin()->getBinFolderClipIds(folderId);
@@ -1649,6 +1694,7 @@ void KdenliveDoc::initCacheDirs()
     dir.mkdir(QStringLiteral("videothumbs"));
     QDir cacheDir(kdenliveCacheDir);
     cacheDir.mkdir(QStringLiteral("proxy"));
+    CacheUsage::get()->setProject(dir);
 }
 
 QDir KdenliveDoc::getCacheDir(CacheType type, bool *ok) const
@@ -88,10 +88,12 @@ public:
     void setZoom(int horizontal, int vertical = -1);
     QPoint zoom() const;
     double dar() const;
-    /** @brief Returns the project file xml. */
-    QDomDocument xmlSceneList(const QString &scene);
-    /** @brief Saves the project file xml to a file. */
-    bool saveSceneList(const QString &path, const QString &scene);
+    /** @brief Copy the MLT xml from source to target, patching it for the project file on the fly.
+     *  @param replacements strings to replace in attribute values and element texts
+     *  @return false if the scene list is corrupted */
+    static bool writeSceneList(QIODevice *source, QIODevice *target, const QMap<QString, QString> &replacements = {});
+    /** @brief Saves the project file xml read from scene to a file, through a temporary file. */
+    bool saveSceneList(const QString &path, QIODevice *scene, const QMap<QString, QString> &replacements = {});
     /** @brief Saves only the MLT xml to a file for preview rendering. */
     void saveMltPlaylist(const QString &fileName);
     void cacheImage(const QString &fileId, const QImage &img) const;
@@ -29,6 +29,7 @@
 #include "klocalizedstring.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
+#include "utils/cacheusage.hpp"
 #include "utils/thumbnailcache.hpp"
 #include <QScopedPointer>
 #include <QTemporaryFile>
@@ -360,7 +361,11 @@ bool AudioThumbJob::startJob()
                 }
                 image.setPixel(i / m_channels, i % m_channels, p);
             }
-            image.save(m_cachePath);
+            // Another job may have written the same stream meanwhile
+            qint64 previousSize = CacheUsage::fileSize(m_cachePath);
+            if (image.save(m_cachePath)) {
+                CacheUsage::get()->fileWritten(CacheAudio, m_cachePath, previousSize);
+            }
         }
         m_audioLevels.clear();
     }
@@ -25,6 +25,7 @@
 #include "bin/projectsubclip.h"
 #include "core.h"
 #include "doc/kthumb.h"
+#include "kdenlivesettings.h"
 #include "klocalizedstring.h"
 #include "macros.hpp"
 #include "utils/thumbnailcache.hpp"
@@ -33,11 +34,15 @@
 #include <set>
 
 #include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
 #include <QScopedPointer>
 #include <QThread>
 #include <QtConcurrent>
 
-CacheJob::CacheJob(const QString &binId, int thumbsCount, int inPoint, int outPoint)
+CacheJob::CacheJob(const QString &binId, int thumbsCount, int inPoint, int outPoint, bool exactFrames)
     : AbstractClipJob(CACHEJOB, binId)
     , m_fullWidth(qFuzzyCompare(pCore->getCurrentSar(), 1.0) ? 0 : pCore->thumbProfile()->height() * pCore->getCurrentDar() + 0.5)
     , m_semaphore(1)
@@ -45,6 +50,7 @@ CacheJob::CacheJob(const QString &binId, int thumbsCount, int inPoint, int outPo
     , m_thumbsCount(thumbsCount)
     , m_inPoint(inPoint)
     , m_outPoint(outPoint)
+    , m_exactFrames(exactFrames)
 
 {
     if (m_fullWidth % 2 > 0) {
@@ -95,33 +101,118 @@ bool CacheJob::startJob()
         frames.insert(pos);
         pos = m_inPoint + (steps * i);
     }
-    int size = (int)frames.size();
-    int count = 0;
+    std::vector<int> missing;
     for (int i : frames) {
+        if (!ThumbnailCache::get()->hasThumbnail(m_clipId, i)) {
+            missing.push_back(i);
+        }
+    }
+    // Progressive extraction: a first pass gives an overview of the whole clip, the second one fills the gaps.
+    // Each pass is sorted by position so that we read the file in order
+    std::vector<int> ordered;
+    for (size_t ix = 0; ix < missing.size(); ix += 4) {
+        ordered.push_back(missing.at(ix));
+    }
+    size_t firstPass = ordered.size();
+    for (size_t ix = 0; ix < missing.size(); ix++) {
+        if (ix % 4 != 0) {
+            ordered.push_back(missing.at(ix));
+        }
+    }
+    // For long GOP codecs, decoding the keyframe preceding the requested frame avoids decoding the whole GOP
+    QMap<int, int> keyframes;
+    if (!m_exactFrames) {
+        keyframes = keyframePositions(missing, steps / 2);
+    }
+    QMap<int, QImage> batch;
+    int size = (int)ordered.size();
+    int count = 0;
+    for (int i : ordered) {
         emit jobProgress(100 * count / size);
         count++;
-        if (m_clipId.isEmpty() || ThumbnailCache::get()->hasThumbnail(m_clipId, i)) {
-            continue;
+        if (m_clipId.isEmpty()) {
+            break;
         }
         if (m_done || !m_semaphore.tryAcquire(1)) {
             m_semaphore.release();
             break;
         }
-        m_prod->seek(i);
+        m_prod->seek(keyframes.value(i, i));
         QScopedPointer<Mlt::Frame> frame(m_prod->get_frame());
         frame->set("deinterlace_method", "onefield");
         frame->set("top_field_first", -1);
         frame->set("rescale.interp", "nearest");
         if (frame != nullptr && frame->is_valid()) {
-            QImage result = KThumb::getFrame(frame.data(), 0, 0, m_fullWidth);
-            QtConcurrent::run(ThumbnailCache::get().get(), &ThumbnailCache::storeThumbnail, m_clipId, i, result, true);
+            batch.insert(i, KThumb::getFrame(frame.data(), 0, 0, m_fullWidth));
         }
         m_semaphore.release(1);
+        // Write thumbnails in batches, and make the overview available as soon as it is ready
+        if (batch.size() >= 10 || count == (int)firstPass) {
+            QtConcurrent::run(ThumbnailCache::get().get(), &ThumbnailCache::storeThumbnails, m_clipId, batch, true);
+            batch.clear();
+        }
+    }
+    if (!batch.isEmpty() && !m_clipId.isEmpty()) {
+        QtConcurrent::run(ThumbnailCache::get().get(), &ThumbnailCache::storeThumbnails, m_clipId, batch, true);
+    }
+    if (!keyframes.isEmpty()) {
+        qDebug() << "// Thumbnails for clip " << m_clipId << ": " << keyframes.size() << " of " << missing.size() << " extracted from keyframes";
     }
     m_done = true;
     return true;
 }
 
+QMap<int, int> CacheJob::keyframePositions(const std::vector<int> &frames, int tolerance) const
+{
+    QMap<int, int> result;
+    if (frames.size() < 2 || tolerance < 1 || KdenliveSettings::ffprobepath().isEmpty() || m_binClip->clipType() == ClipType::Playlist ||
+        !m_binClip->getProducerProperty(QStringLiteral("mlt_service")).startsWith(QLatin1String("avformat"))) {
+        return result;
+    }
+    double fps = pCore->getCurrentFps();
+    // Seek to each requested position and read a single packet: ffprobe seeks to the preceding keyframe
+    QStringList intervals;
+    for (int pos : frames) {
+        intervals << QStringLiteral("%1%+#1").arg(pos / fps, 0, 'f', 3);
+    }
+    QStringList args = {QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-select_streams"), QStringLiteral("v:0"),
+                        QStringLiteral("-read_intervals"), intervals.join(QLatin1Char(',')),
+                        QStringLiteral("-show_entries"), QStringLiteral("packet=pts_time,flags:stream=start_time"),
+                        QStringLiteral("-of"), QStringLiteral("json"), m_binClip->url()};
+    QProcess probe;
+    probe.start(KdenliveSettings::ffprobepath(), args);
+    if (!probe.waitForFinished(30000) || probe.exitCode() != 0) {
+        probe.kill();
+        return result;
+    }
+    QJsonObject json = QJsonDocument::fromJson(probe.readAllStandardOutput()).object();
+    double startTime = 0.;
+    QJsonArray streams = json.value(QStringLiteral("streams")).toArray();
+    if (!streams.isEmpty()) {
+        startTime = streams.first().toObject().value(QStringLiteral("start_time")).toString().toDouble();
+    }
+    std::set<int> keys;
+    for (const auto &packet : json.value(QStringLiteral("packets")).toArray()) {
+        QJsonObject obj = packet.toObject();
+        if (!obj.value(QStringLiteral("flags")).toString().startsWith(QLatin1Char('K'))) {
+            continue;
+        }
+        // Round up so that seeking to this position does not land in the previous GOP
+        keys.insert(qCeil((obj.value(QStringLiteral("pts_time")).toString().toDouble() - startTime) * fps - 0.01));
+    }
+    for (int pos : frames) {
+        auto it = keys.upper_bound(pos);
+        if (it == keys.begin()) {
+            continue;
+        }
+        --it;
+        if (pos - *it <= tolerance) {
+            result.insert(pos, *it);
+        }
+    }
+    return result;
+}
+
 bool CacheJob::commitResult(Fun &undo, Fun &redo)
 {
     Q_UNUSED(undo)
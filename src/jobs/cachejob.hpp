@@ -23,8 +23,10 @@
 
 #include "abstractclipjob.h"
 
+#include <QMap>
 #include <QSemaphore>
 #include <memory>
+#include <vector>
 
 /* @brief This class represents the job that corresponds to computing the thumb of a clip
  */
@@ -42,8 +44,10 @@ public:
     /* @brief Extract a thumb for given clip.
        @param frameNumber is the frame to extract. Leave to -1 for default
        @param persistent: if true, we will use the persistent cache (for query and saving)
+       @param exactFrames: if false, thumbnails can be extracted from the keyframe preceding the requested position. Only
+       hover previews, where a few frames of difference do not matter, should disable it
     */
-    CacheJob(const QString &binId, int thumbsCount = 30, int inPoint = 0, int outPoint = 0);
+    CacheJob(const QString &binId, int thumbsCount = 30, int inPoint = 0, int outPoint = 0, bool exactFrames = true);
 
     const QString getDescription() const override;
 
@@ -54,6 +58,9 @@ public:
     bool commitResult(Fun &undo, Fun &redo) override;
 
 private:
+    /** @brief Use ffprobe to find the keyframe preceding each requested position.
+     *  Returns a map of requested position -> keyframe position, only for positions where snapping is acceptable */
+    QMap<int, int> keyframePositions(const std::vector<int> &frames, int tolerance) const;
     int m_fullWidth;
 
     std::shared_ptr<ProjectClip> m_binClip;
@@ -66,4 +73,5 @@ private:
     int m_outPoint;
     bool m_inCache{false};
     bool m_subClip{false}; // true if we operate on a subclip
+    bool m_exactFrames;
 };
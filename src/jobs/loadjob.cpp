@@ -34,6 +34,7 @@
 #include "effects/effectsrepository.hpp"
 #include "effects/effectstack/model/effectstackmodel.hpp"
 #include "monitor/monitor.h"
+#include "utils/probecache.hpp"
 
 #include "xml/xml.hpp"
 #include <KMessageWidget>
@@ -391,12 +392,19 @@ bool LoadJob::startJob()
         break;
     }
     default:
-        if (!service.isEmpty()) {
+        if (service.isEmpty() || service.startsWith(QLatin1String("avformat"))) {
+            // Skip probing if we already know this file
+            m_producer = ProbeCache::get()->cachedProducer(m_resource, Xml::getXmlProperty(m_xml, QStringLiteral("kdenlive:file_hash")));
+        }
+        if (m_producer) {
+            qCDebug(KDENLIVE_LOG) << "// Using cached probe data for " << m_resource;
+        } else if (!service.isEmpty()) {
             service.append(QChar(':'));
             m_producer = loadResource(m_resource, service);
         } else {
             m_producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, m_resource.toUtf8().constData());
         }
+        ProbeCache::get()->storeProbeData(m_resource, m_producer.get(), Xml::getXmlProperty(m_xml, QStringLiteral("kdenlive:file_hash")));
         break;
     }
     if (!m_producer || m_producer->is_blank() || !m_producer->is_valid()) {
@@ -491,7 +499,7 @@ bool LoadJob::startJob()
             m_producer->set("length", fixedLength);
             m_producer->set("out", fixedLength - 1);
         }
-    } else if (mltService == QLatin1String("avformat")) {
+    } else if (mltService == QLatin1String("avformat") || mltService == QLatin1String("avformat-novalidate")) {
         // check if there are multiple streams
         vindex = m_producer->get_int("video_index");
         // List streams
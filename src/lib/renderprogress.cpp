@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "renderprogress.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <cstdio>
+
+namespace {
+// Only the timing logs of the last renders are kept
+const int maxLogs = 50;
+
+const QMap<RenderProgress::Event, QString> &eventNames()
+{
+    static const QMap<RenderProgress::Event, QString> names{{RenderProgress::Event::Started, QStringLiteral("started")},
+                                                            {RenderProgress::Event::Progress, QStringLiteral("progress")},
+                                                            {RenderProgress::Event::ChunkStarted, QStringLiteral("chunk-started")},
+                                                            {RenderProgress::Event::ChunkDone, QStringLiteral("chunk-done")},
+                                                            {RenderProgress::Event::Finished, QStringLiteral("finished")},
+                                                            {RenderProgress::Event::Failed, QStringLiteral("failed")},
+                                                            {RenderProgress::Event::Aborted, QStringLiteral("aborted")}};
+    return names;
+}
+} // namespace
+
+QByteArray RenderProgress::serialize(const Record &record)
+{
+    QJsonObject obj;
+    obj.insert(QLatin1String("event"), eventNames().value(record.event));
+    if (record.frame >= 0) {
+        obj.insert(QLatin1String("frame"), record.frame);
+    }
+    obj.insert(QLatin1String("frames"), record.frames);
+    if (record.percent >= 0) {
+        obj.insert(QLatin1String("percent"), record.percent);
+    }
+    obj.insert(QLatin1String("fps"), record.fps);
+    if (record.queue >= 0) {
+        obj.insert(QLatin1String("queue"), record.queue);
+    }
+    obj.insert(QLatin1String("elapsed"), record.elapsed);
+    if (!record.stages.isEmpty()) {
+        QJsonObject stages;
+        for (auto i = record.stages.constBegin(); i != record.stages.constEnd(); ++i) {
+            stages.insert(i.key(), i.value());
+        }
+        obj.insert(QLatin1String("stages"), stages);
+    }
+    if (!record.message.isEmpty()) {
+        obj.insert(QLatin1String("message"), record.message);
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool RenderProgress::parse(const QByteArray &line, Record &record)
+{
+    const QJsonObject obj = QJsonDocument::fromJson(line).object();
+    const QString event = obj.value(QLatin1String("event")).toString();
+    if (event.isEmpty() || !eventNames().values().contains(event)) {
+        return false;
+    }
+    record = Record();
+    record.event = eventNames().key(event);
+    record.frame = obj.value(QLatin1String("frame")).toInt(-1);
+    record.frames = obj.value(QLatin1String("frames")).toInt();
+    record.percent = obj.value(QLatin1String("percent")).toInt(-1);
+    record.fps = obj.value(QLatin1String("fps")).toDouble();
+    record.queue = obj.value(QLatin1String("queue")).toInt(-1);
+    record.elapsed = qint64(obj.value(QLatin1String("elapsed")).toDouble());
+    const QJsonObject stages = obj.value(QLatin1String("stages")).toObject();
+    for (auto i = stages.constBegin(); i != stages.constEnd(); ++i) {
+        record.stages.insert(i.key(), qint64(i.value().toDouble()));
+    }
+    record.message = obj.value(QLatin1String("message")).toString();
+    return true;
+}
+
+QString RenderProgress::logFolder()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).absoluteFilePath(QStringLiteral("kdenlive/renderlogs"));
+}
+
+RenderProgress::Log::Log(const QString &target, bool echo)
+    : m_echo(echo)
+{
+    m_timer.start();
+    QDir folder(logFolder());
+    if (target.isEmpty() || !folder.mkpath(QStringLiteral("."))) {
+        return;
+    }
+    QFileInfoList logs = folder.entryInfoList({QStringLiteral("*.jsonl")}, QDir::Files, QDir::Time);
+    while (logs.size() >= maxLogs) {
+        QFile::remove(logs.takeLast().absoluteFilePath());
+    }
+    const QString stamp = QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss"));
+    // The pid and suffix keep the logs of concurrent renders to the same target apart
+    const QString base = QStringLiteral("%1-%2-%3").arg(QFileInfo(target).completeBaseName(), stamp).arg(QCoreApplication::applicationPid());
+    QString name = base + QStringLiteral(".jsonl");
+    for (int suffix = 1; folder.exists(name); ++suffix) {
+        name = QStringLiteral("%1-%2.jsonl").arg(base).arg(suffix);
+    }
+    m_file.setFileName(folder.absoluteFilePath(name));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Unable to write render timing log " << m_file.fileName();
+    }
+}
+
+RenderProgress::Log::~Log()
+{
+    m_file.close();
+}
+
+void RenderProgress::Log::write(Record record)
+{
+    record.elapsed = m_timer.elapsed();
+    const QByteArray line = serialize(record);
+    if (m_echo) {
+        fwrite(line.constData(), 1, size_t(line.size()), stdout);
+        fflush(stdout);
+    }
+    if (m_file.isOpen()) {
+        // Flushed on each record so that the log is complete if the renderer crashes
+        m_file.write(line);
+        m_file.flush();
+    }
+}
+
+qint64 RenderProgress::Log::elapsed() const
+{
+    return m_timer.elapsed();
+}
+
+QString RenderProgress::Log::fileName() const
+{
+    return m_file.fileName();
+}
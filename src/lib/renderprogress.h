@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KDENLIVE_RENDERPROGRESS_H
+#define KDENLIVE_RENDERPROGRESS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QString>
+
+/**
+ * The progress stream written by kdenlive_render on its standard output. Each line is
+ * a compact JSON object describing one event, so that readers don't depend on the
+ * wording of the renderer's messages. Errors and MLT messages stay on standard error.
+ */
+namespace RenderProgress {
+
+enum class Event {
+    /** @brief The render process started */
+    Started,
+    /** @brief Frames were encoded */
+    Progress,
+    /** @brief A timeline preview chunk starts rendering, frame is its first frame */
+    ChunkStarted,
+    /** @brief A timeline preview chunk was written */
+    ChunkDone,
+    Finished,
+    Failed,
+    Aborted
+};
+
+struct Record
+{
+    Event event{Event::Progress};
+    /** @brief The current frame, or the first frame of a chunk */
+    int frame{-1};
+    /** @brief The number of frames encoded so far */
+    int frames{0};
+    int percent{-1};
+    /** @brief Encoding speed in frames per second */
+    double fps{0.};
+    /** @brief Frames rendered but not encoded yet, -1 if unknown */
+    int queue{-1};
+    /** @brief Milliseconds since the render started */
+    qint64 elapsed{0};
+    /** @brief Milliseconds spent in each stage (load, encode, close, concat...) */
+    QMap<QString, qint64> stages;
+    QString message;
+};
+
+/** @brief Returns the record as one line of JSON, with the trailing newline */
+QByteArray serialize(const Record &record);
+/** @brief Read a line of the progress stream. Returns false if it is not a progress record */
+bool parse(const QByteArray &line, Record &record);
+
+/** @brief The folder keeping the timing logs of the last renders */
+QString logFolder();
+
+/**
+ * @class Log
+ * @brief Writes the progress records of a render to its timing log, kept after the render for
+ * analysis of slow renders. Only the most recent logs are kept.
+ */
+class Log
+{
+public:
+    /** @brief Create the timing log for a render to target, no file is written if target is empty.
+     *  Records are also written on standard output if echo is true, which the command line renderer needs */
+    explicit Log(const QString &target = QString(), bool echo = false);
+    ~Log();
+    /** @brief Write a record, filling its elapsed time */
+    void write(Record record);
+    /** @brief Milliseconds since the log was created */
+    qint64 elapsed() const;
+    QString fileName() const;
+
+private:
+    QFile m_file;
+    QElapsedTimer m_timer;
+    bool m_echo;
+};
+
+} // namespace RenderProgress
+
+#endif
@@ -21,6 +21,7 @@
 #include "core.h"
 #include "logger.hpp"
 #include "dialogs/splash.hpp"
+#include "utils/startupprofiler.hpp"
 #include <config-kdenlive.h>
 
 #include <mlt++/Mlt.h>
@@ -71,6 +72,8 @@ int main(int argc, char *argv[])
 #ifdef USE_DRMINGW
     ExcHndlInit();
 #endif
+    // Start the startup clock
+    StartupProfiler::get();
     // Force QDomDocument to use a deterministic XML attribute order
     qSetGlobalQHashSeed(0);
 
@@ -211,6 +214,8 @@ int main(int argc, char *argv[])
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("mlt-path"), i18n("Set the path for MLT environment"), QStringLiteral("mlt-path")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("mlt-log"), i18n("MLT log level"), QStringLiteral("verbose/debug")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("i"), i18n("Comma separated list of clips to add"), QStringLiteral("clips")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("startup-profile"), i18n("Write the duration of each startup phase to a file"),
+                                        QStringLiteral("file")));
     parser.addPositionalArgument(QStringLiteral("file"), i18n("Document to open"));
 
     // Parse command line
@@ -245,6 +250,9 @@ int main(int argc, char *argv[])
     } else if (parser.value(QStringLiteral("mlt-log")) == QStringLiteral("debug")) {
         mlt_log_set_level(MLT_LOG_DEBUG);
     }
+    if (parser.isSet(QStringLiteral("startup-profile"))) {
+        StartupProfiler::get()->setLogFile(parser.value(QStringLiteral("startup-profile")));
+    }
     const QString clipsToLoad = parser.value(QStringLiteral("i"));
     QUrl url;
     if (parser.positionalArguments().count() != 0) {
@@ -65,6 +65,7 @@
 #include "transitions/transitionsrepository.hpp"
 #include "utils/resourcewidget.h"
 #include "utils/thememanager.h"
+#include "utils/startupprofiler.hpp"
 #include "utils/otioconvertions.h"
 #include "lib/localeHandling.h"
 #include "profiles/profilerepository.hpp"
@@ -143,6 +144,7 @@ MainWindow::MainWindow(QWidget *parent)
 
 void MainWindow::init()
 {
+    StartupProfiler::Phase phase(QStringLiteral("Styles"));
     QString desktopStyle = QApplication::style()->objectName();
     // Load themes
     auto themeManager = new ThemeManager(actionCollection());
@@ -212,6 +214,7 @@ void MainWindow::init()
         KdenliveSettings::setDefault_profile(QStringLiteral("atsc_1080p_25"));
     }
 
+    phase.next(QStringLiteral("Effect repository"));
     m_gpuAllowed = EffectsRepository::get()->hasInternalEffect(QStringLiteral("glsl.manager"));
 
     m_shortcutRemoveFocus = new QShortcut(QKeySequence(QStringLiteral("Esc")), this);
@@ -256,11 +259,13 @@ void MainWindow::init()
     fr->setMaximumHeight(1);
     fr->setLineWidth(1);
     ctnLay->addWidget(fr);
+    phase.next(QStringLiteral("Actions"));
     setupActions();
     LayoutManagement *layoutManager = new LayoutManagement(this);
 
     QDockWidget *libraryDock = addDock(i18n("Library"), QStringLiteral("library"), pCore->library());
 
+    phase.next(QStringLiteral("Monitors"));
     m_clipMonitor = new Monitor(Kdenlive::ClipMonitor, pCore->monitorManager(), this);
     pCore->bin()->setMonitor(m_clipMonitor);
     connect(m_clipMonitor, &Monitor::addMarker, this, &MainWindow::slotAddMarkerGuideQuickly);
@@ -330,11 +335,19 @@ void MainWindow::init()
     });
     QDockWidget *screenGrabDock = addDock(i18n("Screen Grab"), QStringLiteral("screengrab"), grabWidget);
 
-    // Audio spectrum scope
-    m_audioSpectrum = new AudioGraphSpectrum(pCore->monitorManager());
-    QDockWidget *spectrumDock = addDock(i18n("Audio Spectrum"), QStringLiteral("audiospectrum"), m_audioSpectrum);
-    connect(spectrumDock, &QDockWidget::visibilityChanged, this, [&](bool visible) {
-        m_audioSpectrum->dockVisible(visible);
+    // Audio spectrum scope, only created when its dock is shown
+    m_audioSpectrum = nullptr;
+    QDockWidget *spectrumDock = addDock(i18n("Audio Spectrum"), QStringLiteral("audiospectrum"), new QWidget(this));
+    connect(spectrumDock, &QDockWidget::visibilityChanged, this, [&, spectrumDock](bool visible) {
+        if (visible && m_audioSpectrum == nullptr) {
+            QWidget *placeholder = spectrumDock->widget();
+            m_audioSpectrum = new AudioGraphSpectrum(pCore->monitorManager());
+            spectrumDock->setWidget(m_audioSpectrum);
+            delete placeholder;
+        }
+        if (m_audioSpectrum) {
+            m_audioSpectrum->dockVisible(visible);
+        }
     });
     // Close library and audiospectrum on first run
     screenGrabDock->close();
@@ -343,6 +356,7 @@ void MainWindow::init()
 
     m_projectBinDock = addDock(i18n("Project Bin"), QStringLiteral("project_bin"), pCore->bin());
 
+    phase.next(QStringLiteral("Asset panel and lists"));
     m_assetPanel = new AssetPanel(this);
     m_effectStackDock = addDock(i18n("Effect/Composition Stack"), QStringLiteral("effect_stack"), m_assetPanel);
     connect(m_assetPanel, &AssetPanel::doSplitEffect, m_projectMonitor, &Monitor::slotSwitchCompare);
@@ -450,6 +464,7 @@ void MainWindow::init()
     m_transitionsMenu = new QMenu(i18n("Add Transition"), this);
     m_transitionActions = new KActionCategory(i18n("Transitions"), actionCollection());
 
+    phase.next(QStringLiteral("Scopes"));
     auto *scmanager = new ScopeManager(this);
 
     HideTitleBars *titleBars = new HideTitleBars(this);
@@ -509,6 +524,7 @@ void MainWindow::init()
     previewButtonAction->setDefaultWidget(timelinePreview);
     addAction(QStringLiteral("timeline_preview_button"), previewButtonAction);
 
+    phase.next(QStringLiteral("Setup GUI"));
     setupGUI(KXmlGuiWindow::ToolBar | KXmlGuiWindow::StatusBar | KXmlGuiWindow::Save | KXmlGuiWindow::Create);
     LocaleHandling::resetLocale();
     if (firstRun) {
@@ -686,6 +702,10 @@ void MainWindow::init()
     connect(autoRender, &QAction::triggered, this, &MainWindow::slotToggleAutoPreview);
     tlMenu->addAction(autoRender);
     tlMenu->addSeparator();
+    tlMenu->addAction(actionCollection()->action(QStringLiteral("profile_render_cost")));
+    tlMenu->addAction(actionCollection()->action(QStringLiteral("show_render_cost")));
+    tlMenu->addAction(actionCollection()->action(QStringLiteral("render_cost_report")));
+    tlMenu->addSeparator();
     tlMenu->addAction(actionCollection()->action(QStringLiteral("disable_preview")));
     tlMenu->addAction(actionCollection()->action(QStringLiteral("manage_cache")));
     timelinePreview->defineDefaultAction(prevRender, stopPrevRender);
@@ -1489,6 +1509,11 @@ void MainWindow::setupActions()
               QIcon::fromTheme(QStringLiteral("preview-render-on")), QKeySequence(Qt::SHIFT + Qt::Key_Return));
     addAction(QStringLiteral("stop_prerender_timeline"), i18n("Stop Preview Render"), this, SLOT(slotStopPreviewRender()),
               QIcon::fromTheme(QStringLiteral("preview-render-off")));
+    addAction(QStringLiteral("profile_render_cost"), i18n("Measure Render Cost"), this, SLOT(slotProfileRenderCost()));
+    QAction *showCost = addAction(QStringLiteral("show_render_cost"), i18n("Show Approximate Render Cost"), this, SLOT(slotToggleRenderCost(bool)));
+    showCost->setCheckable(true);
+    showCost->setChecked(KdenliveSettings::showrendercost());
+    addAction(QStringLiteral("render_cost_report"), i18n("Render Cost Report"), this, SLOT(slotRenderCostReport()));
 
     addAction(QStringLiteral("select_timeline_clip"), i18n("Select Clip"), this, SLOT(slotSelectTimelineClip()),
               QIcon::fromTheme(QStringLiteral("edit-select")), Qt::Key_Plus);
@@ -2017,6 +2042,7 @@ void MainWindow::slotRenderProject()
         connect(m_renderWidget, &RenderWidget::shutdown, this, &MainWindow::slotShutdown);
         connect(m_renderWidget, &RenderWidget::selectedRenderProfile, this, &MainWindow::slotSetDocumentRenderProfile);
         connect(m_renderWidget, &RenderWidget::abortProcess, this, &MainWindow::abortRenderJob);
+        connect(m_renderWidget, &RenderWidget::pauseProcess, this, &MainWindow::pauseRenderJob);
         connect(m_renderWidget, &RenderWidget::openDvdWizard, this, &MainWindow::slotDvdWizard);
         connect(this, &MainWindow::updateRenderWidgetProfile, m_renderWidget, &RenderWidget::adjustViewToProfile);
         m_renderWidget->setGuides(project->getGuideModel());
@@ -2412,6 +2438,8 @@ void MainWindow::updateConfiguration()
     m_buttonVideoThumbs->setChecked(KdenliveSettings::videothumbnails());
     m_buttonShowMarkers->setChecked(KdenliveSettings::showmarkers());
     slotSwitchAutomaticTransition();
+    m_clipMonitor->updateFrameCacheSettings();
+    m_projectMonitor->updateFrameCacheSettings();
 
     // Update list of transcoding profiles
     buildDynamicActions();
@@ -2768,6 +2796,45 @@ void MainWindow::slotClearPreviewRender(bool resetZones)
     }
 }
 
+void MainWindow::slotProfileRenderCost()
+{
+    if (!pCore->currentDoc()) {
+        return;
+    }
+    // The preview zones are rendered to a temporary folder, existing previews are kept
+    if (!getCurrentTimeline()->controller()->profileRenderCost()) {
+        pCore->displayMessage(i18n("Add a preview zone to measure its render cost"), InformationMessage);
+        return;
+    }
+    actionCollection()->action(QStringLiteral("show_render_cost"))->setChecked(true);
+    slotToggleRenderCost(true);
+}
+
+void MainWindow::slotToggleRenderCost(bool show)
+{
+    KdenliveSettings::setShowrendercost(show);
+    if (getMainTimeline()) {
+        emit getMainTimeline()->controller()->renderCostsChanged();
+    }
+}
+
+void MainWindow::slotRenderCostReport()
+{
+    if (!pCore->currentDoc()) {
+        return;
+    }
+    const QStringList report = getCurrentTimeline()->controller()->renderCostReport();
+    if (report.isEmpty()) {
+        KMessageBox::sorry(this, i18n("No render cost measured yet. Add a preview zone and use Measure Render Cost."), i18n("Render Cost Report"));
+        return;
+    }
+    KMessageBox::informationList(this,
+                                 i18n("Approximate render time spent on each item, most expensive first. The time of each preview chunk is "
+                                      "shared between the items active in it, in proportion of their frames. Effect time is included in "
+                                      "the time of their clip."),
+                                 report, i18n("Render Cost Report"));
+}
+
 void MainWindow::slotSelectTimelineClip()
 {
     getCurrentTimeline()->controller()->selectCurrentItem(ObjectType::TimelineClip, true);
@@ -355,6 +355,10 @@ private slots:
     void slotDefinePreviewRender();
     void slotRemovePreviewRender();
     void slotClearPreviewRender(bool resetZones = true);
+    /** @brief Render the preview zones again to measure the render time of each chunk */
+    void slotProfileRenderCost();
+    void slotToggleRenderCost(bool show);
+    void slotRenderCostReport();
     void slotSelectTimelineClip();
     void slotSelectTimelineTransition();
     void slotDeselectTimelineClip();
@@ -508,6 +512,7 @@ private slots:
 
 signals:
     Q_SCRIPTABLE void abortRenderJob(const QString &url);
+    Q_SCRIPTABLE void pauseRenderJob(const QString &url, bool pause);
     void configurationChanged();
     void GUISetupDone();
     void setPreviewProgress(int);
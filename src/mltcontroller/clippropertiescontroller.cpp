@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "profiles/profilerepository.hpp"
 #include "project/projectmanager.h"
 #include "timecodedisplay.h"
+#include "utils/analysistrack.hpp"
 #include <audio/audioStreamInfo.h>
 #include "widgets/choosecolorwidget.h"
 
@@ -126,7 +127,7 @@ QMimeData *AnalysisTree::mimeData(const QList<QTreeWidgetItem *> list) const
     QString mimeData;
     for (QTreeWidgetItem *item : list) {
         if ((item->flags() & Qt::ItemIsDragEnabled) != 0) {
-            mimeData.append(item->text(1));
+            mimeData.append(AnalysisTrack::resolve(item->data(1, Qt::UserRole).toString()));
         }
     }
     auto *mime = new QMimeData;
@@ -1613,7 +1614,10 @@ void ClipPropertiesController::slotFillAnalysisData()
     subProperties.pass_values(*m_properties, "kdenlive:clipanalysis.");
     if (subProperties.count() > 0) {
         for (int i = 0; i < subProperties.count(); i++) {
-            new QTreeWidgetItem(m_analysisTree, QStringList() << subProperties.get_name(i) << subProperties.get(i));
+            // Large data is stored in sidecar files, only display a summary
+            const QString value = QString::fromUtf8(subProperties.get(i));
+            auto *item = new QTreeWidgetItem(m_analysisTree, QStringList() << subProperties.get_name(i) << AnalysisTrack::summary(value));
+            item->setData(1, Qt::UserRole, value);
         }
     }
     m_analysisTree->resizeColumnToContents(0);
@@ -1638,7 +1642,7 @@ void ClipPropertiesController::slotSaveAnalysis()
     KSharedConfigPtr config = KSharedConfig::openConfig(url, KConfig::SimpleConfig);
     KConfigGroup analysisConfig(config, "Analysis");
     QTreeWidgetItem *current = m_analysisTree->currentItem();
-    analysisConfig.writeEntry(current->text(0), current->text(1));
+    analysisConfig.writeEntry(current->text(0), AnalysisTrack::resolve(current->data(1, Qt::UserRole).toString()));
 }
 
 void ClipPropertiesController::slotLoadAnalysis()
@@ -1655,7 +1659,7 @@ void ClipPropertiesController::slotLoadAnalysis()
     QMapIterator<QString, QString> i(profiles);
     while (i.hasNext()) {
         i.next();
-        emit editAnalysis(m_id, "kdenlive:clipanalysis." + i.key(), i.value());
+        emit editAnalysis(m_id, "kdenlive:clipanalysis." + i.key(), AnalysisTrack::storeValue(i.value()));
     }
 }
 
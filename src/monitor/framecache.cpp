@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "framecache.h"
+
+FrameCache::FrameCache()
+{
+    m_frames.setMaxCost(0);
+}
+
+void FrameCache::setMaxSize(int megabytes)
+{
+    QMutexLocker lock(&m_mutex);
+    // Cost is counted in kilobytes to stay in int range
+    m_frames.setMaxCost(qMax(0, megabytes) * 1024);
+}
+
+bool FrameCache::isEnabled() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_frames.maxCost() > 0;
+}
+
+void FrameCache::insert(const SharedFrame &frame)
+{
+    if (!frame.is_valid()) {
+        return;
+    }
+    int size = mlt_image_format_size(frame.get_image_format(), frame.get_image_width(), frame.get_image_height(), nullptr);
+    QMutexLocker lock(&m_mutex);
+    if (m_frames.maxCost() == 0) {
+        return;
+    }
+    m_frames.insert(frame.get_position(), new SharedFrame(frame), qMax(1, size / 1024));
+}
+
+bool FrameCache::contains(int position) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_frames.contains(position);
+}
+
+SharedFrame FrameCache::get(int position)
+{
+    QMutexLocker lock(&m_mutex);
+    SharedFrame *frame = m_frames.object(position);
+    if (frame == nullptr) {
+        m_misses++;
+        return SharedFrame();
+    }
+    m_hits++;
+    return *frame;
+}
+
+void FrameCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_frames.clear();
+}
+
+int FrameCache::hitRate() const
+{
+    QMutexLocker lock(&m_mutex);
+    int total = m_hits + m_misses;
+    return total == 0 ? 0 : 100 * m_hits / total;
+}
+
+void FrameCache::resetStats()
+{
+    QMutexLocker lock(&m_mutex);
+    m_hits = 0;
+    m_misses = 0;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "scopes/sharedframe.h"
+
+#include <QCache>
+#include <QMutex>
+
+/**
+ * @class FrameCache
+ * @brief Memory bounded cache of decoded monitor frames, indexed by position.
+ *
+ * Frames are stored as SharedFrame, so caching a displayed frame does not copy
+ * its image. Least recently used frames are dropped when the cache exceeds its
+ * size. The cache must be cleared whenever the content displayed by the monitor
+ * changes (producer change, effect change, preview scaling, ...).
+ * This class is thread safe.
+ */
+class FrameCache
+{
+public:
+    FrameCache();
+
+    /** @brief Set the maximum memory used by the cache, 0 disables it */
+    void setMaxSize(int megabytes);
+    bool isEnabled() const;
+    /** @brief Store a frame, it must have a rendered image */
+    void insert(const SharedFrame &frame);
+    /** @brief Returns true if a frame is cached for this position, without updating the statistics */
+    bool contains(int position) const;
+    /** @brief Returns the frame cached at position, or an invalid frame. Updates hit/miss statistics */
+    SharedFrame get(int position);
+    void clear();
+
+    /** @brief Percentage of cache lookups that were served from the cache */
+    int hitRate() const;
+    void resetStats();
+
+private:
+    mutable QMutex m_mutex;
+    QCache<int, SharedFrame> m_frames;
+    int m_hits{0};
+    int m_misses{0};
+};
+
+#endif
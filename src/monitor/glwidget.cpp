@@ -23,11 +23,13 @@
 #include <KDeclarative/KDeclarative>
 #include <KMessageBox>
 #include <QApplication>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions_3_2_Core>
 #include <QPainter>
 #include <QQmlContext>
 #include <QQuickItem>
 #include <QFontDatabase>
+#include <QtConcurrent>
 #include <kdeclarative_version.h>
 #include <klocalizedstring.h>
 
@@ -61,6 +63,11 @@
 
 using namespace Mlt;
 
+namespace {
+// Milliseconds without invalidation before the read-ahead copy of the producer is rebuilt
+const int prefetchRebuildDelay = 1000;
+} // namespace
+
 GLWidget::GLWidget(int id, QObject *parent)
     : QQuickView((QWindow *)parent)
     , sendFrameForAnalysis(false)
@@ -71,6 +78,8 @@ GLWidget::GLWidget(int id, QObject *parent)
     , m_rulerHeight(QFontInfo(QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont)).pixelSize() * 1.5)
     , m_bgColor(KdenliveSettings::window_background())
     , m_shader(nullptr)
+    , m_uploadFence(nullptr)
+    , m_pboTextures(false)
     , m_initSem(0)
     , m_analyseSem(1)
     , m_isInitialized(false)
@@ -79,6 +88,7 @@ GLWidget::GLWidget(int id, QObject *parent)
     , m_threadCreateEvent(nullptr)
     , m_threadJoinEvent(nullptr)
     , m_displayEvent(nullptr)
+    , m_renderEvent(nullptr)
     , m_frameRenderer(nullptr)
     , m_projectionLocation(0)
     , m_modelViewLocation(0)
@@ -98,6 +108,9 @@ GLWidget::GLWidget(int id, QObject *parent)
     , m_shareContext(nullptr)
     , m_openGLSync(false)
     , m_ClientWaitSync(nullptr)
+    , m_abortPrefetch(false)
+    , m_lastSeekPosition(-1)
+    , m_prefetchDirection(0)
 {
     KDeclarative::KDeclarative kdeclarative;
     kdeclarative.setDeclarativeEngine(engine());
@@ -125,6 +138,8 @@ GLWidget::GLWidget(int id, QObject *parent)
 
     m_refreshTimer.setSingleShot(true);
     m_refreshTimer.setInterval(50);
+    updateFrameCacheSettings();
+    m_telemetry.setEnabled(KdenliveSettings::monitor_telemetry());
     m_blackClip.reset(new Mlt::Producer(pCore->getCurrentProfile()->profile(), "color:0"));
     m_blackClip->set("kdenlive:id", "black");
     m_blackClip->set("out", 3);
@@ -146,6 +161,7 @@ GLWidget::GLWidget(int id, QObject *parent)
 
 GLWidget::~GLWidget()
 {
+    stopPrefetch();
     // C & D
     delete m_glslManager;
     delete m_threadStartEvent;
@@ -153,6 +169,7 @@ GLWidget::~GLWidget()
     delete m_threadCreateEvent;
     delete m_threadJoinEvent;
     delete m_displayEvent;
+    delete m_renderEvent;
     if (m_frameRenderer) {
         if (m_frameRenderer->isRunning()) {
             QMetaObject::invokeMethod(m_frameRenderer, "cleanup");
@@ -163,6 +180,17 @@ GLWidget::~GLWidget()
             delete m_frameRenderer;
         }
     }
+    if ((m_uploadFence != nullptr || !m_staleFences.isEmpty()) && openglContext() && openglContext()->makeCurrent(&m_offscreenSurface)) {
+        // Upload fences handed over by the renderer for frames that were not displayed
+        QOpenGLExtraFunctions *ef = openglContext()->extraFunctions();
+        m_staleFences << m_uploadFence;
+        for (GLsync fence : qAsConst(m_staleFences)) {
+            if (fence != nullptr) {
+                ef->glDeleteSync(fence);
+            }
+        }
+        openglContext()->doneCurrent();
+    }
     m_blackClip.reset();
     delete m_shareContext;
     delete m_shader;
@@ -214,6 +242,7 @@ void GLWidget::initializeGL()
     m_frameRenderer = new FrameRenderer(openglContext(), &m_offscreenSurface, m_ClientWaitSync);
 
     m_frameRenderer->sendAudioForAnalysis = KdenliveSettings::monitor_audio();
+    m_frameRenderer->setTelemetry(&m_telemetry);
 
     openglContext()->makeCurrent(this);
     connect(m_frameRenderer, &FrameRenderer::textureReady, this, &GLWidget::updateTexture, Qt::DirectConnection);
@@ -430,6 +459,21 @@ bool GLWidget::acquireSharedFrameTextures()
         return false;
     }
 
+    // B with pixel buffer objects: make the GPU wait for the upload instead of blocking the renderer with glFinish
+    QMutexLocker lk(&m_fenceMutex);
+    if (m_uploadFence != nullptr || !m_staleFences.isEmpty()) {
+        QOpenGLExtraFunctions *ef = openglContext()->extraFunctions();
+        for (GLsync stale : qAsConst(m_staleFences)) {
+            ef->glDeleteSync(stale);
+        }
+        m_staleFences.clear();
+        if (m_uploadFence != nullptr) {
+            // Deleting the fence is deferred by GL until the wait is done
+            ef->glWaitSync(m_uploadFence, 0, GL_TIMEOUT_IGNORED);
+            ef->glDeleteSync(m_uploadFence);
+            m_uploadFence = nullptr;
+        }
+    }
     return true;
 }
 
@@ -512,6 +556,7 @@ bool GLWidget::initGPUAccelSync()
 
 void GLWidget::paintGL()
 {
+    qint64 paintStart = m_telemetry.isEnabled() ? PlaybackTelemetry::now() : 0;
     QOpenGLFunctions *f = openglContext()->functions();
     float width = this->width() * devicePixelRatio();
     float height = this->height() * devicePixelRatio();
@@ -620,6 +665,18 @@ void GLWidget::paintGL()
 
     releaseSharedFrameTextures();
     check_error(f);
+    if (m_pboTextures && m_frameRenderer) {
+        // The renderer waits for this draw before uploading another frame to the same textures
+        QOpenGLExtraFunctions *ef = openglContext()->extraFunctions();
+        GLsync fence = ef->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ef->glFlush();
+        if (!m_frameRenderer->setDisplayFence(m_texture[0], fence)) {
+            ef->glDeleteSync(fence);
+        }
+    }
+    if (paintStart > 0) {
+        m_telemetry.recordPresent(PlaybackTelemetry::now() - paintStart);
+    }
 }
 
 void GLWidget::slotZoom(bool zoomIn)
@@ -651,6 +708,18 @@ void GLWidget::updateRulerHeight(int addedHeight)
 
 void GLWidget::requestSeek(int position)
 {
+    stopPrefetch();
+    if (m_frameCache.isEnabled() && qFuzzyIsNull(m_producer->get_speed())) {
+        int direction = (m_lastSeekPosition >= 0 && position < m_lastSeekPosition) ? -1 : 1;
+        m_lastSeekPosition = position;
+        if (showCachedFrame(position)) {
+            // The cached image is displayed at once, the consumer still renders the frame for audio scrubbing
+            startPrefetch(position, direction);
+        } else {
+            // Read ahead once the consumer displayed the requested frame
+            m_prefetchDirection = direction;
+        }
+    }
     m_consumer->set("scrub_audio", 1);
     m_producer->seek(position);
     if (!qFuzzyIsNull(m_producer->get_speed())) {
@@ -662,6 +731,8 @@ void GLWidget::requestSeek(int position)
 
 void GLWidget::requestRefresh()
 {
+    // Displayed content changed, cached frames are outdated
+    invalidateFrameCache();
     if (m_producer && qFuzzyIsNull(m_producer->get_speed())) {
         m_consumer->set("scrub_audio", 0);
         m_refreshTimer.start();
@@ -676,6 +747,7 @@ QString GLWidget::frameToTime(int frames) const
 void GLWidget::refresh()
 {
     m_refreshTimer.stop();
+    invalidateFrameCache();
     QMutexLocker locker(&m_mltMutex);
     restartConsumer();
     m_consumer->set("refresh", 1);
@@ -875,6 +947,7 @@ static void onThreadStopped(mlt_properties owner, GLWidget *self)
 
 int GLWidget::setProducer(const QString &file)
 {
+    invalidateFrameCache();
     if (m_producer) {
         m_producer.reset();
     }
@@ -905,6 +978,7 @@ int GLWidget::setProducer(const std::shared_ptr<Mlt::Producer> &producer, bool i
         consumerPosition = m_consumer->position();
     }
     stop();
+    invalidateFrameCache();
     if (producer) {
         m_producer = producer;
     } else {
@@ -1061,6 +1135,8 @@ int GLWidget::reconfigureMulti(const QString &params, const QString &path, Mlt::
 int GLWidget::reconfigure()
 {
     int error = 0;
+    invalidateFrameCache();
+    m_lastSeekPosition = -1;
     // use SDL for audio, OpenGL for video
     QString serviceName = property("mlt_service").toString();
     if ((m_consumer == nullptr) || !m_consumer->is_valid() || strcmp(m_consumer->get("mlt_service"), "multi") == 0) {
@@ -1157,12 +1233,15 @@ int GLWidget::reconfigure()
         }
 
         delete m_displayEvent;
+        delete m_renderEvent;
+        m_renderEvent = nullptr;
         // C & D
         if (m_glslManager) {
             m_displayEvent = m_consumer->listen("consumer-frame-show", this, (mlt_listener)on_gl_frame_show);
         } else {
             // A & B
             m_displayEvent = m_consumer->listen("consumer-frame-show", this, (mlt_listener)on_frame_show);
+            m_renderEvent = m_consumer->listen("consumer-frame-render", this, (mlt_listener)on_frame_render);
         }
 
         int volume = KdenliveSettings::volume();
@@ -1271,6 +1350,126 @@ void GLWidget::onFrameDisplayed(const SharedFrame &frame)
     m_sendFrame = sendFrameForAnalysis;
     m_contextSharedAccess.unlock();
     update();
+    if (m_glslManager == nullptr && m_frameCache.isEnabled()) {
+        // GPU pipelines only have a texture, we can only cache YUV frames
+        m_frameCache.insert(frame);
+        if (m_prefetchDirection != 0 && m_producer && qFuzzyIsNull(m_producer->get_speed())) {
+            startPrefetch(frame.get_position(), m_prefetchDirection);
+        }
+    }
+    m_prefetchDirection = 0;
+}
+
+bool GLWidget::showCachedFrame(int position)
+{
+    if (m_frameRenderer == nullptr || !m_frameCache.contains(position) || !m_frameRenderer->semaphore()->tryAcquire(1, 0)) {
+        m_frameCache.get(position);
+        return false;
+    }
+    SharedFrame frame = m_frameCache.get(position);
+    if (!frame.is_valid()) {
+        m_frameRenderer->semaphore()->release();
+        return false;
+    }
+    QMetaObject::invokeMethod(m_frameRenderer, "showSharedFrame", Qt::QueuedConnection, Q_ARG(SharedFrame, frame));
+    return true;
+}
+
+void GLWidget::startPrefetch(int position, int direction)
+{
+    stopPrefetch();
+    if (KdenliveSettings::monitor_prefetch() <= 0 || !m_consumer || !m_producer || m_isZoneMode || m_isLoopMode) {
+        return;
+    }
+    if (!m_prefetchProducer && m_prefetchXml.isEmpty()) {
+        // Copying the producer serializes it and opens all its clips again, wait until edits pause before rebuilding it
+        if (m_prefetchInvalidated.isValid() && m_prefetchInvalidated.elapsed() < prefetchRebuildDelay) {
+            return;
+        }
+        // Serialize the producer once, the read-ahead thread builds its own copy from it
+        QMutexLocker locker(&m_mltMutex);
+        m_prefetchXml = sceneList(QString());
+        if (m_prefetchXml.isEmpty()) {
+            return;
+        }
+    }
+    m_abortPrefetch = false;
+    m_prefetchFuture = QtConcurrent::run(this, &GLWidget::prefetchFrames, position, direction, m_consumer->get_int("width"),
+                                         m_consumer->get_int("height"), QByteArray(m_consumer->get("rescale")),
+                                         QByteArray(m_consumer->get("deinterlace_method")));
+}
+
+void GLWidget::prefetchFrames(int position, int direction, int width, int height, const QByteArray &interp, const QByteArray &deinterlacer)
+{
+    if (!m_prefetchProducer) {
+        m_prefetchProducer.reset(new Mlt::Producer(pCore->getCurrentProfile()->profile(), "xml-string", m_prefetchXml.toUtf8().constData()));
+        m_prefetchXml.clear();
+    }
+    if (!m_prefetchProducer->is_valid()) {
+        return;
+    }
+    int max = m_prefetchProducer->get_playtime() - 1;
+    int count = KdenliveSettings::monitor_prefetch();
+    for (int i = 1; i <= count && !m_abortPrefetch; i++) {
+        int pos = position + i * direction;
+        if (pos < 0 || pos > max) {
+            break;
+        }
+        if (m_frameCache.contains(pos)) {
+            continue;
+        }
+        m_prefetchProducer->seek(pos);
+        std::unique_ptr<Mlt::Frame> frame(m_prefetchProducer->get_frame());
+        if (!frame || !frame->is_valid()) {
+            break;
+        }
+        frame->set("rescale.interp", interp.constData());
+        frame->set("deinterlace_method", deinterlacer.constData());
+        mlt_image_format format = mlt_image_yuv422;
+        int w = width;
+        int h = height;
+        frame->get_image(format, w, h);
+        frame->set("rendered", 1);
+        m_frameCache.insert(SharedFrame(*frame));
+    }
+}
+
+void GLWidget::stopPrefetch()
+{
+    if (m_prefetchFuture.isRunning()) {
+        m_abortPrefetch = true;
+        m_prefetchFuture.waitForFinished();
+    }
+}
+
+int GLWidget::frameCacheHitRate() const
+{
+    return m_frameCache.hitRate();
+}
+
+void GLWidget::resetFrameCacheStats()
+{
+    m_frameCache.resetStats();
+}
+
+void GLWidget::updateFrameCacheSettings()
+{
+    stopPrefetch();
+    m_frameCache.setMaxSize(KdenliveSettings::monitor_cachesize());
+}
+
+void GLWidget::invalidateFrameCache()
+{
+    stopPrefetch();
+    m_frameCache.clear();
+    m_prefetchProducer.reset();
+    m_prefetchXml.clear();
+    m_prefetchInvalidated.start();
+}
+
+PlaybackTelemetry *GLWidget::telemetry()
+{
+    return &m_telemetry;
 }
 
 void GLWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -1291,6 +1490,7 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event)
 
 void GLWidget::purgeCache()
 {
+    stopPrefetch();
     if (m_consumer) {
         //m_consumer->set("buffer", 1);
         m_consumer->purge();
@@ -1373,21 +1573,43 @@ const QString GLWidget::sceneList(const QString &root, const QString &fullPath)
     return playlist;
 }
 
-void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName)
+void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName, GLsync uploadFence)
 {
+    QMutexLocker lk(&m_fenceMutex);
+    if (m_uploadFence != nullptr) {
+        // The previous frame was not displayed, its fence needs a current context to be deleted
+        m_staleFences << m_uploadFence;
+    }
+    m_uploadFence = uploadFence;
+    m_pboTextures = uploadFence != nullptr;
     m_texture[0] = yName;
     m_texture[1] = uName;
     m_texture[2] = vName;
 }
 
+void GLWidget::on_frame_render(mlt_consumer, void *self, mlt_frame frame_ptr)
+{
+    auto *widget = static_cast<GLWidget *>(self);
+    if (widget->m_telemetry.isEnabled()) {
+        // Fired by the consumer thread before the frame image is requested
+        Mlt::Frame frame(frame_ptr);
+        frame.set("kdenlive:render_start", int64_t(PlaybackTelemetry::now()));
+    }
+}
+
 void GLWidget::on_frame_show(mlt_consumer, void *self, mlt_frame frame_ptr)
 {
     Mlt::Frame frame(frame_ptr);
     if (frame.get_int("rendered") != 0) {
         auto *widget = static_cast<GLWidget *>(self);
         int timeout = (widget->consumer()->get_int("real_time") > 0) ? 0 : 1000;
+        if (widget->m_telemetry.isEnabled()) {
+            frame.set("kdenlive:show_time", int64_t(PlaybackTelemetry::now()));
+        }
         if ((widget->m_frameRenderer != nullptr) && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+        } else {
+            widget->m_telemetry.recordDisplayBusy(frame.get_position(), frame.get_double("_speed"));
         }
     }
 }
@@ -1459,12 +1681,23 @@ FrameRenderer::FrameRenderer(QOpenGLContext *shareContext, QSurface *surface, GL
     , m_context(nullptr)
     , m_surface(surface)
     , m_ClientWaitSync(clientWaitSync)
+    , m_pboSupport(-1)
+    , m_pboIndex(0)
+    , m_lastUploadTime(0)
+    , m_uploadTimeTotal(0)
+    , m_uploadCount(0)
+    , m_telemetry(nullptr)
     , m_gl32(nullptr)
     , sendAudioForAnalysis(false)
 {
     Q_ASSERT(shareContext);
     m_renderTexture[0] = m_renderTexture[1] = m_renderTexture[2] = 0;
     m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
+    for (int i = 0; i < 3; ++i) {
+        m_pbo[i] = 0;
+        m_displayFence[i] = nullptr;
+        m_pboTexture[i][0] = m_pboTexture[i][1] = m_pboTexture[i][2] = 0;
+    }
     // B & C & D
     if (KdenliveSettings::gpu_accel() || shareContext->supportsThreadedOpenGL()) {
         m_context = new QOpenGLContext;
@@ -1488,21 +1721,51 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
 {
     // Save this frame for future use and to keep a reference to the GL Texture.
     m_displayFrame = SharedFrame(frame);
+    displaySharedFrame();
+}
 
+void FrameRenderer::showSharedFrame(const SharedFrame &frame)
+{
+    m_displayFrame = frame;
+    displaySharedFrame();
+}
+
+void FrameRenderer::displaySharedFrame()
+{
     if ((m_context != nullptr) && m_context->isValid()) {
+        QElapsedTimer uploadTimer;
+        uploadTimer.start();
         m_context->makeCurrent(m_surface);
-        // Upload each plane of YUV to a texture.
-        QOpenGLFunctions *f = m_context->functions();
-        uploadTextures(m_context, m_displayFrame, m_renderTexture);
-        f->glBindTexture(GL_TEXTURE_2D, 0);
-        check_error(f);
-        f->glFinish();
+        if (m_pboSupport == -1) {
+            m_pboSupport = checkPboSupport() ? 1 : 0;
+            qDebug() << "// Monitor texture upload using pixel buffer objects: " << m_pboSupport;
+        }
+        if (m_pboSupport == 0 || !uploadWithPbo()) {
+            // Upload each plane of YUV to a texture.
+            QOpenGLFunctions *f = m_context->functions();
+            uploadTextures(m_context, m_displayFrame, m_renderTexture);
+            f->glBindTexture(GL_TEXTURE_2D, 0);
+            check_error(f);
+            f->glFinish();
 
-        for (int i = 0; i < 3; ++i) {
-            std::swap(m_renderTexture[i], m_displayTexture[i]);
+            for (int i = 0; i < 3; ++i) {
+                std::swap(m_renderTexture[i], m_displayTexture[i]);
+            }
+            emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
         }
-        emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
         m_context->doneCurrent();
+        m_lastUploadTime = uploadTimer.nsecsElapsed() / 1000;
+        m_uploadTimeTotal += m_lastUploadTime;
+        m_uploadCount++;
+        if (m_telemetry && m_telemetry->isEnabled()) {
+            // Frames from the monitor cache were not rendered by the consumer and have no timestamps
+            qint64 renderStart = m_displayFrame.get_int64("kdenlive:render_start");
+            qint64 showTime = m_displayFrame.get_int64("kdenlive:show_time");
+            qint64 uploadStart = PlaybackTelemetry::now() - m_lastUploadTime;
+            m_telemetry->recordFrame(m_displayFrame.get_position(), m_displayFrame.get_double("_speed"),
+                                     renderStart > 0 && showTime > 0 ? showTime - renderStart : 0, showTime > 0 ? uploadStart - showTime : 0,
+                                     m_lastUploadTime);
+        }
     }
     // The frame is now done being modified and can be shared with the rest
     // of the application.
@@ -1547,8 +1810,174 @@ void FrameRenderer::showGLNoSyncFrame(Mlt::Frame frame)
     m_semaphore.release();
 }
 
+bool FrameRenderer::checkPboSupport() const
+{
+    const QSurfaceFormat format = m_context->format();
+    if (format.majorVersion() >= 3) {
+        // Core in GL 3.0 and GLES 3.0, this includes Mesa's llvmpipe
+        return true;
+    }
+    return !m_context->isOpenGLES() && m_context->hasExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object")) &&
+           m_context->hasExtension(QByteArrayLiteral("GL_ARB_map_buffer_range")) && m_context->hasExtension(QByteArrayLiteral("GL_ARB_sync"));
+}
+
+bool FrameRenderer::uploadWithPbo()
+{
+    QOpenGLExtraFunctions *f = m_context->extraFunctions();
+    int width = m_displayFrame.get_image_width();
+    int height = m_displayFrame.get_image_height();
+    const uint8_t *image = m_displayFrame.get_image(mlt_image_yuv420p);
+    if (image == nullptr || width <= 0 || height <= 0) {
+        return false;
+    }
+    const int planeSize[3] = {width * height, width / 2 * height / 2, width / 2 * height / 2};
+    const int planeOffset[3] = {0, planeSize[0], planeSize[0] + planeSize[1]};
+    const int size = planeSize[0] + planeSize[1] + planeSize[2];
+    if (m_pbo[0] == 0) {
+        f->glGenBuffers(3, m_pbo);
+    }
+    // Fences are only waited on and deleted out of the lock, the widget takes it while painting
+    QVector<GLsync> released;
+    GLsync displayFence = nullptr;
+    QMutexLocker lk(&m_fenceMutex);
+    if (m_pboTextureSize != QSize(width, height)) {
+        // (Re)allocate texture storage for the 3 texture sets, we then only update their content
+        for (int i = 0; i < 3; ++i) {
+            if (m_displayFence[i] != nullptr) {
+                released << m_displayFence[i];
+                m_displayFence[i] = nullptr;
+            }
+            if (m_pboTexture[i][0] != 0u) {
+                f->glDeleteTextures(3, m_pboTexture[i]);
+            }
+            f->glGenTextures(3, m_pboTexture[i]);
+            for (int plane = 0; plane < 3; ++plane) {
+                int w = plane == 0 ? width : width / 2;
+                int h = plane == 0 ? height : height / 2;
+                f->glBindTexture(GL_TEXTURE_2D, m_pboTexture[i][plane]);
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                f->glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        check_error(f);
+        m_pboTextureSize = QSize(width, height);
+    }
+    // Triple buffering: the set we write to was displayed 2 frames ago, so its display fence should already be signaled
+    m_pboIndex = (m_pboIndex + 1) % 3;
+    const int ix = m_pboIndex;
+    std::swap(displayFence, m_displayFence[ix]);
+    released << m_releasedFences;
+    m_releasedFences.clear();
+    lk.unlock();
+    for (GLsync fence : qAsConst(released)) {
+        f->glDeleteSync(fence);
+    }
+    if (displayFence != nullptr) {
+        f->glClientWaitSync(displayFence, 0, 100000000);
+        f->glDeleteSync(displayFence);
+    }
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[ix]);
+    // Orphan the previous storage so that mapping never waits for the GPU
+    f->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void *data = f->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (data == nullptr) {
+        f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        qWarning() << "// Cannot map pixel buffer object, falling back to synchronous upload";
+        releasePboUpload();
+        m_pboSupport = 0;
+        return false;
+    }
+    memcpy(data, image, (size_t)size);
+    f->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    f->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int plane = 0; plane < 3; ++plane) {
+        f->glBindTexture(GL_TEXTURE_2D, m_pboTexture[ix][plane]);
+        f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane == 0 ? width : width / 2, plane == 0 ? height : height / 2, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+                           reinterpret_cast<const void *>(static_cast<intptr_t>(planeOffset[plane])));
+    }
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    check_error(f);
+    GLsync uploadFence = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Submit the upload without waiting for it, the display waits on the fence and deletes it
+    f->glFlush();
+    emit textureReady(m_pboTexture[ix][0], m_pboTexture[ix][1], m_pboTexture[ix][2], uploadFence);
+    return true;
+}
+
+bool FrameRenderer::setDisplayFence(GLuint yName, GLsync fence)
+{
+    QMutexLocker lk(&m_fenceMutex);
+    for (int i = 0; i < 3; ++i) {
+        if (yName != 0u && m_pboTexture[i][0] == yName) {
+            if (m_displayFence[i] != nullptr) {
+                // The set was drawn again, waiting on the last draw is enough
+                m_releasedFences << m_displayFence[i];
+            }
+            m_displayFence[i] = fence;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameRenderer::releasePboUpload()
+{
+    QOpenGLExtraFunctions *f = m_context->extraFunctions();
+    QMutexLocker lk(&m_fenceMutex);
+    for (GLsync fence : qAsConst(m_releasedFences)) {
+        f->glDeleteSync(fence);
+    }
+    m_releasedFences.clear();
+    for (int i = 0; i < 3; ++i) {
+        if (m_displayFence[i] != nullptr) {
+            f->glDeleteSync(m_displayFence[i]);
+            m_displayFence[i] = nullptr;
+        }
+        if (m_pboTexture[i][0] != 0u) {
+            f->glDeleteTextures(3, m_pboTexture[i]);
+            m_pboTexture[i][0] = m_pboTexture[i][1] = m_pboTexture[i][2] = 0;
+        }
+    }
+    if (m_pbo[0] != 0u) {
+        f->glDeleteBuffers(3, m_pbo);
+        m_pbo[0] = m_pbo[1] = m_pbo[2] = 0;
+    }
+    m_pboTextureSize = QSize();
+}
+
+qint64 FrameRenderer::lastUploadTime() const
+{
+    return m_lastUploadTime;
+}
+
+qint64 FrameRenderer::averageUploadTime() const
+{
+    int count = m_uploadCount;
+    return count == 0 ? 0 : m_uploadTimeTotal / count;
+}
+
+void FrameRenderer::resetUploadTime()
+{
+    m_uploadTimeTotal = 0;
+    m_uploadCount = 0;
+}
+
+void FrameRenderer::setTelemetry(PlaybackTelemetry *telemetry)
+{
+    m_telemetry = telemetry;
+}
+
 void FrameRenderer::cleanup()
 {
+    if (m_context && (m_pbo[0] != 0u || m_pboTexture[0][0] != 0u)) {
+        m_context->makeCurrent(m_surface);
+        releasePboUpload();
+        m_context->doneCurrent();
+    }
     if ((m_renderTexture[0] != 0u) && (m_renderTexture[1] != 0u) && (m_renderTexture[2] != 0u)) {
         m_context->makeCurrent(m_surface);
         m_context->functions()->glDeleteTextures(3, m_renderTexture);
@@ -1604,6 +2033,7 @@ void GLWidget::switchPlay(bool play, double speed)
     if (!m_producer || !m_consumer) {
         return;
     }
+    stopPrefetch();
     if (m_isZoneMode || m_isLoopMode) {
         resetZoneMode();
     }
@@ -1634,6 +2064,7 @@ bool GLWidget::playZone(bool loop)
         pCore->displayMessage(i18n("Select a zone to play"), InformationMessage, 500);
         return false;
     }
+    stopPrefetch();
     m_producer->seek(m_proxy->zoneIn());
     m_producer->set_speed(0);
     m_consumer->purge();
@@ -1670,6 +2101,7 @@ bool GLWidget::loopClip(QPoint inOut)
         pCore->displayMessage(i18n("Select a clip to play"), InformationMessage, 500);
         return false;
     }
+    stopPrefetch();
     m_loopIn = inOut.x();
     m_producer->seek(inOut.x());
     m_producer->set_speed(0);
@@ -1728,6 +2160,8 @@ void GLWidget::startConsumer()
             delete m_displayEvent;
         }
         m_displayEvent = nullptr;
+        delete m_renderEvent;
+        m_renderEvent = nullptr;
         m_consumer.reset();
         return;
     }
@@ -1737,6 +2171,7 @@ void GLWidget::startConsumer()
 void GLWidget::stop()
 {
     m_refreshTimer.stop();
+    stopPrefetch();
     // why this lock?
     QMutexLocker locker(&m_mltMutex);
     if (m_producer) {
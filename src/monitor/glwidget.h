@@ -20,6 +20,8 @@
 #define GLWIDGET_H
 
 #include <QFont>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <QMutex>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
@@ -34,10 +36,13 @@
 
 #include "bin/model/markerlistmodel.hpp"
 #include "definitions.h"
+#include "framecache.h"
+#include "playbacktelemetry.h"
 #include "kdenlivesettings.h"
 #include "scopes/sharedframe.h"
 
 #include <mlt++/MltProfile.h>
+#include <atomic>
 
 class QOpenGLFunctions_3_2_Core;
 
@@ -142,6 +147,15 @@ public:
     void purgeCache();
     /** @brief Show / hide monitor ruler */
     void switchRuler(bool show);
+    /** @brief Percentage of paused seeks served from the decoded frame cache */
+    int frameCacheHitRate() const;
+    void resetFrameCacheStats();
+    /** @brief Apply the frame cache size and read-ahead settings */
+    void updateFrameCacheSettings();
+    /** @brief The displayed content changed, drop the cached frames and the read-ahead producer */
+    void invalidateFrameCache();
+    /** @brief Per frame playback timings, only recorded when enabled */
+    PlaybackTelemetry *telemetry();
 
 protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
@@ -207,6 +221,15 @@ private:
     QOpenGLShaderProgram *m_shader;
     QPoint m_panStart;
     QPoint m_dragStart;
+    /** @brief Fence signaled when the textures in m_texture are uploaded, if the renderer uses pixel buffer objects.
+        The renderer hands it over with the textures, it is waited on and deleted here */
+    GLsync m_uploadFence;
+    /** @brief Upload fences of frames replaced before they were displayed, deleted on next paint */
+    QVector<GLsync> m_staleFences;
+    /** @brief True if m_texture is a pixel buffer object texture set, the renderer then needs a fence after each draw */
+    bool m_pboTextures;
+    /** @brief Protects the upload fences, set from the renderer thread */
+    QMutex m_fenceMutex;
     QSemaphore m_initSem;
     QSemaphore m_analyseSem;
     bool m_isInitialized;
@@ -235,8 +258,29 @@ private:
     QPoint m_offset;
     MonitorProxy *m_proxy;
     std::shared_ptr<Mlt::Producer> m_blackClip;
+    /** @brief Decoded frames, used when seeking while paused */
+    FrameCache m_frameCache;
+    PlaybackTelemetry m_telemetry;
+    QFuture<void> m_prefetchFuture;
+    std::atomic_bool m_abortPrefetch;
+    /** @brief Copy of the displayed producer, so that read-ahead never touches the producer used by the consumer */
+    QString m_prefetchXml;
+    std::unique_ptr<Mlt::Producer> m_prefetchProducer;
+    /** @brief Started when the cache is invalidated, the copy is only rebuilt once edits pause */
+    QElapsedTimer m_prefetchInvalidated;
+    /** @brief Last position requested while paused, used to find the read-ahead direction */
+    int m_lastSeekPosition;
+    /** @brief Read-ahead direction requested for the next displayed frame, 0 if none */
+    int m_prefetchDirection;
+    /** @brief Display a frame from the cache. Returns false if the frame is not cached */
+    bool showCachedFrame(int position);
+    /** @brief Decode a few frames following position in the seek direction, in a separate thread */
+    void startPrefetch(int position, int direction);
+    void prefetchFrames(int position, int direction, int width, int height, const QByteArray &interp, const QByteArray &deinterlacer);
+    /** @brief Abort and wait for the read-ahead thread, must be called before using the producer */
+    void stopPrefetch();
     static void on_frame_show(mlt_consumer, void *self, mlt_frame frame);
-    static void on_frame_render(mlt_consumer, GLWidget *widget, mlt_frame frame);
+    static void on_frame_render(mlt_consumer, void *self, mlt_frame frame);
     static void on_gl_frame_show(mlt_consumer, void *self, mlt_frame frame_ptr);
     static void on_gl_nosync_frame_show(mlt_consumer, void *self, mlt_frame frame_ptr);
     QOpenGLFramebufferObject *m_fbo;
@@ -249,7 +293,7 @@ private:
      */
 private slots:
     void resizeGL(int width, int height);
-    void updateTexture(GLuint yName, GLuint uName, GLuint vName);
+    void updateTexture(GLuint yName, GLuint uName, GLuint vName, GLsync uploadFence);
     void paintGL();
     void onFrameDisplayed(const SharedFrame &frame);
     void refresh();
@@ -318,14 +362,25 @@ public:
     QSemaphore *semaphore() { return &m_semaphore; }
     QOpenGLContext *context() const { return m_context; }
     Q_INVOKABLE void showFrame(Mlt::Frame frame);
+    /** @brief Display an already rendered frame, for example from the monitor's frame cache */
+    Q_INVOKABLE void showSharedFrame(const SharedFrame &frame);
     Q_INVOKABLE void showGLFrame(Mlt::Frame frame);
     Q_INVOKABLE void showGLNoSyncFrame(Mlt::Frame frame);
+    /** @brief Duration of the last texture upload, in microseconds */
+    qint64 lastUploadTime() const;
+    /** @brief Average texture upload duration since last reset, in microseconds */
+    qint64 averageUploadTime() const;
+    void resetUploadTime();
+    void setTelemetry(PlaybackTelemetry *telemetry);
+    /** @brief Called by the widget after drawing a texture set uploaded through pixel buffer objects. The renderer takes
+        ownership of the fence and waits on it before uploading to that set again. Returns false if yName is not one of its sets */
+    bool setDisplayFence(GLuint yName, GLsync fence);
 
 public slots:
     void cleanup();
 
 signals:
-    void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0);
+    void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0, GLsync uploadFence = nullptr);
     void frameDisplayed(const SharedFrame &frame);
 
 private:
@@ -336,6 +391,30 @@ private:
     GLWidget::ClientWaitSync_fp m_ClientWaitSync;
 
     void pipelineSyncToFrame(Mlt::Frame &);
+    void displaySharedFrame();
+
+    // pipeline B - asynchronous upload through pixel buffer objects
+    /** @brief Returns true if the context supports pixel buffer objects, map buffer range and fence syncs (GL 3 or GLES 3) */
+    bool checkPboSupport() const;
+    /** @brief Upload m_displayFrame to the next texture set through a pixel buffer object. Returns false on failure */
+    bool uploadWithPbo();
+    void releasePboUpload();
+    /** @brief -1 until checked, then 0 or 1 */
+    int m_pboSupport;
+    int m_pboIndex;
+    GLuint m_pbo[3];
+    /** @brief Fence inserted by the widget after its last draw of each texture set, owned by the renderer */
+    GLsync m_displayFence[3];
+    /** @brief Display fences replaced by a newer draw, deleted on next upload */
+    QVector<GLsync> m_releasedFences;
+    /** @brief Protects the display fences and texture set names, shared with the widget */
+    QMutex m_fenceMutex;
+    GLuint m_pboTexture[3][3];
+    QSize m_pboTextureSize;
+    std::atomic<qint64> m_lastUploadTime;
+    std::atomic<qint64> m_uploadTimeTotal;
+    std::atomic<int> m_uploadCount;
+    PlaybackTelemetry *m_telemetry;
 
 public:
     GLuint m_renderTexture[3];
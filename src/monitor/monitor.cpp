@@ -39,6 +39,8 @@
 #include "jobs/cutclipjob.h"
 #include "scopes/monitoraudiolevel.h"
 #include "timeline2/model/snapmodel.hpp"
+#include "timeline2/view/timelinecontroller.h"
+#include "timeline2/view/timelinewidget.h"
 #include "transitions/transitionsrepository.hpp"
 #include "utils/thumbnailcache.hpp"
 
@@ -55,6 +57,7 @@
 #include "kdenlive_debug.h"
 #include <QScreen>
 #include <QDrag>
+#include <QFileDialog>
 #include <QMenu>
 #include <QMimeData>
 #include <QMouseEvent>
@@ -647,11 +650,46 @@ void Monitor::setupMenu(QMenu *goMenu, QMenu *overlayMenu, QAction *playZone, QA
     switchAudioMonitor->setCheckable(true);
     switchAudioMonitor->setChecked((KdenliveSettings::monitoraudio() & m_id) != 0);
 
+    QAction *playbackTiming = m_configMenu->addAction(i18n("Record Playback Timing"), this, SLOT(slotSwitchPlaybackTiming(bool)));
+    playbackTiming->setCheckable(true);
+    playbackTiming->setChecked(KdenliveSettings::monitor_telemetry());
+    m_configMenu->addAction(i18n("Export Playback Timing..."), this, SLOT(slotExportPlaybackTiming()));
+
     // For some reason, the frame in QAbstracSpinBox (base class of TimeCodeDisplay) needs to be displayed once, then hidden
     // or it will never appear (supposed to appear on hover).
     m_timePos->setFrame(false);
 }
 
+void Monitor::slotSwitchPlaybackTiming(bool enable)
+{
+    KdenliveSettings::setMonitor_telemetry(enable);
+    m_glMonitor->telemetry()->clear();
+    m_glMonitor->telemetry()->setEnabled(enable);
+}
+
+void Monitor::slotExportPlaybackTiming()
+{
+    const QString url = QFileDialog::getSaveFileName(this, i18n("Export Playback Timing"), QString(), i18n("JSON File (*.json);;CSV File (*.csv)"));
+    if (url.isEmpty()) {
+        return;
+    }
+    QFile file(url);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        pCore->displayMessage(i18n("Cannot write to file %1", url), ErrorMessage);
+        return;
+    }
+    if (url.endsWith(QLatin1String(".csv"), Qt::CaseInsensitive)) {
+        file.write(m_glMonitor->telemetry()->toCsv().toUtf8());
+    } else if (m_id == Kdenlive::ProjectMonitor) {
+        // Attach the timeline clips and effects playing when frames were dropped
+        TimelineController *controller = pCore->window()->getMainTimeline()->controller();
+        file.write(m_glMonitor->telemetry()->toJson([controller](int position) { return controller->activeClipsInfo(position); }).toJson());
+    } else {
+        file.write(m_glMonitor->telemetry()->toJson().toJson());
+    }
+    file.close();
+}
+
 void Monitor::slotGoToMarker(QAction *action)
 {
     int pos = action->data().toInt();
@@ -1901,6 +1939,10 @@ void Monitor::onFrameDisplayed(const SharedFrame &frame)
     if (!m_glMonitor->checkFrameNumber(frame.get_position(), m_offset, m_playAction->isActive())) {
         m_playAction->setActive(false);
     }
+    if (!m_playAction->isActive()) {
+        // Paused seeks can be served from the frame cache
+        m_qmlManager->setProperty(QStringLiteral("cacheHits"), m_glMonitor->frameCacheHitRate());
+    }
     emit m_monitorManager->frameDisplayed(frame);
 }
 
@@ -1917,6 +1959,7 @@ void Monitor::checkDrops()
         m_qmlManager->setProperty(QStringLiteral("dropped"), true);
         m_qmlManager->setProperty(QStringLiteral("fps"), QString::number(dropped, 'g', 2));
     }
+    m_qmlManager->setProperty(QStringLiteral("cacheHits"), m_glMonitor->frameCacheHitRate());
 }
 
 void Monitor::reloadProducer(const QString &id)
@@ -2403,6 +2446,16 @@ void Monitor::purgeCache()
     m_glMonitor->purgeCache();
 }
 
+void Monitor::invalidateFrameCache()
+{
+    m_glMonitor->invalidateFrameCache();
+}
+
+void Monitor::updateFrameCacheSettings()
+{
+    m_glMonitor->updateFrameCacheSettings();
+}
+
 void Monitor::updateBgColor()
 {
     m_glMonitor->m_bgColor = KdenliveSettings::window_background();
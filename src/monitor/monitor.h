@@ -245,6 +245,10 @@ private:
 
 private slots:
     void slotSetThumbFrame();
+    /** @brief Enable/disable recording of per frame playback timings */
+    void slotSwitchPlaybackTiming(bool enable);
+    /** @brief Save recorded playback timings to a JSON or CSV file */
+    void slotExportPlaybackTiming();
     void slotSeek();
     void updateClipZone(const QPoint zone);
     void slotGoToMarker(QAction *action);
@@ -335,6 +339,10 @@ public slots:
     void forceMonitorRefresh();
     /** @brief Clear read ahead cache, to ensure up to date audio */
     void purgeCache();
+    /** @brief The displayed content changed, drop the cached decoded frames */
+    void invalidateFrameCache();
+    /** @brief Apply the frame cache size and read-ahead settings */
+    void updateFrameCacheSettings();
 
 signals:
     void screenChanged(int screenIndex);
@@ -0,0 +1,241 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "playbacktelemetry.h"
+#include "core.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+
+PlaybackTelemetry::PlaybackTelemetry(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+    m_frames.resize(m_capacity);
+}
+
+// static
+qint64 PlaybackTelemetry::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool PlaybackTelemetry::isEnabled() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_enabled;
+}
+
+void PlaybackTelemetry::setEnabled(bool enabled)
+{
+    QMutexLocker lock(&m_mutex);
+    m_enabled = enabled;
+}
+
+PlaybackTelemetry::FrameTiming *PlaybackTelemetry::lastFrame()
+{
+    if (m_count == 0) {
+        return nullptr;
+    }
+    return &m_frames[(m_next + m_capacity - 1) % m_capacity];
+}
+
+PlaybackTelemetry::DropCause PlaybackTelemetry::dropCause(const FrameTiming &t, qint64 budget) const
+{
+    if (t.stage[int(Stage::Render)] > budget) {
+        return DropCause::Render;
+    }
+    if (t.stage[int(Stage::Upload)] + t.stage[int(Stage::Present)] > budget) {
+        return DropCause::Upload;
+    }
+    return DropCause::Unknown;
+}
+
+void PlaybackTelemetry::recordFrame(int position, double speed, qint64 render, qint64 queue, qint64 upload)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_enabled) {
+        return;
+    }
+    FrameTiming t;
+    t.position = position;
+    t.speed = speed;
+    t.timestamp = now();
+    t.stage[int(Stage::Render)] = render;
+    t.stage[int(Stage::Queue)] = queue;
+    t.stage[int(Stage::Upload)] = upload;
+    // Frame skipping is only a drop during normal speed playback
+    if (qFuzzyCompare(qAbs(speed), 1.) && m_lastPosition > -1) {
+        int gap = (position - m_lastPosition) * (speed > 0 ? 1 : -1) - 1;
+        if (gap > 0) {
+            // Frames skipped because the display was busy are already recorded by recordDisplayBusy
+            t.dropped = gap;
+            qint64 budget = qint64(1000000 / pCore->getCurrentFps());
+            t.cause = dropCause(t, budget);
+        }
+    }
+    m_lastPosition = position;
+    m_frames[m_next] = t;
+    m_next = (m_next + 1) % m_capacity;
+    m_count = qMin(m_count + 1, m_capacity);
+}
+
+void PlaybackTelemetry::recordPresent(qint64 present)
+{
+    QMutexLocker lock(&m_mutex);
+    FrameTiming *t = lastFrame();
+    if (m_enabled && t && t->stage[int(Stage::Present)] == 0) {
+        t->stage[int(Stage::Present)] = present;
+    }
+}
+
+void PlaybackTelemetry::recordDisplayBusy(int position, double speed)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_enabled) {
+        return;
+    }
+    FrameTiming t;
+    t.position = position;
+    t.speed = speed;
+    t.timestamp = now();
+    t.dropped = 1;
+    t.cause = DropCause::DisplayBusy;
+    // The next displayed frame must not count this position as a gap again
+    m_lastPosition = position;
+    m_frames[m_next] = t;
+    m_next = (m_next + 1) % m_capacity;
+    m_count = qMin(m_count + 1, m_capacity);
+}
+
+void PlaybackTelemetry::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_next = 0;
+    m_count = 0;
+    m_lastPosition = -1;
+}
+
+QVector<PlaybackTelemetry::FrameTiming> PlaybackTelemetry::frames() const
+{
+    QMutexLocker lock(&m_mutex);
+    QVector<FrameTiming> result;
+    result.reserve(m_count);
+    int start = (m_next + m_capacity - m_count) % m_capacity;
+    for (int i = 0; i < m_count; ++i) {
+        result << m_frames.at((start + i) % m_capacity);
+    }
+    return result;
+}
+
+qint64 PlaybackTelemetry::percentile(Stage stage, int percent) const
+{
+    QVector<qint64> values;
+    for (const FrameTiming &t : frames()) {
+        // Frames that were never displayed have no timing
+        if (t.cause != DropCause::DisplayBusy) {
+            values << t.stage[int(stage)];
+        }
+    }
+    if (values.isEmpty()) {
+        return 0;
+    }
+    int ix = qBound(0, (values.size() - 1) * percent / 100, values.size() - 1);
+    std::nth_element(values.begin(), values.begin() + ix, values.end());
+    return values.at(ix);
+}
+
+int PlaybackTelemetry::droppedFrames() const
+{
+    int dropped = 0;
+    for (const FrameTiming &t : frames()) {
+        dropped += t.dropped;
+    }
+    return dropped;
+}
+
+// static
+QString PlaybackTelemetry::causeName(DropCause cause)
+{
+    switch (cause) {
+    case DropCause::Render:
+        return QStringLiteral("render");
+    case DropCause::Upload:
+        return QStringLiteral("upload");
+    case DropCause::DisplayBusy:
+        return QStringLiteral("display_busy");
+    case DropCause::Unknown:
+        return QStringLiteral("unknown");
+    default:
+        return QString();
+    }
+}
+
+QJsonDocument PlaybackTelemetry::toJson(const std::function<QStringList(int)> &dropInfo) const
+{
+    const QStringList stageNames = {QStringLiteral("render"), QStringLiteral("queue"), QStringLiteral("upload"), QStringLiteral("present")};
+    QJsonObject summary;
+    for (int i = 0; i < 4; ++i) {
+        QJsonObject stats;
+        stats.insert(QStringLiteral("p50"), percentile(Stage(i), 50));
+        stats.insert(QStringLiteral("p90"), percentile(Stage(i), 90));
+        stats.insert(QStringLiteral("p99"), percentile(Stage(i), 99));
+        summary.insert(stageNames.at(i), stats);
+    }
+    summary.insert(QStringLiteral("dropped"), droppedFrames());
+    QJsonArray list;
+    for (const FrameTiming &t : frames()) {
+        QJsonObject frame;
+        frame.insert(QStringLiteral("position"), t.position);
+        frame.insert(QStringLiteral("speed"), t.speed);
+        frame.insert(QStringLiteral("timestamp"), t.timestamp);
+        for (int i = 0; i < 4; ++i) {
+            frame.insert(stageNames.at(i), t.stage[i]);
+        }
+        if (t.dropped > 0) {
+            frame.insert(QStringLiteral("dropped"), t.dropped);
+            frame.insert(QStringLiteral("cause"), causeName(t.cause));
+            if (dropInfo) {
+                frame.insert(QStringLiteral("items"), QJsonArray::fromStringList(dropInfo(t.position)));
+            }
+        }
+        list.append(frame);
+    }
+    QJsonObject json;
+    json.insert(QStringLiteral("unit"), QStringLiteral("us"));
+    json.insert(QStringLiteral("summary"), summary);
+    json.insert(QStringLiteral("frames"), list);
+    return QJsonDocument(json);
+}
+
+QString PlaybackTelemetry::toCsv() const
+{
+    QString csv;
+    QTextStream out(&csv);
+    out << "position,speed,timestamp,render,queue,upload,present,dropped,cause\n";
+    for (const FrameTiming &t : frames()) {
+        out << t.position << ',' << t.speed << ',' << t.timestamp << ',' << t.stage[0] << ',' << t.stage[1] << ',' << t.stage[2] << ',' << t.stage[3] << ','
+            << t.dropped << ',' << causeName(t.cause) << '\n';
+    }
+    return csv;
+}
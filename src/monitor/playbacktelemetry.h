@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef PLAYBACKTELEMETRY_H
+#define PLAYBACKTELEMETRY_H
+
+#include <QJsonDocument>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+/**
+ * @class PlaybackTelemetry
+ * @brief Records per frame timings of a monitor in a ring buffer.
+ *
+ * Timings are in microseconds. MLT decodes and applies filters in a single
+ * get_image call, so both are reported as the render stage. The queue stage is
+ * the time a rendered frame waited before the consumer showed it.
+ * This class is thread safe, frames are recorded from the consumer and frame
+ * renderer threads while the presentation time comes from the GUI thread.
+ */
+class PlaybackTelemetry
+{
+public:
+    enum class Stage { Render = 0, Queue, Upload, Present };
+    enum class DropCause { None = 0, Render, Upload, DisplayBusy, Unknown };
+
+    struct FrameTiming
+    {
+        int position{-1};
+        double speed{0.};
+        qint64 timestamp{0};
+        qint64 stage[4]{0, 0, 0, 0};
+        /** @brief Number of frames dropped just before this one */
+        int dropped{0};
+        DropCause cause{DropCause::None};
+    };
+
+    explicit PlaybackTelemetry(int capacity = 2000);
+
+    /** @brief Returns a monotonic timestamp in microseconds, to be used for all measurements */
+    static qint64 now();
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    /** @brief Record a displayed frame. Dropped frames are detected from the gap with the previous position */
+    void recordFrame(int position, double speed, qint64 render, qint64 queue, qint64 upload);
+    /** @brief Set the presentation time of the last recorded frame */
+    void recordPresent(qint64 present);
+    /** @brief A frame could not be displayed because the renderer was still busy */
+    void recordDisplayBusy(int position, double speed);
+    void clear();
+
+    /** @brief Returns the percentile (0-100) of the given stage over the recorded frames */
+    qint64 percentile(Stage stage, int percent) const;
+    int droppedFrames() const;
+    QVector<FrameTiming> frames() const;
+
+    /** @brief Export recorded frames. Extra info (for example the clips active at a position) can be attached to dropped frames */
+    QJsonDocument toJson(const std::function<QStringList(int)> &dropInfo = nullptr) const;
+    QString toCsv() const;
+    static QString causeName(DropCause cause);
+
+private:
+    mutable QMutex m_mutex;
+    QVector<FrameTiming> m_frames;
+    int m_capacity;
+    /** @brief Index of the next slot to write in the ring buffer */
+    int m_next{0};
+    int m_count{0};
+    int m_lastPosition{-1};
+    bool m_enabled{false};
+    /** @brief Find the most likely cause for a drop before frame t, the frame budget is in microseconds */
+    DropCause dropCause(const FrameTiming &t, qint64 budget) const;
+    /** @brief Returns the last recorded frame, must be called with the mutex locked */
+    FrameTiming *lastFrame();
+};
+
+#endif
@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "refreshscheduler.h"
+#include "core.h"
+#include "mainwindow.h"
+#include "timeline2/model/timelineitemmodel.hpp"
+#include "timeline2/view/timelinecontroller.h"
+#include "timeline2/view/timelinewidget.h"
+
+#include <QDebug>
+
+RefreshScheduler::RefreshScheduler(QObject *parent)
+    : QObject(parent)
+{
+    // One refresh per 40ms is enough to follow a slider drag
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(40);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &RefreshScheduler::processRefresh);
+    // Preview invalidation is only done once the user stopped editing
+    m_invalidateTimer.setSingleShot(true);
+    m_invalidateTimer.setInterval(800);
+    connect(&m_invalidateTimer, &QTimer::timeout, this, &RefreshScheduler::processInvalidation);
+}
+
+void RefreshScheduler::scheduleRefresh(const ObjectId &owner)
+{
+    if (!m_pendingRefresh.insert(owner).second) {
+        // A refresh is already pending for this item, it will render the latest state
+        m_droppedRefreshes++;
+    }
+    if (!m_refreshTimer.isActive()) {
+        m_refreshTimer.start();
+    }
+}
+
+void RefreshScheduler::scheduleInvalidation(const ObjectId &owner)
+{
+    if (!m_pendingInvalidation.insert(owner).second) {
+        m_droppedInvalidations++;
+    }
+    // Restart timer on each request, the invalidation happens when edits stop
+    m_invalidateTimer.start();
+}
+
+bool RefreshScheduler::isUnderCursor(const ObjectId &owner) const
+{
+    switch (owner.first) {
+    case ObjectType::TimelineClip:
+    case ObjectType::TimelineComposition: {
+        TimelineController *controller = pCore->window()->getCurrentTimeline()->controller();
+        const auto &model = controller->getModel();
+        // Deleted items are not refreshed
+        if (owner.first == ObjectType::TimelineClip ? !model->isClip(owner.second) : !model->isComposition(owner.second)) {
+            return false;
+        }
+        return controller->positionIsInItem(owner.second);
+    }
+    default:
+        // Range is not known (bin clip, track, master), let the monitor decide
+        return true;
+    }
+}
+
+void RefreshScheduler::processRefresh()
+{
+    std::set<ObjectId> pending;
+    std::swap(pending, m_pendingRefresh);
+    for (const ObjectId &owner : pending) {
+        if (!isUnderCursor(owner)) {
+            m_skippedRefreshes++;
+            continue;
+        }
+        m_processedRefreshes++;
+        pCore->refreshProjectItem(owner);
+    }
+}
+
+void RefreshScheduler::processInvalidation()
+{
+    std::set<ObjectId> pending;
+    std::swap(pending, m_pendingInvalidation);
+    for (const ObjectId &owner : pending) {
+        pCore->invalidateItem(owner);
+    }
+    qDebug() << "// Refresh scheduler: " << m_processedRefreshes << " refreshes, " << m_droppedRefreshes << " dropped, " << m_skippedRefreshes
+             << " outside cursor, " << m_droppedInvalidations << " merged invalidations";
+}
+
+void RefreshScheduler::flush()
+{
+    m_refreshTimer.stop();
+    m_invalidateTimer.stop();
+    processRefresh();
+    processInvalidation();
+}
+
+void RefreshScheduler::clear()
+{
+    m_refreshTimer.stop();
+    m_invalidateTimer.stop();
+    m_pendingRefresh.clear();
+    m_pendingInvalidation.clear();
+}
+
+int RefreshScheduler::droppedRefreshes() const
+{
+    return m_droppedRefreshes;
+}
+
+int RefreshScheduler::skippedRefreshes() const
+{
+    return m_skippedRefreshes;
+}
+
+int RefreshScheduler::processedRefreshes() const
+{
+    return m_processedRefreshes;
+}
+
+int RefreshScheduler::droppedInvalidations() const
+{
+    return m_droppedInvalidations;
+}
+
+void RefreshScheduler::resetCounters()
+{
+    m_droppedRefreshes = 0;
+    m_skippedRefreshes = 0;
+    m_processedRefreshes = 0;
+    m_droppedInvalidations = 0;
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include "definitions.h"
+
+#include <QObject>
+#include <QTimer>
+#include <set>
+
+/**
+ * @class RefreshScheduler
+ * @brief Coalesces monitor refresh and timeline preview invalidation requests.
+ *
+ * Parameter edits (slider drags, color wheels) can request dozens of refreshes
+ * per second. Requests are stored per owner and processed once the refresh
+ * timer fires, so that only the latest state of the asset is rendered. Monitor
+ * refresh is skipped if the timeline cursor is outside the owner's range at
+ * that time. Preview invalidation is delayed until no edit happened for a
+ * while, which is considered the end of the interaction.
+ */
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RefreshScheduler(QObject *parent = nullptr);
+
+    /** @brief Request a monitor refresh for this item, processed on next refresh tick */
+    void scheduleRefresh(const ObjectId &owner);
+    /** @brief Request a timeline preview invalidation, processed when the interaction ends */
+    void scheduleInvalidation(const ObjectId &owner);
+    /** @brief Process all pending requests immediately */
+    void flush();
+    /** @brief Drop all pending requests, for example on project close */
+    void clear();
+
+    /** @brief Number of refresh requests merged into an already pending one */
+    int droppedRefreshes() const;
+    /** @brief Number of refreshes skipped because the cursor was outside the item */
+    int skippedRefreshes() const;
+    /** @brief Number of refreshes actually sent to the monitor */
+    int processedRefreshes() const;
+    /** @brief Number of invalidation requests merged into an already pending one */
+    int droppedInvalidations() const;
+    void resetCounters();
+
+private:
+    QTimer m_refreshTimer;
+    QTimer m_invalidateTimer;
+    std::set<ObjectId> m_pendingRefresh;
+    std::set<ObjectId> m_pendingInvalidation;
+    int m_droppedRefreshes{0};
+    int m_skippedRefreshes{0};
+    int m_processedRefreshes{0};
+    int m_droppedInvalidations{0};
+    /** @brief Returns false if we know the cursor is outside of the item's range */
+    bool isUnderCursor(const ObjectId &owner) const;
+
+private slots:
+    void processRefresh();
+    void processInvalidation();
+};
+
+#endif
@@ -17,6 +17,7 @@ Item {
     property double scalex
     property double scaley
     property bool dropped: false
+    property int cacheHits: 0
     property string fps: '-'
     property bool showMarkers: false
     property bool showTimecode: false
@@ -151,7 +152,7 @@ Item {
                 background: Rectangle {
                     color: root.dropped ? "#99ff0000" : "#66004400"
                 }
-                text: i18n("%1fps", root.fps)
+                text: root.cacheHits > 0 ? i18n("%1fps, cache %2%", root.fps, root.cacheHits) : i18n("%1fps", root.fps)
                 visible: root.showFps
                 anchors {
                     right: timecode.visible ? timecode.left : parent.right
@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "archivecopier.h"
+#include "kdenlive_debug.h"
+#include "utils/fingerprintcache.hpp"
+
+#include <KLocalizedString>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+const qint64 copyBufferSize = 1024 * 1024;
+}
+
+ArchiveCopier::ArchiveCopier(const QString &root, QObject *parent)
+    : QObject(parent)
+    , m_root(root)
+{
+}
+
+ArchiveCopier::~ArchiveCopier()
+{
+    abort();
+    m_future.waitForFinished();
+}
+
+void ArchiveCopier::addFile(const QString &source, const QString &destination, bool deduplicate)
+{
+    m_tasks.append({source, destination, deduplicate, QFileInfo(source).size()});
+}
+
+void ArchiveCopier::start(int maxJobs)
+{
+    if (isRunning()) {
+        return;
+    }
+    m_abort = false;
+    m_processed = 0;
+    m_copied = 0;
+    m_skipped = 0;
+    m_linked = 0;
+    m_deduplicated = 0;
+    m_error.clear();
+    m_sharedDestinations.clear();
+    m_total = 0;
+    for (const Task &task : qAsConst(m_tasks)) {
+        m_total += task.size;
+    }
+    m_pool.setMaxThreadCount(qMax(1, maxJobs));
+    m_future = QtConcurrent::run(this, &ArchiveCopier::run);
+}
+
+void ArchiveCopier::abort()
+{
+    m_abort = true;
+}
+
+bool ArchiveCopier::isRunning() const
+{
+    return m_future.isRunning();
+}
+
+void ArchiveCopier::setAllowHardLinks(bool allow)
+{
+    m_allowHardLinks = allow;
+}
+
+QString ArchiveCopier::destinationFor(const QString &source) const
+{
+    QMutexLocker lk(&m_mutex);
+    return m_sharedDestinations.value(source);
+}
+
+QString ArchiveCopier::report() const
+{
+    return i18n("%1 files copied, %2 linked, %3 already archived, %4 duplicates", m_copied.load(), m_linked.load(), m_skipped.load(),
+                m_deduplicated.load());
+}
+
+void ArchiveCopier::run()
+{
+    // Identical media only needs to be archived once
+    QStringList paths;
+    for (const Task &task : qAsConst(m_tasks)) {
+        if (task.deduplicate) {
+            paths << task.source;
+        }
+    }
+    const QMap<QString, QString> hashes = FingerprintCache::get()->fingerprints(paths);
+    // Fingerprints only read the start and end of the files, candidates are compared in full before sharing a copy
+    QHash<QString, QVector<Task>> archived;
+    QVector<Task> tasks;
+    tasks.reserve(m_tasks.size());
+    for (const Task &task : qAsConst(m_tasks)) {
+        const QString hash = task.deduplicate ? hashes.value(task.source) : QString();
+        if (hash.isEmpty()) {
+            tasks << task;
+            continue;
+        }
+        const QString key = hash + QLatin1Char(':') + QString::number(task.size);
+        QVector<Task> &candidates = archived[key];
+        QString shared;
+        for (const Task &candidate : qAsConst(candidates)) {
+            if (m_abort) {
+                break;
+            }
+            if (sameContent(candidate.source, task.source)) {
+                shared = candidate.destination;
+                break;
+            }
+        }
+        if (shared.isEmpty()) {
+            candidates << task;
+            tasks << task;
+            continue;
+        }
+        QMutexLocker lk(&m_mutex);
+        m_sharedDestinations.insert(task.source, shared);
+        m_deduplicated++;
+        addProgress(task.size);
+    }
+    for (const Task &task : qAsConst(tasks)) {
+        QtConcurrent::run(&m_pool, [this, task]() { copyFile(task); });
+    }
+    m_pool.waitForDone();
+    FingerprintCache::get()->save();
+    qCDebug(KDENLIVE_LOG) << "// Archiving done: " << report();
+    QMutexLocker lk(&m_mutex);
+    if (m_abort && m_error.isEmpty()) {
+        m_error = i18n("Archiving aborted");
+    }
+    emit finished(m_error.isEmpty(), m_error);
+}
+
+bool ArchiveCopier::isIdentical(const QString &source, const QString &destination) const
+{
+    QFileInfo src(source);
+    QFileInfo dst(destination);
+    if (!dst.exists() || dst.size() != src.size()) {
+        return false;
+    }
+    if (dst.lastModified() == src.lastModified()) {
+        return true;
+    }
+    // Fingerprints only read the start and end of the files, compare the whole content
+    return sameContent(source, destination);
+}
+
+bool ArchiveCopier::sameContent(const QString &first, const QString &second) const
+{
+    QFile a(first);
+    QFile b(second);
+    if (a.size() != b.size() || !a.open(QIODevice::ReadOnly) || !b.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    while (!a.atEnd()) {
+        if (m_abort) {
+            return false;
+        }
+        const QByteArray data = a.read(copyBufferSize);
+        if (data.isEmpty() || data != b.read(data.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray ArchiveCopier::sourceStamp(const QString &source)
+{
+    QFileInfo info(source);
+    return QByteArray::number(info.size()) + ' ' + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+bool ArchiveCopier::linkFile(const QString &source, const QString &destination)
+{
+#ifdef Q_OS_LINUX
+    {
+        // Copy on write clone, only supported on some filesystems (btrfs, xfs)
+        QFile in(source);
+        QFile out(destination);
+        if (in.open(QIODevice::ReadOnly) && out.open(QIODevice::WriteOnly)) {
+            if (ioctl(out.handle(), FICLONE, in.handle()) == 0) {
+                return true;
+            }
+            out.remove();
+        }
+    }
+#endif
+#ifdef Q_OS_UNIX
+    if (m_allowHardLinks && ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0) {
+        return true;
+    }
+#endif
+    return false;
+}
+
+void ArchiveCopier::copyFile(const Task &task)
+{
+    if (m_abort) {
+        return;
+    }
+    const QString destination = QDir(m_root).absoluteFilePath(task.destination);
+    if (!QDir().mkpath(QFileInfo(destination).absolutePath())) {
+        setError(i18n("Cannot create directory %1", QFileInfo(destination).absolutePath()));
+        return;
+    }
+    if (isIdentical(task.source, destination)) {
+        m_skipped++;
+        addProgress(task.size);
+        return;
+    }
+    QFile::remove(destination);
+    if (linkFile(task.source, destination)) {
+        m_linked++;
+        addProgress(task.size);
+        return;
+    }
+    QFile in(task.source);
+    if (!in.open(QIODevice::ReadOnly)) {
+        setError(i18n("Cannot read file %1", task.source));
+        return;
+    }
+    // Data is written to a partial file, an interrupted copy continues where it stopped
+    // unless the source was modified in between
+    const QString partial = destination + QStringLiteral(".part");
+    const QByteArray stamp = sourceStamp(task.source);
+    QFile stampFile(partial + QStringLiteral(".info"));
+    bool sameSource = false;
+    if (stampFile.open(QIODevice::ReadOnly)) {
+        sameSource = stampFile.readAll() == stamp;
+        stampFile.close();
+    }
+    QFile out(partial);
+    qint64 done = QFileInfo(partial).size();
+    if (sameSource && done > 0 && done <= in.size() && out.open(QIODevice::WriteOnly | QIODevice::Append) && in.seek(done)) {
+        addProgress(done);
+    } else {
+        out.close();
+        done = 0;
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || !stampFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            stampFile.write(stamp) != stamp.size()) {
+            setError(i18n("Cannot write to file %1", destination));
+            return;
+        }
+        stampFile.close();
+    }
+    QByteArray buffer;
+    while (!in.atEnd()) {
+        if (m_abort) {
+            return;
+        }
+        buffer = in.read(copyBufferSize);
+        if (buffer.isEmpty() || out.write(buffer) != buffer.size()) {
+            setError(i18n("There was an error while copying the files: %1", out.errorString()));
+            return;
+        }
+        addProgress(buffer.size());
+    }
+    out.close();
+    if (!out.rename(destination)) {
+        setError(i18n("Cannot write to file %1", destination));
+        return;
+    }
+    stampFile.remove();
+    // Keep the source time so that the next archiving can skip this file
+    QFile copy(destination);
+    if (copy.open(QIODevice::ReadWrite)) {
+        copy.setFileTime(QFileInfo(task.source).lastModified(), QFileDevice::FileModificationTime);
+    }
+    m_copied++;
+}
+
+void ArchiveCopier::addProgress(qint64 size)
+{
+    qint64 processed = m_processed.fetch_add(size) + size;
+    emit progress(processed, m_total);
+}
+
+void ArchiveCopier::setError(const QString &error)
+{
+    QMutexLocker lk(&m_mutex);
+    if (m_error.isEmpty()) {
+        m_error = error;
+    }
+    m_abort = true;
+}
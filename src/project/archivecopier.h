@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef ARCHIVECOPIER_H
+#define ARCHIVECOPIER_H
+
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+
+/**
+ * @class ArchiveCopier
+ * @brief Copies the files of a project archive to a destination folder.
+ *
+ * Files are copied in parallel on a dedicated thread pool, so that the number
+ * of concurrent transfers stays bounded. Identical media files (same size,
+ * fingerprint and content) are only copied once, destinationFor() then returns
+ * the shared copy. Files already present at the destination with the same size
+ * and modification time or content are skipped, and interrupted copies are
+ * resumed from their partial file if the source did not change since, so
+ * archiving the same project again only transfers what changed. When the
+ * filesystem supports it, files are cloned (reflink) instead of copied. Hard
+ * links are only used when allowed with setAllowHardLinks().
+ */
+class ArchiveCopier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ArchiveCopier(const QString &root, QObject *parent = nullptr);
+    ~ArchiveCopier() override;
+
+    /** @brief Add a file to copy
+     *  @param source is the absolute path of the file
+     *  @param destination is the path relative to the archive root
+     *  @param deduplicate is false for files that must keep their own copy (slideshow sequences)
+     */
+    void addFile(const QString &source, const QString &destination, bool deduplicate = true);
+    /** @brief Start copying in a background thread, using at most maxJobs concurrent transfers */
+    void start(int maxJobs = 4);
+    /** @brief Stop copying. Partial files are kept so that the next run can resume */
+    void abort();
+    bool isRunning() const;
+    /** @brief Allow hard links when the archive is on the same filesystem as the source. Disabled by default,
+     *  since the archived file then changes with the original */
+    void setAllowHardLinks(bool allow);
+    /** @brief Returns the archive path (relative to root) used for a deduplicated source file, or an empty string */
+    QString destinationFor(const QString &source) const;
+    /** @brief Summary of the last run */
+    QString report() const;
+
+private:
+    struct Task
+    {
+        QString source;
+        QString destination;
+        bool deduplicate;
+        qint64 size;
+    };
+    QString m_root;
+    QVector<Task> m_tasks;
+    QMap<QString, QString> m_sharedDestinations;
+    QThreadPool m_pool;
+    QFuture<void> m_future;
+    mutable QMutex m_mutex;
+    QString m_error;
+    qint64 m_total{0};
+    bool m_allowHardLinks{false};
+    std::atomic<bool> m_abort{false};
+    std::atomic<qint64> m_processed{0};
+    std::atomic<int> m_copied{0};
+    std::atomic<int> m_skipped{0};
+    std::atomic<int> m_linked{0};
+    std::atomic<int> m_deduplicated{0};
+
+    void run();
+    void copyFile(const Task &task);
+    /** @brief Try to clone or hard link the file instead of copying it */
+    bool linkFile(const QString &source, const QString &destination);
+    /** @brief Returns true if the destination file is identical to the source */
+    bool isIdentical(const QString &source, const QString &destination) const;
+    /** @brief Byte comparison of two files, returns false if they differ or one cannot be read */
+    bool sameContent(const QString &first, const QString &second) const;
+    /** @brief Size and modification time of the source, stored next to a partial file to check that it can be resumed */
+    static QByteArray sourceStamp(const QString &source);
+    void addProgress(qint64 size);
+    void setError(const QString &error);
+
+signals:
+    void progress(qint64 processed, qint64 total);
+    void finished(bool success, const QString &error);
+};
+
+#endif
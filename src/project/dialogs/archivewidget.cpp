@@ -18,13 +18,16 @@
  ***************************************************************************/
 
 #include "archivewidget.h"
+#include "project/archivecopier.h"
 #include "bin/bin.h"
+#include "bin/binplaylist.hpp"
 #include "bin/projectclip.h"
 #include "bin/projectfolder.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
 #include "projectsettings.h"
 #include "titler/titlewidget.h"
+#include "utils/analysistrack.hpp"
 #include "xml/xml.hpp"
 
 #include "kdenlive_debug.h"
@@ -37,6 +40,7 @@
 #include <kio/directorysizejob.h>
 #include <klocalizedstring.h>
 
+#include <QThread>
 #include <QTreeWidget>
 #include <QtConcurrent>
 #include <utility>
@@ -44,6 +48,7 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QString xmlData,
     : QDialog(parent)
     , m_requestedSize(0)
     , m_copyJob(nullptr)
+    , m_copier(nullptr)
     , m_name(projectName.section(QLatin1Char('.'), 0, -2))
     , m_temp(nullptr)
     , m_abortArchive(false)
@@ -60,6 +65,8 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QString xmlData,
     connect(this, &ArchiveWidget::archivingFinished, this, &ArchiveWidget::slotArchivingBoolFinished);
     connect(this, &ArchiveWidget::archiveProgress, this, &ArchiveWidget::slotArchivingIntProgress);
     connect(proxy_only, &QCheckBox::stateChanged, this, &ArchiveWidget::slotProxyOnly);
+    // Tar entries cannot be linked
+    connect(compressed_archive, &QCheckBox::toggled, hard_links, &QCheckBox::setDisabled);
 
     // Prepare xml
     m_doc.setContent(xmlData);
@@ -103,6 +110,11 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QString xmlData,
     proxies->setData(0, Qt::UserRole, QStringLiteral("proxy"));
     proxies->setExpanded(false);
 
+    QTreeWidgetItem *analysis = new QTreeWidgetItem(files_list, QStringList() << i18n("Analysis data"));
+    analysis->setIcon(0, QIcon::fromTheme(QStringLiteral("application-octet-stream")));
+    analysis->setData(0, Qt::UserRole, QStringLiteral("analysis"));
+    analysis->setExpanded(false);
+
     // process all files
     QStringList allFonts;
     QStringList extraImageUrls;
@@ -115,10 +127,19 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QString xmlData,
     QMap<QString, QString> imageUrls;
     QMap<QString, QString> playlistUrls;
     QMap<QString, QString> proxyUrls;
+    QStringList analysisUrls;
     QList<std::shared_ptr<ProjectClip>> clipList = pCore->projectItemModel()->getRootFolder()->childClips();
     for (const std::shared_ptr<ProjectClip> &clip : qAsConst(clipList)) {
         ClipType::ProducerType t = clip->clipType();
         QString id = clip->binId();
+        // Analysis data stored in sidecar files of the project folder
+        const QMap<QString, QString> analysisData = clip->getPropertiesFromPrefix(QStringLiteral("kdenlive:clipanalysis."));
+        for (const QString &value : analysisData) {
+            const QString sidecar = AnalysisTrack::sidecarFile(value);
+            if (!sidecar.isEmpty() && !analysisUrls.contains(sidecar)) {
+                analysisUrls << sidecar;
+            }
+        }
         if (t == ClipType::Color) {
             continue;
         }
@@ -160,12 +181,13 @@ ArchiveWidget::ArchiveWidget(const QString &projectName, const QString xmlData,
     generateItems(playlists, playlistUrls);
     generateItems(others, otherUrls);
     generateItems(proxies, proxyUrls);
+    generateItems(analysis, analysisUrls);
 
     allFonts.removeDuplicates();
 
     m_infoMessage = new KMessageWidget(this);
     auto *s = static_cast<QVBoxLayout *>(layout());
-    s->insertWidget(5, m_infoMessage);
+    s->insertWidget(6, m_infoMessage);
     m_infoMessage->setCloseButtonVisible(false);
     m_infoMessage->setWordWrap(true);
     m_infoMessage->hide();
@@ -226,6 +248,7 @@ ArchiveWidget::ArchiveWidget(QUrl url, QWidget *parent)
     : QDialog(parent)
     , m_requestedSize(0)
     , m_copyJob(nullptr)
+    , m_copier(nullptr)
     , m_temp(nullptr)
     , m_abortArchive(false)
     , m_extractMode(true)
@@ -246,6 +269,7 @@ ArchiveWidget::ArchiveWidget(QUrl url, QWidget *parent)
 
     compressed_archive->setHidden(true);
     proxy_only->setHidden(true);
+    hard_links->setHidden(true);
     project_files->setHidden(true);
     files_list->setHidden(true);
     label->setText(i18n("Extract to"));
@@ -336,6 +360,9 @@ bool ArchiveWidget::closeAccepted()
         if (m_copyJob) {
             m_copyJob->kill();
         }
+        if (m_copier) {
+            m_copier->abort();
+        }
     }
     return true;
 }
@@ -521,15 +548,31 @@ void ArchiveWidget::slotCheckSpace()
 
 bool ArchiveWidget::slotStartArchiving(bool firstPass)
 {
-    if (firstPass && ((m_copyJob != nullptr) || m_archiveThread.isRunning())) {
+    if (firstPass && ((m_copyJob != nullptr) || m_archiveThread.isRunning() || (m_copier && m_copier->isRunning()))) {
         // archiving in progress, abort
         if (m_copyJob) {
             m_copyJob->kill(KJob::EmitResult);
         }
+        if (m_copier) {
+            m_copier->abort();
+        }
         m_abortArchive = true;
         return true;
     }
     bool isArchive = compressed_archive->isChecked();
+    if (firstPass && !isArchive) {
+        m_abortArchive = false;
+        m_replacementList.clear();
+        slotDisplayMessage(QStringLiteral("system-run"), i18n("Archiving..."));
+        archive_url->setEnabled(false);
+        proxy_only->setEnabled(false);
+        compressed_archive->setEnabled(false);
+        hard_links->setEnabled(false);
+        startCopier();
+        progressBar->setValue(0);
+        buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Abort"));
+        return true;
+    }
     if (!firstPass) {
         m_copyJob = nullptr;
     } else {
@@ -670,6 +713,74 @@ bool ArchiveWidget::slotStartArchiving(bool firstPass)
     return true;
 }
 
+void ArchiveWidget::startCopier()
+{
+    delete m_copier;
+    m_copier = new ArchiveCopier(archive_url->url().toLocalFile(), this);
+    m_copier->setAllowHardLinks(hard_links->isChecked());
+    connect(m_copier, &ArchiveCopier::progress, this, [this](qint64 processed, qint64 total) {
+        if (total > 0) {
+            progressBar->setValue(static_cast<int>(100 * processed / total));
+        }
+    });
+    connect(m_copier, &ArchiveCopier::finished, this, &ArchiveWidget::slotCopierFinished);
+    // Queue all files at once, the copier handles concurrency and duplicates
+    for (int i = 0; i < files_list->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(i);
+        if (parentItem->isDisabled() || parentItem->childCount() == 0) {
+            continue;
+        }
+        QString folder = parentItem->data(0, Qt::UserRole).toString();
+        bool isSlideshow = folder == QLatin1String("slideshows");
+        // Analysis sidecars are named after their content, there is nothing to deduplicate
+        bool deduplicate = folder != QLatin1String("analysis");
+        if (!deduplicate) {
+            // The archived project's storage folder is set in processProjectFile, sidecars are resolved in its analysis folder
+            const QString root = archive_url->url().adjusted(QUrl::StripTrailingSlash).toLocalFile();
+            const QString documentId = pCore->currentDoc()->getDocumentProperty(QStringLiteral("documentid"));
+            folder = QDir(root).relativeFilePath(AnalysisTrack::analysisFolder(root + QLatin1Char('/') + documentId));
+        }
+        for (int j = 0; j < parentItem->childCount(); ++j) {
+            QTreeWidgetItem *item = parentItem->child(j);
+            if (item->isDisabled()) {
+                continue;
+            }
+            if (isSlideshow) {
+                const QString slideFolder = folder + QLatin1Char('/') + item->data(0, Qt::UserRole).toString() + QLatin1Char('/');
+                const QStringList srcFiles = item->data(0, Qt::UserRole + 1).toStringList();
+                for (const QString &src : srcFiles) {
+                    m_copier->addFile(src, slideFolder + QFileInfo(src).fileName(), false);
+                }
+            } else if (item->data(0, Qt::UserRole).isNull()) {
+                m_copier->addFile(item->text(0), folder + QLatin1Char('/') + QFileInfo(item->text(0)).fileName(), deduplicate);
+            } else {
+                // Another file with the same name exists, use the renamed destination
+                m_copier->addFile(item->text(0), folder + QLatin1Char('/') + item->data(0, Qt::UserRole).toString(), deduplicate);
+            }
+        }
+    }
+    m_copier->start(QThread::idealThreadCount() > 2 ? 4 : 2);
+}
+
+void ArchiveWidget::slotCopierFinished(bool success, const QString &error)
+{
+    if (success) {
+        progressBar->setValue(100);
+        if (processProjectFile()) {
+            slotJobResult(true, i18n("Project was successfully archived.") + QLatin1Char(' ') + m_copier->report());
+        } else {
+            slotJobResult(false, i18n("There was an error processing project file"));
+        }
+    } else {
+        slotJobResult(false, error);
+    }
+    buttonBox->button(QDialogButtonBox::Apply)->setText(i18n("Archive"));
+    archive_url->setEnabled(true);
+    proxy_only->setEnabled(true);
+    compressed_archive->setEnabled(true);
+    hard_links->setEnabled(true);
+}
+
 void ArchiveWidget::slotArchivingFinished(KJob *job, bool finished)
 {
     if (job == nullptr || job->error() == 0) {
@@ -733,6 +844,13 @@ bool ArchiveWidget::processProjectFile()
                 } else {
                     dest = QUrl::fromLocalFile(parentItem->data(0, Qt::UserRole).toString() + QLatin1Char('/') + item->data(0, Qt::UserRole).toString());
                 }
+                if (!isArchive && !isSlideshow && m_copier) {
+                    // Identical media files share a single archived copy
+                    const QString shared = m_copier->destinationFor(src.toLocalFile());
+                    if (!shared.isEmpty()) {
+                        dest = QUrl::fromLocalFile(shared);
+                    }
+                }
                 m_replacementList.insert(src, dest);
             }
         }
@@ -754,6 +872,24 @@ bool ArchiveWidget::processProjectFile()
     // Switch to relative path
     mlt.removeAttribute(QStringLiteral("root"));
 
+    for (int ix = 0; ix < files_list->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *parentItem = files_list->topLevelItem(ix);
+        if (parentItem->data(0, Qt::UserRole).toString() == QLatin1String("analysis") && parentItem->childCount() > 0) {
+            // Analysis sidecars are resolved in the project folder, make the archive folder the project folder
+            QDomNodeList playlists = mlt.elementsByTagName(QStringLiteral("playlist"));
+            for (int i = 0; i < playlists.count(); ++i) {
+                QDomElement e = playlists.at(i).toElement();
+                if (e.attribute(QStringLiteral("id")) == BinPlaylist::binPlaylistId) {
+                    const QString documentId = Xml::getXmlProperty(e, QStringLiteral("kdenlive:docproperties.documentid"));
+                    Xml::setXmlProperty(e, QStringLiteral("kdenlive:docproperties.storagefolder"),
+                                        archive_url->url().adjusted(QUrl::StripTrailingSlash).toLocalFile() + QLatin1Char('/') + documentId);
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
     // process mlt producers
     QDomNodeList prods = mlt.elementsByTagName(QStringLiteral("producer"));
     for (int i = 0; i < prods.count(); ++i) {
@@ -31,6 +31,7 @@
 #include <QFuture>
 #include <memory>
 
+class ArchiveCopier;
 class KJob;
 class KArchive;
 
@@ -73,6 +74,7 @@ private slots:
     void slotDisplayMessage(const QString &icon, const QString &text);
     void slotJobResult(bool success, const QString &text);
     void slotProxyOnly(int onlyProxy);
+    void slotCopierFinished(bool success, const QString &error);
 
 protected:
     void closeEvent(QCloseEvent *e) override;
@@ -80,6 +82,8 @@ protected:
 private:
     KIO::filesize_t m_requestedSize;
     KIO::CopyJob *m_copyJob;
+    /** @brief Copies the files when archiving to a folder */
+    ArchiveCopier *m_copier;
     QMap<QUrl, QUrl> m_duplicateFiles;
     QMap<QUrl, QUrl> m_replacementList;
     QString m_name;
@@ -101,6 +105,8 @@ private:
     void generateItems(QTreeWidgetItem *parentItem, const QStringList &items);
     /** @brief Generate tree widget subitems from a map of clip ids / urls. */
     void generateItems(QTreeWidgetItem *parentItem, const QMap<QString, QString> &items);
+    /** @brief Queue all enabled files in a new copier and start it. */
+    void startCopier();
     /** @brief Replace urls in project file. */
     bool processProjectFile();
 
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "kdenlivesettings.h"
 #include "core.h"
 #include "bin/bin.h"
+#include "utils/cacheusage.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -233,17 +234,13 @@ void TemporaryData::updateDataInfo()
         m_currentPage->setEnabled(false);
         return;
     }
-    preview = m_doc->getCacheDir(CachePreview, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotPreviewSize);
-    }
+    computeCacheSize(CachePreview, 0);
 
     preview = m_doc->getCacheDir(CacheProxy, &ok);
     if (ok) {
         if (m_proxies.isEmpty()) {
             // No proxies for this project
-            gotProxySize(0);
+            updateCurrentSize(1, 0);
         } else {
             preview.setNameFilters(m_proxies);
             const QFileInfoList fList = preview.entryInfoList();
@@ -251,85 +248,52 @@ void TemporaryData::updateDataInfo()
             for (const QFileInfo &info : fList) {
                 size += (uint)info.size();
             }
-            gotProxySize(size);
+            updateCurrentSize(1, size);
         }
     }
 
-    preview = m_doc->getCacheDir(CacheAudio, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotAudioSize);
-    }
-    preview = m_doc->getCacheDir(CacheThumbs, &ok);
-    if (ok) {
-        KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
-        connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotThumbSize);
-    }
+    computeCacheSize(CacheAudio, 2);
+    computeCacheSize(CacheThumbs, 3);
     if (m_globalPage) {
         updateGlobalInfo();
     }
 }
 
-void TemporaryData::gotPreviewSize(KJob *job)
+void TemporaryData::computeCacheSize(CacheType type, int row)
 {
-    auto *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
-    QLayoutItem *button = m_grid->itemAtPosition(0, 4);
-    if ((button != nullptr) && (button->widget() != nullptr)) {
-        button->widget()->setEnabled(total > 0);
-    }
-    m_totalCurrent += total;
-    m_currentSizes[0] = total;
-    m_previewSize->setText(KIO::convertSize(total));
-    updateTotal();
-}
-
-void TemporaryData::gotProxySize(KIO::filesize_t total)
-{
-    QLayoutItem *button = m_grid->itemAtPosition(1, 4);
-    if ((button != nullptr) && (button->widget() != nullptr)) {
-        button->widget()->setEnabled(total > 0);
-    }
-    m_totalCurrent += total;
-    m_currentSizes[1] = total;
-    m_proxySize->setText(KIO::convertSize(total));
-    updateTotal();
-}
-
-void TemporaryData::gotAudioSize(KJob *job)
-{
-    auto *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
+    bool ok = false;
+    QDir dir = m_doc->getCacheDir(type, &ok);
+    if (!ok) {
+        return;
     }
-    QLayoutItem *button = m_grid->itemAtPosition(2, 4);
-    if ((button != nullptr) && (button->widget() != nullptr)) {
-        button->widget()->setEnabled(total > 0);
+    qint64 size = 0;
+    if (CacheUsage::get()->usage(type, &size)) {
+        // Usage is tracked while writing the cache, no need to walk the folder
+        updateCurrentSize(row, KIO::filesize_t(size));
+        return;
     }
-    m_totalCurrent += total;
-    m_currentSizes[2] = total;
-    m_audioSize->setText(KIO::convertSize(total));
-    updateTotal();
+    KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(dir.absolutePath()));
+    connect(job, &KIO::DirectorySizeJob::result, this, [this, type, row](KJob *j) {
+        auto *sourceJob = static_cast<KIO::DirectorySizeJob *>(j);
+        KIO::filesize_t total = sourceJob->totalSize();
+        if (sourceJob->totalFiles() == 0) {
+            total = 0;
+        }
+        CacheUsage::get()->setUsage(type, qint64(total), qint64(sourceJob->totalFiles()));
+        updateCurrentSize(row, total);
+    });
 }
 
-void TemporaryData::gotThumbSize(KJob *job)
+void TemporaryData::updateCurrentSize(int row, KIO::filesize_t total)
 {
-    auto *sourceJob = static_cast<KIO::DirectorySizeJob *>(job);
-    KIO::filesize_t total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
-    }
-    QLayoutItem *button = m_grid->itemAtPosition(3, 4);
+    QLayoutItem *button = m_grid->itemAtPosition(row, 4);
     if ((button != nullptr) && (button->widget() != nullptr)) {
         button->widget()->setEnabled(total > 0);
     }
     m_totalCurrent += total;
-    m_currentSizes[3] = total;
-    m_thumbSize->setText(KIO::convertSize(total));
+    m_currentSizes[row] = total;
+    QLabel *labels[] = {m_previewSize, m_proxySize, m_audioSize, m_thumbSize};
+    labels[row]->setText(KIO::convertSize(total));
     updateTotal();
 }
 
@@ -364,6 +328,7 @@ void TemporaryData::deletePreview()
     if (dir.dirName() == QLatin1String("preview")) {
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
+        CacheUsage::get()->clear(CachePreview);
         emit disablePreview();
         updateDataInfo();
     }
@@ -495,6 +460,7 @@ void TemporaryData::deleteAudio()
     if (dir.dirName() == QLatin1String("audiothumbs")) {
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
+        CacheUsage::get()->clear(CacheAudio);
         updateDataInfo();
     }
 }
@@ -512,6 +478,7 @@ void TemporaryData::deleteThumbs()
     if (dir.dirName() == QLatin1String("videothumbs")) {
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
+        CacheUsage::get()->clear(CacheThumbs);
         updateDataInfo();
     }
 }
@@ -531,6 +498,7 @@ void TemporaryData::deleteCurrentCacheData()
         emit disableProxies();
         dir.removeRecursively();
         m_doc->initCacheDirs();
+        CacheUsage::get()->clear(CacheBase);
         updateDataInfo();
     }
 }
@@ -724,6 +692,23 @@ void TemporaryData::buildGlobalCacheDialog(int minHeight)
     });
     hLay->addWidget(age);
     lay->addLayout(hLay);
+
+    // Config maximum cache size
+    hLay = new QHBoxLayout;
+    hLay->addWidget(new QLabel(i18n("Maximum cache size"), this));
+    QSpinBox *maxSize = new QSpinBox(this);
+    maxSize->setRange(0, 1000000);
+    maxSize->setSingleStep(100);
+    maxSize->setSuffix(i18n(" MB"));
+    maxSize->setSpecialValueText(i18n("Unlimited"));
+    maxSize->setToolTip(i18n("When the cache grows over this size, the data of the least recently used projects is deleted"));
+    maxSize->setValue(KdenliveSettings::maxcachesize());
+    connect(maxSize, &QSpinBox::editingFinished, [maxSize]() {
+        KdenliveSettings::setMaxcachesize(maxSize->value());
+        CacheUsage::get()->enforceLimit();
+    });
+    hLay->addWidget(maxSize);
+    lay->addLayout(hLay);
     lay->addStretch(10);
 
     processBackupDirectories();
@@ -758,12 +743,20 @@ void TemporaryData::updateGlobalInfo()
 
 void TemporaryData::processglobalDirectories()
 {
-    if (m_globalDirectories.isEmpty()) {
-        return;
+    while (!m_globalDirectories.isEmpty()) {
+        m_processingDirectory = m_globalDirectories.takeFirst();
+        QDateTime lastUsed;
+        qint64 stored = CacheUsage::storedUsage(QDir(m_globalDir.absoluteFilePath(m_processingDirectory)), &lastUsed);
+        if (stored < 0) {
+            KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(m_globalDir.absoluteFilePath(m_processingDirectory)));
+            connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotFolderSize);
+            return;
+        }
+        // Project folders with tracked usage don't need to be walked
+        addFolderItem(KIO::filesize_t(stored), lastUsed);
     }
-    m_processingDirectory = m_globalDirectories.takeFirst();
-    KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(m_globalDir.absoluteFilePath(m_processingDirectory)));
-    connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotFolderSize);
+    m_globalSize->setText(KIO::convertSize(m_totalGlobal));
+    m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
 }
 
 void TemporaryData::gotFolderSize(KJob *job)
@@ -773,6 +766,12 @@ void TemporaryData::gotFolderSize(KJob *job)
     if (sourceJob->totalFiles() == 0) {
         total = 0;
     }
+    addFolderItem(total, QFileInfo(m_globalDir.absoluteFilePath(m_processingDirectory)).lastModified());
+    processglobalDirectories();
+}
+
+void TemporaryData::addFolderItem(KIO::filesize_t total, const QDateTime &date)
+{
     m_totalGlobal += total;
     auto *item = new TreeWidgetItem(m_listWidget);
     // Check last save path for this cache folder
@@ -798,19 +797,12 @@ void TemporaryData::gotFolderSize(KJob *job)
     }
     item->setData(0, Qt::UserRole, m_processingDirectory);
     item->setText(1, KIO::convertSize(total));
-    QDateTime date = QFileInfo(dir.absolutePath()).lastModified();
     item->setText(2, date.toString(Qt::SystemLocaleShortDate));
     item->setData(1, Qt::UserRole, total);
     item->setData(2, Qt::UserRole, date);
     m_listWidget->addTopLevelItem(item);
     m_listWidget->resizeColumnToContents(0);
     m_listWidget->resizeColumnToContents(1);
-    if (m_globalDirectories.isEmpty()) {
-        m_globalSize->setText(KIO::convertSize(m_totalGlobal));
-        m_listWidget->setCurrentItem(m_listWidget->topLevelItem(0));
-    } else {
-        processglobalDirectories();
-    }
 }
 
 void TemporaryData::refreshGlobalPie()
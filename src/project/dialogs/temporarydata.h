@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "definitions.h"
 #include <KIO/DirectorySizeJob>
+#include <QDateTime>
 #include <QDir>
 #include <QTreeWidgetItem>
 #include <QWidget>
@@ -131,12 +132,12 @@ private:
     void processglobalDirectories();
     void processBackupDirectories();
     void processProxyDirectory();
+    /** @brief Display the size of a cache folder of the current project, using the tracked usage when available */
+    void computeCacheSize(CacheType type, int row);
+    void updateCurrentSize(int row, KIO::filesize_t total);
+    void addFolderItem(KIO::filesize_t total, const QDateTime &date);
 
 private slots:
-    void gotPreviewSize(KJob *job);
-    void gotProxySize(KIO::filesize_t total);
-    void gotAudioSize(KJob *job);
-    void gotThumbSize(KJob *job);
     void gotFolderSize(KJob *job);
     void gotBackupSize(KJob *job);
     void gotProjectProxySize(KJob *job);
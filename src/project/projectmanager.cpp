@@ -17,11 +17,15 @@ the Free Software Foundation, either version 3 of the License, or
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
 #include "monitor/monitormanager.h"
+#include "monitor/refreshscheduler.h"
 #include "profiles/profilemodel.hpp"
 #include "project/dialogs/archivewidget.h"
 #include "project/dialogs/backupwidget.h"
 #include "project/dialogs/noteswidget.h"
 #include "project/dialogs/projectsettings.h"
+#include "utils/cacheusage.hpp"
+#include "utils/fingerprintcache.hpp"
+#include "utils/startupprofiler.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
 
@@ -49,10 +53,32 @@ the Free Software Foundation, either version 3 of the License, or
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QProgressDialog>
+#include <QTemporaryFile>
 #include <QTimeZone>
 #include <audiomixer/mixermanager.hpp>
 #include <lib/localeHandling.h>
 
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+/** @brief Returns the peak resident memory of the process in KB, or -1 if unknown */
+static qint64 peakMemoryUsage()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+        // Reported in bytes on macOS
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
 static QString getProjectNameFilters(bool ark=true) {
     auto filter = i18n("Kdenlive project (*.kdenlive)");
     if (ark) {
@@ -103,6 +129,7 @@ ProjectManager::~ProjectManager() = default;
 
 void ProjectManager::slotLoadOnOpen()
 {
+    std::unique_ptr<StartupProfiler::Phase> phase(new StartupProfiler::Phase(QStringLiteral("Open project")));
     m_loading = true;
     if (m_startUrl.isValid()) {
         openFile();
@@ -125,6 +152,9 @@ void ProjectManager::slotLoadOnOpen()
     m_loadClipsOnOpen.clear();
     m_loading = false;
     emit pCore->closeSplash();
+    // Startup is over once the project is loaded
+    phase.reset();
+    StartupProfiler::get()->finish();
 }
 
 void ProjectManager::init(const QUrl &projectUrl, const QString &clipList)
@@ -267,6 +297,9 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
     ::mlt_pool_purge();
     pCore->audioThumbCache.clear();
     pCore->jobManager()->slotCancelJobs();
+    CacheUsage::get()->save();
+    // Pending refreshes and invalidations target items of the closed timeline
+    pCore->refreshScheduler()->clear();
     disconnect(pCore->window()->getMainTimeline()->controller(), &TimelineController::durationChanged, this, &ProjectManager::adjustProjectDuration);
     pCore->window()->getMainTimeline()->controller()->clipActions.clear();
     pCore->window()->getMainTimeline()->controller()->prepareClose();
@@ -293,22 +326,31 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveACopy)
     pCore->monitorManager()->pauseActiveMonitor();
     // Sync document properties
     prepareSave();
+    QElapsedTimer saveTimer;
+    saveTimer.start();
+    qint64 peakMemory = peakMemoryUsage();
     QString saveFolder = QFileInfo(outputFileName).absolutePath();
-    QString scene = projectSceneList(saveFolder);
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
+    // MLT writes its xml directly to a temporary file, which is then patched while copied to the project file
+    QTemporaryFile tmpFile(saveFolder + QStringLiteral("/kdenlive-XXXXXX.mlt"));
+    if (!tmpFile.open()) {
+        KMessageBox::error(qApp->activeWindow(), i18n("Cannot write to file %1", tmpFile.fileTemplate()));
+        return false;
     }
-    if (!m_project->saveSceneList(outputFileName, scene)) {
+    tmpFile.close();
+    projectSceneList(saveFolder, tmpFile.fileName());
+    if (!tmpFile.open() || !m_project->saveSceneList(outputFileName, &tmpFile, m_replacementPattern)) {
         return false;
     }
+    tmpFile.close();
+    qint64 savePeakMemory = peakMemoryUsage();
+    qCDebug(KDENLIVE_LOG) << "// Project saved in " << saveTimer.elapsed() << "ms, peak memory: " << savePeakMemory << "KB, increased by "
+                          << (savePeakMemory - peakMemory) << "KB during save";
     QUrl url = QUrl::fromLocalFile(outputFileName);
     // Save timeline thumbnails
     QStringList thumbKeys = pCore->window()->getMainTimeline()->controller()->getThumbKeys();
     ThumbnailCache::get()->saveCachedThumbs(thumbKeys);
+    FingerprintCache::get()->save();
+    CacheUsage::get()->save();
     if (!saveACopy) {
         m_project->setUrl(url);
         // setting up autosave file in ~/.kde/data/stalefiles/kdenlive/
@@ -690,7 +732,7 @@ void ProjectManager::slotAutoSave()
     m_lastSave.start();
 }
 
-QString ProjectManager::projectSceneList(const QString &outputFolder)
+QString ProjectManager::projectSceneList(const QString &outputFolder, const QString &fullPath)
 {
     // Disable multitrack view and overlay
     bool isMultiTrack = pCore->monitorManager()->isMultiTrack();
@@ -702,7 +744,7 @@ QString ProjectManager::projectSceneList(const QString &outputFolder)
         pCore->window()->getMainTimeline()->controller()->updatePreviewConnection(false);
     }
     pCore->mixer()->pauseMonitoring(true);
-    QString scene = pCore->monitorManager()->projectMonitor()->sceneList(outputFolder);
+    QString scene = pCore->monitorManager()->projectMonitor()->sceneList(outputFolder, fullPath);
     pCore->mixer()->pauseMonitoring(false);
     if (isMultiTrack) {
         pCore->window()->getMainTimeline()->controller()->slotMultitrackView(true, false);
@@ -931,6 +973,8 @@ bool ProjectManager::updateTimeline(int pos, int scrollPos)
         pCore->window()->getMainTimeline()->controller()->setActiveTrack(m_mainTimelineModel->getTrackIndexFromPosition(activeTrackPosition));
     }
     m_mainTimelineModel->setUndoStack(m_project->commandStack());
+    // Keep the hashes computed while loading clips
+    FingerprintCache::get()->save();
 
     // Reset locale to C to ensure numbers are serialised correctly
     LocaleHandling::resetLocale();
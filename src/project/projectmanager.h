@@ -64,8 +64,8 @@ public:
     void prepareSave();
     /** @brief Disable all bin effects in current project */
     void disableBinEffects(bool disable);
-    /** @brief Returns current project's xml scene */
-    QString projectSceneList(const QString &outputFolder);
+    /** @brief Returns current project's xml scene, or writes it to fullPath if not empty */
+    QString projectSceneList(const QString &outputFolder, const QString &fullPath = QString());
     /** @brief returns a default hd profile depending on timezone*/
     static QString getDefaultProjectFormat();
     void saveZone(const QStringList &info, const QDir &dir);
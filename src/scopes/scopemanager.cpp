@@ -298,20 +298,32 @@ void ScopeManager::checkActiveColourScopes()
 
 void ScopeManager::createScopes()
 {
-    createScopeDock(new Vectorscope(pCore->window()), i18n("Vectorscope"), QStringLiteral("vectorscope"));
-    createScopeDock(new Waveform(pCore->window()), i18n("Waveform"), QStringLiteral("waveform"));
-    createScopeDock(new RGBParade(pCore->window()), i18n("RGB Parade"), QStringLiteral("rgb_parade"));
-    createScopeDock(new Histogram(pCore->window()), i18n("Histogram"), QStringLiteral("histogram"));
+    createScopeDock<Vectorscope>(i18n("Vectorscope"), QStringLiteral("vectorscope"));
+    createScopeDock<Waveform>(i18n("Waveform"), QStringLiteral("waveform"));
+    createScopeDock<RGBParade>(i18n("RGB Parade"), QStringLiteral("rgb_parade"));
+    createScopeDock<Histogram>(i18n("Histogram"), QStringLiteral("histogram"));
     // Deprecated scopes
     // createScopeDock(new Spectrogram(pCore->window()),   i18n("Spectrogram"));
     // createScopeDock(new AudioSignal(pCore->window()),   i18n("Audio Signal"));
     // createScopeDock(new AudioSpectrum(pCore->window()), i18n("AudioSpectrum"));
 }
 
-template <class T> void ScopeManager::createScopeDock(T *scopeWidget, const QString &title, const QString &name)
+template <class T> void ScopeManager::createScopeDock(const QString &title, const QString &name)
 {
-    QDockWidget *dock = pCore->window()->addDock(title, name, scopeWidget);
-    addScope(scopeWidget, dock);
+    // Scopes are hidden on startup, create them on first use
+    QDockWidget *dock = pCore->window()->addDock(title, name, new QWidget(pCore->window()));
+    connect(dock, &QDockWidget::visibilityChanged, this, [this, dock](bool visible) {
+        if (!visible || dynamic_cast<T *>(dock->widget()) != nullptr) {
+            return;
+        }
+        QWidget *placeholder = dock->widget();
+        auto *scopeWidget = new T(pCore->window());
+        dock->setWidget(scopeWidget);
+        delete placeholder;
+        addScope(scopeWidget, dock);
+        slotCheckActiveScopes();
+        slotRequestFrame(scopeWidget->widgetName());
+    });
 
     // close for initial layout
     // actual state will be restored by session management
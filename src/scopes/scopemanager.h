@@ -93,11 +93,11 @@ private:
     void createScopes();
 
     /**
-      Creates a dock for @param scopeWidget with the title @param title and
-      adds it to the manager.
-      @param scopeWidget has to be of type AbstractAudioScopeWidget or AbstractGfxScopeWidget (@see addScope).
+      Creates a dock with the title @param title. The scope widget of type T is only created
+      and added to the manager when the dock is shown for the first time.
+      T has to be of type AbstractAudioScopeWidget or AbstractGfxScopeWidget (@see addScope).
      */
-    template <class T> void createScopeDock(T *scopeWidget, const QString &title, const QString &name);
+    template <class T> void createScopeDock(const QString &title, const QString &name);
 
 public slots:
     void slotCheckActiveScopes();
@@ -22,9 +22,11 @@
 #include "doc/docundostack.hpp"
 #include "doc/kdenlivedoc.h"
 #include "kdenlivesettings.h"
+#include "lib/renderprogress.h"
 #include "monitor/monitor.h"
 #include "profiles/profilemodel.hpp"
 #include "timeline2/view/timelinecontroller.h"
+#include "utils/cacheusage.hpp"
 
 #include <KLocalizedString>
 #include <QProcess>
@@ -60,19 +62,23 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
     }
     connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
     connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
+    connect(&m_previewProcess, &QProcess::readyReadStandardOutput, this, &PreviewManager::receivedProgress);
+    connect(&m_profileProcess, &QProcess::readyReadStandardOutput, this, &PreviewManager::receivedProfileProgress);
+    QObject::connect(&m_profileProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::profileEnded);
 }
 
 PreviewManager::~PreviewManager()
 {
+    abortProfiling();
     if (m_initialized) {
         abortRendering();
         if (m_undoDir.dirName() == QLatin1String("undo")) {
-            m_undoDir.removeRecursively();
+            CacheUsage::get()->removeFolder(CachePreview, m_undoDir);
         }
         if ((pCore->currentDoc()->url().isEmpty() && m_cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).isEmpty()) ||
             m_cacheDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
             if (m_cacheDir.dirName() == QLatin1String("preview")) {
-                m_cacheDir.removeRecursively();
+                CacheUsage::get()->removeFolder(CachePreview, m_cacheDir);
             }
         }
     }
@@ -154,7 +160,7 @@ void PreviewManager::loadChunks(QVariantList previewChunks, QVariantList dirtyCh
         if (file.exists()) {
             if (!documentDate.isNull() && QFileInfo(file).lastModified() > documentDate) {
                 // Timeline preview file was created after document, invalidate
-                file.remove();
+                CacheUsage::get()->removeFile(CachePreview, fileName);
                 dirtyChunks << frame;
             } else {
                 gotPreviewRender(frame.toInt(), fileName, 1000);
@@ -362,10 +368,11 @@ void PreviewManager::invalidatePreviews(const QVariantList chunks)
         for (const auto &i : chunks) {
             QString cacheFileName = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
             if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
+                CacheUsage::get()->removeFile(CachePreview, m_cacheDir.absoluteFilePath(cacheFileName));
             }
             if (moveFile) {
                 if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
+                    CacheUsage::get()->fileWritten(CachePreview, m_cacheDir.absoluteFilePath(cacheFileName));
                     foundChunks << i;
                     m_dirtyChunks.removeAll(i);
                     m_renderedChunks << i;
@@ -404,7 +411,7 @@ void PreviewManager::doCleanupOldPreviews()
         QString dirName = dirs.takeFirst();
         dirName.toInt(&ok);
         if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
+            CacheUsage::get()->removeFolder(CachePreview, tmp);
         }
     }
 }
@@ -416,7 +423,7 @@ void PreviewManager::clearPreviewRange(bool resetZones)
     m_tractor->lock();
     bool hasPreview = m_previewTrack != nullptr;
     for (const auto &ix : qAsConst(m_renderedChunks)) {
-        m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+        CacheUsage::get()->removeFile(CachePreview, m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension)));
         if (!m_dirtyChunks.contains(ix)) {
             m_dirtyChunks << ix;
         }
@@ -439,6 +446,8 @@ void PreviewManager::clearPreviewRange(bool resetZones)
     if (resetZones) {
         m_dirtyChunks.clear();
     }
+    m_renderCost.clear();
+    emit m_controller->renderCostsChanged();
     emit m_controller->renderedChunksChanged();
     emit m_controller->dirtyChunksChanged();
 }
@@ -479,7 +488,7 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         m_tractor->lock();
         bool hasPreview = m_previewTrack != nullptr;
         for (int ix : qAsConst(toRemove)) {
-            m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix).arg(m_extension));
+            CacheUsage::get()->removeFile(CachePreview, m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix).arg(m_extension)));
             if (!hasPreview) {
                 continue;
             }
@@ -539,22 +548,42 @@ void PreviewManager::startPreviewRender()
 
 void PreviewManager::receivedStderr()
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'));
-    for (auto &result : resultList) {
-        qDebug() << "GOT PROCESS RESULT: " << result;
-        if (result.startsWith(QLatin1String("START:"))) {
-            workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
-            qDebug() << "// GOT START INFO: " << workingPreview;
+    m_errorLog.append(QString::fromLocal8Bit(m_previewProcess.readAllStandardError()));
+}
+
+void PreviewManager::receivedProgress()
+{
+    RenderProgress::Record record;
+    while (m_previewProcess.canReadLine()) {
+        if (!RenderProgress::parse(m_previewProcess.readLine(), record)) {
+            continue;
+        }
+        switch (record.event) {
+        case RenderProgress::Event::ChunkStarted:
+            workingPreview = record.frame;
             emit m_controller->workingPreviewChanged();
-        } else if (result.startsWith(QLatin1String("DONE:"))) {
-            int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            break;
+        case RenderProgress::Event::ChunkDone: {
             m_processedChunks++;
-            QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
-            qDebug() << "---------------\nJOB PROGRRESS: " << m_chunksToRender << ", " << m_processedChunks << " = "
-                     << (100 * m_processedChunks / m_chunksToRender);
-            emit previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
-        } else {
-            m_errorLog.append(result);
+            QString fileName = QStringLiteral("%1.%2").arg(record.frame).arg(m_extension);
+            CacheUsage::get()->fileWritten(CachePreview, m_cacheDir.absoluteFilePath(fileName));
+            if (record.frames > 0) {
+                qCDebug(KDENLIVE_LOG) << "// Preview chunk" << record.frame << "rendered at" << record.fps << "fps, stages:" << record.stages;
+                qint64 time = 0;
+                for (qint64 stage : qAsConst(record.stages)) {
+                    time += stage;
+                }
+                m_renderCost.addChunk(record.frame, record.frames, time);
+                emit m_controller->renderCostsChanged();
+            }
+            emit previewRender(record.frame, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
+            break;
+        }
+        case RenderProgress::Event::Failed:
+            m_errorLog.append(record.message);
+            break;
+        default:
+            break;
         }
     }
 }
@@ -568,22 +597,9 @@ void PreviewManager::doPreviewRender(const QString &scene)
     }
     Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
 
-    QStringList chunks;
-    for (QVariant &frame : m_dirtyChunks) {
-        chunks << frame.toString();
-    }
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
-    int chunkSize = KdenliveSettings::timelinechunks();
-    QStringList args{KdenliveSettings::rendererpath(),
-                     scene,
-                     m_cacheDir.absolutePath(),
-                     QStringLiteral("-split"),
-                     chunks.join(QLatin1Char(',')),
-                     QString::number(chunkSize - 1),
-                     pCore->getCurrentProfilePath(),
-                     m_extension,
-                     m_consumerParams.join(QLatin1Char(' '))};
+    const QStringList args = renderArgs(scene, m_cacheDir.absolutePath(), m_dirtyChunks);
     qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
     pCore->currentDoc()->previewProgress(0);
     m_previewProcess.start(m_renderer, args);
@@ -592,6 +608,111 @@ void PreviewManager::doPreviewRender(const QString &scene)
     }
 }
 
+QStringList PreviewManager::renderArgs(const QString &scene, const QString &folder, const QVariantList &chunks) const
+{
+    QStringList frames;
+    for (const QVariant &frame : chunks) {
+        frames << frame.toString();
+    }
+    int chunkSize = KdenliveSettings::timelinechunks();
+    return {KdenliveSettings::rendererpath(),
+            scene,
+            folder,
+            QStringLiteral("-split"),
+            frames.join(QLatin1Char(',')),
+            QString::number(chunkSize - 1),
+            pCore->getCurrentProfilePath(),
+            m_extension,
+            m_consumerParams.join(QLatin1Char(' '))};
+}
+
+bool PreviewManager::profileRenderCost()
+{
+    if (m_profileProcess.state() != QProcess::NotRunning) {
+        return true;
+    }
+    QVariantList chunks = m_renderedChunks + m_dirtyChunks;
+    if (chunks.isEmpty()) {
+        return false;
+    }
+    std::sort(chunks.begin(), chunks.end(), [](const QVariant &a, const QVariant &b) { return a.toInt() < b.toInt(); });
+    // Measured chunks are written to a temporary folder, the preview cache is left untouched
+    m_profileDir.reset(new QTemporaryDir(QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-cost-XXXXXX"))));
+    if (!m_profileDir->isValid()) {
+        pCore->displayMessage(i18n("Cannot create temporary folder %1", m_profileDir->path()), ErrorMessage);
+        m_profileDir.reset();
+        return true;
+    }
+    const QString sceneList = QDir(m_profileDir->path()).absoluteFilePath(QStringLiteral("preview.mlt"));
+    // The rendered previews must not replace the timeline in the measured scene
+    m_tractor->lock();
+    int previewHide = m_previewTrack ? m_previewTrack->get_int("hide") : 0;
+    int overlayHide = m_overlayTrack ? m_overlayTrack->get_int("hide") : 0;
+    if (m_previewTrack) {
+        m_previewTrack->set("hide", 3);
+    }
+    if (m_overlayTrack) {
+        m_overlayTrack->set("hide", 3);
+    }
+    pCore->getMonitor(Kdenlive::ProjectMonitor)->sceneList(m_cacheDir.absolutePath(), sceneList);
+    if (m_previewTrack) {
+        m_previewTrack->set("hide", previewHide);
+    }
+    if (m_overlayTrack) {
+        m_overlayTrack->set("hide", overlayHide);
+    }
+    m_tractor->unlock();
+    pCore->currentDoc()->saveMltPlaylist(sceneList);
+    m_renderCost.clear();
+    emit m_controller->renderCostsChanged();
+    m_profileProcess.start(m_renderer, renderArgs(sceneList, m_profileDir->path(), chunks));
+    return true;
+}
+
+void PreviewManager::abortProfiling()
+{
+    // Without its folder, the ended process is not reported as a failure
+    m_profileDir.reset();
+    if (m_profileProcess.state() != QProcess::NotRunning) {
+        m_profileProcess.kill();
+        m_profileProcess.waitForFinished();
+    }
+}
+
+void PreviewManager::receivedProfileProgress()
+{
+    RenderProgress::Record record;
+    while (m_profileProcess.canReadLine()) {
+        if (!RenderProgress::parse(m_profileProcess.readLine(), record) || record.event != RenderProgress::Event::ChunkDone || record.frames <= 0) {
+            continue;
+        }
+        qint64 time = 0;
+        for (qint64 stage : qAsConst(record.stages)) {
+            time += stage;
+        }
+        m_renderCost.addChunk(record.frame, record.frames, time);
+        emit m_controller->renderCostsChanged();
+        // Only the time is needed
+        if (m_profileDir) {
+            QFile::remove(QDir(m_profileDir->path()).absoluteFilePath(QStringLiteral("%1.%2").arg(record.frame).arg(m_extension)));
+        }
+    }
+}
+
+void PreviewManager::profileEnded(int exitCode, QProcess::ExitStatus status)
+{
+    if (!m_profileDir) {
+        // Aborted
+        return;
+    }
+    m_profileDir.reset();
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        pCore->displayMessage(i18n("Render cost measure failed"), ErrorMessage);
+    } else {
+        pCore->displayMessage(i18n("Render cost measured"), InformationMessage);
+    }
+}
+
 void PreviewManager::processEnded(int, QProcess::ExitStatus status)
 {
     qDebug() << "// PROCESS IS FINISHED!!!";
@@ -603,6 +724,7 @@ void PreviewManager::processEnded(int, QProcess::ExitStatus status)
         if (workingPreview >= 0) {
             const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
+                // Chunk was not accounted yet
                 m_cacheDir.remove(fileName);
             }
         }
@@ -637,7 +759,7 @@ void PreviewManager::slotRemoveInvalidUndo(int ix)
         if (dir.toInt(&ok) >= ix && ok) {
             QDir tmp = m_undoDir;
             if (tmp.cd(dir)) {
-                tmp.removeRecursively();
+                CacheUsage::get()->removeFolder(CachePreview, tmp);
             }
         }
     }
@@ -674,6 +796,15 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
         }
     }
     m_tractor->unlock();
+    if (m_profileDir) {
+        // The measured scene is outdated
+        abortProfiling();
+    }
+    if (!m_renderCost.isEmpty()) {
+        // Measures of the modified chunks are outdated
+        m_renderCost.invalidate(start, end + chunkSize - 1);
+        emit m_controller->renderCostsChanged();
+    }
     if (chunksChanged) {
         m_previewTrack->consolidate_blanks();
         emit m_controller->renderedChunksChanged();
@@ -757,7 +888,7 @@ void PreviewManager::corruptedChunk(int frame, const QString &fileName)
         emit m_controller->workingPreviewChanged();
     }
     emit previewRender(0, m_errorLog, -1);
-    m_cacheDir.remove(fileName);
+    CacheUsage::get()->removeFile(CachePreview, fileName);
     if (!m_dirtyChunks.contains(frame)) {
         m_dirtyChunks << frame;
         std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end());
@@ -792,6 +923,53 @@ QPair<QStringList, QStringList> PreviewManager::previewChunks() const
     return {renderedChunks, dirtyChunks};
 }
 
+QList<int> PreviewManager::reusableChunks(int in, int out, const QDomElement &consumer) const
+{
+    QList<int> chunks;
+    if (m_consumerParams.isEmpty() || QFileInfo(consumer.attribute(QStringLiteral("target"))).suffix() != m_extension) {
+        return chunks;
+    }
+    // Properties that don't change the encoded video stream
+    auto isIgnored = [](const QString &name) {
+        static const QStringList ignored = {QStringLiteral("mlt_service"), QStringLiteral("target"),   QStringLiteral("in"),
+                                            QStringLiteral("out"),         QStringLiteral("an"),       QStringLiteral("threads"),
+                                            QStringLiteral("real_time"),   QStringLiteral("glsl."),    QStringLiteral("channels"),
+                                            QStringLiteral("acodec"),      QStringLiteral("ab"),       QStringLiteral("aq"),
+                                            QStringLiteral("ar"),          QStringLiteral("ac"),       QStringLiteral("terminate_on_pause")};
+        return ignored.contains(name) || name.startsWith(QLatin1String("meta."));
+    };
+    QMap<QString, QString> previewParams;
+    for (const QString &param : m_consumerParams) {
+        const QString name = param.section(QLatin1Char('='), 0, 0);
+        if (!isIgnored(name)) {
+            previewParams.insert(name, param.section(QLatin1Char('='), 1));
+        }
+    }
+    QMap<QString, QString> renderParams;
+    QDomNamedNodeMap attributes = consumer.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        QDomAttr attr = attributes.item(i).toAttr();
+        if (!isIgnored(attr.name())) {
+            renderParams.insert(attr.name(), attr.value());
+        }
+    }
+    if (previewParams != renderParams) {
+        return chunks;
+    }
+    int chunkSize = KdenliveSettings::timelinechunks();
+    for (const QVariant &frame : m_renderedChunks) {
+        int pos = frame.toInt();
+        if (pos < in || pos + chunkSize - 1 > out || pos == workingPreview || m_dirtyChunks.contains(frame)) {
+            continue;
+        }
+        if (m_cacheDir.exists(QStringLiteral("%1.%2").arg(pos).arg(m_extension))) {
+            chunks << pos;
+        }
+    }
+    std::sort(chunks.begin(), chunks.end());
+    return chunks;
+}
+
 bool PreviewManager::hasOverlayTrack() const
 {
     return m_overlayTrack != nullptr;
@@ -21,12 +21,16 @@
 #define PREVIEWMANAGER_H
 
 #include "definitions.h"
+#include "utils/rendercost.hpp"
 
 #include <QDir>
+#include <QDomElement>
 #include <QFuture>
 #include <QMutex>
 #include <QProcess>
+#include <QTemporaryDir>
 #include <QTimer>
+#include <memory>
 
 class TimelineController;
 
@@ -88,6 +92,14 @@ public:
     int workingPreview;
     /** @brief Returns the list of existing chunks */
     QPair<QStringList, QStringList> previewChunks() const;
+    /** @brief Returns the up to date chunks lying in the in/out range that can be copied into a render using this consumer,
+     *  or an empty list if the render parameters differ from the preview parameters */
+    QList<int> reusableChunks(int in, int out, const QDomElement &consumer) const;
+    /** @brief: Render the preview zones into a temporary folder to measure the render time of each chunk.
+     *  Existing previews are kept. Returns false if there is no preview zone */
+    bool profileRenderCost();
+    /** @brief: Stop measuring the render cost */
+    void abortProfiling();
     bool hasOverlayTrack() const;
     bool hasPreviewTrack() const;
     int addedTracks() const;
@@ -122,6 +134,13 @@ private:
     int m_processedChunks;
     /** @brief: The render process output, useful in case of failure */
     QString m_errorLog;
+    /** @brief: The time spent rendering each chunk, shown as a heatmap on the ruler */
+    RenderCost m_renderCost;
+    /** @brief: The render process measuring the render cost, and its temporary chunk folder */
+    QProcess m_profileProcess;
+    std::unique_ptr<QTemporaryDir> m_profileDir;
+    /** @brief: Arguments of the kdenlive_render process rendering chunks of a scene into a folder */
+    QStringList renderArgs(const QString &scene, const QString &folder, const QVariantList &chunks) const;
     /** @brief: After an undo/redo, if we have preview history, use it. */
     void reloadChunks(const QVariantList chunks);
     /** @brief: A chunk failed to render, abort. */
@@ -140,9 +159,14 @@ private slots:
     void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
-    /** @brief: Process preview rendering output. */
+    /** @brief: Collect the preview rendering errors. */
     void receivedStderr();
+    /** @brief: Process the progress records written by the preview rendering. */
+    void receivedProgress();
     void processEnded(int, QProcess::ExitStatus status);
+    /** @brief: Store the chunk times of the render cost measure. */
+    void receivedProfileProgress();
+    void profileEnded(int, QProcess::ExitStatus status);
 
 public slots:
     /** @brief: Prepare and start rendering. */
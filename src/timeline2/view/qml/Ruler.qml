@@ -94,6 +94,39 @@ Item {
         visible: rulerRoot.workingPreview > -1
     }
 
+    // Approximate preview render cost, from green (cheap) to red (most expensive chunk)
+    Repeater {
+        model: timeline.renderCosts
+        anchors.fill: parent
+        delegate: Rectangle {
+            x: modelData.frame * timeline.scaleFactor
+            y: 0
+            width: modelData.frames * timeline.scaleFactor
+            height: parent.height / 4
+            color: Qt.hsla((1 - modelData.level) / 3, 1, 0.45, 1)
+            MouseArea {
+                id: costArea
+                anchors.fill: parent
+                hoverEnabled: true
+                acceptedButtons: Qt.NoButton
+            }
+            ToolTip {
+                visible: costArea.containsMouse
+                delay: 1000
+                timeout: 5000
+                background: Rectangle {
+                    color: activePalette.alternateBase
+                    border.color: activePalette.light
+                }
+                contentItem: Label {
+                    color: activePalette.text
+                    font: miniFont
+                    text: i18n("Approximate render cost: %1 ms per frame", modelData.cost.toFixed(1))
+                }
+            }
+        }
+    }
+
     // Ruler marks
     Repeater {
         id: tickRepeater
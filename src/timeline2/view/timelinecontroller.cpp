@@ -120,6 +120,12 @@ void TimelineController::setModel(std::shared_ptr<TimelineItemModel> model)
     });
     connect(m_model.get(), &TimelineItemModel::requestMonitorRefresh, [&]() { pCore->requestMonitorRefresh(); });
     connect(m_model.get(), &TimelineModel::invalidateZone, this, &TimelineController::invalidateZone, Qt::DirectConnection);
+    connect(m_model.get(), &QAbstractItemModel::dataChanged, this, [](const QModelIndex &, const QModelIndex &, const QVector<int> &roles) {
+        // Selection does not change the rendered frames
+        if (roles.size() != 1 || roles.first() != TimelineModel::SelectedRole) {
+            pCore->getMonitor(Kdenlive::ProjectMonitor)->invalidateFrameCache();
+        }
+    });
     connect(m_model.get(), &TimelineModel::durationUpdated, this, &TimelineController::checkDuration);
     connect(m_model.get(), &TimelineModel::selectionChanged, this, &TimelineController::selectionChanged);
     connect(m_model.get(), &TimelineModel::checkTrackDeletion, this, &TimelineController::checkTrackDeletion, Qt::DirectConnection);
@@ -1106,6 +1112,30 @@ void TimelineController::showTrackAsset(int trackId)
     emit showItemEffectStack(getTrackNameFromIndex(trackId), m_model->getTrackEffectStackModel(trackId), pCore->getCurrentFrameSize(), false);
 }
 
+QStringList TimelineController::activeClipsInfo(int position) const
+{
+    QStringList result;
+    auto it = m_model->m_allTracks.cbegin();
+    while (it != m_model->m_allTracks.cend()) {
+        int tid = (*it)->getId();
+        ++it;
+        if (m_model->getTrackById_const(tid)->isHidden()) {
+            continue;
+        }
+        int cid = m_model->getClipByPosition(tid, position);
+        if (cid == -1) {
+            continue;
+        }
+        QString info = QStringLiteral("%1: %2").arg(m_model->getTrackTagById(tid), m_model->m_allClips.at(cid)->clipName());
+        const QString effects = m_model->m_allClips.at(cid)->effectNames();
+        if (!effects.isEmpty()) {
+            info.append(QStringLiteral(" (%1)").arg(effects));
+        }
+        result << info;
+    }
+    return result;
+}
+
 void TimelineController::adjustAllTrackHeight(int trackId, int height)
 {
     bool isAudio = m_model->getTrackById_const(trackId)->isAudioTrack();
@@ -1477,10 +1507,8 @@ bool TimelineController::positionIsInItem(int id)
     if (in > position) {
         return false;
     }
-    if (position <= in + m_model->getItemPlaytime(id)) {
-        return true;
-    }
-    return false;
+    // The item's last frame is in + playtime - 1
+    return position < in + m_model->getItemPlaytime(id);
 }
 
 void TimelineController::refreshItem(int id)
@@ -1766,6 +1794,64 @@ QVariantList TimelineController::renderedChunks() const
     return m_timelinePreview ? m_timelinePreview->m_renderedChunks : QVariantList();
 }
 
+QVariantList TimelineController::renderCosts() const
+{
+    if (!KdenliveSettings::showrendercost() || !m_timelinePreview) {
+        return QVariantList();
+    }
+    return m_timelinePreview->m_renderCost.heatmap();
+}
+
+bool TimelineController::profileRenderCost()
+{
+    return m_timelinePreview && m_timelinePreview->profileRenderCost();
+}
+
+QStringList TimelineController::renderCostReport(int count) const
+{
+    QStringList result;
+    if (!m_timelinePreview || m_timelinePreview->m_renderCost.isEmpty()) {
+        return result;
+    }
+    // Timeline preview is rendered without audio, only visible video items are charged
+    QVector<RenderCost::Item> items;
+    for (const auto &clp : m_model->m_allClips) {
+        int tid = clp.second->getCurrentTrackId();
+        if (tid == -1 || clp.second->isAudioOnly() || m_model->getTrackById_const(tid)->isAudioTrack() ||
+            m_model->getTrackById_const(tid)->isHidden()) {
+            continue;
+        }
+        QString info = QStringLiteral("%1: %2").arg(m_model->getTrackTagById(tid), clp.second->clipName());
+        const QString effects = clp.second->effectNames();
+        if (!effects.isEmpty()) {
+            info.append(QStringLiteral(" (%1)").arg(effects));
+        }
+        items.append({clp.first, info, clp.second->getPosition(), clp.second->getPlaytime()});
+    }
+    for (const auto &compo : m_model->m_allCompositions) {
+        int tid = compo.second->getCurrentTrackId();
+        if (tid == -1) {
+            continue;
+        }
+        const QString info = QStringLiteral("%1: %2").arg(m_model->getTrackTagById(tid), compo.second->displayName());
+        items.append({compo.first, info, compo.second->getPosition(), compo.second->getPlaytime()});
+    }
+    const QVector<RenderCost::ItemCost> costs = m_timelinePreview->m_renderCost.attribute(items);
+    for (const RenderCost::ItemCost &cost : costs) {
+        if (result.count() >= count) {
+            break;
+        }
+        result << i18n("%1: %2 s, %3 ms per frame", cost.name, QString::number(cost.time / 1000., 'f', 1),
+                       QString::number(cost.time / cost.frames, 'f', 1));
+    }
+    return result;
+}
+
+QList<int> TimelineController::reusablePreviewChunks(int in, int out, const QDomElement &consumer) const
+{
+    return m_timelinePreview ? m_timelinePreview->reusableChunks(in, out, consumer) : QList<int>();
+}
+
 int TimelineController::workingPreview() const
 {
     return m_timelinePreview ? m_timelinePreview->workingPreview : -1;
@@ -1901,6 +1987,7 @@ void TimelineController::removeSpace(int trackId, int frame, bool affectAllTrack
 
 void TimelineController::invalidateItem(int cid)
 {
+    pCore->getMonitor(Kdenlive::ProjectMonitor)->invalidateFrameCache();
     if (!m_timelinePreview || !m_model->isItem(cid)) {
         return;
     }
@@ -1925,6 +2012,8 @@ void TimelineController::invalidateTrack(int tid)
 
 void TimelineController::invalidateZone(int in, int out)
 {
+    // Cached monitor frames are outdated even when the change is away from the playhead
+    pCore->getMonitor(Kdenlive::ProjectMonitor)->invalidateFrameCache();
     if (!m_timelinePreview) {
         return;
     }
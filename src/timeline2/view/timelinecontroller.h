@@ -31,6 +31,7 @@
 
 class PreviewManager;
 class QAction;
+class QDomElement;
 class QQuickItem;
 
 // see https://bugreports.qt.io/browse/QTBUG-57714, don't expose a QWidget as a context property
@@ -58,6 +59,7 @@ class TimelineController : public QObject
     Q_PROPERTY(bool showAudioThumbnails READ showAudioThumbnails NOTIFY showAudioThumbnailsChanged)
     Q_PROPERTY(QVariantList dirtyChunks READ dirtyChunks NOTIFY dirtyChunksChanged)
     Q_PROPERTY(QVariantList renderedChunks READ renderedChunks NOTIFY renderedChunksChanged)
+    Q_PROPERTY(QVariantList renderCosts READ renderCosts NOTIFY renderCostsChanged)
     Q_PROPERTY(int workingPreview READ workingPreview NOTIFY workingPreviewChanged)
     Q_PROPERTY(bool useRuler READ useRuler NOTIFY useRulerChanged)
     Q_PROPERTY(int activeTrack READ activeTrack WRITE setActiveTrack NOTIFY activeTrackChanged)
@@ -90,6 +92,8 @@ public:
     /** @brief Sets the model that this widgets displays */
     void setModel(std::shared_ptr<TimelineItemModel> model);
     std::shared_ptr<TimelineItemModel> getModel() const;
+    /** @brief Returns a description (track, clip name and effects) of each visible clip at position, used to report playback issues */
+    QStringList activeClipsInfo(int position) const;
     void setRoot(QQuickItem *root);
     /** @brief Edit an item's in/out points with a dialog
      */
@@ -482,6 +486,14 @@ public:
     void stopPreviewRender();
     QVariantList dirtyChunks() const;
     QVariantList renderedChunks() const;
+    /** @brief Returns the render time measured on the timeline preview chunks, as a heatmap drawn on the ruler */
+    QVariantList renderCosts() const;
+    /** @brief Measure the render time of the preview zones without touching the preview cache. Returns false if there is no preview zone */
+    bool profileRenderCost();
+    /** @brief Returns the clips and compositions ranked by the preview render time spent on them */
+    QStringList renderCostReport(int count = 20) const;
+    /** @brief Returns the timeline preview chunks that can be copied into a render using this consumer */
+    QList<int> reusablePreviewChunks(int in, int out, const QDomElement &consumer) const;
     /* @brief returns the frame currently processed by timeline preview, -1 if none
      */
     int workingPreview() const;
@@ -659,6 +671,7 @@ signals:
      */
     void dirtyChunksChanged();
     void renderedChunksChanged();
+    void renderCostsChanged();
     void workingPreviewChanged();
     void useRulerChanged();
     void updateZoom(double);
@@ -0,0 +1,619 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "analysistrack.hpp"
+#include "core.h"
+#include "doc/kdenlivedoc.h"
+#include "kdenlive_debug.h"
+#include "kdenlivesettings.h"
+#include <KLocalizedString>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+namespace {
+const QLatin1String referencePrefix("kdenlive-analysis:");
+const QLatin1String sidecarExtension(".analysis");
+const quint32 sidecarMagic = 0x4b444154; // KDAT
+// Version 1 stored the values as 32 bit floats
+const quint16 sidecarVersion = 2;
+// Loaded sidecars, by file path
+QMutex cacheMutex;
+QHash<QString, std::shared_ptr<const AnalysisTrack>> loadedTracks;
+const int maxLoadedTracks = 20;
+
+QString formatValue(double value)
+{
+    if (std::abs(value) < 1e15 && value == std::floor(value)) {
+        return QString::number((qint64)value);
+    }
+    return QString::number(value, 'g', 15);
+}
+} // namespace
+
+AnalysisTrack::AnalysisTrack(int components)
+    : m_components(components)
+    , m_values(components)
+{
+}
+
+AnalysisTrack AnalysisTrack::fromAnimation(const QString &data)
+{
+    const QVector<QStringRef> keyframes = data.splitRef(QLatin1Char(';'), QString::SkipEmptyParts);
+    if (keyframes.isEmpty()) {
+        return AnalysisTrack();
+    }
+    AnalysisTrack track;
+    QVector<double> values;
+    int previous = INT_MIN;
+    for (const QStringRef &key : keyframes) {
+        int sep = key.indexOf(QLatin1Char('='));
+        if (sep < 1) {
+            return AnalysisTrack();
+        }
+        QStringRef framePart = key.left(sep).trimmed();
+        char type = 0;
+        if (framePart.endsWith(QLatin1Char('|')) || framePart.endsWith(QLatin1Char('~'))) {
+            type = framePart.at(framePart.size() - 1).toLatin1();
+            framePart.chop(1);
+        }
+        bool ok;
+        int frame = framePart.toInt(&ok);
+        if (!ok || frame <= previous) {
+            // Timecodes and unsorted keyframes are kept as text
+            return AnalysisTrack();
+        }
+        previous = frame;
+        values.clear();
+        const QVector<QStringRef> items = key.mid(sep + 1).split(QLatin1Char(' '), QString::SkipEmptyParts);
+        for (const QStringRef &item : items) {
+            double val = item.toDouble(&ok);
+            if (!ok) {
+                return AnalysisTrack();
+            }
+            values << val;
+        }
+        if (track.m_components == 0) {
+            if (values.isEmpty()) {
+                return AnalysisTrack();
+            }
+            track = AnalysisTrack(values.size());
+            track.m_frames.reserve(keyframes.size());
+            track.m_types.reserve(keyframes.size());
+            for (auto &component : track.m_values) {
+                component.reserve(keyframes.size());
+            }
+        } else if (values.size() != track.m_components) {
+            return AnalysisTrack();
+        }
+        track.append(frame, type, values);
+    }
+    return track;
+}
+
+QString AnalysisTrack::toAnimation() const
+{
+    QString result;
+    // Rough estimate of the string size to avoid reallocations
+    result.reserve(m_frames.size() * (8 + 6 * m_components));
+    for (int i = 0; i < m_frames.size(); ++i) {
+        if (i > 0) {
+            result.append(QLatin1Char(';'));
+        }
+        result.append(QString::number(m_frames.at(i)));
+        if (m_types.at(i) != 0) {
+            result.append(QLatin1Char(m_types.at(i)));
+        }
+        result.append(QLatin1Char('='));
+        for (int c = 0; c < m_components; ++c) {
+            if (c > 0) {
+                result.append(QLatin1Char(' '));
+            }
+            result.append(formatValue(m_values.at(c).at(i)));
+        }
+    }
+    return result;
+}
+
+bool AnalysisTrack::isValid() const
+{
+    return m_components > 0 && !m_frames.isEmpty();
+}
+
+int AnalysisTrack::count() const
+{
+    return m_frames.size();
+}
+
+int AnalysisTrack::components() const
+{
+    return m_components;
+}
+
+int AnalysisTrack::frame(int ix) const
+{
+    return m_frames.at(ix);
+}
+
+char AnalysisTrack::keyframeType(int ix) const
+{
+    return m_types.at(ix);
+}
+
+double AnalysisTrack::value(int ix, int component) const
+{
+    return m_values.at(component).at(ix);
+}
+
+void AnalysisTrack::append(int frame, char type, const QVector<double> &values)
+{
+    Q_ASSERT(values.size() == m_components);
+    Q_ASSERT(m_frames.isEmpty() || frame > m_frames.constLast());
+    m_frames.append(frame);
+    m_types.append(type);
+    for (int c = 0; c < m_components; ++c) {
+        m_values[c].append(values.at(c));
+    }
+}
+
+void AnalysisTrack::offsetFrames(int offset)
+{
+    if (offset == 0) {
+        return;
+    }
+    qint32 *frames = m_frames.data();
+    const int size = m_frames.size();
+    for (int i = 0; i < size; ++i) {
+        frames[i] += offset;
+    }
+}
+
+void AnalysisTrack::transform(int component, double scale, double offset)
+{
+    if (component < 0 || component >= m_components) {
+        return;
+    }
+    double *values = m_values[component].data();
+    const int size = m_frames.size();
+    for (int i = 0; i < size; ++i) {
+        values[i] = values[i] * scale + offset;
+    }
+}
+
+bool AnalysisTrack::merge(const AnalysisTrack &other)
+{
+    if (!other.isValid()) {
+        return true;
+    }
+    if (!isValid()) {
+        *this = other;
+        return true;
+    }
+    if (other.m_components != m_components) {
+        return false;
+    }
+    AnalysisTrack result(m_components);
+    const int total = m_frames.size() + other.m_frames.size();
+    result.m_frames.reserve(total);
+    result.m_types.reserve(total);
+    for (auto &component : result.m_values) {
+        component.reserve(total);
+    }
+    auto copyKey = [&result](const AnalysisTrack &source, int ix) {
+        result.m_frames.append(source.m_frames.at(ix));
+        result.m_types.append(source.m_types.at(ix));
+        for (int c = 0; c < result.m_components; ++c) {
+            result.m_values[c].append(source.m_values.at(c).at(ix));
+        }
+    };
+    int i = 0;
+    int j = 0;
+    while (i < m_frames.size() || j < other.m_frames.size()) {
+        if (j >= other.m_frames.size() || (i < m_frames.size() && m_frames.at(i) < other.m_frames.at(j))) {
+            copyKey(*this, i++);
+        } else {
+            if (i < m_frames.size() && m_frames.at(i) == other.m_frames.at(j)) {
+                // New data replaces the existing keyframe
+                i++;
+            }
+            copyKey(other, j++);
+        }
+    }
+    *this = std::move(result);
+    return true;
+}
+
+double AnalysisTrack::interpolate(int component, int prev, int a, int b, int next, int frame) const
+{
+    const QVector<double> &values = m_values.at(component);
+    if (m_types.at(a) == '|' || frame <= m_frames.at(a)) {
+        return values.at(a);
+    }
+    const double t = double(frame - m_frames.at(a)) / (m_frames.at(b) - m_frames.at(a));
+    const double y1 = values.at(a);
+    const double y2 = values.at(b);
+    if (m_types.at(a) != '~') {
+        return y1 + (y2 - y1) * t;
+    }
+    // Catmull-Rom spline through the surrounding keyframes, like MLT smooth keyframes
+    const double y0 = prev < 0 ? y1 : values.at(prev);
+    const double y3 = next < 0 ? y2 : values.at(next);
+    const double t2 = t * t;
+    const double a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+    const double a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+    const double a2 = -0.5 * y0 + 0.5 * y2;
+    return a0 * t * t2 + a1 * t2 + a2 * t + y1;
+}
+
+AnalysisTrack AnalysisTrack::simplified(double tolerance, double *maxDeviation) const
+{
+    const AnalysisTrack result = simplified(QVector<double>(m_components, tolerance), maxDeviation);
+    if (maxDeviation) {
+        *maxDeviation *= tolerance;
+    }
+    return result;
+}
+
+AnalysisTrack AnalysisTrack::simplified(const QVector<double> &tolerances, double *maxDeviation) const
+{
+    double deviation = 0.;
+    const int size = m_frames.size();
+    if (size < 3 || tolerances.size() < m_components) {
+        if (maxDeviation) {
+            *maxDeviation = deviation;
+        }
+        return *this;
+    }
+    QVector<bool> keep(size, false);
+    keep[0] = true;
+    keep[size - 1] = true;
+    for (int i = 0; i < size - 1; ++i) {
+        if (m_types.at(i) == '|') {
+            // Value holds until next keyframe, both define the step
+            keep[i] = true;
+            keep[i + 1] = true;
+        }
+    }
+    // Deviation of a keyframe from the interpolation of the kept ones, relative to the tolerance
+    auto error = [&](int prev, int a, int b, int next, int k) {
+        double result = 0.;
+        for (int c = 0; c < m_components; ++c) {
+            const double diff = std::abs(m_values.at(c).at(k) - interpolate(c, prev, a, b, next, m_frames.at(k)));
+            if (tolerances.at(c) > 0.) {
+                result = qMax(result, diff / tolerances.at(c));
+            } else if (diff > 0.) {
+                result = std::numeric_limits<double>::infinity();
+            }
+        }
+        return result;
+    };
+    // Smooth keyframes depend on their neighbours, so adding a keyframe changes the curve of the segments around it.
+    // Each pass keeps the worst keyframe of every segment out of tolerance, until all segments are within tolerance
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        deviation = 0.;
+        QVector<int> kept;
+        for (int i = 0; i < size; ++i) {
+            if (keep.at(i)) {
+                kept << i;
+            }
+        }
+        for (int s = 0; s < kept.size() - 1; ++s) {
+            const int a = kept.at(s);
+            const int b = kept.at(s + 1);
+            const int prev = s > 0 ? kept.at(s - 1) : -1;
+            const int next = s + 2 < kept.size() ? kept.at(s + 2) : -1;
+            double maxError = 0.;
+            int maxIndex = -1;
+            for (int k = a + 1; k < b; ++k) {
+                const double e = error(prev, a, b, next, k);
+                if (maxIndex < 0 || e > maxError) {
+                    maxError = e;
+                    maxIndex = k;
+                }
+            }
+            if (maxIndex < 0) {
+                continue;
+            }
+            if (maxError > 1.) {
+                keep[maxIndex] = true;
+                changed = true;
+            } else {
+                deviation = qMax(deviation, maxError);
+            }
+        }
+    }
+    AnalysisTrack result(m_components);
+    const int kept = int(std::count(keep.cbegin(), keep.cend(), true));
+    result.m_frames.reserve(kept);
+    result.m_types.reserve(kept);
+    for (auto &component : result.m_values) {
+        component.reserve(kept);
+    }
+    for (int i = 0; i < size; ++i) {
+        if (!keep.at(i)) {
+            continue;
+        }
+        result.m_frames.append(m_frames.at(i));
+        result.m_types.append(m_types.at(i));
+        for (int c = 0; c < m_components; ++c) {
+            result.m_values[c].append(m_values.at(c).at(i));
+        }
+    }
+    if (maxDeviation) {
+        *maxDeviation = deviation;
+    }
+    return result;
+}
+
+void AnalysisTrack::valuesAt(int frame, double *values) const
+{
+    if (!isValid()) {
+        std::fill(values, values + m_components, 0.);
+        return;
+    }
+    auto next = std::upper_bound(m_frames.cbegin(), m_frames.cend(), frame);
+    if (next == m_frames.cbegin() || next == m_frames.cend()) {
+        int ix = next == m_frames.cbegin() ? 0 : m_frames.size() - 1;
+        for (int c = 0; c < m_components; ++c) {
+            values[c] = m_values.at(c).at(ix);
+        }
+        return;
+    }
+    int ix = int(next - m_frames.cbegin()) - 1;
+    const int last = m_frames.size() - 1;
+    for (int c = 0; c < m_components; ++c) {
+        values[c] = interpolate(c, ix > 0 ? ix - 1 : -1, ix, ix + 1, ix + 1 < last ? ix + 2 : -1, frame);
+    }
+}
+
+QByteArray AnalysisTrack::toBinary() const
+{
+    QByteArray payload;
+    QDataStream body(&payload, QIODevice::WriteOnly);
+    body.setVersion(QDataStream::Qt_5_9);
+    body.setByteOrder(QDataStream::LittleEndian);
+    body.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    // Frames are delta encoded, consecutive keyframes then compress very well
+    qint32 previous = 0;
+    for (qint32 frame : m_frames) {
+        body << frame - previous;
+        previous = frame;
+    }
+    body.writeRawData(m_types.constData(), m_types.size());
+    for (const auto &component : m_values) {
+        for (double val : component) {
+            body << val;
+        }
+    }
+    QByteArray result;
+    {
+        QDataStream header(&result, QIODevice::WriteOnly);
+        header.setVersion(QDataStream::Qt_5_9);
+        header.setByteOrder(QDataStream::LittleEndian);
+        header << sidecarMagic << sidecarVersion << quint16(m_components) << quint32(m_frames.size());
+    }
+    result.append(qCompress(payload));
+    return result;
+}
+
+AnalysisTrack AnalysisTrack::fromBinary(const QByteArray &data)
+{
+    QDataStream header(data);
+    header.setVersion(QDataStream::Qt_5_9);
+    header.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic;
+    quint16 version;
+    quint16 components;
+    quint32 count;
+    header >> magic >> version >> components >> count;
+    if (header.status() != QDataStream::Ok || magic != sidecarMagic || version > sidecarVersion || components == 0) {
+        return AnalysisTrack();
+    }
+    const int headerSize = int(sizeof(magic) + sizeof(version) + sizeof(components) + sizeof(count));
+    const QByteArray payload = qUncompress(data.mid(headerSize));
+    const int valueSize = version < 2 ? int(sizeof(float)) : int(sizeof(double));
+    if (payload.size() != int(count * (sizeof(qint32) + 1 + components * valueSize))) {
+        return AnalysisTrack();
+    }
+    QDataStream body(payload);
+    body.setVersion(QDataStream::Qt_5_9);
+    body.setByteOrder(QDataStream::LittleEndian);
+    body.setFloatingPointPrecision(version < 2 ? QDataStream::SinglePrecision : QDataStream::DoublePrecision);
+    AnalysisTrack track(components);
+    track.m_frames.resize(int(count));
+    track.m_types.resize(int(count));
+    qint32 frame = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        qint32 delta;
+        body >> delta;
+        frame += delta;
+        track.m_frames[int(i)] = frame;
+    }
+    body.readRawData(track.m_types.data(), int(count));
+    for (auto &component : track.m_values) {
+        component.resize(int(count));
+        for (quint32 i = 0; i < count; ++i) {
+            body >> component[int(i)];
+        }
+    }
+    if (body.status() != QDataStream::Ok) {
+        return AnalysisTrack();
+    }
+    return track;
+}
+
+bool AnalysisTrack::isReference(const QString &value)
+{
+    return value.startsWith(referencePrefix);
+}
+
+QString AnalysisTrack::analysisFolder(const QString &projectFolder)
+{
+    if (!pCore || !pCore->currentDoc()) {
+        return QString();
+    }
+    // Each document has its own folder, unused files can then be removed without looking at other projects
+    const QString documentId = QDir::cleanPath(pCore->currentDoc()->getDocumentProperty(QStringLiteral("documentid")));
+    bool ok;
+    documentId.toLongLong(&ok, 10);
+    if (!ok || documentId.isEmpty()) {
+        return QString();
+    }
+    const QString folder = projectFolder.isEmpty() ? pCore->currentDoc()->projectDataFolder() : projectFolder;
+    return QDir(folder).absoluteFilePath(QStringLiteral("analysis/") + documentId);
+}
+
+QString AnalysisTrack::sidecarFile(const QString &value, const QString &projectFolder)
+{
+    if (!isReference(value)) {
+        return QString();
+    }
+    return QDir(analysisFolder(projectFolder)).absoluteFilePath(value.mid(referencePrefix.size()) + sidecarExtension);
+}
+
+QString AnalysisTrack::store() const
+{
+    return store(QString());
+}
+
+QString AnalysisTrack::store(const QString &folder) const
+{
+    if (!isValid() || !KdenliveSettings::analysissidecars()) {
+        return QString();
+    }
+    const QString path = analysisFolder(folder);
+    QDir dir(path);
+    if (path.isEmpty() || !dir.mkpath(QStringLiteral("."))) {
+        return QString();
+    }
+    const QByteArray data = toBinary();
+    const QString name = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+    const QString filePath = dir.absoluteFilePath(name + sidecarExtension);
+    if (!QFile::exists(filePath)) {
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qCDebug(KDENLIVE_LOG) << "// Cannot write analysis data to " << filePath;
+            return QString();
+        }
+    }
+    return referencePrefix + name;
+}
+
+QString AnalysisTrack::storeValue(const QString &value, const QString &folder)
+{
+    if (value.isEmpty() || isReference(value)) {
+        return value;
+    }
+    const AnalysisTrack track = fromAnimation(value);
+    const QString reference = track.store(folder);
+    return reference.isEmpty() ? value : reference;
+}
+
+QString AnalysisTrack::saveValue(const QString &value)
+{
+    if (KdenliveSettings::analysissidecars()) {
+        return storeValue(value);
+    }
+    if (!isReference(value)) {
+        return value;
+    }
+    auto track = load(value);
+    // Keep the reference if its file is missing, so that the data can still be restored
+    return track->isValid() ? track->toAnimation() : value;
+}
+
+void AnalysisTrack::removeUnused(const QStringList &values)
+{
+    QDir dir(analysisFolder());
+    if (dir.path().isEmpty() || !dir.exists()) {
+        return;
+    }
+    QStringList used;
+    for (const QString &value : values) {
+        if (isReference(value)) {
+            used << value.mid(referencePrefix.size()) + sidecarExtension;
+        }
+    }
+    const QStringList files = dir.entryList({QStringLiteral("*") + sidecarExtension}, QDir::Files);
+    QMutexLocker lk(&cacheMutex);
+    for (const QString &file : files) {
+        if (!used.contains(file)) {
+            const QString path = dir.absoluteFilePath(file);
+            loadedTracks.remove(path);
+            QFile::remove(path);
+        }
+    }
+}
+
+std::shared_ptr<const AnalysisTrack> AnalysisTrack::load(const QString &value)
+{
+    if (!isReference(value)) {
+        return std::make_shared<const AnalysisTrack>(fromAnimation(value));
+    }
+    const QString path = sidecarFile(value);
+    QMutexLocker lk(&cacheMutex);
+    auto cached = loadedTracks.constFind(path);
+    if (cached != loadedTracks.constEnd()) {
+        return cached.value();
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCDebug(KDENLIVE_LOG) << "// Missing analysis data file " << path;
+        return std::make_shared<const AnalysisTrack>();
+    }
+    auto track = std::make_shared<const AnalysisTrack>(fromBinary(file.readAll()));
+    if (loadedTracks.size() >= maxLoadedTracks) {
+        loadedTracks.clear();
+    }
+    loadedTracks.insert(path, track);
+    return track;
+}
+
+QString AnalysisTrack::resolve(const QString &value)
+{
+    if (!isReference(value)) {
+        return value;
+    }
+    return load(value)->toAnimation();
+}
+
+QString AnalysisTrack::summary(const QString &value)
+{
+    if (!isReference(value)) {
+        return value;
+    }
+    auto track = load(value);
+    if (!track->isValid()) {
+        return i18n("Missing data");
+    }
+    return i18np("%1 keyframe (%2-%3)", "%1 keyframes (%2-%3)", track->count(), track->frame(0), track->frame(track->count() - 1));
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+/** @brief This class holds per frame analysis data (motion tracking rects, detected values) in a compact form.
+    Keyframes are stored as a structure of arrays: one array of frame numbers, one array of keyframe types and
+    one double array per component, so that offset and scale transforms run over contiguous memory.
+    If enabled in the settings, a track is stored in a binary sidecar file in the document's analysis folder.
+    The clip property then only holds a reference to that file, and the data is loaded on first use.
+    Only plain numeric animations (integer frames, space separated numbers) can be converted, other data
+    is kept as an MLT animation string.
+ */
+class AnalysisTrack
+{
+
+public:
+    AnalysisTrack() = default;
+    explicit AnalysisTrack(int components);
+
+    /* @brief Parse an MLT animation string like "0=10 20 100 100 1;5~=12 20 100 100 1"
+       Returns an invalid track if the string cannot be represented (timecodes, percentages, text) */
+    static AnalysisTrack fromAnimation(const QString &data);
+    /* @brief Build the MLT animation string of this track */
+    QString toAnimation() const;
+
+    /* @brief Returns true if the track holds data */
+    bool isValid() const;
+    int count() const;
+    int components() const;
+    int frame(int ix) const;
+    char keyframeType(int ix) const;
+    double value(int ix, int component) const;
+    /* @brief Append a keyframe. Frames must be added in increasing order */
+    void append(int frame, char type, const QVector<double> &values);
+
+    /* @brief Shift all keyframes by offset frames */
+    void offsetFrames(int offset);
+    /* @brief Apply value * scale + offset on one component */
+    void transform(int component, double scale, double offset);
+    /* @brief Insert the keyframes of another track, replacing keyframes at the same frame */
+    bool merge(const AnalysisTrack &other);
+    /* @brief Returns a track with the minimal set of keyframes that stays within tolerance of this one.
+       The kept keyframes, interpolated like MLT does with their own type (linear, discrete or smooth), deviate
+       from every dropped keyframe by at most tolerances[c] on component c (Ramer-Douglas-Peucker).
+       Discrete keyframes and the keyframes following them are kept.
+       @param maxDeviation if not null, receives the largest deviation of a dropped keyframe, as a fraction of its tolerance
+    */
+    AnalysisTrack simplified(const QVector<double> &tolerances, double *maxDeviation = nullptr) const;
+    /* @brief Same as above, with the same tolerance for all components. maxDeviation is in component units */
+    AnalysisTrack simplified(double tolerance, double *maxDeviation = nullptr) const;
+    /* @brief Fill values with the component values at a frame, interpolated between keyframes like MLT does */
+    void valuesAt(int frame, double *values) const;
+
+    /* @brief Binary serialization of the track */
+    QByteArray toBinary() const;
+    static AnalysisTrack fromBinary(const QByteArray &data);
+
+    /* @brief Returns true if this property value is a reference to a sidecar file */
+    static bool isReference(const QString &value);
+    /* @brief Write the track in the analysis folder of the current project and return its reference.
+       Sidecar files are named after their content, so that references kept in the undo history stay valid.
+       Returns an empty string if sidecar files are disabled in the settings, the data is then kept as text */
+    QString store() const;
+    /* @brief Convert a property value to a reference if it is a plain animation string
+       @param folder is the project data folder, the current project's one if empty
+       Returns the original value if it cannot be stored in binary form */
+    static QString storeValue(const QString &value, const QString &folder = QString());
+    /* @brief Returns the property value to write in the project file: a reference if sidecar files are enabled,
+       the MLT animation string otherwise, so that the project file holds the data */
+    static QString saveValue(const QString &value);
+    /* @brief Delete the sidecar files of the current project that none of these property values references.
+       Must only be called before the undo history holds references, for example on project opening */
+    static void removeUnused(const QStringList &values);
+    /* @brief Load the track for a property value (reference or animation string). Loaded sidecars are cached */
+    static std::shared_ptr<const AnalysisTrack> load(const QString &value);
+    /* @brief Returns the MLT animation string for a property value, loading the sidecar if needed */
+    static QString resolve(const QString &value);
+    /* @brief Short description of a property value for display */
+    static QString summary(const QString &value);
+    /* @brief Returns the sidecar file path for a property value, empty if the value is not a reference
+       @param projectFolder is the project data folder, the current project's one if empty */
+    static QString sidecarFile(const QString &value, const QString &projectFolder = QString());
+    /* @brief The folder holding the sidecar files of the current document, in its project folder
+       @param projectFolder is the project data folder, the current project's one if empty */
+    static QString analysisFolder(const QString &projectFolder = QString());
+
+private:
+    int m_components{0};
+    QVector<qint32> m_frames;
+    QVector<char> m_types;
+    /* One value array per component */
+    QVector<QVector<double>> m_values;
+
+    QString store(const QString &folder) const;
+    /* Value of a component at a frame between keyframes a and b, prev and next are the keyframes around them (-1 if none) */
+    double interpolate(int component, int prev, int a, int b, int next, int frame) const;
+};
@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "audiomixdown.hpp"
+#include "xml/xml.hpp"
+
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+namespace {
+const QStringList serviceTags{QStringLiteral("producer"), QStringLiteral("chain"), QStringLiteral("playlist"), QStringLiteral("tractor"),
+                              QStringLiteral("multitrack")};
+const QString blankId = QStringLiteral("audiomixdown_blank");
+
+QMap<QString, QDomElement> servicesById(const QDomDocument &doc)
+{
+    QMap<QString, QDomElement> services;
+    for (const QString &tag : serviceTags) {
+        QDomNodeList nodes = doc.elementsByTagName(tag);
+        for (int i = 0; i < nodes.count(); ++i) {
+            QDomElement e = nodes.at(i).toElement();
+            if (e.hasAttribute(QStringLiteral("id"))) {
+                services.insert(e.attribute(QStringLiteral("id")), e);
+            }
+        }
+    }
+    return services;
+}
+
+// Collect the ids of the services used by an element, directly or through other services
+void collectReferences(const QDomElement &element, const QMap<QString, QDomElement> &services, QSet<QString> &ids)
+{
+    for (QDomElement child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        const QString id = child.attribute(QStringLiteral("producer"));
+        if (!id.isEmpty() && !ids.contains(id)) {
+            ids.insert(id);
+            collectReferences(services.value(id), services, ids);
+        }
+        collectReferences(child, services, ids);
+    }
+}
+} // namespace
+
+// static
+bool AudioMixdown::isAudioOnly(const QDomElement &consumer)
+{
+    if (consumer.attribute(QStringLiteral("an")) == QLatin1String("1")) {
+        return false;
+    }
+    return consumer.attribute(QStringLiteral("vn")) == QLatin1String("1") || consumer.attribute(QStringLiteral("video_off")) == QLatin1String("1");
+}
+
+// static
+int AudioMixdown::strip(QDomDocument &doc, const std::function<bool(const QString &)> &isVideoEffect)
+{
+    QDomNodeList tractors = doc.elementsByTagName(QStringLiteral("tractor"));
+    QDomElement mainTractor;
+    for (int i = 0; i < tractors.count(); ++i) {
+        QDomElement tractor = tractors.at(i).toElement();
+        if (tractor.hasAttribute(QStringLiteral("global_feed"))) {
+            mainTractor = tractor;
+            break;
+        }
+    }
+    if (mainTractor.isNull()) {
+        if (tractors.isEmpty()) {
+            return -1;
+        }
+        mainTractor = tractors.at(tractors.count() - 1).toElement();
+    }
+    QMap<QString, QDomElement> services = servicesById(doc);
+
+    // Replace the video tracks, the first track is the black background that provides silence
+    QSet<QString> strippedServices;
+    QSet<int> strippedTracks;
+    QVector<QDomNode> tracks = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("track"));
+    for (int i = 1; i < tracks.count(); ++i) {
+        QDomElement track = tracks.at(i).toElement();
+        const QString hide = track.attribute(QStringLiteral("hide"));
+        const QString id = track.attribute(QStringLiteral("producer"));
+        bool audioTrack = Xml::getXmlProperty(services.value(id), QStringLiteral("kdenlive:audio_track")) == QLatin1String("1");
+        if (audioTrack && hide != QLatin1String("audio") && hide != QLatin1String("both")) {
+            continue;
+        }
+        strippedTracks.insert(i);
+        strippedServices.insert(id);
+        collectReferences(services.value(id), services, strippedServices);
+        track.setAttribute(QStringLiteral("producer"), blankId);
+        track.setAttribute(QStringLiteral("hide"), QStringLiteral("both"));
+    }
+    if (strippedTracks.isEmpty()) {
+        return 0;
+    }
+    QDomElement blank = doc.createElement(QStringLiteral("playlist"));
+    blank.setAttribute(QStringLiteral("id"), blankId);
+    mainTractor.parentNode().insertBefore(blank, mainTractor);
+
+    // Compositions involving a removed track, and video master effects
+    QVector<QDomNode> transitions = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("transition"));
+    for (const QDomNode &node : qAsConst(transitions)) {
+        QDomElement transition = node.toElement();
+        if (strippedTracks.contains(Xml::getXmlProperty(transition, QStringLiteral("a_track")).toInt()) ||
+            strippedTracks.contains(Xml::getXmlProperty(transition, QStringLiteral("b_track")).toInt())) {
+            mainTractor.removeChild(transition);
+        }
+    }
+    QVector<QDomNode> filters = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("filter"));
+    for (const QDomNode &node : qAsConst(filters)) {
+        QDomElement filter = node.toElement();
+        const QString id = Xml::getXmlProperty(filter, QStringLiteral("kdenlive_id"), Xml::getXmlProperty(filter, QStringLiteral("mlt_service")));
+        if (isVideoEffect(id)) {
+            mainTractor.removeChild(filter);
+        }
+    }
+
+    // Delete the services that were only used by the removed tracks, MLT would otherwise open them
+    QSet<QString> used;
+    collectReferences(mainTractor, services, used);
+    used.insert(mainTractor.attribute(QStringLiteral("id")));
+    QSet<QString> unused;
+    for (const QString &id : qAsConst(strippedServices)) {
+        if (!used.contains(id)) {
+            unused.insert(id);
+        }
+    }
+    for (const QString &id : qAsConst(unused)) {
+        QDomElement service = services.value(id);
+        if (!service.isNull()) {
+            service.parentNode().removeChild(service);
+        }
+    }
+    // Other playlists, like the bin playlist, may still list them
+    QDomNodeList entries = doc.elementsByTagName(QStringLiteral("entry"));
+    for (int i = entries.count() - 1; i >= 0; --i) {
+        QDomElement entry = entries.at(i).toElement();
+        if (unused.contains(entry.attribute(QStringLiteral("producer")))) {
+            entry.parentNode().removeChild(entry);
+        }
+    }
+    return strippedTracks.count();
+}
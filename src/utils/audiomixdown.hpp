@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDomDocument>
+#include <QString>
+#include <functional>
+
+/** @brief Audio only renders do not need the video part of the timeline. Disabling video in the consumer still leaves
+    every video track, composition and clip in the render playlist, so MLT opens all video producers and may evaluate
+    them. This class rewrites a render playlist so that its main tractor only contains the audio tracks: video tracks
+    are replaced by an empty playlist (so that track indexes of the remaining transitions are unchanged), compositions
+    involving them and video master effects are removed, and producers that are not used anymore are deleted.
+ */
+
+class AudioMixdown
+{
+
+public:
+    /* @brief Returns true if the render consumer only outputs audio */
+    static bool isAudioOnly(const QDomElement &consumer);
+    /* @brief Strip the video part of a render playlist
+       @param isVideoEffect returns true for a master effect (identified by its kdenlive_id or mlt_service) that only processes video
+       @return the number of removed tracks, or -1 if the playlist has no main tractor
+    */
+    static int strip(QDomDocument &doc, const std::function<bool(const QString &)> &isVideoEffect);
+};
@@ -0,0 +1,377 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "cacheusage.hpp"
+#include "kdenlive_debug.h"
+#include "kdenlivesettings.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+
+std::unique_ptr<CacheUsage> CacheUsage::instance;
+std::once_flag CacheUsage::m_onceFlag;
+
+namespace {
+const QList<CacheType> accountedTypes{CachePreview, CacheAudio, CacheThumbs};
+// Write the usage file after that many changes
+const int saveInterval = 200;
+} // namespace
+
+CacheUsage::CacheUsage() = default;
+
+std::unique_ptr<CacheUsage> &CacheUsage::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new CacheUsage()); });
+    return instance;
+}
+
+// static
+QString CacheUsage::usageFile(const QString &baseDir)
+{
+    return QDir(baseDir).absoluteFilePath(QStringLiteral("usage.json"));
+}
+
+// static
+QString CacheUsage::lockFile(const QString &baseDir)
+{
+    return QDir(baseDir).absoluteFilePath(QStringLiteral("usage.lock"));
+}
+
+// static
+QString CacheUsage::typeName(CacheType type)
+{
+    switch (type) {
+    case CachePreview:
+        return QStringLiteral("preview");
+    case CacheAudio:
+        return QStringLiteral("audiothumbs");
+    case CacheThumbs:
+        return QStringLiteral("videothumbs");
+    default:
+        return QString();
+    }
+}
+
+// static
+qint64 CacheUsage::folderSize(const QString &path, qint64 *files)
+{
+    qint64 size = 0;
+    qint64 count = 0;
+    QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        size += it.fileInfo().size();
+        count++;
+    }
+    if (files) {
+        *files = count;
+    }
+    return size;
+}
+
+void CacheUsage::setProject(const QDir &baseDir)
+{
+    QMutexLocker lk(&m_mutex);
+    const QString base = baseDir.absolutePath();
+    if (base == m_baseDir) {
+        return;
+    }
+    if (!m_baseDir.isEmpty()) {
+        writeUsage();
+    }
+    m_baseDir = base;
+    m_usage.clear();
+    // Another instance may have the project open, the lock is then only used to protect the folder from eviction
+    m_lock.reset(new QLockFile(lockFile(base)));
+    m_lock->setStaleLockTime(0);
+    if (!m_lock->tryLock(0)) {
+        qCDebug(KDENLIVE_LOG) << "// Cache folder already in use by another instance: " << base;
+    }
+    QFile file(usageFile(base));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+        for (CacheType type : accountedTypes) {
+            const QJsonObject entry = obj.value(typeName(type)).toObject();
+            if (!entry.isEmpty()) {
+                Usage usage;
+                usage.size = entry.value(QLatin1String("size")).toVariant().toLongLong();
+                usage.files = entry.value(QLatin1String("files")).toVariant().toLongLong();
+                usage.valid = true;
+                m_usage.insert(type, usage);
+            }
+        }
+    }
+    // Update last use time
+    writeUsage();
+    // Folders without stored usage are walked once in the background
+    for (CacheType type : accountedTypes) {
+        if (m_usage.value(type).valid) {
+            continue;
+        }
+        QtConcurrent::run([this, base, type]() {
+            qint64 files = 0;
+            qint64 size = folderSize(QDir(base).absoluteFilePath(typeName(type)), &files);
+            QMutexLocker locker(&m_mutex);
+            if (m_baseDir == base && !m_usage.value(type).valid) {
+                m_usage.insert(type, {size, files, true});
+                writeUsage();
+            }
+        });
+    }
+    lk.unlock();
+    enforceLimit();
+}
+
+// static
+qint64 CacheUsage::fileSize(const QString &path)
+{
+    QFileInfo info(path);
+    return info.exists() ? info.size() : -1;
+}
+
+void CacheUsage::add(CacheType type, qint64 size, qint64 files)
+{
+    auto usage = m_usage.find(type);
+    if (usage == m_usage.end() || !usage->valid) {
+        // Usage will be known once the folder was walked
+        return;
+    }
+    usage->size = qMax(0LL, usage->size + size);
+    usage->files = qMax(0LL, usage->files + files);
+    if (++m_changes >= saveInterval) {
+        writeUsage();
+    }
+}
+
+void CacheUsage::fileWritten(CacheType type, const QString &path, qint64 previousSize)
+{
+    qint64 size = fileSize(path);
+    if (size < 0) {
+        return;
+    }
+    QMutexLocker lk(&m_mutex);
+    if (previousSize < 0) {
+        add(type, size, 1);
+    } else {
+        add(type, size - previousSize, 0);
+    }
+}
+
+bool CacheUsage::removeFile(CacheType type, const QString &path)
+{
+    qint64 size = fileSize(path);
+    if (size < 0 || !QFile::remove(path)) {
+        return false;
+    }
+    QMutexLocker lk(&m_mutex);
+    add(type, -size, -1);
+    return true;
+}
+
+bool CacheUsage::removeFolder(CacheType type, QDir dir)
+{
+    qint64 files = 0;
+    qint64 size = folderSize(dir.absolutePath(), &files);
+    bool result = dir.removeRecursively();
+    QMutexLocker lk(&m_mutex);
+    if (result) {
+        add(type, -size, -files);
+    } else {
+        // Part of the folder may have been deleted, measure again later
+        m_usage.remove(type);
+    }
+    return result;
+}
+
+void CacheUsage::clear(CacheType type)
+{
+    QMutexLocker lk(&m_mutex);
+    for (CacheType t : accountedTypes) {
+        if (type == CacheBase || type == t) {
+            m_usage.insert(t, Usage{0, 0, true});
+        }
+    }
+    writeUsage();
+}
+
+bool CacheUsage::usage(CacheType type, qint64 *size) const
+{
+    QMutexLocker lk(&m_mutex);
+    const Usage usage = m_usage.value(type);
+    *size = usage.size;
+    return usage.valid;
+}
+
+void CacheUsage::setUsage(CacheType type, qint64 size, qint64 files)
+{
+    QMutexLocker lk(&m_mutex);
+    if (m_usage.value(type).valid) {
+        // Known from the stored usage or another walk, and kept up to date by the writes since then
+        return;
+    }
+    m_usage.insert(type, {size, files, true});
+    writeUsage();
+}
+
+void CacheUsage::writeUsage()
+{
+    m_changes = 0;
+    if (m_baseDir.isEmpty() || !QFileInfo::exists(m_baseDir)) {
+        return;
+    }
+    QJsonObject obj;
+    obj.insert(QLatin1String("version"), 1);
+    obj.insert(QLatin1String("lastUsed"), QDateTime::currentMSecsSinceEpoch());
+    QMapIterator<int, Usage> i(m_usage);
+    while (i.hasNext()) {
+        i.next();
+        if (!i.value().valid) {
+            continue;
+        }
+        QJsonObject entry;
+        entry.insert(QLatin1String("size"), i.value().size);
+        entry.insert(QLatin1String("files"), i.value().files);
+        obj.insert(typeName(CacheType(i.key())), entry);
+    }
+    QSaveFile file(usageFile(m_baseDir));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(KDENLIVE_LOG) << "// Cannot write cache usage to " << file.fileName();
+        return;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    file.commit();
+}
+
+void CacheUsage::save()
+{
+    QMutexLocker lk(&m_mutex);
+    writeUsage();
+    lk.unlock();
+    enforceLimit();
+}
+
+// static
+qint64 CacheUsage::storedUsage(const QDir &baseDir, QDateTime *lastUsed)
+{
+    QFile file(usageFile(baseDir.absolutePath()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    qint64 total = 0;
+    for (CacheType type : accountedTypes) {
+        const QJsonObject entry = obj.value(typeName(type)).toObject();
+        if (entry.isEmpty()) {
+            return -1;
+        }
+        total += entry.value(QLatin1String("size")).toVariant().toLongLong();
+    }
+    if (lastUsed) {
+        *lastUsed = QDateTime::fromMSecsSinceEpoch(obj.value(QLatin1String("lastUsed")).toVariant().toLongLong());
+    }
+    return total;
+}
+
+void CacheUsage::enforceLimit()
+{
+    qint64 maxSize = qint64(KdenliveSettings::maxcachesize()) * 1024 * 1024;
+    if (maxSize <= 0 || m_eviction.isRunning()) {
+        return;
+    }
+    QString current;
+    {
+        QMutexLocker lk(&m_mutex);
+        current = QFileInfo(m_baseDir).fileName();
+    }
+    // Only the global cache folder holds several projects, custom project folders are left alone
+    const QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    m_eviction = QtConcurrent::run(&CacheUsage::evict, root, current, maxSize);
+}
+
+// static
+void CacheUsage::evict(const QString &root, const QString &current, qint64 maxSize, qint64 minIdle)
+{
+    struct Entry
+    {
+        QString folder;
+        qint64 size;
+        QDateTime lastUsed;
+    };
+    QVector<Entry> entries;
+    qint64 total = 0;
+    QDir rootDir(root);
+    const QStringList folders = rootDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    bool ok;
+    for (const QString &folder : folders) {
+        // Project cache folders are named after the document id
+        folder.toLongLong(&ok);
+        if (!ok) {
+            continue;
+        }
+        QDir dir(rootDir.absoluteFilePath(folder));
+        QDateTime lastUsed;
+        qint64 size = storedUsage(dir, &lastUsed);
+        if (size < 0) {
+            size = folderSize(dir.absolutePath());
+            lastUsed = QFileInfo(dir.absolutePath()).lastModified();
+        }
+        total += size;
+        if (folder != current) {
+            entries.append({folder, size, lastUsed});
+        }
+    }
+    if (total <= maxSize) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+    const QDateTime idleLimit = QDateTime::currentDateTime().addSecs(-minIdle);
+    for (const Entry &entry : qAsConst(entries)) {
+        if (total <= maxSize) {
+            break;
+        }
+        if (entry.lastUsed > idleLimit) {
+            // Sorted by last use, all remaining folders were used recently
+            break;
+        }
+        QDir dir(rootDir.absoluteFilePath(entry.folder));
+        // The folder is locked while its project is open in a Kdenlive instance. Locking it also prevents an instance
+        // from opening the project while its cache is deleted
+        QLockFile lock(lockFile(dir.absolutePath()));
+        // Locks are held as long as a project is open, only the lock of a dead process is stale
+        lock.setStaleLockTime(0);
+        if (!lock.tryLock(0)) {
+            qCDebug(KDENLIVE_LOG) << "// Cache for project " << entry.folder << " is in use, not deleted";
+            continue;
+        }
+        if (dir.removeRecursively()) {
+            qCDebug(KDENLIVE_LOG) << "// Cache limit reached, deleted cache for project " << entry.folder << ", " << entry.size << " bytes";
+            total -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "definitions.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFuture>
+#include <QLockFile>
+#include <QMap>
+#include <QMutex>
+#include <memory>
+#include <mutex>
+
+/** @brief This class keeps track of the disk usage of the current project's cache folders (timeline previews,
+    audio and video thumbnails). Cache writers report the files they write and delete, so the usage is known
+    without walking the folders. The usage is stored in a usage.json file in the project's cache folder, along
+    with the last time the project was used. A folder is only walked once, in the background, when no stored
+    usage exists for it.
+    When a maximum cache size is configured, the cache folders of the least recently used projects are deleted
+    in the background until the total size fits. The current project's folder is locked, so that the folder of a
+    project open in another Kdenlive instance is not deleted.
+ * Note that this class is a Singleton
+ */
+
+class CacheUsage
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<CacheUsage> &get();
+
+    /* @brief Switch accounting to the cache folder of a project, loading its stored usage
+       @param baseDir is the project's cache folder (CacheBase)
+    */
+    void setProject(const QDir &baseDir);
+
+    /* @brief Returns the size of a file, or -1 if it does not exist. Used to get the previous size before overwriting a file */
+    static qint64 fileSize(const QString &path);
+    /* @brief Account for a file written in a cache folder of the current project
+       @param previousSize is the size of the file before writing it, -1 if it did not exist
+    */
+    void fileWritten(CacheType type, const QString &path, qint64 previousSize = -1);
+    /* @brief Delete a file from a cache folder and account for it */
+    bool removeFile(CacheType type, const QString &path);
+    /* @brief Recursively delete a folder inside a cache folder and account for its content */
+    bool removeFolder(CacheType type, QDir dir);
+    /* @brief The cache folder was emptied. CacheBase resets all cache types */
+    void clear(CacheType type);
+
+    /* @brief Get the usage of a cache type. Returns false if the usage is not known yet */
+    bool usage(CacheType type, qint64 *size) const;
+    /* @brief Set the usage of a cache type after walking its folder. Ignored if the usage became known during the walk */
+    void setUsage(CacheType type, qint64 size, qint64 files);
+
+    /* @brief Write the usage of the current project if it changed, and enforce the cache size limit */
+    void save();
+
+    /* @brief Returns the total size stored for a project's cache folder, or -1 if it is not known
+       @param lastUsed if not null, receives the last time the project was used
+    */
+    static qint64 storedUsage(const QDir &baseDir, QDateTime *lastUsed = nullptr);
+
+    /* @brief Delete the cache folders of the least recently used projects in the background, until the total
+       cache size is below the configured limit. The current project is never deleted */
+    void enforceLimit();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    CacheUsage();
+
+    struct Usage
+    {
+        qint64 size{0};
+        qint64 files{0};
+        bool valid{false};
+    };
+
+    static std::unique_ptr<CacheUsage> instance;
+    static std::once_flag m_onceFlag; // flag to create the repository only once;
+
+    mutable QMutex m_mutex;
+    QString m_baseDir;
+    QMap<int, Usage> m_usage;
+    int m_changes{0};
+    QFuture<void> m_eviction;
+    /** @brief Lock of the current project's cache folder, held while the project is open */
+    std::unique_ptr<QLockFile> m_lock;
+
+    // Must be called with the mutex locked
+    void add(CacheType type, qint64 size, qint64 files);
+    void writeUsage();
+    static QString usageFile(const QString &baseDir);
+    static QString lockFile(const QString &baseDir);
+    static QString typeName(CacheType type);
+    static qint64 folderSize(const QString &path, qint64 *files = nullptr);
+    /* @brief Delete the least recently used project folders of root until they fit in maxSize. Folders that are
+       locked or were used in the last minIdle seconds are kept */
+    static void evict(const QString &root, const QString &current, qint64 maxSize, qint64 minIdle = 3600);
+};
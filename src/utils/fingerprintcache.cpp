@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "fingerprintcache.hpp"
+#include "kdenlive_debug.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+std::unique_ptr<FingerprintCache> FingerprintCache::instance;
+std::once_flag FingerprintCache::m_onceFlag;
+
+namespace {
+// Increase when the cache file format changes
+const quint32 fingerprintCacheVersion = 1;
+// Write the cache after that many new entries
+const int saveInterval = 100;
+} // namespace
+
+FingerprintCache::FingerprintCache() = default;
+
+std::unique_ptr<FingerprintCache> &FingerprintCache::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new FingerprintCache()); });
+    return instance;
+}
+
+// static
+QString FingerprintCache::cacheFile()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath(QStringLiteral("fingerprints.dat"));
+}
+
+// static
+QByteArray FingerprintCache::computeFingerprint(const QString &path, qint64 *size)
+{
+    QFile file(path);
+    *size = 0;
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    /*
+     * 1 MB = 1 second per 450 files (or faster)
+     * 10 MB = 9 seconds per 450 files (or faster)
+     */
+    QByteArray fileData;
+    *size = file.size();
+    if (*size > 2000000) {
+        fileData = file.read(1000000);
+        if (file.seek(*size - 1000000)) {
+            fileData.append(file.readAll());
+        }
+    } else {
+        fileData = file.readAll();
+    }
+    file.close();
+    return QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+}
+
+void FingerprintCache::load()
+{
+    // Must be called with the mutex locked
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(cacheFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream in(&file);
+    quint32 version;
+    in >> version;
+    if (version != fingerprintCacheVersion) {
+        return;
+    }
+    quint32 count;
+    in >> count;
+    m_entries.reserve(int(count));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        in >> path >> entry.size >> entry.mtime >> entry.hash;
+        m_entries.insert(path, entry);
+    }
+}
+
+void FingerprintCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_unsavedEntries == 0) {
+        return;
+    }
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    QSaveFile file(cacheFile());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(KDENLIVE_LOG) << "// Cannot write fingerprint cache " << cacheFile();
+        return;
+    }
+    QDataStream out(&file);
+    out << fingerprintCacheVersion << quint32(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        out << it.key() << it.value().size << it.value().mtime << it.value().hash;
+    }
+    if (file.commit()) {
+        m_unsavedEntries = 0;
+    }
+}
+
+QPair<QByteArray, qint64> FingerprintCache::fingerprint(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.isFile()) {
+        return {QByteArray(), 0};
+    }
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker lock(&m_mutex);
+        load();
+        auto it = m_entries.constFind(path);
+        if (it != m_entries.constEnd() && it.value().size == info.size() && it.value().mtime == mtime) {
+            return {it.value().hash, it.value().size};
+        }
+    }
+    // Read the file without holding the lock, so that other files can be hashed in parallel
+    qint64 size;
+    const QByteArray hash = computeFingerprint(path, &size);
+    if (hash.isEmpty()) {
+        return {hash, size};
+    }
+    bool needsSave = false;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_entries.insert(path, {size, mtime, hash});
+        needsSave = ++m_unsavedEntries >= saveInterval;
+    }
+    if (needsSave) {
+        save();
+    }
+    return {hash, size};
+}
+
+QMap<QString, QString> FingerprintCache::fingerprints(const QStringList &paths)
+{
+    const QList<QByteArray> hashes = QtConcurrent::blockingMapped<QList<QByteArray>>(
+        paths, std::function<QByteArray(const QString &)>([this](const QString &path) { return fingerprint(path).first; }));
+    QMap<QString, QString> result;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (!hashes.at(i).isEmpty()) {
+            result.insert(paths.at(i), QString::fromLatin1(hashes.at(i).toHex()));
+        }
+    }
+    save();
+    return result;
+}
+
+QMap<QString, QString> FingerprintCache::findFiles(const QDir &dir, const QList<QPair<qint64, QString>> &requests)
+{
+    QMap<QString, QString> result;
+    // Index requested hashes by size, a file is only hashed if its size matches a request
+    QHash<qint64, QStringList> requestedSizes;
+    for (const auto &request : requests) {
+        if (request.first > 0 && !request.second.isEmpty()) {
+            requestedSizes[request.first] << request.second;
+        }
+    }
+    if (requestedSizes.isEmpty()) {
+        return result;
+    }
+    QStringList candidates;
+    QDirIterator it(dir.absolutePath(), QDir::Files | QDir::Readable | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (requestedSizes.contains(it.fileInfo().size())) {
+            candidates << it.filePath();
+        }
+    }
+    // Keep a stable order so that the first match in the folder tree wins
+    candidates.sort();
+    qCDebug(KDENLIVE_LOG) << "// Fingerprint search: " << candidates.size() << " files with matching size for " << requests.size() << " requests";
+    const QMap<QString, QString> hashes = fingerprints(candidates);
+    for (const QString &path : candidates) {
+        const QString hash = hashes.value(path);
+        if (!hash.isEmpty() && !result.contains(hash)) {
+            result.insert(hash, path);
+        }
+    }
+    return result;
+}
+
+QString FingerprintCache::findFile(const QDir &dir, qint64 size, const QString &hash)
+{
+    return findFiles(dir, {{size, hash}}).value(hash);
+}
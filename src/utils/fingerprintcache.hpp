@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDir>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <mutex>
+
+/** @brief This class computes and caches the fingerprints used to identify media files (kdenlive:file_hash).
+    A fingerprint is the md5 of the first and last MB of the file, so it stays compatible with the hashes
+    stored in existing projects. Results are kept in a persistent cache keyed by path, size and
+    modification time, so a file is only read again if it changed. Batches of files are hashed in
+    parallel on the global thread pool.
+ * Note that this class is a Singleton
+ */
+
+class FingerprintCache
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<FingerprintCache> &get();
+
+    /* @brief Returns the raw fingerprint and size of a file. The fingerprint is empty if the file cannot be read */
+    QPair<QByteArray, qint64> fingerprint(const QString &path);
+
+    /* @brief Returns the hex fingerprint of each file, hashing in parallel */
+    QMap<QString, QString> fingerprints(const QStringList &paths);
+
+    /* @brief Search files matching a size and hex fingerprint in a folder and its sub folders
+       Only files with a matching size are hashed. The folder is only walked once for all requests
+       @param requests is a list of (size, hash) pairs
+       @return a map of hash to the first matching path, missing if not found
+    */
+    QMap<QString, QString> findFiles(const QDir &dir, const QList<QPair<qint64, QString>> &requests);
+
+    /* @brief Convenience method to search a single file, returns an empty string if not found */
+    QString findFile(const QDir &dir, qint64 size, const QString &hash);
+
+    /* @brief Write the cache to disk if it changed */
+    void save();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    FingerprintCache();
+
+    // Read the file sample and compute its fingerprint
+    static QByteArray computeFingerprint(const QString &path, qint64 *size);
+    static QString cacheFile();
+    void load();
+
+    struct Entry
+    {
+        qint64 size;
+        qint64 mtime;
+        QByteArray hash;
+    };
+
+    static std::unique_ptr<FingerprintCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the repository only once;
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    bool m_loaded{false};
+    int m_unsavedEntries{0};
+};
@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "inprocessrender.hpp"
+#include "kdenlive_debug.h"
+#include "lib/renderprogress.h"
+
+#include <KLocalizedString>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent>
+#include <memory>
+#include <mlt++/MltConsumer.h>
+#include <mlt++/MltEvent.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+namespace {
+// Interval between two progress checks
+const int pollInterval = 200;
+
+void frame_show(mlt_consumer, std::atomic<int> *position, mlt_frame frame)
+{
+    *position = int(mlt_frame_get_position(frame));
+}
+} // namespace
+
+InProcessRender::InProcessRender(const QString &playlist, const QString &target, QObject *parent)
+    : QObject(parent)
+    , m_playlist(playlist)
+    , m_target(target)
+{
+}
+
+InProcessRender::~InProcessRender()
+{
+    abort();
+    m_future.waitForFinished();
+}
+
+// static
+bool InProcessRender::canRender(const QDomElement &consumer, int maxFrames)
+{
+    if (maxFrames <= 0 || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat")) {
+        return false;
+    }
+    // Multi pass encodings and image sequences are left to kdenlive_render
+    if (consumer.hasAttribute(QStringLiteral("pass")) || consumer.attribute(QStringLiteral("x265-params")).contains(QLatin1String("pass=")) ||
+        consumer.attribute(QStringLiteral("f")) == QLatin1String("image2") || consumer.attribute(QStringLiteral("target")).contains(QLatin1Char('%'))) {
+        return false;
+    }
+    if (!consumer.hasAttribute(QStringLiteral("in")) || !consumer.hasAttribute(QStringLiteral("out"))) {
+        return false;
+    }
+    int frames = consumer.attribute(QStringLiteral("out")).toInt() - consumer.attribute(QStringLiteral("in")).toInt() + 1;
+    return frames > 0 && frames <= maxFrames;
+}
+
+void InProcessRender::start()
+{
+    if (isRunning()) {
+        return;
+    }
+    m_abort = false;
+    m_future = QtConcurrent::run(this, &InProcessRender::run);
+}
+
+void InProcessRender::abort()
+{
+    m_abort = true;
+}
+
+bool InProcessRender::isRunning() const
+{
+    return m_future.isRunning();
+}
+
+const QString &InProcessRender::target() const
+{
+    return m_target;
+}
+
+void InProcessRender::run()
+{
+    RenderProgress::Log progressLog(m_target, false);
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::Started;
+    record.message = QStringLiteral("in process");
+    progressLog.write(record);
+    auto fail = [&](const QString &error) {
+        RenderProgress::Record failed;
+        failed.event = RenderProgress::Event::Failed;
+        failed.message = error;
+        progressLog.write(failed);
+        emit finished(m_target, -2, error);
+    };
+
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    QDomDocument doc;
+    QFile file(m_playlist);
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        fail(i18n("Cannot read playlist %1", m_playlist));
+        return;
+    }
+    file.close();
+    // The consumer is created here, the xml producer would ignore it
+    QDomElement root = doc.documentElement();
+    QDomElement consumerElement = root.firstChildElement(QStringLiteral("consumer"));
+    root.removeChild(consumerElement);
+    int in = consumerElement.attribute(QStringLiteral("in")).toInt();
+    int out = consumerElement.attribute(QStringLiteral("out")).toInt();
+
+    // The playlist is parsed again instead of reusing the timeline tractor: MLT cannot deep copy a tractor, and the
+    // monitors keep using and editing the timeline while this thread renders it. The parsing time is logged in
+    // the "load" stage. The profile is read from the playlist, the project profile used by the monitors is not touched
+    Mlt::Profile profile;
+    profile.set_explicit(0);
+    Mlt::Producer producer(profile, "xml-string", doc.toString().toUtf8().constData());
+    if (!producer.is_valid()) {
+        fail(i18n("Cannot load playlist %1", m_playlist));
+        return;
+    }
+    profile.set_explicit(1);
+    std::unique_ptr<Mlt::Producer> cut(producer.cut(in, out));
+    Mlt::Consumer consumer(profile, "avformat", m_target.toUtf8().constData());
+    if (!consumer.is_valid()) {
+        fail(i18n("Cannot create consumer."));
+        return;
+    }
+    QDomNamedNodeMap attributes = consumerElement.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        QDomAttr attribute = attributes.item(i).toAttr();
+        const QString name = attribute.name();
+        if (name != QLatin1String("mlt_service") && name != QLatin1String("target") && name != QLatin1String("in") && name != QLatin1String("out")) {
+            consumer.set(name.toUtf8().constData(), attribute.value().toUtf8().constData());
+        }
+    }
+    consumer.set("terminate_on_pause", 1);
+    consumer.connect(*cut);
+    std::atomic<int> position{0};
+    std::unique_ptr<Mlt::Event> showEvent(consumer.listen("consumer-frame-show", &position, (mlt_listener)frame_show));
+    record.stages.insert(QStringLiteral("load"), stageTimer.restart());
+
+    const int frames = out - in + 1;
+    int lastProgress = -1;
+    emit progress(m_target, 0, in);
+    consumer.start();
+    while (!consumer.is_stopped() && !m_abort) {
+        QThread::msleep(pollInterval);
+        int pos = position;
+        int percent = qBound(0, 100 * pos / frames, 99);
+        if (percent > lastProgress) {
+            lastProgress = percent;
+            emit progress(m_target, percent, in + pos);
+            RenderProgress::Record current;
+            current.frame = in + pos;
+            current.frames = pos;
+            current.percent = percent;
+            current.fps = 1000. * pos / qMax(qint64(1), stageTimer.elapsed());
+            progressLog.write(current);
+        }
+    }
+    consumer.stop();
+    showEvent.reset();
+    record.stages.insert(QStringLiteral("encode"), stageTimer.elapsed());
+    record.frames = position;
+    record.fps = 1000. * record.frames / qMax(qint64(1), record.stages.value(QStringLiteral("encode")));
+
+    if (m_abort) {
+        QFile::remove(m_target);
+        record.event = RenderProgress::Event::Aborted;
+        progressLog.write(record);
+        emit finished(m_target, -3, QString());
+        return;
+    }
+    if (!QFile::exists(m_target)) {
+        fail(i18n("Rendering of %1 failed", m_target));
+        return;
+    }
+    record.event = RenderProgress::Event::Finished;
+    progressLog.write(record);
+    qCDebug(KDENLIVE_LOG) << "// In process render of" << m_target << "done in" << progressLog.elapsed() << "ms";
+    emit finished(m_target, -1, QString());
+}
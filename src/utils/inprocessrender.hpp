@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <atomic>
+
+class QDomElement;
+
+/** @brief This class renders a playlist written for kdenlive_render inside Kdenlive, on a worker thread.
+    Starting kdenlive_render initializes MLT and loads all its modules again, which takes longer than the
+    render itself for short exports. Here the already loaded MLT repository is used, and the playlist is
+    parsed into its own producer graph so that the timeline and monitors are not affected.
+    Progress and result are reported with the same values as the kdenlive_render DBus calls, and a timing
+    log is written like for external renders.
+ */
+
+class InProcessRender : public QObject
+{
+    Q_OBJECT
+
+public:
+    InProcessRender(const QString &playlist, const QString &target, QObject *parent = nullptr);
+    /* @brief Aborts the render and waits for the worker thread */
+    ~InProcessRender() override;
+
+    /* @brief Returns true if the render described by a playlist's consumer can be done in process
+       @param maxFrames is the maximum length of the render, longer renders use an external process
+    */
+    static bool canRender(const QDomElement &consumer, int maxFrames);
+
+    void start();
+    /* @brief Stop rendering, the partial file is deleted */
+    void abort();
+    bool isRunning() const;
+    const QString &target() const;
+
+private:
+    QString m_playlist;
+    QString m_target;
+    QFuture<void> m_future;
+    std::atomic<bool> m_abort{false};
+    void run();
+
+signals:
+    /* @brief Same parameters as the setRenderingProgress DBus call of kdenlive_render */
+    void progress(const QString &target, int progress, int frame);
+    /* @brief Same parameters as the setRenderingFinished DBus call: -1 success, -2 failure, -3 aborted */
+    void finished(const QString &target, int status, const QString &error);
+};
@@ -0,0 +1,274 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "probecache.hpp"
+#include "core.h"
+#include "kdenlive_debug.h"
+#include "profiles/profilemodel.hpp"
+#include "xml/xml.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <mlt++/MltProducer.h>
+
+std::unique_ptr<ProbeCache> ProbeCache::instance;
+std::once_flag ProbeCache::m_onceFlag;
+
+namespace {
+// Increase when the stored properties change
+const int probeCacheVersion = 1;
+// Entries not used for this number of days are deleted
+const int maxEntryAge = 90;
+// Maximum number of entries, the least recently used ones are deleted first
+const int maxEntries = 10000;
+
+// Producer properties that are set when avformat probes a file
+bool isProbeProperty(const QString &name)
+{
+    static const QStringList probeProperties = {QStringLiteral("length"), QStringLiteral("seekable"), QStringLiteral("video_index"),
+                                                QStringLiteral("audio_index"), QStringLiteral("aspect_ratio"), QStringLiteral("creation_time")};
+    return name.startsWith(QLatin1String("meta.media.")) || name.startsWith(QLatin1String("meta.attr.")) || probeProperties.contains(name);
+}
+} // namespace
+
+ProbeCache::ProbeCache() = default;
+
+std::unique_ptr<ProbeCache> &ProbeCache::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new ProbeCache()); });
+    return instance;
+}
+
+// static
+QString ProbeCache::entryPath(const QString &path, bool *ok)
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    *ok = dir.mkpath(QStringLiteral("probe"));
+    const QString key = QString::fromLatin1(QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Md5).toHex());
+    return dir.absoluteFilePath(QStringLiteral("probe/%1.json").arg(key));
+}
+
+QMap<QString, QString> ProbeCache::probeData(const QString &path, const QString &fileHash) const
+{
+    QFileInfo info(path);
+    if (path.isEmpty() || !info.exists()) {
+        return {};
+    }
+    QMap<QString, QString> properties;
+    QMutexLocker lock(&m_mutex);
+    if (m_entries.contains(path)) {
+        properties = m_entries.value(path);
+    } else {
+        bool ok = false;
+        QFile file(entryPath(path, &ok));
+        if (!ok || !file.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+        const QJsonObject entry = QJsonDocument::fromJson(file.readAll()).object();
+        // The modification time of an entry is its last use, for pruning
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        file.close();
+        if (entry.value(QLatin1String("version")).toInt() != probeCacheVersion || entry.value(QLatin1String("mlt")).toInt() != mlt_version_get_int() ||
+            entry.value(QLatin1String("path")).toString() != path) {
+            return {};
+        }
+        properties.insert(QStringLiteral("_size"), entry.value(QLatin1String("size")).toString());
+        properties.insert(QStringLiteral("_mtime"), entry.value(QLatin1String("mtime")).toString());
+        properties.insert(QStringLiteral("_hash"), entry.value(QLatin1String("hash")).toString());
+        const QJsonObject props = entry.value(QLatin1String("properties")).toObject();
+        for (auto it = props.constBegin(); it != props.constEnd(); ++it) {
+            properties.insert(it.key(), it.value().toString());
+        }
+        m_entries.insert(path, properties);
+    }
+    // The entry is only valid if the file did not change since it was probed
+    if (properties.value(QStringLiteral("_size")) != QString::number(info.size()) ||
+        properties.value(QStringLiteral("_mtime")) != QString::number(info.lastModified().toMSecsSinceEpoch())) {
+        return {};
+    }
+    const QString storedHash = properties.value(QStringLiteral("_hash"));
+    if (!fileHash.isEmpty() && !storedHash.isEmpty() && storedHash != fileHash) {
+        return {};
+    }
+    properties.remove(QStringLiteral("_size"));
+    properties.remove(QStringLiteral("_mtime"));
+    properties.remove(QStringLiteral("_hash"));
+    return properties;
+}
+
+void ProbeCache::storeProbeData(const QString &path, Mlt::Producer *producer, const QString &fileHash)
+{
+    if (path.isEmpty() || producer == nullptr || !producer->is_valid() || qstrcmp(producer->get("mlt_service"), "avformat") != 0) {
+        // Only a validating avformat producer has probed the file
+        return;
+    }
+    QMap<QString, QString> properties;
+    for (int i = 0; i < producer->count(); ++i) {
+        const QString name = QString::fromUtf8(producer->get_name(i));
+        if (isProbeProperty(name)) {
+            properties.insert(name, QString::fromUtf8(producer->get(i)));
+        }
+    }
+    if (properties.isEmpty()) {
+        return;
+    }
+    QtConcurrent::run(this, &ProbeCache::writeEntry, path, properties, fileHash);
+}
+
+void ProbeCache::writeEntry(const QString &path, const QMap<QString, QString> &properties, const QString &fileHash)
+{
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return;
+    }
+    QJsonObject props;
+    QMapIterator<QString, QString> i(properties);
+    while (i.hasNext()) {
+        i.next();
+        props.insert(i.key(), i.value());
+    }
+    QJsonObject entry;
+    entry.insert(QStringLiteral("version"), probeCacheVersion);
+    entry.insert(QStringLiteral("mlt"), mlt_version_get_int());
+    entry.insert(QStringLiteral("path"), path);
+    entry.insert(QStringLiteral("size"), QString::number(info.size()));
+    entry.insert(QStringLiteral("mtime"), QString::number(info.lastModified().toMSecsSinceEpoch()));
+    entry.insert(QStringLiteral("hash"), fileHash);
+    entry.insert(QStringLiteral("properties"), props);
+    QMap<QString, QString> cached = properties;
+    cached.insert(QStringLiteral("_size"), entry.value(QLatin1String("size")).toString());
+    cached.insert(QStringLiteral("_mtime"), entry.value(QLatin1String("mtime")).toString());
+    cached.insert(QStringLiteral("_hash"), fileHash);
+
+    QMutexLocker lock(&m_mutex);
+    m_entries.insert(path, cached);
+    bool ok = false;
+    QSaveFile file(entryPath(path, &ok));
+    if (!ok || !file.open(QIODevice::WriteOnly)) {
+        qCDebug(KDENLIVE_LOG) << "// Cannot write probe cache for " << path;
+        return;
+    }
+    file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact));
+    file.commit();
+    if (!m_pruned) {
+        // Once per session is enough, we are already in a separate thread
+        m_pruned = true;
+        prune();
+    }
+}
+
+// static
+void ProbeCache::prune()
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    if (!dir.cd(QStringLiteral("probe"))) {
+        return;
+    }
+    const QDateTime limit = QDateTime::currentDateTime().addDays(-maxEntryAge);
+    // Most recently used first
+    const QFileInfoList entries = dir.entryInfoList({QStringLiteral("*.json")}, QDir::Files, QDir::Time);
+    for (int i = 0; i < entries.count(); ++i) {
+        if (i >= maxEntries || entries.at(i).lastModified() < limit) {
+            QFile::remove(entries.at(i).absoluteFilePath());
+        }
+    }
+}
+
+std::shared_ptr<Mlt::Producer> ProbeCache::cachedProducer(const QString &path, const QString &fileHash) const
+{
+    const QMap<QString, QString> properties = probeData(path, fileHash);
+    if (properties.isEmpty()) {
+        return nullptr;
+    }
+    QString resource = path;
+    resource.prepend(QStringLiteral("avformat-novalidate:"));
+    auto producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, resource.toUtf8().constData());
+    if (!producer->is_valid()) {
+        return nullptr;
+    }
+    QMapIterator<QString, QString> i(properties);
+    while (i.hasNext()) {
+        i.next();
+        producer->set(i.key().toUtf8().constData(), i.value().toUtf8().constData());
+    }
+    if (producer->get_int("video_index") != -1) {
+        // Same as ClipController does when it switches a clip with video to avformat-novalidate
+        producer->set("mute_on_pause", 0);
+    }
+    return producer;
+}
+
+int ProbeCache::applyToDocument(QDomDocument &doc) const
+{
+    int lazyProducers = 0;
+    QDomNodeList producers = doc.elementsByTagName(QStringLiteral("producer"));
+    for (int i = 0; i < producers.count(); ++i) {
+        QDomElement prod = producers.at(i).toElement();
+        // Projects saved by Kdenlive already use avformat-novalidate, they need the cached properties too
+        const QString service = Xml::getXmlProperty(prod, QStringLiteral("mlt_service"));
+        if (service != QLatin1String("avformat") && service != QLatin1String("avformat-novalidate")) {
+            continue;
+        }
+        const QString resource = Xml::getXmlProperty(prod, QStringLiteral("resource"));
+        QString path = resource;
+        if (QFileInfo(path).isRelative()) {
+            path = QDir(doc.documentElement().attribute(QStringLiteral("root"))).absoluteFilePath(resource);
+        }
+        const QMap<QString, QString> properties = probeData(path, Xml::getXmlProperty(prod, QStringLiteral("kdenlive:file_hash")));
+        if (properties.isEmpty()) {
+            continue;
+        }
+        // Only add what is missing, the project may have specific stream indexes
+        QMapIterator<QString, QString> j(properties);
+        while (j.hasNext()) {
+            j.next();
+            if (!Xml::hasXmlProperty(prod, j.key())) {
+                Xml::setXmlProperty(prod, j.key(), j.value());
+            }
+        }
+        if (service == QLatin1String("avformat") && Xml::getXmlProperty(prod, QStringLiteral("video_index")) != QLatin1String("-1") &&
+            !Xml::hasXmlProperty(prod, QStringLiteral("mute_on_pause"))) {
+            // ClipController only sets this when it switches the service itself
+            Xml::setXmlProperty(prod, QStringLiteral("mute_on_pause"), QStringLiteral("0"));
+        }
+        Xml::setXmlProperty(prod, QStringLiteral("mlt_service"), QStringLiteral("avformat-novalidate"));
+        lazyProducers++;
+    }
+    return lazyProducers;
+}
+
+void ProbeCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    if (dir.cd(QStringLiteral("probe"))) {
+        dir.removeRecursively();
+    }
+}
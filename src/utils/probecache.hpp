@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QDomDocument>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <mutex>
+
+namespace Mlt {
+class Producer;
+}
+
+/** @brief This class is a persistent cache of the stream layout and metadata of media files.
+    Opening an avformat producer probes the file, which is slow on network storage. The probe result
+    (meta.media.* properties, stream indexes, length) is stored per file, and is valid as long as the
+    file size, modification time and hash (when known) did not change. Producers for files with a valid
+    entry are created with the avformat-novalidate service, which only opens the file when the first frame
+    is requested.
+    Entries that were not used for some time are deleted, and the number of entries is bounded.
+ * Note that this class is a Singleton
+ */
+
+class ProbeCache
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<ProbeCache> &get();
+
+    /* @brief Returns the cached probe properties for a file, or an empty map if there is no valid entry
+       @param path is the media file
+       @param fileHash is the kdenlive:file_hash of the clip, if known. It must match the stored hash
+    */
+    QMap<QString, QString> probeData(const QString &path, const QString &fileHash = QString()) const;
+
+    /* @brief Store the probe properties of a producer that opened its file
+       @param path is the media file
+       @param producer must be a valid avformat producer
+       @param fileHash is the kdenlive:file_hash of the clip, if known
+    */
+    void storeProbeData(const QString &path, Mlt::Producer *producer, const QString &fileHash = QString());
+
+    /* @brief Create an avformat producer, skipping the probe if the cache has a valid entry
+       Returns nullptr if there is no valid entry */
+    std::shared_ptr<Mlt::Producer> cachedProducer(const QString &path, const QString &fileHash = QString()) const;
+
+    /* @brief Switch the avformat producers of a project document to lazy loading when their cache entry is valid
+       @return the number of producers that will skip probing
+    */
+    int applyToDocument(QDomDocument &doc) const;
+
+    /* @brief Remove all entries */
+    void clear();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    ProbeCache();
+
+    // Return the file where the entry for a media file is stored
+    static QString entryPath(const QString &path, bool *ok);
+
+    static std::unique_ptr<ProbeCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the repository only once;
+
+    mutable QMutex m_mutex;
+    // Entries read or written during this session, by file path
+    mutable QMap<QString, QMap<QString, QString>> m_entries;
+
+    // Write an entry to disk, called from a separate thread
+    void writeEntry(const QString &path, const QMap<QString, QString> &properties, const QString &fileHash);
+    // Delete the entries unused for too long, and the least recently used ones above the maximum count
+    static void prune();
+    bool m_pruned{false};
+};
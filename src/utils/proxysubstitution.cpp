@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "proxysubstitution.hpp"
+
+#include <KLocalizedString>
+
+namespace {
+// Proxy sizes are rounded to even dimensions, allow a few pixels less than the needed size
+const double sizeTolerance = 0.98;
+} // namespace
+
+ProxySubstitution::ProxySubstitution(const QSize &outputSize)
+    : m_outputSize(outputSize)
+{
+}
+
+void ProxySubstitution::addClip(const QString &proxy, const Clip &clip)
+{
+    m_clips.insert(proxy, clip);
+}
+
+bool ProxySubstitution::contains(const QString &proxy) const
+{
+    return m_clips.contains(proxy);
+}
+
+// static
+bool ProxySubstitution::proxyIsSufficient(const QSize &proxySize, const QSize &originalSize, const QSize &outputSize)
+{
+    if (proxySize.isEmpty() || originalSize.isEmpty() || outputSize.isEmpty()) {
+        return false;
+    }
+    // The frame size the original is scaled to in the output, it is never upscaled beyond its own size
+    QSize needed = originalSize;
+    if (originalSize.width() > outputSize.width() || originalSize.height() > outputSize.height()) {
+        needed = originalSize.scaled(outputSize, Qt::KeepAspectRatio);
+    }
+    return proxySize.width() >= needed.width() * sizeTolerance && proxySize.height() >= needed.height() * sizeTolerance;
+}
+
+QString ProxySubstitution::resource(const QString &proxy)
+{
+    auto clip = m_clips.constFind(proxy);
+    if (clip == m_clips.constEnd()) {
+        return proxy;
+    }
+    bool useProxy = proxyIsSufficient(clip->proxySize, clip->originalSize, m_outputSize);
+    m_useProxy.insert(proxy, useProxy);
+    return useProxy ? proxy : clip->original;
+}
+
+QStringList ProxySubstitution::proxyClips() const
+{
+    QStringList names;
+    for (auto i = m_useProxy.constBegin(); i != m_useProxy.constEnd(); ++i) {
+        if (i.value()) {
+            names << m_clips.value(i.key()).name;
+        }
+    }
+    return names;
+}
+
+QStringList ProxySubstitution::originalClips() const
+{
+    QStringList names;
+    for (auto i = m_useProxy.constBegin(); i != m_useProxy.constEnd(); ++i) {
+        if (!i.value()) {
+            names << m_clips.value(i.key()).name;
+        }
+    }
+    return names;
+}
+
+QString ProxySubstitution::summary() const
+{
+    return i18n("%1 clips rendered from proxy, %2 from original", proxyClips().count(), originalClips().count());
+}
+
+QString ProxySubstitution::report() const
+{
+    QStringList lines;
+    for (auto i = m_useProxy.constBegin(); i != m_useProxy.constEnd(); ++i) {
+        const Clip clip = m_clips.value(i.key());
+        const QSize size = i.value() ? clip.proxySize : clip.originalSize;
+        lines << i18nc("Clip name, source used for rendering and its frame size", "%1: %2 (%3x%4)", clip.name,
+                       i.value() ? i18n("proxy") : i18n("original"), size.width(), size.height());
+    }
+    return lines.join(QLatin1Char('\n'));
+}
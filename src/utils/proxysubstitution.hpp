@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QMap>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+/** @brief This class decides, for each proxied clip of a render, whether the proxy or the original clip is used.
+    A proxy is used when it has enough resolution for the output: the original would be downscaled to the output
+    size anyway, so a proxy at least as large as that downscaled frame gives the same picture. Clips with unknown
+    frame sizes always use their original.
+    The choices are recorded so that the render job can report which sources were used.
+ */
+class ProxySubstitution
+{
+
+public:
+    struct Clip
+    {
+        QString name;
+        QString original;
+        QSize originalSize;
+        QSize proxySize;
+    };
+
+    explicit ProxySubstitution(const QSize &outputSize);
+
+    /* @brief Register a proxied clip
+       @param proxy is the absolute path of the proxy file, as found in the playlist
+    */
+    void addClip(const QString &proxy, const Clip &clip);
+    /* @brief Returns true if this resource is the proxy of a registered clip */
+    bool contains(const QString &proxy) const;
+    /* @brief Returns the resource to render for a proxy: the proxy itself if its resolution is sufficient, the original otherwise */
+    QString resource(const QString &proxy);
+
+    /* @brief Returns true if a proxy of proxySize can replace an original of originalSize in an output of outputSize */
+    static bool proxyIsSufficient(const QSize &proxySize, const QSize &originalSize, const QSize &outputSize);
+
+    /* @brief The names of the clips rendered from their proxy / from their original */
+    QStringList proxyClips() const;
+    QStringList originalClips() const;
+    /* @brief One line summary of the sources used */
+    QString summary() const;
+    /* @brief List of the clips and their source */
+    QString report() const;
+
+private:
+    QSize m_outputSize;
+    QMap<QString, Clip> m_clips;
+    QMap<QString, bool> m_useProxy;
+};
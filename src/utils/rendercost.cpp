@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "rendercost.hpp"
+
+#include <QVariantMap>
+#include <algorithm>
+
+void RenderCost::addChunk(int frame, int frames, double time)
+{
+    if (frames <= 0 || time < 0) {
+        return;
+    }
+    m_chunks.insert(frame, {frames, time});
+}
+
+void RenderCost::invalidate(int startFrame, int endFrame)
+{
+    auto it = m_chunks.begin();
+    while (it != m_chunks.end()) {
+        if (it.key() <= endFrame && it.key() + it->frames > startFrame) {
+            it = m_chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RenderCost::clear()
+{
+    m_chunks.clear();
+}
+
+bool RenderCost::isEmpty() const
+{
+    return m_chunks.isEmpty();
+}
+
+double RenderCost::frameCost(int frame) const
+{
+    auto it = m_chunks.constFind(frame);
+    if (it == m_chunks.constEnd()) {
+        return -1;
+    }
+    return it->time / it->frames;
+}
+
+double RenderCost::totalTime(int *frames) const
+{
+    double time = 0;
+    int count = 0;
+    for (const Chunk &chunk : m_chunks) {
+        time += chunk.time;
+        count += chunk.frames;
+    }
+    if (frames) {
+        *frames = count;
+    }
+    return time;
+}
+
+QVariantList RenderCost::heatmap() const
+{
+    double maxCost = 0;
+    for (const Chunk &chunk : m_chunks) {
+        maxCost = qMax(maxCost, chunk.time / chunk.frames);
+    }
+    QVariantList result;
+    QMapIterator<int, Chunk> i(m_chunks);
+    while (i.hasNext()) {
+        i.next();
+        const double cost = i.value().time / i.value().frames;
+        QVariantMap entry;
+        entry.insert(QStringLiteral("frame"), i.key());
+        entry.insert(QStringLiteral("frames"), i.value().frames);
+        entry.insert(QStringLiteral("cost"), cost);
+        entry.insert(QStringLiteral("level"), maxCost > 0 ? cost / maxCost : 0.);
+        result << entry;
+    }
+    return result;
+}
+
+QVector<RenderCost::ItemCost> RenderCost::attribute(const QVector<Item> &items) const
+{
+    QVector<ItemCost> result;
+    result.reserve(items.size());
+    for (const Item &item : items) {
+        result.append({item.id, item.name, 0., 0});
+    }
+    QVector<int> overlaps(items.size());
+    QMapIterator<int, Chunk> i(m_chunks);
+    while (i.hasNext()) {
+        i.next();
+        const int start = i.key();
+        const int end = start + i.value().frames;
+        int covered = 0;
+        for (int ix = 0; ix < items.size(); ix++) {
+            const Item &item = items.at(ix);
+            overlaps[ix] = qMax(0, qMin(end, item.position + item.duration) - qMax(start, item.position));
+            covered += overlaps.at(ix);
+        }
+        if (covered == 0) {
+            // Nothing but blanks, the time is not charged to anything
+            continue;
+        }
+        for (int ix = 0; ix < items.size(); ix++) {
+            if (overlaps.at(ix) > 0) {
+                result[ix].time += i.value().time * overlaps.at(ix) / covered;
+                result[ix].frames += overlaps.at(ix);
+            }
+        }
+    }
+    result.erase(std::remove_if(result.begin(), result.end(), [](const ItemCost &cost) { return cost.frames == 0; }), result.end());
+    std::sort(result.begin(), result.end(), [](const ItemCost &a, const ItemCost &b) { return a.time > b.time; });
+    return result;
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+/** @brief This class collects the wall time spent rendering each timeline preview chunk, so that
+    the expensive parts of a timeline can be shown on the ruler. The time of a chunk is attributed to
+    the timeline items (clips, compositions) active in it, in proportion of the frames they cover.
+ */
+
+class RenderCost
+{
+
+public:
+    /* @brief A timeline item that can be charged for render time */
+    struct Item
+    {
+        int id;
+        QString name;
+        int position;
+        int duration;
+    };
+    /* @brief The render time attributed to an item */
+    struct ItemCost
+    {
+        int id;
+        QString name;
+        // Attributed time in milliseconds
+        double time;
+        // Frames of the item lying in measured chunks
+        int frames;
+    };
+
+    /* @brief Store the render time of a chunk
+       @param frame is the first frame of the chunk
+       @param frames is the count of rendered frames
+       @param time is the wall time in milliseconds
+    */
+    void addChunk(int frame, int frames, double time);
+    /* @brief Forget the measures of the chunks lying between two frames, because the timeline changed there */
+    void invalidate(int startFrame, int endFrame);
+    void clear();
+    bool isEmpty() const;
+    /* @brief Returns the milliseconds per frame of the chunk starting at frame, or -1 if not measured */
+    double frameCost(int frame) const;
+    /* @brief Returns the total measured time and frames */
+    double totalTime(int *frames = nullptr) const;
+
+    /* @brief Returns the heatmap drawn on the ruler: a map per chunk with its first frame (frame), length (frames),
+       milliseconds per frame (cost) and cost relative to the most expensive chunk (level, 0 to 1) */
+    QVariantList heatmap() const;
+    /* @brief Share the time of every chunk between the items active in it, most expensive items first */
+    QVector<ItemCost> attribute(const QVector<Item> &items) const;
+
+private:
+    struct Chunk
+    {
+        int frames;
+        double time;
+    };
+    QMap<int, Chunk> m_chunks;
+};
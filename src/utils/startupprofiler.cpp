@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "startupprofiler.hpp"
+#include "kdenlive_debug.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+std::unique_ptr<StartupProfiler> StartupProfiler::instance;
+std::once_flag StartupProfiler::m_onceFlag;
+
+StartupProfiler::StartupProfiler()
+{
+    m_clock.start();
+}
+
+std::unique_ptr<StartupProfiler> &StartupProfiler::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new StartupProfiler()); });
+    return instance;
+}
+
+void StartupProfiler::setLogFile(const QString &path)
+{
+    m_logFile = path;
+}
+
+int StartupProfiler::begin(const QString &name)
+{
+    // Only the startup sequence in the main thread is profiled
+    if (m_finished || (QCoreApplication::instance() && QThread::currentThread() != QCoreApplication::instance()->thread())) {
+        return -1;
+    }
+    m_entries.append({name, m_depth++, m_clock.elapsed(), -1});
+    return m_entries.size() - 1;
+}
+
+void StartupProfiler::end(int index)
+{
+    if (index < 0 || index >= m_entries.size()) {
+        return;
+    }
+    m_depth--;
+    m_entries[index].duration = m_clock.elapsed() - m_entries.at(index).start;
+}
+
+StartupProfiler::Phase::Phase(const QString &name)
+    : m_index(StartupProfiler::get()->begin(name))
+{
+}
+
+StartupProfiler::Phase::~Phase()
+{
+    StartupProfiler::get()->end(m_index);
+}
+
+void StartupProfiler::Phase::next(const QString &name)
+{
+    StartupProfiler::get()->end(m_index);
+    m_index = StartupProfiler::get()->begin(name);
+}
+
+void StartupProfiler::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    qint64 total = m_clock.elapsed();
+    qCDebug(KDENLIVE_LOG) << "// Startup finished in " << total << "ms";
+    if (m_logFile.isEmpty()) {
+        m_entries.clear();
+        return;
+    }
+    QFile file(m_logFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(KDENLIVE_LOG) << "// Cannot write startup profile to " << m_logFile;
+        return;
+    }
+    QTextStream out(&file);
+    out << "Kdenlive startup profile, " << total << " ms until the project was ready\n";
+    out << "   start   duration  phase\n";
+    for (const Entry &entry : qAsConst(m_entries)) {
+        out << QString::number(entry.start).rightJustified(8) << QString::number(entry.duration).rightJustified(8) << " ms  "
+            << QString(entry.depth * 2, QLatin1Char(' ')) << entry.name << '\n';
+    }
+    m_entries.clear();
+}
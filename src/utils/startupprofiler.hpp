@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Kdenlive developers                             *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <mutex>
+
+/** @brief This class records how long each phase of the application startup takes. Phases can be nested, they are
+    recorded with a StartupProfiler::Phase object living for the duration of the phase. Recording is cheap and always
+    active until the first project is ready, the report is only written to a log file when requested with the
+    --startup-profile command line option.
+ * Note that this class is a Singleton
+ */
+
+class StartupProfiler
+{
+
+public:
+    // Returns the instance of the Singleton, the startup clock starts on the first call
+    static std::unique_ptr<StartupProfiler> &get();
+
+    /* @brief Write the report to the given file when startup is finished */
+    void setLogFile(const QString &path);
+    /* @brief Stop recording, print the total startup time and write the report if requested */
+    void finish();
+
+    /* @brief Records the duration of a startup phase, from its construction to its destruction */
+    class Phase
+    {
+    public:
+        explicit Phase(const QString &name);
+        ~Phase();
+        /* @brief End this phase and start the next one at the same level */
+        void next(const QString &name);
+
+    private:
+        int m_index;
+    };
+
+protected:
+    // Constructor is protected because class is a Singleton
+    StartupProfiler();
+
+    struct Entry
+    {
+        QString name;
+        int depth;
+        qint64 start;
+        qint64 duration;
+    };
+
+    static std::unique_ptr<StartupProfiler> instance;
+    static std::once_flag m_onceFlag; // flag to create the repository only once;
+
+    QElapsedTimer m_clock;
+    QVector<Entry> m_entries;
+    QString m_logFile;
+    int m_depth{0};
+    bool m_finished{false};
+
+    // Returns the index of the entry, or -1 if not recording
+    int begin(const QString &name);
+    void end(int index);
+};
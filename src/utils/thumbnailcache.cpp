@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 #include "thumbnailcache.hpp"
+#include "cacheusage.hpp"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
@@ -187,8 +188,10 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     if (persistent) {
         QDir thumbFolder = getDir(false, &ok);
         if (ok) {
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: "<<thumbFolder.absoluteFilePath(key);
+            const QString path = thumbFolder.absoluteFilePath(key);
+            qint64 previousSize = CacheUsage::fileSize(path);
+            if (img.save(path)) {
+                CacheUsage::get()->fileWritten(CacheThumbs, path, previousSize);
             }
             m_storedOnDisk[binId].push_back(pos);
             // if volatile cache also contains this entry, update it
@@ -205,6 +208,60 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     }
 }
 
+void ThumbnailCache::storeThumbnails(const QString &binId, const QMap<int, QImage> &thumbs, bool persistent)
+{
+    bool ok = false;
+    QDir thumbFolder;
+    QMap<int, QString> positionKeys;
+    {
+        // Like in storeThumbnail, the clip and folder lookups are done under the lock
+        QMutexLocker locker(&m_mutex);
+        if (persistent) {
+            thumbFolder = getDir(false, &ok);
+            if (!ok) {
+                return;
+            }
+        }
+        for (auto i = thumbs.constBegin(); i != thumbs.constEnd(); ++i) {
+            const QString key = getKey(binId, i.key(), &ok);
+            if (!ok) {
+                return;
+            }
+            positionKeys.insert(i.key(), key);
+        }
+    }
+    // Disk writes don't need the lock, only the bookkeeping does
+    QMap<QString, int> keys;
+    QMapIterator<int, QString> i(positionKeys);
+    while (i.hasNext()) {
+        i.next();
+        if (persistent) {
+            const QString path = thumbFolder.absoluteFilePath(i.value());
+            qint64 previousSize = CacheUsage::fileSize(path);
+            if (!thumbs.value(i.key()).save(path)) {
+                continue;
+            }
+            CacheUsage::get()->fileWritten(CacheThumbs, path, previousSize);
+        }
+        keys.insert(i.value(), i.key());
+    }
+    QMutexLocker locker(&m_mutex);
+    QMapIterator<QString, int> k(keys);
+    while (k.hasNext()) {
+        k.next();
+        const QImage &img = thumbs.value(k.value());
+        if (persistent) {
+            m_storedOnDisk[binId].push_back(k.value());
+        }
+        if (m_volatileCache->contains(k.key())) {
+            m_volatileCache->remove(k.key());
+        } else {
+            m_storedVolatile[binId].push_back(k.value());
+        }
+        m_volatileCache->insert(k.key(), img, (int)img.sizeInBytes());
+    }
+}
+
 void ThumbnailCache::saveCachedThumbs(QStringList keys)
 {
     bool ok;
@@ -215,10 +272,13 @@ void ThumbnailCache::saveCachedThumbs(QStringList keys)
     for (const QString &key : keys) {
         if (!thumbFolder.exists(key) && m_volatileCache->contains(key)) {
             QImage img = m_volatileCache->get(key);
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
+            const QString path = thumbFolder.absoluteFilePath(key);
+            qint64 previousSize = CacheUsage::fileSize(path);
+            if (!img.save(path)) {
                 qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
                 break;
             }
+            CacheUsage::get()->fileWritten(CacheThumbs, path, previousSize);
         }
     }
 }
@@ -246,7 +306,7 @@ void ThumbnailCache::invalidateThumbsForClip(const QString &binId)
             if (pos >= 0) {
                 auto key = getKey(binId, pos, &ok);
                 if (ok) {
-                    QFile::remove(thumbFolder.absoluteFilePath(key));
+                    CacheUsage::get()->removeFile(CacheThumbs, thumbFolder.absoluteFilePath(key));
                 }
             }
         }
@@ -25,6 +25,7 @@
 #include <QDir>
 #include <QUrl>
 #include <QImage>
+#include <QMap>
 #include <QMutex>
 #include <memory>
 #include <mutex>
@@ -70,6 +71,13 @@ public:
     */
     void storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent = false);
 
+    /* @brief Store a batch of thumbnails for a clip, with a single cache lock
+       @param binId is the id of the clip
+       @param thumbs maps positions to images
+       @param persistent if true, we store the images in the persistent cache, which generates disk access
+    */
+    void storeThumbnails(const QString &binId, const QMap<int, QImage> &thumbs, bool persistent = false);
+
     /* @brief Removes all the thumbnails for a given clip */
     void invalidateThumbsForClip(const QString &binId);
 
@@ -0,0 +1,178 @@
+#include "catch.hpp"
+
+#include "utils/analysistrack.hpp"
+#include <QDataStream>
+#include <cmath>
+
+TEST_CASE("Analysis track storage", "[AnalysisTrack]")
+{
+    const QString data = QStringLiteral("0=10 20 100 50 1;1~=12 21 100 50 1;5|=20 25.5 110 55 1");
+
+    SECTION("Parse and serialize")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(data);
+        REQUIRE(track.isValid());
+        REQUIRE(track.count() == 3);
+        REQUIRE(track.components() == 5);
+        REQUIRE(track.frame(2) == 5);
+        REQUIRE(track.keyframeType(1) == '~');
+        REQUIRE(track.value(2, 1) == 25.5f);
+        REQUIRE(track.toAnimation() == data);
+    }
+
+    SECTION("Unsupported data is rejected")
+    {
+        REQUIRE_FALSE(AnalysisTrack::fromAnimation(QStringLiteral("00:00:00.000=10 20")).isValid());
+        REQUIRE_FALSE(AnalysisTrack::fromAnimation(QStringLiteral("0=10 20 100 100 100%")).isValid());
+        REQUIRE_FALSE(AnalysisTrack::fromAnimation(QStringLiteral("0=10 20;5=10")).isValid());
+        REQUIRE_FALSE(AnalysisTrack::fromAnimation(QStringLiteral("5=10;0=10")).isValid());
+        REQUIRE_FALSE(AnalysisTrack::fromAnimation(QString()).isValid());
+    }
+
+    SECTION("Offset and transform")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(data);
+        track.offsetFrames(10);
+        track.transform(0, 2.f, 1.f);
+        REQUIRE(track.frame(0) == 10);
+        REQUIRE(track.frame(2) == 15);
+        REQUIRE(track.value(0, 0) == 21.f);
+        REQUIRE(track.value(2, 0) == 41.f);
+        REQUIRE(track.value(2, 1) == 25.5f);
+    }
+
+    SECTION("Merge")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(data);
+        AnalysisTrack other = AnalysisTrack::fromAnimation(QStringLiteral("1=0 0 10 10 1;8=1 1 10 10 1"));
+        REQUIRE(track.merge(other));
+        REQUIRE(track.count() == 4);
+        REQUIRE(track.frame(1) == 1);
+        REQUIRE(track.value(1, 2) == 10.f);
+        REQUIRE(track.frame(3) == 8);
+        REQUIRE_FALSE(track.merge(AnalysisTrack::fromAnimation(QStringLiteral("0=1"))));
+    }
+
+    SECTION("Interpolation")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(QStringLiteral("0=0 0;10=100 50;20|=0 0;30=10 10"));
+        double values[2];
+        track.valuesAt(5, values);
+        REQUIRE(values[0] == 50.f);
+        REQUIRE(values[1] == 25.f);
+        track.valuesAt(25, values);
+        REQUIRE(values[0] == 0.f);
+        track.valuesAt(-5, values);
+        REQUIRE(values[0] == 0.f);
+        track.valuesAt(40, values);
+        REQUIRE(values[0] == 10.f);
+    }
+
+    SECTION("Binary round trip")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(data);
+        QByteArray binary = track.toBinary();
+        AnalysisTrack loaded = AnalysisTrack::fromBinary(binary);
+        REQUIRE(loaded.isValid());
+        REQUIRE(loaded.toAnimation() == data);
+        binary.chop(4);
+        REQUIRE_FALSE(AnalysisTrack::fromBinary(binary).isValid());
+        REQUIRE(AnalysisTrack::load(data)->count() == 3);
+        REQUIRE(AnalysisTrack::resolve(data) == data);
+    }
+
+    SECTION("Values keep double precision")
+    {
+        const QString precise = QStringLiteral("0=0.123456789012;10=1234567.891");
+        AnalysisTrack track = AnalysisTrack::fromAnimation(precise);
+        REQUIRE(track.value(0, 0) == 0.123456789012);
+        REQUIRE(AnalysisTrack::fromBinary(track.toBinary()).toAnimation() == precise);
+    }
+
+    SECTION("Single precision sidecars are read")
+    {
+        QByteArray payload;
+        QDataStream body(&payload, QIODevice::WriteOnly);
+        body.setByteOrder(QDataStream::LittleEndian);
+        body.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        body << qint32(0) << qint32(5);
+        body.writeRawData("\0|", 2);
+        body << 1.5f << 2.f;
+        QByteArray binary;
+        QDataStream header(&binary, QIODevice::WriteOnly);
+        header.setByteOrder(QDataStream::LittleEndian);
+        header << quint32(0x4b444154) << quint16(1) << quint16(1) << quint32(2);
+        binary.append(qCompress(payload));
+        REQUIRE(AnalysisTrack::fromBinary(binary).toAnimation() == QStringLiteral("0=1.5;5|=2"));
+    }
+}
+
+TEST_CASE("Analysis track simplification", "[AnalysisTrack]")
+{
+    SECTION("Linear data is reduced to its ends")
+    {
+        AnalysisTrack track(2);
+        for (int i = 0; i <= 100; ++i) {
+            track.append(i, 0, {double(2 * i), double(-i)});
+        }
+        double deviation = -1;
+        AnalysisTrack result = track.simplified(0.5, &deviation);
+        REQUIRE(result.count() == 2);
+        REQUIRE(result.frame(0) == 0);
+        REQUIRE(result.frame(1) == 100);
+        REQUIRE(deviation == 0.);
+    }
+
+    SECTION("Deviation stays within tolerance")
+    {
+        AnalysisTrack track(1);
+        for (int i = 0; i <= 200; ++i) {
+            track.append(i, 0, {double(50. * std::sin(i / 10.))});
+        }
+        double deviation = -1;
+        AnalysisTrack result = track.simplified(1., &deviation);
+        REQUIRE(result.count() < track.count() / 4);
+        REQUIRE(deviation <= 1.);
+        double values[1];
+        for (int i = 0; i < track.count(); ++i) {
+            result.valuesAt(track.frame(i), values);
+            REQUIRE(std::abs(values[0] - track.value(i, 0)) <= 1.f);
+        }
+    }
+
+    SECTION("Smooth keyframes are checked with their spline")
+    {
+        AnalysisTrack track(1);
+        for (int i = 0; i <= 200; ++i) {
+            track.append(i, '~', {double(50. * std::sin(i / 10.))});
+        }
+        double deviation = -1;
+        AnalysisTrack result = track.simplified(0.5, &deviation);
+        REQUIRE(result.count() < track.count() / 4);
+        REQUIRE(deviation <= 0.5);
+        double values[1];
+        for (int i = 0; i < track.count(); ++i) {
+            result.valuesAt(track.frame(i), values);
+            REQUIRE(std::abs(values[0] - track.value(i, 0)) <= 0.5f);
+        }
+    }
+
+    SECTION("Each component has its own tolerance")
+    {
+        AnalysisTrack track(2);
+        for (int i = 0; i <= 100; ++i) {
+            track.append(i, 0, {double(i % 2), double(10 * (i % 2))});
+        }
+        double deviation = -1;
+        REQUIRE(track.simplified(QVector<double>{2., 20.}, &deviation).count() == 2);
+        REQUIRE(deviation <= 1.);
+        REQUIRE(track.simplified(QVector<double>{2., 5.}).count() > 2);
+    }
+
+    SECTION("Discrete steps are kept")
+    {
+        AnalysisTrack track = AnalysisTrack::fromAnimation(QStringLiteral("0=0;1=1;2|=2;3=10;4=11;5=12"));
+        AnalysisTrack result = track.simplified(0.5);
+        REQUIRE(result.toAnimation() == QStringLiteral("0=0;2|=2;3=10;5=12"));
+    }
+}
@@ -0,0 +1,63 @@
+#include "catch.hpp"
+
+#include "project/archivecopier.h"
+#include <QEventLoop>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTimer>
+
+namespace {
+// Files with the same size, start and end, only their middle differs
+void writeMedia(const QString &path, char middle)
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(3 * 1024 * 1024, 'a'));
+    file.seek(3 * 1024 * 1024 / 2);
+    file.write(QByteArray(1, middle));
+}
+
+bool archive(ArchiveCopier &copier)
+{
+    bool success = false;
+    QEventLoop loop;
+    QObject::connect(&copier, &ArchiveCopier::finished, &loop, [&](bool result, const QString &) {
+        success = result;
+        loop.quit();
+    });
+    QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+    copier.start();
+    loop.exec();
+    return success;
+}
+} // namespace
+
+TEST_CASE("Archive deduplication", "[ArchiveCopier]")
+{
+    QTemporaryDir source;
+    QTemporaryDir dest;
+    REQUIRE(source.isValid());
+    REQUIRE(dest.isValid());
+    writeMedia(source.filePath(QStringLiteral("stem1.wav")), 'x');
+    writeMedia(source.filePath(QStringLiteral("stem2.wav")), 'y');
+    writeMedia(source.filePath(QStringLiteral("copy.wav")), 'x');
+
+    ArchiveCopier copier(dest.path());
+    copier.addFile(source.filePath(QStringLiteral("stem1.wav")), QStringLiteral("audio/stem1.wav"));
+    copier.addFile(source.filePath(QStringLiteral("stem2.wav")), QStringLiteral("audio/stem2.wav"));
+    copier.addFile(source.filePath(QStringLiteral("copy.wav")), QStringLiteral("audio/copy.wav"));
+    REQUIRE(archive(copier));
+    // Same fingerprint but different content: both are archived
+    REQUIRE(copier.destinationFor(source.filePath(QStringLiteral("stem2.wav"))).isEmpty());
+    REQUIRE(QFile::exists(dest.filePath(QStringLiteral("audio/stem2.wav"))));
+    // Identical content is shared
+    REQUIRE(copier.destinationFor(source.filePath(QStringLiteral("copy.wav"))) == QLatin1String("audio/stem1.wav"));
+
+    // An existing copy with a different content is replaced
+    writeMedia(dest.filePath(QStringLiteral("audio/stem2.wav")), 'z');
+    REQUIRE(archive(copier));
+    QFile copy(dest.filePath(QStringLiteral("audio/stem2.wav")));
+    REQUIRE(copy.open(QIODevice::ReadOnly));
+    copy.seek(3 * 1024 * 1024 / 2);
+    REQUIRE(copy.read(1) == QByteArray(1, 'y'));
+}
@@ -0,0 +1,124 @@
+#include "catch.hpp"
+
+#include "utils/audiomixdown.hpp"
+#include "xml/xml.hpp"
+
+#include <QDomDocument>
+#include <memory>
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+namespace {
+// A timeline with a video track (with a composition) and an audio track, and a video and an audio master effect
+const QString timeline = QStringLiteral(
+    "<mlt LC_NUMERIC=\"C\"><profile width=\"320\" height=\"240\" frame_rate_num=\"25\" frame_rate_den=\"1\" progressive=\"1\" "
+    "sample_aspect_num=\"1\" sample_aspect_den=\"1\" display_aspect_num=\"4\" display_aspect_den=\"3\" colorspace=\"601\"/>"
+    "<producer id=\"videoclip\" in=\"0\" out=\"99\"><property name=\"mlt_service\">color</property><property name=\"resource\">red</property>"
+    "<property name=\"length\">100</property></producer>"
+    "<producer id=\"audioclip\" in=\"0\" out=\"99\"><property name=\"mlt_service\">tone</property><property name=\"frequency\">440</property>"
+    "<property name=\"length\">100</property></producer>"
+    "<playlist id=\"main_bin\"><entry producer=\"videoclip\" in=\"0\" out=\"99\"/><entry producer=\"audioclip\" in=\"0\" out=\"99\"/></playlist>"
+    "<producer id=\"black_track\" in=\"0\" out=\"99\"><property name=\"mlt_service\">color</property><property name=\"resource\">black</property>"
+    "<property name=\"length\">100</property><property name=\"set.test_audio\">0</property></producer>"
+    "<playlist id=\"playlist0\"><entry producer=\"videoclip\" in=\"0\" out=\"99\"/></playlist>"
+    "<tractor id=\"tractor0\" in=\"0\" out=\"99\"><track producer=\"playlist0\"/></tractor>"
+    "<playlist id=\"playlist1\"><blank length=\"10\"/><entry producer=\"audioclip\" in=\"0\" out=\"89\"/></playlist>"
+    "<tractor id=\"tractor1\" in=\"0\" out=\"99\"><property name=\"kdenlive:audio_track\">1</property><track producer=\"playlist1\"/></tractor>"
+    "<tractor id=\"maintractor\" global_feed=\"1\" in=\"0\" out=\"99\"><track producer=\"black_track\"/><track producer=\"tractor0\"/>"
+    "<track producer=\"tractor1\"/>"
+    "<transition id=\"transition0\"><property name=\"a_track\">0</property><property name=\"b_track\">1</property>"
+    "<property name=\"mlt_service\">composite</property><property name=\"always_active\">1</property></transition>"
+    "<transition id=\"transition1\"><property name=\"a_track\">0</property><property name=\"b_track\">2</property>"
+    "<property name=\"mlt_service\">mix</property><property name=\"always_active\">1</property><property name=\"sum\">1</property></transition>"
+    "<filter id=\"filter0\"><property name=\"mlt_service\">brightness</property><property name=\"kdenlive_id\">brightness</property></filter>"
+    "<filter id=\"filter1\"><property name=\"mlt_service\">volume</property><property name=\"kdenlive_id\">volume</property>"
+    "<property name=\"gain\">0.5</property></filter>"
+    "</tractor></mlt>");
+
+QByteArray mixdown(const QString &xml, int frames)
+{
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "xml-string", xml.toUtf8().constData());
+    if (!producer.is_valid()) {
+        return QByteArray();
+    }
+    QByteArray result;
+    for (int i = 0; i < frames; ++i) {
+        producer.seek(i);
+        std::unique_ptr<Mlt::Frame> frame(producer.get_frame());
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = mlt_sample_calculator(25, frequency, i);
+        auto *data = static_cast<const char *>(frame->get_audio(format, frequency, channels, samples));
+        if (data == nullptr) {
+            return QByteArray();
+        }
+        result.append(data, samples * channels * 2);
+    }
+    return result;
+}
+} // namespace
+
+TEST_CASE("Audio only render playlist", "[AudioMixdown]")
+{
+    QDomDocument consumerDoc;
+    QDomElement consumer = consumerDoc.createElement(QStringLiteral("consumer"));
+    REQUIRE_FALSE(AudioMixdown::isAudioOnly(consumer));
+    consumer.setAttribute(QStringLiteral("vn"), 1);
+    REQUIRE(AudioMixdown::isAudioOnly(consumer));
+    consumer.setAttribute(QStringLiteral("an"), 1);
+    REQUIRE_FALSE(AudioMixdown::isAudioOnly(consumer));
+
+    QDomDocument doc;
+    REQUIRE(doc.setContent(timeline));
+    auto isVideoEffect = [](const QString &id) { return id == QLatin1String("brightness"); };
+    REQUIRE(AudioMixdown::strip(doc, isVideoEffect) == 1);
+
+    SECTION("Video part is removed")
+    {
+        QStringList ids;
+        for (const QString &tag : {QStringLiteral("producer"), QStringLiteral("playlist"), QStringLiteral("tractor")}) {
+            QDomNodeList nodes = doc.elementsByTagName(tag);
+            for (int i = 0; i < nodes.count(); ++i) {
+                ids << nodes.at(i).toElement().attribute(QStringLiteral("id"));
+            }
+        }
+        REQUIRE_FALSE(ids.contains(QStringLiteral("videoclip")));
+        REQUIRE_FALSE(ids.contains(QStringLiteral("playlist0")));
+        REQUIRE_FALSE(ids.contains(QStringLiteral("tractor0")));
+        REQUIRE(ids.contains(QStringLiteral("audioclip")));
+        REQUIRE(ids.contains(QStringLiteral("tractor1")));
+        REQUIRE(ids.contains(QStringLiteral("black_track")));
+        // The bin playlist no longer lists the video clip
+        REQUIRE(doc.elementsByTagName(QStringLiteral("entry")).count() == 2);
+
+        QDomElement mainTractor = doc.elementsByTagName(QStringLiteral("tractor")).at(1).toElement();
+        REQUIRE(mainTractor.attribute(QStringLiteral("id")) == QStringLiteral("maintractor"));
+        // Track indexes are kept for the remaining transitions
+        QVector<QDomNode> tracks = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("track"));
+        REQUIRE(tracks.count() == 3);
+        REQUIRE(tracks.at(2).toElement().attribute(QStringLiteral("producer")) == QStringLiteral("tractor1"));
+        QVector<QDomNode> transitions = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("transition"));
+        REQUIRE(transitions.count() == 1);
+        REQUIRE(Xml::getXmlProperty(transitions.at(0).toElement(), QStringLiteral("mlt_service")) == QStringLiteral("mix"));
+        QVector<QDomNode> filters = Xml::getDirectChildrenByTagName(mainTractor, QStringLiteral("filter"));
+        REQUIRE(filters.count() == 1);
+        REQUIRE(Xml::getXmlProperty(filters.at(0).toElement(), QStringLiteral("kdenlive_id")) == QStringLiteral("volume"));
+        // Nothing left to strip
+        REQUIRE(AudioMixdown::strip(doc, isVideoEffect) == 0);
+    }
+
+    SECTION("Audio matches the full timeline")
+    {
+        const QByteArray full = mixdown(timeline, 50);
+        if (full.isEmpty()) {
+            WARN("tone producer not available, mixdown output not compared");
+            return;
+        }
+        const QByteArray audioOnly = mixdown(doc.toString(), 50);
+        REQUIRE(audioOnly.size() == full.size());
+        REQUIRE(audioOnly == full);
+    }
+}
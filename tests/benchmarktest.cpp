@@ -0,0 +1,239 @@
+#include "test_utils.hpp"
+#include "renderer/twopassrenderjob.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <functional>
+#include <map>
+#include <random>
+#include <unordered_set>
+
+/* Performance regression tests. They are hidden from the default run and must be selected explicitly:
+       runTests "[benchmark]"
+   or with ctest, in a build configured with -DBUILD_BENCHMARKS=ON:
+       ctest -L benchmark
+   Each operation is timed and divided by the time of a fixed reference workload, so that the results can be compared
+   between machines. They are compared to the baselines stored in tests/benchmarks.json (or the file given in the
+   KDENLIVE_BENCHMARK_BASELINES environment variable) and the test fails when an operation is slower than its baseline
+   multiplied by KDENLIVE_BENCHMARK_TOLERANCE (1.5 by default). Operations without a baseline only give a warning.
+   Set KDENLIVE_BENCHMARK_UPDATE=1 to record the measured values as the new baselines.
+*/
+
+Mlt::Profile profile_benchmark;
+
+namespace {
+class Benchmarks
+{
+public:
+    Benchmarks()
+        : m_path(qEnvironmentVariableIsSet("KDENLIVE_BENCHMARK_BASELINES") ? qEnvironmentVariable("KDENLIVE_BENCHMARK_BASELINES")
+                                                                             : QStringLiteral(TESTS_SOURCE_DIR "/benchmarks.json"))
+        , m_update(qEnvironmentVariableIntValue("KDENLIVE_BENCHMARK_UPDATE") > 0)
+    {
+        bool ok;
+        m_tolerance = qEnvironmentVariable("KDENLIVE_BENCHMARK_TOLERANCE").toDouble(&ok);
+        if (!ok || m_tolerance < 1.) {
+            m_tolerance = 1.5;
+        }
+        QFile file(m_path);
+        if (file.open(QIODevice::ReadOnly)) {
+            m_baselines = QJsonDocument::fromJson(file.readAll()).object();
+        }
+        m_reference = calibrate();
+    }
+
+    ~Benchmarks()
+    {
+        if (!m_update) {
+            return;
+        }
+        QSaveFile file(m_path);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(m_baselines).toJson());
+            file.commit();
+        }
+    }
+
+    /* @brief Time an operation and compare it to its baseline */
+    void measure(const QString &name, const std::function<void()> &operation)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        operation();
+        double cost = double(timer.nsecsElapsed()) / m_reference;
+        double baseline = m_baselines.value(name).toDouble(-1);
+        // Reported with the test results, so that slow runs can be compared to the baselines
+        WARN("Benchmark " << name.toStdString() << ": " << timer.elapsed() << "ms, cost " << cost << ", baseline " << baseline);
+        if (m_update) {
+            m_baselines.insert(name, cost);
+        } else if (baseline <= 0) {
+            WARN("No baseline for " << name.toStdString());
+        } else {
+            INFO(name.toStdString() << " cost " << cost << " exceeds baseline " << baseline << " with tolerance " << m_tolerance);
+            CHECK(cost <= baseline * m_tolerance);
+        }
+    }
+
+private:
+    QString m_path;
+    bool m_update;
+    double m_tolerance;
+    QJsonObject m_baselines;
+    double m_reference;
+
+    /* @brief Time of a fixed workload, in nanoseconds. Best of a few runs to limit the noise */
+    static double calibrate()
+    {
+        qint64 best = -1;
+        for (int run = 0; run < 5; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            std::map<int, int> values;
+            std::mt19937 gen(42);
+            for (int i = 0; i < 200000; ++i) {
+                values[int(gen() % 100000)] += i;
+            }
+            qint64 sum = 0;
+            for (const auto &v : values) {
+                sum += v.second;
+            }
+            REQUIRE(sum > 0);
+            qint64 elapsed = timer.nsecsElapsed();
+            if (best < 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        return double(qMax(best, qint64(1)));
+    }
+};
+} // namespace
+
+TEST_CASE("Timeline model performance", "[.][benchmark]")
+{
+    Logger::clear();
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    // The default limit would drop the oldest commands
+    undoStack->setUndoLimit(0);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_benchmark, guideModel, undoStack);
+    Benchmarks benchmarks;
+
+    const int trackCount = 4;
+    const int clipCount = 10000;
+    const int clipLength = 20;
+    std::vector<int> tracks;
+    for (int i = 0; i < trackCount; ++i) {
+        tracks.push_back(TrackModel::construct(timeline));
+    }
+    QString binId = createProducer(profile_benchmark, "red", binModel, clipLength);
+    std::vector<std::vector<int>> clips(trackCount);
+
+    benchmarks.measure(QStringLiteral("insert_10k_clips"), [&]() {
+        for (int i = 0; i < clipCount; ++i) {
+            int cid;
+            int track = i % trackCount;
+            REQUIRE(timeline->requestClipInsertion(binId, tracks[track], int(clips[track].size()) * clipLength, cid));
+            clips[track].push_back(cid);
+        }
+    });
+    REQUIRE(timeline->getClipsCount() == clipCount);
+
+    // Group all the clips of the first track and move them after the end of the timeline
+    std::unordered_set<int> firstTrack(clips[0].begin(), clips[0].end());
+    int gid = timeline->requestClipsGroup(firstTrack);
+    REQUIRE(gid > -1);
+    benchmarks.measure(QStringLiteral("group_move"), [&]() {
+        REQUIRE(timeline->requestGroupMove(clips[0].front(), gid, 0, clipLength * 10));
+    });
+    REQUIRE(timeline->getClipPosition(clips[0].front()) == clipLength * 10);
+    REQUIRE(timeline->requestClipsUngroup(firstTrack));
+
+    benchmarks.measure(QStringLiteral("cut_all_200"), [&]() {
+        for (int i = 0; i < 200; ++i) {
+            TimelineFunctions::requestClipCutAll(timeline, clipLength * (20 + i) + clipLength / 2);
+        }
+    });
+    REQUIRE(timeline->checkConsistency());
+
+    int commands = undoStack->count();
+    benchmarks.measure(QStringLiteral("undo_history"), [&]() {
+        while (undoStack->canUndo()) {
+            undoStack->undo();
+        }
+    });
+    REQUIRE(commands > clipCount);
+    REQUIRE(timeline->getClipsCount() == 0);
+    REQUIRE(timeline->checkConsistency());
+
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Two pass render performance", "[.][benchmark]")
+{
+    const QString melt = QStandardPaths::findExecutable(QStringLiteral("melt"));
+    if (melt.isEmpty()) {
+        WARN("melt not found, two pass render not measured");
+        return;
+    }
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    Benchmarks benchmarks;
+    // 10 seconds of blurred noise, so that the timeline costs more than reading the intermediate
+    auto writePlaylist = [&dir](int pass, const QString &target) {
+        const QString path = dir.filePath(QStringLiteral("pass%1.mlt").arg(pass));
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(QStringLiteral("<mlt><profile width=\"1280\" height=\"720\" frame_rate_num=\"25\" frame_rate_den=\"1\" progressive=\"1\" "
+                                  "sample_aspect_num=\"1\" sample_aspect_den=\"1\" display_aspect_num=\"16\" display_aspect_den=\"9\"/>"
+                                  "<producer id=\"noise\" in=\"0\" out=\"249\"><property name=\"mlt_service\">noise</property>"
+                                  "<filter><property name=\"mlt_service\">boxblur</property><property name=\"hori\">8</property>"
+                                  "<property name=\"vert\">8</property></filter></producer>"
+                                  "<playlist id=\"main\"><entry producer=\"noise\" in=\"0\" out=\"249\"/></playlist>"
+                                  "<consumer mlt_service=\"avformat\" target=\"%1\" in=\"0\" out=\"249\" f=\"mp4\" vcodec=\"mpeg4\" vb=\"2M\" an=\"1\" "
+                                  "pass=\"%2\" passlogfile=\"%3\" real_time=\"-1\" terminate_on_pause=\"1\"/></mlt>")
+                       .arg(target)
+                       .arg(pass)
+                       .arg(dir.filePath(QStringLiteral("passlog")))
+                       .toUtf8());
+        return path;
+    };
+
+    const QString sequential = dir.filePath(QStringLiteral("sequential.mp4"));
+    benchmarks.measure(QStringLiteral("twopass_timeline"), [&]() {
+        for (int pass = 1; pass <= 2; ++pass) {
+            QProcess process;
+            process.start(melt, {QStringLiteral("-progress"), writePlaylist(pass, sequential)});
+            REQUIRE(process.waitForFinished(600000));
+            REQUIRE(process.exitCode() == 0);
+        }
+    });
+    REQUIRE(QFile::exists(sequential));
+
+    const QString cached = dir.filePath(QStringLiteral("cached.mp4"));
+    benchmarks.measure(QStringLiteral("twopass_intermediate"), [&]() {
+        TwoPassRenderJob job(melt, writePlaylist(1, cached), writePlaylist(2, cached), cached);
+        REQUIRE(job.prepare());
+        QEventLoop loop;
+        QObject::connect(&job, &TwoPassRenderJob::renderingFinished, &loop, &QEventLoop::quit);
+        QTimer::singleShot(600000, &loop, &QEventLoop::quit);
+        QTimer::singleShot(0, &job, &TwoPassRenderJob::start);
+        loop.exec();
+    });
+    REQUIRE(QFile::exists(cached));
+}
@@ -0,0 +1,88 @@
+#include "catch.hpp"
+
+#include "utils/cacheusage.hpp"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QTemporaryDir>
+
+namespace {
+// Gives access to the eviction of project cache folders
+class TestCacheUsage : public CacheUsage
+{
+public:
+    using CacheUsage::evict;
+};
+
+// Create a project cache folder with its stored usage
+void createProjectCache(const QDir &root, const QString &id, qint64 size, const QDateTime &lastUsed)
+{
+    root.mkpath(id);
+    QJsonObject obj;
+    obj.insert(QLatin1String("version"), 1);
+    obj.insert(QLatin1String("lastUsed"), lastUsed.toMSecsSinceEpoch());
+    for (const QString &type : {QStringLiteral("preview"), QStringLiteral("audiothumbs"), QStringLiteral("videothumbs")}) {
+        QJsonObject entry;
+        entry.insert(QLatin1String("size"), type == QLatin1String("preview") ? size : 0);
+        entry.insert(QLatin1String("files"), 1);
+        obj.insert(type, entry);
+    }
+    QFile file(QDir(root.absoluteFilePath(id)).absoluteFilePath(QStringLiteral("usage.json")));
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+}
+} // namespace
+
+TEST_CASE("Cache eviction", "[CacheUsage]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDir root(dir.path());
+    const QDateTime now = QDateTime::currentDateTime();
+    createProjectCache(root, QStringLiteral("1"), 1000, now.addDays(-30));
+    createProjectCache(root, QStringLiteral("2"), 1000, now.addDays(-20));
+    createProjectCache(root, QStringLiteral("3"), 1000, now.addDays(-10));
+    createProjectCache(root, QStringLiteral("4"), 1000, now.addSecs(-60));
+    createProjectCache(root, QStringLiteral("5"), 1000, now.addDays(-40));
+
+    SECTION("Least recently used folders are deleted first, the current project is kept")
+    {
+        TestCacheUsage::evict(root.absolutePath(), QStringLiteral("5"), 3000);
+        REQUIRE_FALSE(root.exists(QStringLiteral("1")));
+        REQUIRE_FALSE(root.exists(QStringLiteral("2")));
+        REQUIRE(root.exists(QStringLiteral("3")));
+        REQUIRE(root.exists(QStringLiteral("4")));
+        REQUIRE(root.exists(QStringLiteral("5")));
+    }
+
+    SECTION("Locked and recently used folders are kept")
+    {
+        // Project 1 is open in another instance
+        QLockFile lock(QDir(root.absoluteFilePath(QStringLiteral("1"))).absoluteFilePath(QStringLiteral("usage.lock")));
+        REQUIRE(lock.tryLock(0));
+        TestCacheUsage::evict(root.absolutePath(), QStringLiteral("5"), 0);
+        REQUIRE(root.exists(QStringLiteral("1")));
+        REQUIRE_FALSE(root.exists(QStringLiteral("2")));
+        REQUIRE_FALSE(root.exists(QStringLiteral("3")));
+        REQUIRE(root.exists(QStringLiteral("4")));
+        REQUIRE(root.exists(QStringLiteral("5")));
+    }
+}
+
+TEST_CASE("Cache usage walk", "[CacheUsage]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDir root(dir.path());
+    createProjectCache(root, QStringLiteral("1"), 1000, QDateTime::currentDateTime());
+    CacheUsage::get()->setProject(QDir(root.absoluteFilePath(QStringLiteral("1"))));
+    qint64 size = 0;
+    REQUIRE(CacheUsage::get()->usage(CachePreview, &size));
+    REQUIRE(size == 1000);
+    // A folder walk finishing late does not replace the tracked usage
+    CacheUsage::get()->setUsage(CachePreview, 5, 1);
+    REQUIRE(CacheUsage::get()->usage(CachePreview, &size));
+    REQUIRE(size == 1000);
+}
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#define private public
+#define protected public
+#include "bin/clipimporter.hpp"
+
+namespace {
+void createFile(const QDir &dir, const QString &path)
+{
+    QFileInfo info(dir.absoluteFilePath(path));
+    REQUIRE(dir.mkpath(info.path()));
+    QFile file(info.absoluteFilePath());
+    REQUIRE(file.open(QIODevice::WriteOnly));
+}
+} // namespace
+
+TEST_CASE("Clip import scan", "[ClipImporter]")
+{
+    QTemporaryDir tmp;
+    REQUIRE(tmp.isValid());
+    QDir dir(tmp.path());
+    createFile(dir, QStringLiteral("a/clips/1.png"));
+    createFile(dir, QStringLiteral("a/clips/sub/2.png"));
+    createFile(dir, QStringLiteral("a/clips/sub/notes.txt"));
+    createFile(dir, QStringLiteral("b/clips/3.png"));
+    createFile(dir, QStringLiteral("single.png"));
+    const QList<QUrl> urls{QUrl::fromLocalFile(dir.absoluteFilePath(QStringLiteral("a/clips"))),
+                           QUrl::fromLocalFile(dir.absoluteFilePath(QStringLiteral("b/clips"))),
+                           QUrl::fromLocalFile(dir.absoluteFilePath(QStringLiteral("single.png"))),
+                           QUrl::fromLocalFile(dir.absoluteFilePath(QStringLiteral("a/clips/1.png")))};
+    std::atomic<bool> abort{false};
+    const QVector<ClipImporter::Entry> entries = ClipImporter::scan(urls, {QStringLiteral("*.png")}, &abort);
+
+    SECTION("Dropped folders keep their hierarchy")
+    {
+        // Files already found in a dropped folder are not imported twice
+        REQUIRE(entries.size() == 4);
+        REQUIRE(entries.at(0).path == dir.absoluteFilePath(QStringLiteral("a/clips/1.png")));
+        REQUIRE(entries.at(0).folder == QLatin1String("clips"));
+        REQUIRE(entries.at(1).folder == QLatin1String("clips/sub"));
+        REQUIRE(entries.at(0).root == entries.at(1).root);
+        // Folders with the same name are different bin folders
+        REQUIRE(entries.at(2).folder == QLatin1String("clips"));
+        REQUIRE(entries.at(2).root != entries.at(0).root);
+        // Dropped files go in the parent folder
+        REQUIRE(entries.at(3).path == dir.absoluteFilePath(QStringLiteral("single.png")));
+        REQUIRE(entries.at(3).folder.isEmpty());
+    }
+
+    SECTION("Files of dropped folders are checked for removable devices")
+    {
+        int checks = 0;
+        const QString removableFolder = dir.absoluteFilePath(QStringLiteral("a/clips/sub"));
+        const QVector<int> removable = ClipImporter::removableEntries(entries, [&checks, removableFolder](const QString &folder) {
+            checks++;
+            return folder == removableFolder;
+        });
+        REQUIRE(removable == QVector<int>({1}));
+        REQUIRE(checks == 4);
+    }
+}
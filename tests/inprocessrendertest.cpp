@@ -0,0 +1,83 @@
+#include "catch.hpp"
+
+#include "utils/inprocessrender.hpp"
+
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+TEST_CASE("In process render", "[InProcessRender]")
+{
+    QDomDocument doc;
+    QDomElement consumer = doc.createElement(QStringLiteral("consumer"));
+    consumer.setAttribute(QStringLiteral("mlt_service"), QStringLiteral("avformat"));
+    consumer.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/out.mkv"));
+    consumer.setAttribute(QStringLiteral("in"), 5);
+    consumer.setAttribute(QStringLiteral("out"), 54);
+
+    SECTION("Render choice")
+    {
+        REQUIRE(InProcessRender::canRender(consumer, 50));
+        // Long renders and disabled setting use kdenlive_render
+        REQUIRE_FALSE(InProcessRender::canRender(consumer, 49));
+        REQUIRE_FALSE(InProcessRender::canRender(consumer, 0));
+        // Two pass encoding
+        consumer.setAttribute(QStringLiteral("pass"), 1);
+        REQUIRE_FALSE(InProcessRender::canRender(consumer, 50));
+        consumer.removeAttribute(QStringLiteral("pass"));
+        // Image sequence
+        consumer.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/out_%05d.png"));
+        REQUIRE_FALSE(InProcessRender::canRender(consumer, 50));
+    }
+
+    SECTION("Render a playlist")
+    {
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        const QString target = dir.filePath(QStringLiteral("out.mkv"));
+        const QString playlist = dir.filePath(QStringLiteral("render.mlt"));
+        QFile file(playlist);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(QStringLiteral("<mlt LC_NUMERIC=\"C\"><profile width=\"320\" height=\"240\" frame_rate_num=\"25\" frame_rate_den=\"1\" progressive=\"1\" "
+                                  "sample_aspect_num=\"1\" sample_aspect_den=\"1\" display_aspect_num=\"4\" display_aspect_den=\"3\" colorspace=\"601\"/>"
+                                  "<producer id=\"color\" in=\"0\" out=\"99\"><property name=\"mlt_service\">color</property>"
+                                  "<property name=\"resource\">red</property><property name=\"length\">100</property></producer>"
+                                  "<consumer mlt_service=\"avformat\" target=\"%1\" in=\"5\" out=\"54\" f=\"matroska\" vcodec=\"mpeg4\" an=\"1\" "
+                                  "real_time=\"-1\"/></mlt>")
+                       .arg(target)
+                       .toUtf8());
+        file.close();
+
+        InProcessRender render(playlist, target);
+        int status = 0;
+        int lastProgress = -1;
+        QObject::connect(&render, &InProcessRender::finished, &render, [&status](const QString &, int result, const QString &) { status = result; },
+                         Qt::DirectConnection);
+        QObject::connect(&render, &InProcessRender::progress, &render, [&lastProgress](const QString &, int progress, int) { lastProgress = progress; },
+                         Qt::DirectConnection);
+        render.start();
+        QElapsedTimer timer;
+        timer.start();
+        while (render.isRunning() && timer.elapsed() < 60000) {
+            QThread::msleep(20);
+        }
+        if (render.isRunning()) {
+            // The destructor waits for the render thread once aborted
+            render.abort();
+            FAIL("In process render did not finish in 60 seconds");
+        }
+        if (status == -2) {
+            WARN("avformat consumer not available, in process render not tested");
+            return;
+        }
+        REQUIRE(status == -1);
+        REQUIRE(lastProgress >= 0);
+        Mlt::Profile profile;
+        Mlt::Producer prod(profile, target.toUtf8().constData());
+        REQUIRE(prod.is_valid());
+        REQUIRE(prod.get_length() == 50);
+    }
+}
@@ -0,0 +1,43 @@
+#include "catch.hpp"
+
+#include "utils/proxysubstitution.hpp"
+
+TEST_CASE("Proxy substitution", "[ProxySubstitution]")
+{
+    const QSize uhd(3840, 2160);
+    const QSize proxy720(1280, 720);
+
+    SECTION("Proxy resolution against output")
+    {
+        // Heavily downscaled originals can use their proxy
+        REQUIRE(ProxySubstitution::proxyIsSufficient(proxy720, uhd, QSize(1280, 720)));
+        REQUIRE(ProxySubstitution::proxyIsSufficient(proxy720, uhd, QSize(640, 360)));
+        // The output needs more than the proxy
+        REQUIRE_FALSE(ProxySubstitution::proxyIsSufficient(proxy720, uhd, QSize(1920, 1080)));
+        // Originals are not upscaled beyond their size, a proxy of the same size is enough
+        REQUIRE(ProxySubstitution::proxyIsSufficient(proxy720, proxy720, QSize(1920, 1080)));
+        // Aspect ratio of the original is kept in the output
+        REQUIRE(ProxySubstitution::proxyIsSufficient(QSize(640, 480), QSize(1440, 1080), QSize(1280, 480)));
+        // Odd sizes rounded down in the proxy
+        REQUIRE(ProxySubstitution::proxyIsSufficient(QSize(1278, 718), uhd, QSize(1280, 720)));
+        // Unknown sizes use the original
+        REQUIRE_FALSE(ProxySubstitution::proxyIsSufficient(QSize(), uhd, QSize(1280, 720)));
+        REQUIRE_FALSE(ProxySubstitution::proxyIsSufficient(proxy720, QSize(), QSize(1280, 720)));
+    }
+
+    SECTION("Per clip choice and report")
+    {
+        ProxySubstitution substitution(QSize(1280, 720));
+        substitution.addClip(QStringLiteral("/proxy/a.mkv"), {QStringLiteral("a"), QStringLiteral("/media/a.mov"), uhd, proxy720});
+        substitution.addClip(QStringLiteral("/proxy/b.mkv"), {QStringLiteral("b"), QStringLiteral("/media/b.mov"), uhd, QSize(640, 360)});
+        REQUIRE(substitution.contains(QStringLiteral("/proxy/a.mkv")));
+        REQUIRE_FALSE(substitution.contains(QStringLiteral("/media/a.mov")));
+        REQUIRE(substitution.resource(QStringLiteral("/proxy/a.mkv")) == QStringLiteral("/proxy/a.mkv"));
+        REQUIRE(substitution.resource(QStringLiteral("/proxy/b.mkv")) == QStringLiteral("/media/b.mov"));
+        // Unknown resources are not changed
+        REQUIRE(substitution.resource(QStringLiteral("/media/c.mov")) == QStringLiteral("/media/c.mov"));
+        REQUIRE(substitution.proxyClips() == QStringList{QStringLiteral("a")});
+        REQUIRE(substitution.originalClips() == QStringList{QStringLiteral("b")});
+        REQUIRE(substitution.report().split(QLatin1Char('\n')).size() == 2);
+    }
+}
@@ -0,0 +1,50 @@
+#include "catch.hpp"
+
+#include "utils/rendercost.hpp"
+
+TEST_CASE("Render cost attribution", "[RenderCost]")
+{
+    RenderCost cost;
+    // Two chunks of 25 frames, the second one is 3 times slower
+    cost.addChunk(0, 25, 250);
+    cost.addChunk(25, 25, 750);
+    REQUIRE(cost.frameCost(0) == Approx(10));
+    REQUIRE(cost.frameCost(25) == Approx(30));
+    REQUIRE(cost.frameCost(50) < 0);
+    int frames = 0;
+    REQUIRE(cost.totalTime(&frames) == Approx(1000));
+    REQUIRE(frames == 50);
+
+    SECTION("Heatmap levels are relative to the most expensive chunk")
+    {
+        const QVariantList heatmap = cost.heatmap();
+        REQUIRE(heatmap.count() == 2);
+        REQUIRE(heatmap.at(0).toMap().value(QStringLiteral("frame")).toInt() == 0);
+        REQUIRE(heatmap.at(0).toMap().value(QStringLiteral("level")).toDouble() == Approx(1. / 3));
+        REQUIRE(heatmap.at(1).toMap().value(QStringLiteral("level")).toDouble() == Approx(1));
+    }
+
+    SECTION("Chunk time is shared between the active items")
+    {
+        // A clip on the whole range, a composition over the second chunk, a clip outside measured chunks
+        QVector<RenderCost::Item> items{{1, QStringLiteral("clip"), 0, 50}, {2, QStringLiteral("composition"), 25, 25},
+                                        {3, QStringLiteral("unmeasured"), 100, 10}};
+        const QVector<RenderCost::ItemCost> costs = cost.attribute(items);
+        REQUIRE(costs.count() == 2);
+        REQUIRE(costs.at(0).id == 1);
+        REQUIRE(costs.at(0).time == Approx(250 + 375));
+        REQUIRE(costs.at(0).frames == 50);
+        REQUIRE(costs.at(1).id == 2);
+        REQUIRE(costs.at(1).time == Approx(375));
+        REQUIRE(costs.at(1).frames == 25);
+    }
+
+    SECTION("Modified chunks are forgotten")
+    {
+        cost.invalidate(30, 40);
+        REQUIRE(cost.frameCost(0) == Approx(10));
+        REQUIRE(cost.frameCost(25) < 0);
+        cost.clear();
+        REQUIRE(cost.isEmpty());
+    }
+}
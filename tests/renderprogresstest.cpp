@@ -0,0 +1,56 @@
+#include "catch.hpp"
+#include "lib/renderprogress.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+TEST_CASE("Render progress records", "[RenderProgress]")
+{
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::ChunkDone;
+    record.frame = 125;
+    record.frames = 25;
+    record.fps = 12.5;
+    record.queue = 3;
+    record.stages.insert(QStringLiteral("load"), 40);
+    record.stages.insert(QStringLiteral("encode"), 2000);
+    const QByteArray line = RenderProgress::serialize(record);
+    // One record per line
+    REQUIRE(line.endsWith('\n'));
+    REQUIRE(line.count('\n') == 1);
+
+    RenderProgress::Record parsed;
+    REQUIRE(RenderProgress::parse(line, parsed));
+    REQUIRE(parsed.event == RenderProgress::Event::ChunkDone);
+    REQUIRE(parsed.frame == 125);
+    REQUIRE(parsed.frames == 25);
+    REQUIRE(parsed.fps == 12.5);
+    REQUIRE(parsed.queue == 3);
+    REQUIRE(parsed.percent == -1);
+    REQUIRE(parsed.stages == record.stages);
+
+    // Other output of the renderer is ignored
+    REQUIRE_FALSE(RenderProgress::parse("Current Frame: 12, percentage: 5", parsed));
+    REQUIRE_FALSE(RenderProgress::parse("{\"event\":\"unknown\"}", parsed));
+}
+
+TEST_CASE("Render timing logs", "[RenderProgress]")
+{
+    // Concurrent renders of the same target get their own log
+    const QString target = QStringLiteral("/tmp/renderprogresstest.mp4");
+    RenderProgress::Log first(target);
+    RenderProgress::Log second(target);
+    REQUIRE_FALSE(first.fileName().isEmpty());
+    REQUIRE(first.fileName() != second.fileName());
+    RenderProgress::Record record;
+    record.event = RenderProgress::Event::ChunkDone;
+    first.write(record);
+    REQUIRE(QFileInfo(first.fileName()).size() > 0);
+    REQUIRE(QFileInfo(second.fileName()).size() == 0);
+    QFile::remove(first.fileName());
+    QFile::remove(second.fileName());
+
+    // Without target, nothing is written
+    RenderProgress::Log none;
+    REQUIRE(none.fileName().isEmpty());
+}
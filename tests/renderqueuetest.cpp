@@ -0,0 +1,91 @@
+#include "catch.hpp"
+#include "renderer/renderqueue.h"
+#include "renderer/rendersegments.h"
+
+#include <QDateTime>
+#include <QDomDocument>
+#include <QFile>
+#include <QTemporaryDir>
+
+TEST_CASE("Shared render queue", "[RenderQueue]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDomDocument doc;
+    doc.setContent(QStringLiteral("<mlt><consumer mlt_service=\"avformat\" in=\"0\" out=\"299\"/></mlt>"));
+    RenderQueue queue(dir.filePath(QStringLiteral("queue")));
+    REQUIRE_FALSE(queue.load());
+    REQUIRE(queue.create(doc, RenderSegments::split(0, 299, 3, 25), QStringLiteral("mkv"), 2));
+    REQUIRE(queue.count() == 3);
+
+    // Another process joins the queue
+    RenderQueue worker(queue.folder());
+    REQUIRE(worker.load());
+    REQUIRE(worker.chunkFile(1) == queue.chunkFile(1));
+
+    // Each chunk is claimed once
+    RenderQueue::Chunk first;
+    RenderQueue::Chunk second;
+    RenderQueue::Chunk third;
+    REQUIRE(queue.claim(QStringLiteral("a"), first));
+    REQUIRE(worker.claim(QStringLiteral("b"), second));
+    REQUIRE(first.index == 0);
+    REQUIRE(second.index == 1);
+    REQUIRE(queue.chunks(RenderQueue::Running).size() == 2);
+    second.done = 40;
+    REQUIRE(worker.heartbeat(second));
+    REQUIRE(queue.chunks(RenderQueue::Running).at(1).done == 40);
+
+    // Completed chunk keeps its timing
+    const QString rendered = queue.workFile(first, QStringLiteral("mkv"));
+    QFile file(rendered);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write("data");
+    file.close();
+    REQUIRE(queue.complete(first, rendered));
+    REQUIRE(QFile::exists(queue.chunkFile(0)));
+    const QVector<RenderQueue::Chunk> done = queue.chunks(RenderQueue::Done);
+    REQUIRE(done.size() == 1);
+    REQUIRE(done.first().worker == QLatin1String("a"));
+    REQUIRE(done.first().done == first.length());
+
+    // A worker without heartbeat loses its chunk, and cannot complete it anymore.
+    // Heartbeats are counted, the file times written by another computer are not used
+    QFile running(dir.filePath(QStringLiteral("queue/running/0001.json")));
+    REQUIRE(running.open(QIODevice::ReadWrite));
+    REQUIRE(running.setFileTime(QDateTime::currentDateTime().addSecs(-120), QFileDevice::FileModificationTime));
+    running.close();
+    REQUIRE(queue.requeueStale(60) == 0);
+    REQUIRE(queue.requeueStale(60) == 0);
+    REQUIRE(worker.heartbeat(second));
+    REQUIRE(queue.requeueStale(0) == 0);
+    queue.resetStaleCheck();
+    REQUIRE(queue.requeueStale(0) == 0);
+    REQUIRE(queue.requeueStale(0) == 1);
+    REQUIRE_FALSE(worker.heartbeat(second));
+    REQUIRE(queue.claim(QStringLiteral("c"), third));
+    REQUIRE(third.index == 1);
+    REQUIRE(third.attempts == 1);
+    REQUIRE_FALSE(worker.complete(second, worker.workFile(second, QStringLiteral("mkv"))));
+
+    // Too many failures
+    REQUIRE(queue.release(third, QStringLiteral("crash")));
+    REQUIRE(queue.chunks(RenderQueue::Failed).size() == 1);
+    REQUIRE(queue.chunks(RenderQueue::Failed).first().error == QLatin1String("crash"));
+    REQUIRE_FALSE(queue.isFinished());
+    REQUIRE(queue.claim(QStringLiteral("c"), third));
+    REQUIRE(third.index == 2);
+    REQUIRE_FALSE(queue.claim(QStringLiteral("d"), second));
+    // Released chunks are rendered again
+    REQUIRE(queue.release(third, QStringLiteral("crash")));
+    REQUIRE_FALSE(queue.isFinished());
+    REQUIRE(queue.claim(QStringLiteral("d"), second));
+    REQUIRE(second.index == 2);
+    REQUIRE(queue.release(second, QStringLiteral("crash")));
+    REQUIRE(queue.isFinished());
+    REQUIRE(queue.chunks(RenderQueue::Failed).size() == 2);
+
+    REQUIRE_FALSE(worker.isCancelled());
+    queue.cancel();
+    REQUIRE(worker.isCancelled());
+}
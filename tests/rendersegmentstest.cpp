@@ -0,0 +1,227 @@
+#include "catch.hpp"
+#include "renderer/rendersegments.h"
+#include "renderer/segmentrenderjob.h"
+
+#include <QDir>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <memory>
+#include <mlt++/MltConsumer.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+Mlt::Profile profile_segments;
+
+namespace {
+// Render frames in to out of the producer, like a kdenlive_render worker
+bool renderRange(Mlt::Producer &prod, int in, int out, const QString &path)
+{
+    std::unique_ptr<Mlt::Producer> cut(prod.cut(in, out));
+    Mlt::Consumer cons(profile_segments, "avformat", path.toUtf8().constData());
+    if (!cons.is_valid()) {
+        return false;
+    }
+    cons.set("f", "matroska");
+    cons.set("vcodec", "mpeg4");
+    cons.set("g", 10);
+    cons.set("an", 1);
+    cons.set("terminate_on_pause", 1);
+    cons.set("real_time", -1);
+    cons.connect(*cut);
+    cons.run();
+    cons.stop();
+    return QFile::exists(path);
+}
+
+int frameCount(const QString &path)
+{
+    Mlt::Producer prod(profile_segments, path.toUtf8().constData());
+    return prod.is_valid() ? prod.get_length() : -1;
+}
+} // namespace
+
+TEST_CASE("Render segments split", "[RenderSegments]")
+{
+    SECTION("Segments cover the range exactly, aligned on keyframe interval")
+    {
+        for (int count : {2, 3, 4, 7, 16}) {
+            auto segments = RenderSegments::split(12, 1012, count, 25);
+            REQUIRE(segments.size() > 1);
+            REQUIRE(segments.size() <= count);
+            REQUIRE(segments.first().in == 12);
+            REQUIRE(segments.last().out == 1012);
+            int total = 0;
+            for (int i = 0; i < segments.size(); ++i) {
+                total += segments.at(i).length();
+                if (i > 0) {
+                    REQUIRE(segments.at(i).in == segments.at(i - 1).out + 1);
+                }
+                if (i < segments.size() - 1) {
+                    REQUIRE(segments.at(i).length() % 25 == 0);
+                }
+            }
+            REQUIRE(total == 1001);
+        }
+    }
+
+    SECTION("Short ranges are not split below one keyframe interval")
+    {
+        REQUIRE(RenderSegments::split(0, 9, 4, 25).size() == 1);
+        REQUIRE(RenderSegments::split(0, 49, 4, 25).size() == 2);
+        REQUIRE(RenderSegments::split(10, 5, 4, 1).isEmpty());
+    }
+
+    SECTION("Only single pass video renders are split")
+    {
+        QDomDocument doc;
+        QDomElement consumer = doc.createElement(QStringLiteral("consumer"));
+        consumer.setAttribute(QStringLiteral("mlt_service"), QStringLiteral("avformat"));
+        consumer.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/out.mp4"));
+        REQUIRE_FALSE(RenderSegments::canSplit(consumer));
+        consumer.setAttribute(QStringLiteral("in"), 0);
+        consumer.setAttribute(QStringLiteral("out"), 500);
+        REQUIRE(RenderSegments::canSplit(consumer));
+        REQUIRE(RenderSegments::gopSize(consumer) == 1);
+        consumer.setAttribute(QStringLiteral("g"), 15);
+        REQUIRE(RenderSegments::gopSize(consumer) == 15);
+        consumer.setAttribute(QStringLiteral("pass"), 1);
+        REQUIRE_FALSE(RenderSegments::canSplit(consumer));
+        consumer.removeAttribute(QStringLiteral("pass"));
+        consumer.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/out_%05d.png"));
+        REQUIRE_FALSE(RenderSegments::canSplit(consumer));
+    }
+}
+
+TEST_CASE("Render segments reusing preview chunks", "[RenderSegments]")
+{
+    QMap<int, QString> chunks;
+    for (int frame : {0, 25, 50, 150, 175, 400}) {
+        chunks.insert(frame, QStringLiteral("%1.mkv").arg(frame));
+    }
+    // Render frames 10 to 410, chunks at 0 and 400 are not fully inside the range
+    auto segments = RenderSegments::plan(10, 410, chunks, 25, 4, 1);
+    int total = 0;
+    int reused = 0;
+    QStringList files;
+    for (int i = 0; i < segments.size(); ++i) {
+        if (i > 0) {
+            REQUIRE(segments.at(i).in == segments.at(i - 1).out + 1);
+        }
+        total += segments.at(i).length();
+        if (!segments.at(i).file.isEmpty()) {
+            REQUIRE(segments.at(i).length() == 25);
+            reused += segments.at(i).length();
+            files << segments.at(i).file;
+        }
+    }
+    REQUIRE(segments.first().in == 10);
+    REQUIRE(segments.last().out == 410);
+    REQUIRE(total == 401);
+    REQUIRE(reused == 100);
+    REQUIRE(files == QStringList({QStringLiteral("25.mkv"), QStringLiteral("50.mkv"), QStringLiteral("150.mkv"), QStringLiteral("175.mkv")}));
+    // The 75 to 149 gap is too short to be split, 200 to 410 is split in 2
+    REQUIRE(segments.size() == 1 + 2 + 1 + 2 + 2);
+}
+
+TEST_CASE("Segmented render frame count", "[RenderSegments]")
+{
+    const QString ffmpeg = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    if (ffmpeg.isEmpty()) {
+        WARN("ffmpeg not found, segmented render not tested");
+        return;
+    }
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    Mlt::Producer prod(profile_segments, "color:red");
+    REQUIRE(prod.is_valid());
+    prod.set("length", 200);
+    prod.set_in_and_out(0, 199);
+    const int in = 3;
+    const int out = 99;
+
+    // Single process render
+    const QString single = dir.filePath(QStringLiteral("single.mkv"));
+    REQUIRE(renderRange(prod, in, out, single));
+
+    // Segmented render
+    auto segments = RenderSegments::split(in, out, 4, 10);
+    REQUIRE(segments.size() == 4);
+    QStringList files;
+    for (int i = 0; i < segments.size(); ++i) {
+        files << dir.filePath(QStringLiteral("segment-%1.mkv").arg(i));
+        REQUIRE(renderRange(prod, segments.at(i).in, segments.at(i).out, files.last()));
+    }
+    const QString listFile = dir.filePath(QStringLiteral("segments.txt"));
+    REQUIRE(RenderSegments::writeConcatList(listFile, files));
+    const QString joined = dir.filePath(QStringLiteral("joined.mkv"));
+    QProcess concat;
+    concat.start(ffmpeg, RenderSegments::concatArguments(listFile, QString(), joined));
+    REQUIRE(concat.waitForFinished(30000));
+    REQUIRE(concat.exitCode() == 0);
+
+    REQUIRE(frameCount(single) == out - in + 1);
+    REQUIRE(frameCount(joined) == frameCount(single));
+}
+
+TEST_CASE("Segmented render audio continuity", "[RenderSegments]")
+{
+    const QString ffmpeg = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    const QString melt = QStandardPaths::findExecutable(QStringLiteral("melt"));
+    if (ffmpeg.isEmpty() || melt.isEmpty()) {
+        WARN("ffmpeg or melt not found, segmented render not tested");
+        return;
+    }
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    // 4 seconds of video and tone, split in 4 segments
+    const int fps = 25;
+    const int in = 0;
+    const int out = 99;
+    const QString target = dir.filePath(QStringLiteral("joined.mkv"));
+    const QString playlist = dir.filePath(QStringLiteral("playlist.mlt"));
+    QFile file(playlist);
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write(QStringLiteral("<mlt><profile width=\"320\" height=\"240\" frame_rate_num=\"%1\" frame_rate_den=\"1\" progressive=\"1\" "
+                              "sample_aspect_num=\"1\" sample_aspect_den=\"1\" display_aspect_num=\"4\" display_aspect_den=\"3\"/>"
+                              "<producer id=\"video\" in=\"0\" out=\"199\"><property name=\"mlt_service\">color</property>"
+                              "<property name=\"resource\">red</property></producer>"
+                              "<producer id=\"audio\" in=\"0\" out=\"199\"><property name=\"mlt_service\">tone</property></producer>"
+                              "<playlist id=\"v\"><entry producer=\"video\" in=\"0\" out=\"199\"/></playlist>"
+                              "<playlist id=\"a\"><entry producer=\"audio\" in=\"0\" out=\"199\"/></playlist>"
+                              "<tractor id=\"main\"><track producer=\"v\"/><track producer=\"a\" hide=\"video\"/>"
+                              "<transition mlt_service=\"mix\" a_track=\"0\" b_track=\"1\" always_active=\"1\" sum=\"1\"/></tractor>"
+                              "<consumer mlt_service=\"avformat\" in=\"%2\" out=\"%3\" f=\"matroska\" vcodec=\"mpeg4\" g=\"10\" "
+                              "acodec=\"aac\" ar=\"48000\" channels=\"2\" real_time=\"-1\" terminate_on_pause=\"1\"/></mlt>")
+                   .arg(fps)
+                   .arg(in)
+                   .arg(out)
+                   .toUtf8());
+    file.close();
+
+    SegmentRenderJob job(melt, playlist, target, ffmpeg, 4);
+    REQUIRE(job.prepare());
+    QEventLoop loop;
+    QObject::connect(&job, &SegmentRenderJob::renderingFinished, &loop, &QEventLoop::quit);
+    QTimer::singleShot(120000, &loop, &QEventLoop::quit);
+    QTimer::singleShot(0, &job, &SegmentRenderJob::start);
+    loop.exec();
+    REQUIRE(QFileInfo(target).size() > 0);
+    REQUIRE(frameCount(target) == out - in + 1);
+
+    // Decode the joined audio, it must last as long as the video: no segment boundary adds a gap or drops samples
+    const QString raw = dir.filePath(QStringLiteral("audio.raw"));
+    QProcess decode;
+    decode.start(ffmpeg, {QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-i"), target, QStringLiteral("-map"), QStringLiteral("0:a:0"),
+                          QStringLiteral("-ac"), QStringLiteral("1"), QStringLiteral("-ar"), QStringLiteral("48000"), QStringLiteral("-f"),
+                          QStringLiteral("s16le"), raw});
+    REQUIRE(decode.waitForFinished(30000));
+    REQUIRE(decode.exitCode() == 0);
+    const qint64 samples = QFileInfo(raw).size() / 2;
+    const qint64 expected = qint64(out - in + 1) * 48000 / fps;
+    // Encoder priming and padding may add less than a frame of samples
+    REQUIRE(qAbs(samples - expected) < 48000 / fps);
+}
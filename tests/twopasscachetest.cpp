@@ -0,0 +1,79 @@
+#include "catch.hpp"
+#include "renderer/twopasscache.h"
+
+#include <QDomDocument>
+
+TEST_CASE("Two pass intermediate playlists", "[TwoPassCache]")
+{
+    QDomDocument doc;
+    doc.setContent(QStringLiteral("<mlt><profile width=\"1920\" height=\"1080\" display_aspect_num=\"16\" display_aspect_den=\"9\" "
+                                  "sample_aspect_num=\"1\" sample_aspect_den=\"1\"/><producer id=\"black\"/><tractor id=\"main\"/>"
+                                  "<consumer mlt_service=\"avformat\" target=\"/tmp/out.mp4\" in=\"10\" out=\"109\" s=\"1280x720\" "
+                                  "vcodec=\"libx264\" pass=\"2\" passlogfile=\"/tmp/log\" ar=\"48000\"/></mlt>"));
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    REQUIRE(TwoPassCache::canCache(consumer));
+
+    // The intermediate is rendered at the output size, without the encoding parameters
+    QDomDocument cache = TwoPassCache::cachePlaylist(doc, QStringLiteral("/tmp/cache.mkv"));
+    QDomElement cacheConsumer = cache.documentElement().firstChildElement(QStringLiteral("consumer"));
+    REQUIRE(cacheConsumer.attribute(QStringLiteral("target")) == QLatin1String("/tmp/cache.mkv"));
+    REQUIRE(cacheConsumer.attribute(QStringLiteral("s")) == QLatin1String("1280x720"));
+    REQUIRE(cacheConsumer.attribute(QStringLiteral("in")) == QLatin1String("10"));
+    REQUIRE(cacheConsumer.attribute(QStringLiteral("ar")) == QLatin1String("48000"));
+    REQUIRE_FALSE(cacheConsumer.hasAttribute(QStringLiteral("pass")));
+    REQUIRE(cacheConsumer.attribute(QStringLiteral("vcodec")) != QLatin1String("libx264"));
+    REQUIRE(cache.documentElement().elementsByTagName(QStringLiteral("tractor")).count() == 1);
+
+    // Passes only read the intermediate, in a profile of its size
+    QDomDocument pass = TwoPassCache::passPlaylist(doc, QStringLiteral("/tmp/cache.mkv"));
+    QDomElement root = pass.documentElement();
+    REQUIRE(root.elementsByTagName(QStringLiteral("tractor")).isEmpty());
+    REQUIRE(root.elementsByTagName(QStringLiteral("producer")).count() == 1);
+    QDomElement passConsumer = root.firstChildElement(QStringLiteral("consumer"));
+    REQUIRE(passConsumer.attribute(QStringLiteral("in")) == QLatin1String("0"));
+    REQUIRE(passConsumer.attribute(QStringLiteral("out")) == QLatin1String("99"));
+    REQUIRE(passConsumer.attribute(QStringLiteral("pass")) == QLatin1String("2"));
+    REQUIRE_FALSE(passConsumer.hasAttribute(QStringLiteral("s")));
+    QDomElement profile = root.firstChildElement(QStringLiteral("profile"));
+    REQUIRE(profile.attribute(QStringLiteral("width")) == QLatin1String("1280"));
+    REQUIRE(profile.attribute(QStringLiteral("height")) == QLatin1String("720"));
+
+    // Frame rate conversions and image sequences are rendered from the timeline
+    consumer.setAttribute(QStringLiteral("r"), 50);
+    REQUIRE_FALSE(TwoPassCache::canCache(consumer));
+    consumer.removeAttribute(QStringLiteral("r"));
+    consumer.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/img-%05d.png"));
+    REQUIRE_FALSE(TwoPassCache::canCache(consumer));
+
+    // The intermediate size is estimated from the output size and audio layout: 100 frames at 1280x720 in 4:2:2, 4 seconds
+    // of 16 bit stereo at 48kHz with the default 25fps
+    REQUIRE(TwoPassCache::cacheSize(doc) == 100LL * 1280 * 720 * 2 + 4 * 48000 * 2 * 2);
+    consumer.setAttribute(QStringLiteral("an"), 1);
+    consumer.removeAttribute(QStringLiteral("s"));
+    REQUIRE(TwoPassCache::cacheSize(doc) == 100LL * 1920 * 1080 * 2);
+    consumer.removeAttribute(QStringLiteral("an"));
+
+    // The intermediate audio is as deep as the output's
+    auto cacheCodec = [&doc]() {
+        return TwoPassCache::cachePlaylist(doc, QStringLiteral("/tmp/cache.mkv"))
+            .documentElement()
+            .firstChildElement(QStringLiteral("consumer"))
+            .attribute(QStringLiteral("acodec"));
+    };
+    REQUIRE(cacheCodec() == QLatin1String("pcm_s16le"));
+    consumer.setAttribute(QStringLiteral("acodec"), QStringLiteral("pcm_s24le"));
+    REQUIRE(cacheCodec() == QLatin1String("pcm_s24le"));
+    REQUIRE(TwoPassCache::cacheSize(doc) == 100LL * 1920 * 1080 * 2 + 4 * 48000 * 2 * 3);
+    consumer.setAttribute(QStringLiteral("acodec"), QStringLiteral("flac"));
+    consumer.setAttribute(QStringLiteral("sample_fmt"), QStringLiteral("s32"));
+    REQUIRE(cacheCodec() == QLatin1String("pcm_s32le"));
+    consumer.setAttribute(QStringLiteral("acodec"), QStringLiteral("aac"));
+    consumer.removeAttribute(QStringLiteral("sample_fmt"));
+    REQUIRE(cacheCodec() == QLatin1String("pcm_f32le"));
+
+    // Pixel formats that ffvhuff cannot store are rendered from the timeline
+    consumer.setAttribute(QStringLiteral("pix_fmt"), QStringLiteral("yuv422p10le"));
+    REQUIRE(TwoPassCache::canCache(consumer));
+    consumer.setAttribute(QStringLiteral("pix_fmt"), QStringLiteral("nv12"));
+    REQUIRE_FALSE(TwoPassCache::canCache(consumer));
+}